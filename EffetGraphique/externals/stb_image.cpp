@@ -1,2 +1,4 @@
 #define STB_IMAGE_IMPLEMENTATION
+// Images are decoded on several threads (GL::DecodeImages): no failure reason written to a global
+#define STBI_NO_FAILURE_STRINGS
 #include <stb_image.h>
\ No newline at end of file
@@ -0,0 +1,591 @@
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "maths.h"
+#include "jobs.h"
+#include "obj_parser.h"
+#include "3ds_parser.h"
+
+using namespace Mesh;
+
+// .3ds chunks: [uint16_t Id][uint32_t Length (header included)][data][sub-chunks], little endian
+// Only the chunks below are read, the others (keyframes, lights, cameras...) are skipped with their length
+const uint16_t CHUNK_3DS_MAIN            = 0x4D4D;
+const uint16_t CHUNK_3DS_EDITOR          = 0x3D3D;
+const uint16_t CHUNK_3DS_OBJECT          = 0x4000; // Name + sub-chunks
+const uint16_t CHUNK_3DS_TRIMESH         = 0x4100;
+const uint16_t CHUNK_3DS_VERTICES        = 0x4110; // uint16_t Count, float[3] * Count
+const uint16_t CHUNK_3DS_FACES           = 0x4120; // uint16_t Count, uint16_t[4] * Count (3 indices + flags), sub-chunks
+const uint16_t CHUNK_3DS_FACE_MATERIAL   = 0x4130; // Material name, uint16_t Count, uint16_t Faces[Count]
+const uint16_t CHUNK_3DS_TEXCOORDS       = 0x4140; // uint16_t Count, float[2] * Count
+const uint16_t CHUNK_3DS_SMOOTHING       = 0x4150; // uint32_t group bits per face
+const uint16_t CHUNK_3DS_MATERIAL        = 0xAFFF;
+const uint16_t CHUNK_3DS_MATERIAL_NAME   = 0xA000;
+const uint16_t CHUNK_3DS_AMBIENT         = 0xA010;
+const uint16_t CHUNK_3DS_DIFFUSE         = 0xA020;
+const uint16_t CHUNK_3DS_SPECULAR        = 0xA030;
+const uint16_t CHUNK_3DS_SHININESS       = 0xA040;
+const uint16_t CHUNK_3DS_TEXTURE_MAP     = 0xA200;
+const uint16_t CHUNK_3DS_MAP_FILENAME    = 0xA300;
+const uint16_t CHUNK_3DS_COLOR_FLOAT     = 0x0010;
+const uint16_t CHUNK_3DS_COLOR_24        = 0x0011;
+const uint16_t CHUNK_3DS_PERCENT_INT     = 0x0030;
+const uint16_t CHUNK_3DS_PERCENT_FLOAT   = 0x0031;
+
+const int CHUNK_3DS_HEADER_SIZE = 6;
+
+struct chunk_3ds
+{
+    uint16_t Id;
+    const uint8_t* Begin; // After the header
+    const uint8_t* End;
+};
+
+// Faces of an object using a material
+struct face_material_3ds
+{
+    std::string Name;
+    const uint8_t* Faces; // uint16_t * FaceCount
+    int FaceCount;
+};
+
+// Triangle mesh of an object, arrays point inside the mapped file (unaligned)
+struct object_3ds
+{
+    const uint8_t* Positions;       // float[3] * VertexCount
+    const uint8_t* TexCoords;       // float[2] * VertexCount, null if missing
+    const uint8_t* Faces;           // uint16_t[4] * FaceCount
+    const uint8_t* SmoothingGroups; // uint32_t * FaceCount, null if missing (flat faces)
+    int VertexCount;
+    int FaceCount;
+    int FirstTriangle;
+    std::vector<face_material_3ds> FaceMaterials;
+};
+
+struct parser_3ds
+{
+    std::vector<object_3ds> Objects;
+    std::vector<mesh_material> Materials;
+    std::map<std::string, int> MaterialIds;
+    bool Truncated = false;
+};
+
+template<typename T>
+static T Read3ds(const uint8_t* Data)
+{
+    T Value;
+    memcpy(&Value, Data, sizeof(T));
+    return Value;
+}
+
+// Chunk at Cursor, false at the end of the parent or when the chunk overflows it (Truncated is set)
+static bool Read3dsChunk(const uint8_t** Cursor, const uint8_t* End, chunk_3ds* Chunk, bool* Truncated)
+{
+    if (End - *Cursor < CHUNK_3DS_HEADER_SIZE)
+    {
+        *Truncated = *Truncated || *Cursor != End;
+        return false;
+    }
+
+    uint32_t Length = Read3ds<uint32_t>(*Cursor + 2);
+    if (Length < (uint32_t)CHUNK_3DS_HEADER_SIZE || Length > (size_t)(End - *Cursor))
+    {
+        *Truncated = true;
+        return false;
+    }
+
+    Chunk->Id = Read3ds<uint16_t>(*Cursor);
+    Chunk->Begin = *Cursor + CHUNK_3DS_HEADER_SIZE;
+    Chunk->End = *Cursor + Length;
+    *Cursor = Chunk->End;
+    return true;
+}
+
+// Zero terminated string, returns the data after it (null if not terminated)
+static const uint8_t* Read3dsString(const uint8_t* Begin, const uint8_t* End, std::string* String)
+{
+    const uint8_t* Terminator = (const uint8_t*)memchr(Begin, 0, End - Begin);
+    if (Terminator == nullptr)
+        return nullptr;
+    String->assign((const char*)Begin, (const char*)Terminator);
+    return Terminator + 1;
+}
+
+// Array of Count elements of ElementSize bytes after a uint16_t count, null if it overflows the chunk
+static const uint8_t* Read3dsArray(const chunk_3ds& Chunk, int ElementSize, int* Count)
+{
+    if (Chunk.End - Chunk.Begin < 2)
+        return nullptr;
+    *Count = Read3ds<uint16_t>(Chunk.Begin);
+    if (Chunk.End - (Chunk.Begin + 2) < (ptrdiff_t)*Count * ElementSize)
+        return nullptr;
+    return Chunk.Begin + 2;
+}
+
+// First color of the chunk (the gamma corrected variants come after)
+static v3 Parse3dsColor(const chunk_3ds& Parent, parser_3ds& Parser)
+{
+    const uint8_t* Cursor = Parent.Begin;
+    chunk_3ds Chunk;
+    while (Read3dsChunk(&Cursor, Parent.End, &Chunk, &Parser.Truncated))
+    {
+        ptrdiff_t Size = Chunk.End - Chunk.Begin;
+        if (Chunk.Id == CHUNK_3DS_COLOR_24 && Size >= 3)
+            return { Chunk.Begin[0] / 255.f, Chunk.Begin[1] / 255.f, Chunk.Begin[2] / 255.f };
+        if (Chunk.Id == CHUNK_3DS_COLOR_FLOAT && Size >= 12)
+            return { Read3ds<float>(Chunk.Begin), Read3ds<float>(Chunk.Begin + 4), Read3ds<float>(Chunk.Begin + 8) };
+    }
+    return {};
+}
+
+static float Parse3dsPercent(const chunk_3ds& Parent, parser_3ds& Parser)
+{
+    const uint8_t* Cursor = Parent.Begin;
+    chunk_3ds Chunk;
+    while (Read3dsChunk(&Cursor, Parent.End, &Chunk, &Parser.Truncated))
+    {
+        ptrdiff_t Size = Chunk.End - Chunk.Begin;
+        if (Chunk.Id == CHUNK_3DS_PERCENT_INT && Size >= 2)
+            return (float)Read3ds<int16_t>(Chunk.Begin);
+        if (Chunk.Id == CHUNK_3DS_PERCENT_FLOAT && Size >= 4)
+            return Read3ds<float>(Chunk.Begin);
+    }
+    return 0.f;
+}
+
+static void Parse3dsMaterial(const chunk_3ds& Parent, parser_3ds& Parser)
+{
+    mesh_material Material = {};
+    std::string String;
+
+    const uint8_t* Cursor = Parent.Begin;
+    chunk_3ds Chunk;
+    while (Read3dsChunk(&Cursor, Parent.End, &Chunk, &Parser.Truncated))
+    {
+        switch (Chunk.Id)
+        {
+        case CHUNK_3DS_MATERIAL_NAME:
+            if (Read3dsString(Chunk.Begin, Chunk.End, &String))
+                snprintf(Material.Name, sizeof(Material.Name), "%s", String.c_str());
+            break;
+        case CHUNK_3DS_AMBIENT:  Material.Ambient = Parse3dsColor(Chunk, Parser);  break;
+        case CHUNK_3DS_DIFFUSE:  Material.Diffuse = Parse3dsColor(Chunk, Parser);  break;
+        case CHUNK_3DS_SPECULAR: Material.Specular = Parse3dsColor(Chunk, Parser); break;
+        // Percentage mapped to the 0-128 range of the .mtl exponent
+        case CHUNK_3DS_SHININESS: Material.Shininess = Parse3dsPercent(Chunk, Parser) * 1.28f; break;
+        case CHUNK_3DS_TEXTURE_MAP:
+        {
+            const uint8_t* MapCursor = Chunk.Begin;
+            chunk_3ds MapChunk;
+            while (Read3dsChunk(&MapCursor, Chunk.End, &MapChunk, &Parser.Truncated))
+            {
+                if (MapChunk.Id == CHUNK_3DS_MAP_FILENAME && Read3dsString(MapChunk.Begin, MapChunk.End, &String))
+                    snprintf(Material.DiffuseMap, sizeof(Material.DiffuseMap), "%s", String.c_str());
+            }
+        } break;
+        default: break;
+        }
+    }
+
+    // The first material of a name wins, like tinyobj
+    Parser.MaterialIds.insert({ Material.Name, (int)Parser.Materials.size() });
+    Parser.Materials.push_back(Material);
+}
+
+static void Parse3dsTrimesh(const chunk_3ds& Parent, parser_3ds& Parser)
+{
+    object_3ds Object = {};
+    int TexCoordCount = 0;
+
+    const uint8_t* Cursor = Parent.Begin;
+    chunk_3ds Chunk;
+    while (Read3dsChunk(&Cursor, Parent.End, &Chunk, &Parser.Truncated))
+    {
+        switch (Chunk.Id)
+        {
+        case CHUNK_3DS_VERTICES:
+            Object.Positions = Read3dsArray(Chunk, 3 * sizeof(float), &Object.VertexCount);
+            Parser.Truncated = Parser.Truncated || Object.Positions == nullptr;
+            break;
+        case CHUNK_3DS_TEXCOORDS:
+            Object.TexCoords = Read3dsArray(Chunk, 2 * sizeof(float), &TexCoordCount);
+            Parser.Truncated = Parser.Truncated || Object.TexCoords == nullptr;
+            break;
+        case CHUNK_3DS_FACES:
+        {
+            Object.Faces = Read3dsArray(Chunk, 4 * sizeof(uint16_t), &Object.FaceCount);
+            if (Object.Faces == nullptr)
+            {
+                Parser.Truncated = true;
+                break;
+            }
+
+            // Face sub-chunks follow the face list
+            const uint8_t* FaceCursor = Object.Faces + Object.FaceCount * 4 * sizeof(uint16_t);
+            chunk_3ds FaceChunk;
+            while (Read3dsChunk(&FaceCursor, Chunk.End, &FaceChunk, &Parser.Truncated))
+            {
+                if (FaceChunk.Id == CHUNK_3DS_FACE_MATERIAL)
+                {
+                    face_material_3ds FaceMaterial;
+                    chunk_3ds FaceList = FaceChunk;
+                    FaceList.Begin = Read3dsString(FaceChunk.Begin, FaceChunk.End, &FaceMaterial.Name);
+                    FaceMaterial.Faces = FaceList.Begin ? Read3dsArray(FaceList, sizeof(uint16_t), &FaceMaterial.FaceCount) : nullptr;
+                    if (FaceMaterial.Faces)
+                        Object.FaceMaterials.push_back(FaceMaterial);
+                    else
+                        Parser.Truncated = true;
+                }
+                else if (FaceChunk.Id == CHUNK_3DS_SMOOTHING)
+                {
+                    if (FaceChunk.End - FaceChunk.Begin >= (ptrdiff_t)Object.FaceCount * (ptrdiff_t)sizeof(uint32_t))
+                        Object.SmoothingGroups = FaceChunk.Begin;
+                    else
+                        Parser.Truncated = true;
+                }
+            }
+        } break;
+        default: break;
+        }
+    }
+
+    // UVs are per vertex
+    if (TexCoordCount < Object.VertexCount)
+        Object.TexCoords = nullptr;
+
+    if (Object.Positions && Object.Faces && Object.FaceCount > 0)
+        Parser.Objects.push_back(Object);
+}
+
+static void Parse3dsObject(const chunk_3ds& Parent, parser_3ds& Parser)
+{
+    std::string Name;
+    const uint8_t* Cursor = Read3dsString(Parent.Begin, Parent.End, &Name);
+    if (Cursor == nullptr)
+    {
+        Parser.Truncated = true;
+        return;
+    }
+
+    chunk_3ds Chunk;
+    while (Read3dsChunk(&Cursor, Parent.End, &Chunk, &Parser.Truncated))
+    {
+        if (Chunk.Id == CHUNK_3DS_TRIMESH)
+            Parse3dsTrimesh(Chunk, Parser);
+    }
+}
+
+// Expand the faces of an object to triangles, returns false on out of range indices
+// Corner normals are the sum of the face normals around the position sharing a smoothing group with the face
+static bool Build3dsObject(const object_3ds& Object, const parser_3ds& Parser, vertex_full* Triangles, int* TriangleMaterials)
+{
+    int VertexCount = Object.VertexCount;
+    int FaceCount = Object.FaceCount;
+
+    // Z up to Y up: (x, y, z) -> (x, z, -y) is a rotation, the winding is kept
+    std::vector<vertex_full> Vertices(VertexCount);
+    for (int i = 0; i < VertexCount; ++i)
+    {
+        const uint8_t* Position = Object.Positions + i * 3 * sizeof(float);
+        Vertices[i] = {};
+        Vertices[i].Position = { Read3ds<float>(Position), Read3ds<float>(Position + 8), -Read3ds<float>(Position + 4) };
+        if (Object.TexCoords)
+        {
+            const uint8_t* TexCoord = Object.TexCoords + i * 2 * sizeof(float);
+            Vertices[i].UV = { Read3ds<float>(TexCoord), Read3ds<float>(TexCoord + 4) };
+        }
+    }
+
+    // Corners and area weighted face normals
+    std::vector<uint32_t> Corners(FaceCount * 3);
+    std::vector<v3> FaceNormals(FaceCount);
+    std::vector<uint32_t> SmoothingGroups(FaceCount, 0);
+    for (int f = 0; f < FaceCount; ++f)
+    {
+        const uint8_t* Face = Object.Faces + f * 4 * sizeof(uint16_t);
+        for (int Corner = 0; Corner < 3; ++Corner)
+        {
+            Corners[f * 3 + Corner] = Read3ds<uint16_t>(Face + Corner * sizeof(uint16_t));
+            if (Corners[f * 3 + Corner] >= (uint32_t)VertexCount)
+                return false;
+        }
+
+        v3 P0 = Vertices[Corners[f * 3 + 0]].Position;
+        v3 P1 = Vertices[Corners[f * 3 + 1]].Position;
+        v3 P2 = Vertices[Corners[f * 3 + 2]].Position;
+        FaceNormals[f] = Vec3::Cross(P1 - P0, P2 - P0);
+
+        if (Object.SmoothingGroups)
+            SmoothingGroups[f] = Read3ds<uint32_t>(Object.SmoothingGroups + f * sizeof(uint32_t));
+    }
+
+    // Vertices split on UV seams share the faces around their position
+    std::vector<uint32_t> PositionIds;
+    BuildPositionRemap(PositionIds, Vertices.data(), VertexCount);
+
+    std::vector<int> AdjacencyOffsets(VertexCount + 1, 0);
+    for (int i = 0; i < FaceCount * 3; ++i)
+        AdjacencyOffsets[PositionIds[Corners[i]] + 1]++;
+    for (int v = 0; v < VertexCount; ++v)
+        AdjacencyOffsets[v + 1] += AdjacencyOffsets[v];
+    std::vector<int> AdjacentFaces(FaceCount * 3);
+    {
+        std::vector<int> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+        for (int i = 0; i < FaceCount * 3; ++i)
+            AdjacentFaces[Fill[PositionIds[Corners[i]]]++] = i / 3;
+    }
+
+    for (int f = 0; f < FaceCount; ++f)
+    {
+        for (int Corner = 0; Corner < 3; ++Corner)
+        {
+            uint32_t Vertex = Corners[f * 3 + Corner];
+            v3 Normal = FaceNormals[f];
+            if (SmoothingGroups[f] != 0)
+            {
+                Normal = {};
+                uint32_t Position = PositionIds[Vertex];
+                for (int a = AdjacencyOffsets[Position]; a < AdjacencyOffsets[Position + 1]; ++a)
+                {
+                    int Adjacent = AdjacentFaces[a];
+                    if (SmoothingGroups[Adjacent] & SmoothingGroups[f])
+                        Normal += FaceNormals[Adjacent];
+                }
+            }
+
+            vertex_full& Triangle = Triangles[(Object.FirstTriangle + f) * 3 + Corner];
+            Triangle = Vertices[Vertex];
+            float Length = Vec3::Length(Normal);
+            Triangle.Normal = Length > 0.f ? Normal / Length : v3 {};
+        }
+    }
+
+    for (int f = 0; f < FaceCount; ++f)
+        TriangleMaterials[Object.FirstTriangle + f] = -1;
+    for (const face_material_3ds& FaceMaterial : Object.FaceMaterials)
+    {
+        auto It = Parser.MaterialIds.find(FaceMaterial.Name);
+        int MaterialId = It != Parser.MaterialIds.end() ? It->second : -1;
+        for (int i = 0; i < FaceMaterial.FaceCount; ++i)
+        {
+            int Face = Read3ds<uint16_t>(FaceMaterial.Faces + i * sizeof(uint16_t));
+            if (Face < FaceCount)
+                TriangleMaterials[Object.FirstTriangle + Face] = MaterialId;
+        }
+    }
+
+    return true;
+}
+
+bool Mesh::Parse3ds(std::vector<vertex_full>& Triangles, std::vector<int>& TriangleMaterials, std::vector<mesh_material>& Materials,
+                    bool* HasTexCoords, const char* Filename)
+{
+    file_mapping File;
+    if (!File::Map(File, Filename))
+        return false;
+
+    const uint8_t* FileBegin = (const uint8_t*)File.Data;
+    const uint8_t* FileEnd = FileBegin + File.Size;
+
+    parser_3ds Parser;
+    chunk_3ds Main;
+    const uint8_t* Cursor = FileBegin;
+    if (!Read3dsChunk(&Cursor, FileEnd, &Main, &Parser.Truncated) || Main.Id != CHUNK_3DS_MAIN)
+    {
+        fprintf(stderr, "Not a .3ds file: %s\n", Filename);
+        File::Unmap(File);
+        return false;
+    }
+
+    // Materials and objects of the editor chunk, the sub-chunks are walked in place
+    Cursor = Main.Begin;
+    chunk_3ds Chunk;
+    while (Read3dsChunk(&Cursor, Main.End, &Chunk, &Parser.Truncated))
+    {
+        if (Chunk.Id != CHUNK_3DS_EDITOR)
+            continue;
+
+        const uint8_t* EditorCursor = Chunk.Begin;
+        chunk_3ds EditorChunk;
+        while (Read3dsChunk(&EditorCursor, Chunk.End, &EditorChunk, &Parser.Truncated))
+        {
+            if (EditorChunk.Id == CHUNK_3DS_MATERIAL)
+                Parse3dsMaterial(EditorChunk, Parser);
+            else if (EditorChunk.Id == CHUNK_3DS_OBJECT)
+                Parse3dsObject(EditorChunk, Parser);
+        }
+    }
+
+    if (Parser.Truncated)
+    {
+        fprintf(stderr, "Truncated .3ds file: %s\n", Filename);
+        File::Unmap(File);
+        return false;
+    }
+
+    // Objects write their triangles at the prefix sum of the face counts
+    int TriangleCount = 0;
+    *HasTexCoords = false;
+    for (object_3ds& Object : Parser.Objects)
+    {
+        Object.FirstTriangle = TriangleCount;
+        TriangleCount += Object.FaceCount;
+        *HasTexCoords = *HasTexCoords || Object.TexCoords != nullptr;
+    }
+    Triangles.resize(TriangleCount * 3);
+    TriangleMaterials.resize(TriangleCount);
+
+    std::atomic<bool> InvalidIndex(false);
+    Jobs::ParallelFor((int)Parser.Objects.size(), 1, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            if (!Build3dsObject(Parser.Objects[i], Parser, Triangles.data(), TriangleMaterials.data()))
+                InvalidIndex = true;
+        }
+    });
+
+    File::Unmap(File);
+
+    if (InvalidIndex)
+    {
+        fprintf(stderr, "Out of range indices in .3ds file: %s\n", Filename);
+        return false;
+    }
+
+    Materials.swap(Parser.Materials);
+    return true;
+}
+
+// .obj/.mtl conversion of parsed triangles (welded vertices, usemtl on material changes)
+static bool Write3dsAsObj(const std::string& ObjFilename, const std::string& MtlFilename, const std::vector<vertex_full>& Triangles,
+                          const std::vector<int>& TriangleMaterials, const std::vector<mesh_material>& Materials)
+{
+    FILE* Mtl = fopen(MtlFilename.c_str(), "w");
+    if (Mtl == nullptr)
+        return false;
+    for (const mesh_material& Material : Materials)
+    {
+        fprintf(Mtl, "newmtl %s\n", Material.Name);
+        fprintf(Mtl, "Ka %g %g %g\nKd %g %g %g\nKs %g %g %g\nNs %g\n", Material.Ambient.x, Material.Ambient.y, Material.Ambient.z,
+                Material.Diffuse.x, Material.Diffuse.y, Material.Diffuse.z, Material.Specular.x, Material.Specular.y, Material.Specular.z, Material.Shininess);
+        if (Material.DiffuseMap[0])
+            fprintf(Mtl, "map_Kd %s\n", Material.DiffuseMap);
+    }
+    fclose(Mtl);
+
+    FILE* Obj = fopen(ObjFilename.c_str(), "w");
+    if (Obj == nullptr)
+        return false;
+
+    indexed_mesh Mesh;
+    BuildIndexedMesh(Mesh, Triangles.data(), (int)Triangles.size());
+
+    fprintf(Obj, "mtllib %s\n", MtlFilename.substr(GetObjDirectory(MtlFilename.c_str()).size()).c_str());
+    for (const vertex_full& Vertex : Mesh.Vertices)
+        fprintf(Obj, "v %.9g %.9g %.9g\n", Vertex.Position.x, Vertex.Position.y, Vertex.Position.z);
+    for (const vertex_full& Vertex : Mesh.Vertices)
+        fprintf(Obj, "vt %.9g %.9g\n", Vertex.UV.x, Vertex.UV.y);
+    for (const vertex_full& Vertex : Mesh.Vertices)
+        fprintf(Obj, "vn %.9g %.9g %.9g\n", Vertex.Normal.x, Vertex.Normal.y, Vertex.Normal.z);
+
+    int Material = -1;
+    for (int t = 0; t < (int)TriangleMaterials.size(); ++t)
+    {
+        if (TriangleMaterials[t] != Material && TriangleMaterials[t] >= 0)
+            fprintf(Obj, "usemtl %s\n", Materials[TriangleMaterials[t]].Name);
+        Material = TriangleMaterials[t];
+
+        uint32_t I0 = Mesh.Indices[t * 3 + 0] + 1;
+        uint32_t I1 = Mesh.Indices[t * 3 + 1] + 1;
+        uint32_t I2 = Mesh.Indices[t * 3 + 2] + 1;
+        fprintf(Obj, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", I0, I0, I0, I1, I1, I1, I2, I2, I2);
+    }
+
+    bool Success = ferror(Obj) == 0;
+    fclose(Obj);
+    return Success;
+}
+
+void Mesh::Benchmark3dsParser(const char* Filename, int Iterations)
+{
+    typedef std::chrono::high_resolution_clock clock;
+
+    std::vector<vertex_full> Triangles;
+    std::vector<int> TriangleMaterials;
+    std::vector<mesh_material> Materials;
+    bool HasTexCoords = false;
+    if (!Parse3ds(Triangles, TriangleMaterials, Materials, &HasTexCoords, Filename))
+        return;
+
+    std::string ObjFilename = std::string(Filename) + ".benchmark.obj";
+    std::string MtlFilename = std::string(Filename) + ".benchmark.mtl";
+    if (!Write3dsAsObj(ObjFilename, MtlFilename, Triangles, TriangleMaterials, Materials))
+    {
+        fprintf(stderr, "Cannot write %s\n", ObjFilename.c_str());
+        remove(ObjFilename.c_str());
+        remove(MtlFilename.c_str());
+        return;
+    }
+
+    const char* ParserNames[3] = { ".3ds:", ".obj tinyobj:", ".obj parallel:" };
+    double BestTimes[3] = { 1e30, 1e30, 1e30 };
+    int TriangleCounts[3] = {};
+    bool SameMaterials[3] = { true, true, true };
+    bool Success[3] = {};
+
+    for (int i = 0; i < Iterations; ++i)
+    {
+        for (int Parser = 0; Parser < 3; ++Parser)
+        {
+            std::vector<vertex_full> Result;
+            std::vector<int> ResultMaterials;
+            std::vector<mesh_material> ResultMaterialList;
+            bool HasNormals = false;
+
+            clock::time_point Start = clock::now();
+            if (Parser == 0)
+                Success[Parser] = Parse3ds(Result, ResultMaterials, ResultMaterialList, &HasTexCoords, Filename);
+            else if (Parser == 1)
+                Success[Parser] = ParseObjTinyObj(Result, ResultMaterials, ResultMaterialList, &HasNormals, &HasTexCoords, ObjFilename.c_str());
+            else
+                Success[Parser] = ParseObjParallel(Result, ResultMaterials, ResultMaterialList, &HasNormals, &HasTexCoords, ObjFilename.c_str());
+            double Time = std::chrono::duration<double, std::milli>(clock::now() - Start).count();
+
+            BestTimes[Parser] = Math::Min(BestTimes[Parser], Time);
+            TriangleCounts[Parser] = (int)Result.size() / 3;
+            SameMaterials[Parser] = ResultMaterials == TriangleMaterials;
+        }
+    }
+
+    size_t ObjSize = 0;
+    file_mapping Obj;
+    if (File::Map(Obj, ObjFilename.c_str()))
+    {
+        ObjSize = Obj.Size;
+        File::Unmap(Obj);
+    }
+    remove(ObjFilename.c_str());
+    remove(MtlFilename.c_str());
+
+    printf("3ds parser benchmark: %s (%d triangles, %d materials, best of %d)\n", Filename, (int)TriangleMaterials.size(), (int)Materials.size(), Iterations);
+    printf("  .obj conversion: %.1f MB\n", ObjSize / (1024.0 * 1024.0));
+    printf("  %-14s %8.2f ms (%d threads)\n", ParserNames[0], BestTimes[0], Jobs::GetThreadCount());
+    for (int Parser = 1; Parser < 3; ++Parser)
+    {
+        if (!Success[Parser])
+        {
+            printf("  %-14s failed\n", ParserNames[Parser]);
+            continue;
+        }
+        printf("  %-14s %8.2f ms (.3ds x%.2f faster)%s\n", ParserNames[Parser], BestTimes[Parser], BestTimes[Parser] / BestTimes[0],
+               TriangleCounts[Parser] == TriangleCounts[0] && SameMaterials[Parser] ? "" : ", DIFFERENT triangles");
+    }
+}
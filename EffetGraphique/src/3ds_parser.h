@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+namespace Mesh
+{
+
+// Parse a binary .3ds as a list of triangles by walking the chunks of the memory mapped file (no text round-trip)
+// Same outputs as the .obj parsers: positions are converted from Z up to Y up, normals are built from the smoothing groups
+// and TriangleMaterials gets the index in Materials of each triangle (-1 without material)
+bool Parse3ds(std::vector<vertex_full>& Triangles, std::vector<int>& TriangleMaterials, std::vector<mesh_material>& Materials,
+              bool* HasTexCoords, const char* Filename);
+
+// Time the .3ds parser against both .obj parsers on an .obj conversion of the same model (temporary file next to the .3ds)
+void Benchmark3dsParser(const char* Filename, int Iterations);
+}
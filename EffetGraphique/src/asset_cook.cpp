@@ -0,0 +1,257 @@
+
+// asset_cook: offline conversion of media/ into gpu ready files listed in COOKED_MANIFEST_FILENAME
+// Run it from the same working directory as ibr.exe, then GL::cache loads the cooked files instead of decoding/parsing the sources
+//   - meshes: indexed, optimized mesh caches with clusters and LODs (see Mesh::MapObj), compressed per asset
+//     and the BVH next to the cache for the meshes picked by the demos (see Mesh::LoadBvh)
+//   - textures: decoded with the image flags of the demos, mip chain filtered offline in linear space (see Texture::GenerateMips)
+//   - cubemaps: the six faces decoded in GL face order in one file
+//   - textures and cubemaps loaded with IMG_COMPRESS: block compressed .dds instead (see Texture::MapCompressedCache)
+// With --pack (or --pack-lz4 to compress the entries), the manifest, cooked files and sources are also packed in ASSET_PACK_FILENAME
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "platform.h"
+#include "opengl_helpers.h"
+#include "mesh.h"
+#include "mesh_bvh.h"
+#include "obj_parser.h"
+#include "jobs.h"
+#include "cooked_assets.h"
+#include "texture_codec.h"
+#include "asset_pack.h"
+
+// Assets loaded by the demos, with the image flags they use
+// Mesh caches are compressed, the large scenes are also quantized (see --vertex-encodings for the error)
+struct mesh_recipe
+{
+    const char* Filename;
+    mesh_cache_encoding Encoding;
+    bool Bvh;              // Loaded with GL::MESH_LOAD_BVH
+};
+
+static const mesh_recipe MeshSources[] =
+{
+    { "media/ball.obj",             MESH_CACHE_COMPRESSED, false },
+    { "media/teapot.obj",           MESH_CACHE_COMPRESSED, false },
+    { "media/fantasy_game_inn.obj", MESH_CACHE_QUANTIZED,  true },
+    { "media/T-Rex/T-Rex.3ds",      MESH_CACHE_QUANTIZED,  false },
+};
+
+struct texture_recipe
+{
+    const char* Filename;
+    int ImageFlags;
+};
+
+static const texture_recipe TextureSources[] =
+{
+    { "media/fantasy_game_inn_diffuse.png",  IMG_FLIP | IMG_GEN_MIPMAPS | IMG_COMPRESS },
+    { "media/fantasy_game_inn_emissive.png", IMG_FLIP | IMG_GEN_MIPMAPS | IMG_COMPRESS },
+    { "media/roh.png",                       IMG_FLIP },
+};
+
+// Diffuse maps of the mesh materials
+static const int MATERIAL_IMAGE_FLAGS = IMG_FLIP | IMG_GEN_MIPMAPS | IMG_COMPRESS;
+
+static const char* const SkyboxFaces[6] =
+{
+    "media/skybox/skybox0.jpg", "media/skybox/skybox1.jpg", "media/skybox/skybox2.jpg",
+    "media/skybox/skybox3.jpg", "media/skybox/skybox4.jpg", "media/skybox/skybox5.jpg",
+};
+static const int SKYBOX_IMAGE_FLAGS = IMG_FORCE_RGB | IMG_COMPRESS;
+
+// Texture or cubemap to decode and write
+struct texture_job
+{
+    cooked_asset Asset;
+    bool Success;
+};
+
+static bool AddSources(cooked_asset& Asset, const std::vector<std::string>& Sources)
+{
+    for (const std::string& Source : Sources)
+    {
+        uint64_t Size = 0;
+        if (!File::GetSize(Source.c_str(), &Size))
+        {
+            fprintf(stderr, "Missing source: %s\n", Source.c_str());
+            return false;
+        }
+        Asset.Sources.push_back(Source);
+        Asset.SourceSizes.push_back(Size);
+    }
+    return true;
+}
+
+// Cooked file of a texture or cubemap (the faces are the sources)
+static std::string GetCookedTextureName(const cooked_asset& Asset)
+{
+    if (Asset.ImageFlags & IMG_COMPRESS)
+        return Texture::GetCompressedCacheName(Asset.Sources[0].c_str(), (int)Asset.Sources.size(), Asset.ImageFlags);
+    return Cook::GetTextureCacheName(Asset.Sources[0].c_str(), (int)Asset.Sources.size(), Asset.ImageFlags);
+}
+
+// Same files as the caches GL::cache builds from the sources, so they are reused until the sources change
+static bool CookTexture(const cooked_asset& Asset)
+{
+    std::vector<const char*> Filenames;
+    for (const std::string& Source : Asset.Sources)
+        Filenames.push_back(Source.c_str());
+
+    uint64_t SourceHash = 0;
+    if (!Texture::HashFiles(Filenames.data(), (int)Filenames.size(), &SourceHash))
+        return false;
+
+    if (Asset.ImageFlags & IMG_COMPRESS)
+    {
+        compressed_texture Compressed;
+        if (!Texture::MapCompressedCache(Compressed, Filenames.data(), (int)Filenames.size(), Asset.ImageFlags, SourceHash))
+            return false;
+        Texture::UnmapCompressedTexture(Compressed);
+        return true;
+    }
+
+    cooked_texture Cooked;
+    if (!Cook::MapTextureCache(Cooked, Filenames.data(), (int)Filenames.size(), Asset.ImageFlags, SourceHash))
+        return false;
+    Cook::UnmapCookedTexture(Cooked);
+    return true;
+}
+
+static void AddPackFile(std::vector<std::string>& Files, const std::string& File)
+{
+    if (std::find(Files.begin(), Files.end(), File) == Files.end())
+        Files.push_back(File);
+}
+
+int main(int argc, char* argv[])
+{
+    bool WritePack = argc == 2 && (strcmp(argv[1], "--pack") == 0 || strcmp(argv[1], "--pack-lz4") == 0);
+    bool CompressPack = WritePack && strcmp(argv[1], "--pack-lz4") == 0;
+
+    typedef std::chrono::high_resolution_clock clock;
+    clock::time_point Start = clock::now();
+
+    cooked_manifest Manifest;
+    std::vector<texture_job> TextureJobs;
+
+    // Meshes: MapObj rebuilds the cache when it is missing or stale, the cache is the cooked mesh
+    std::vector<std::string> MaterialMaps;
+    std::vector<std::string> BvhFiles;
+    for (const mesh_recipe& Recipe : MeshSources)
+    {
+        const char* Source = Recipe.Filename;
+        cooked_asset Asset = {};
+        Asset.Type = COOKED_MESH;
+        Asset.Cooked = std::string(Source) + ".cache";
+        mapped_mesh MappedMesh;
+        if (!AddSources(Asset, { Source }) || !Mesh::MapObj(MappedMesh, Source, Recipe.Encoding))
+        {
+            fprintf(stderr, "Cannot cook %s\n", Source);
+            continue;
+        }
+
+        // Material textures are cooked with the textures (once each)
+        std::string Directory = Mesh::GetObjDirectory(Source);
+        for (int i = 0; i < MappedMesh.MaterialCount; ++i)
+        {
+            std::string Map = MappedMesh.Materials[i].DiffuseMap;
+            uint64_t Size = 0;
+            if (!Map.empty() && File::GetSize((Directory + Map).c_str(), &Size) && std::find(MaterialMaps.begin(), MaterialMaps.end(), Directory + Map) == MaterialMaps.end())
+                MaterialMaps.push_back(Directory + Map);
+        }
+
+        // Built from the cooked cache, so that the loads of the cooked mesh find it up to date
+        mesh_bvh Bvh;
+        if (Recipe.Bvh && Mesh::LoadBvh(Bvh, Source, MappedMesh))
+            BvhFiles.push_back(std::string(Source) + ".bvh");
+
+        Mesh::UnmapObj(MappedMesh);
+        Manifest.Assets.push_back(Asset);
+    }
+
+    // Textures and cubemap, decoded in parallel
+    std::vector<texture_recipe> Textures(TextureSources, TextureSources + ARRAY_SIZE(TextureSources));
+    for (const std::string& Map : MaterialMaps)
+        Textures.push_back({ Map.c_str(), MATERIAL_IMAGE_FLAGS });
+
+    for (const texture_recipe& Texture : Textures)
+    {
+        texture_job Job = {};
+        Job.Asset.Type = COOKED_TEXTURE;
+        Job.Asset.ImageFlags = Texture.ImageFlags;
+        if (AddSources(Job.Asset, { Texture.Filename }))
+        {
+            Job.Asset.Cooked = GetCookedTextureName(Job.Asset);
+            TextureJobs.push_back(Job);
+        }
+    }
+
+    texture_job Skybox = {};
+    Skybox.Asset.Type = COOKED_CUBEMAP;
+    Skybox.Asset.ImageFlags = SKYBOX_IMAGE_FLAGS;
+    if (AddSources(Skybox.Asset, std::vector<std::string>(SkyboxFaces, SkyboxFaces + 6)))
+    {
+        Skybox.Asset.Cooked = GetCookedTextureName(Skybox.Asset);
+        TextureJobs.push_back(Skybox);
+    }
+
+    std::atomic<uint64_t> CookedSize(0);
+    Jobs::ParallelFor((int)TextureJobs.size(), 1, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            TextureJobs[i].Success = CookTexture(TextureJobs[i].Asset);
+            uint64_t Size = 0;
+            if (TextureJobs[i].Success && File::GetSize(TextureJobs[i].Asset.Cooked.c_str(), &Size))
+                CookedSize += Size;
+        }
+    });
+
+    int FailureCount = 0;
+    for (const texture_job& Job : TextureJobs)
+    {
+        if (Job.Success)
+            Manifest.Assets.push_back(Job.Asset);
+        else
+            fprintf(stderr, "Cannot cook %s\n", Job.Asset.Sources[0].c_str());
+        FailureCount += Job.Success ? 0 : 1;
+    }
+
+    if (!Cook::SaveManifest(Manifest, COOKED_MANIFEST_FILENAME))
+        return 1;
+
+    double Time = std::chrono::duration<double>(clock::now() - Start).count();
+    printf("Cooked %d assets (%d textures and cubemaps, %.1f MB) in %.2f s: %s\n",
+           (int)Manifest.Assets.size(), (int)TextureJobs.size() - FailureCount, CookedSize / (1024.0 * 1024.0), Time, COOKED_MANIFEST_FILENAME);
+
+    if (WritePack)
+    {
+        std::vector<std::string> PackFiles = { COOKED_MANIFEST_FILENAME };
+        for (const cooked_asset& Asset : Manifest.Assets)
+        {
+            AddPackFile(PackFiles, Asset.Cooked);
+            for (const std::string& Source : Asset.Sources)
+                AddPackFile(PackFiles, Source);
+        }
+        for (const std::string& BvhFile : BvhFiles)
+            AddPackFile(PackFiles, BvhFile);
+
+        if (!Pack::Write(ASSET_PACK_FILENAME, PackFiles, CompressPack))
+            return 1;
+
+        uint64_t PackSize = 0;
+        File::GetSize(ASSET_PACK_FILENAME, &PackSize);
+        Time = std::chrono::duration<double>(clock::now() - Start).count();
+        printf("Packed %d files (%.1f MB%s) in %.2f s: %s\n",
+               (int)PackFiles.size(), PackSize / (1024.0 * 1024.0), CompressPack ? ", LZ4" : "", Time, ASSET_PACK_FILENAME);
+    }
+
+    return FailureCount == 0 ? 0 : 1;
+}
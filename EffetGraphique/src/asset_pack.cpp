@@ -0,0 +1,383 @@
+
+#include <cstdio>
+#include <cstring>
+
+#include "asset_pack.h"
+
+const uint32_t ASSET_PACK_MAGIC = 'P' | ('A' << 8) | ('C' << 16) | ('K' << 24);
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint64_t PACK_ALIGNMENT = 4096;
+
+// LZ4 block format: sequences of literals and (offset, length) matches in a 64 KB window
+const int LZ4_MIN_MATCH = 4;
+const int LZ4_LAST_LITERALS = 5;   // The block ends with at least 5 literals
+const int LZ4_MATCH_LIMIT = 12;    // No match starts in the last 12 bytes
+const int LZ4_HASH_BITS = 16;
+const int LZ4_MAX_OFFSET = 65535;
+
+static uint32_t Read32(const uint8_t* Data)
+{
+    uint32_t Value;
+    memcpy(&Value, Data, sizeof(Value));
+    return Value;
+}
+
+static uint8_t* WriteLength(uint8_t* Dst, size_t Length)
+{
+    for (; Length >= 255; Length -= 255)
+        *Dst++ = 255;
+    *Dst++ = (uint8_t)Length;
+    return Dst;
+}
+
+static uint8_t* WriteSequence(uint8_t* Dst, const uint8_t* Literals, size_t LiteralCount, int Offset, size_t MatchLength)
+{
+    uint8_t* Token = Dst++;
+    *Token = (uint8_t)((LiteralCount < 15 ? LiteralCount : 15) << 4);
+    if (LiteralCount >= 15)
+        Dst = WriteLength(Dst, LiteralCount - 15);
+    memcpy(Dst, Literals, LiteralCount);
+    Dst += LiteralCount;
+
+    // Last sequence: literals only
+    if (Offset == 0)
+        return Dst;
+
+    *Dst++ = (uint8_t)(Offset & 0xFF);
+    *Dst++ = (uint8_t)(Offset >> 8);
+    MatchLength -= LZ4_MIN_MATCH;
+    *Token |= (uint8_t)(MatchLength < 15 ? MatchLength : 15);
+    if (MatchLength >= 15)
+        Dst = WriteLength(Dst, MatchLength - 15);
+    return Dst;
+}
+
+static size_t GetCompressBound(size_t Size)
+{
+    return Size + Size / 255 + 16;
+}
+
+// Greedy matching on a hash of 4 bytes, Dst must hold GetCompressBound(Size) bytes
+static size_t CompressLZ4(uint8_t* Dst, const uint8_t* Src, size_t Size)
+{
+    std::vector<int64_t> Table((size_t)1 << LZ4_HASH_BITS, -1);
+    uint8_t* Out = Dst;
+    const uint8_t* Anchor = Src;
+    const uint8_t* End = Src + Size;
+
+    if (Size > (size_t)LZ4_MATCH_LIMIT)
+    {
+        const uint8_t* MatchEnd = End - LZ4_LAST_LITERALS;
+        for (const uint8_t* In = Src; In < End - LZ4_MATCH_LIMIT; )
+        {
+            uint32_t Sequence = Read32(In);
+            uint32_t Hash = (Sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+            int64_t Candidate = Table[Hash];
+            Table[Hash] = In - Src;
+
+            if (Candidate < 0 || (In - Src) - Candidate > LZ4_MAX_OFFSET || Read32(Src + Candidate) != Sequence)
+            {
+                In++;
+                continue;
+            }
+
+            const uint8_t* Match = Src + Candidate;
+            size_t Length = LZ4_MIN_MATCH;
+            while (In + Length < MatchEnd && In[Length] == Match[Length])
+                Length++;
+
+            Out = WriteSequence(Out, Anchor, In - Anchor, (int)(In - Match), Length);
+            In += Length;
+            Anchor = In;
+        }
+    }
+
+    Out = WriteSequence(Out, Anchor, End - Anchor, 0, 0);
+    return Out - Dst;
+}
+
+static bool ReadLength(const uint8_t*& Src, const uint8_t* SrcEnd, size_t& Length)
+{
+    uint8_t Byte;
+    do
+    {
+        if (Src >= SrcEnd)
+            return false;
+        Byte = *Src++;
+        Length += Byte;
+    } while (Byte == 255);
+    return true;
+}
+
+// Bounds checked: a corrupted pack fails instead of writing out of Dst
+static bool DecompressLZ4(uint8_t* Dst, size_t DstSize, const uint8_t* Src, size_t SrcSize)
+{
+    uint8_t* Out = Dst;
+    uint8_t* OutEnd = Dst + DstSize;
+    const uint8_t* SrcEnd = Src + SrcSize;
+
+    while (Src < SrcEnd)
+    {
+        uint8_t Token = *Src++;
+        size_t LiteralCount = Token >> 4;
+        if (LiteralCount == 15 && !ReadLength(Src, SrcEnd, LiteralCount))
+            return false;
+        if (LiteralCount > (size_t)(SrcEnd - Src) || LiteralCount > (size_t)(OutEnd - Out))
+            return false;
+        memcpy(Out, Src, LiteralCount);
+        Out += LiteralCount;
+        Src += LiteralCount;
+
+        if (Src == SrcEnd)
+            break;
+
+        if (SrcEnd - Src < 2)
+            return false;
+        size_t Offset = Src[0] | (Src[1] << 8);
+        Src += 2;
+        size_t Length = Token & 15;
+        if (Length == 15 && !ReadLength(Src, SrcEnd, Length))
+            return false;
+        Length += LZ4_MIN_MATCH;
+        if (Offset == 0 || Offset > (size_t)(Out - Dst) || Length > (size_t)(OutEnd - Out))
+            return false;
+
+        // Overlapping copies repeat the last Offset bytes
+        const uint8_t* Match = Out - Offset;
+        if (Offset >= Length)
+            memcpy(Out, Match, Length);
+        else
+        {
+            for (size_t i = 0; i < Length; ++i)
+                Out[i] = Match[i];
+        }
+        Out += Length;
+    }
+
+    return Out == OutEnd;
+}
+
+// Skip "./" prefixes and read '\' as '/', so paths built by the demos on any platform match
+static const char* SkipPathPrefix(const char* Path)
+{
+    while (Path[0] == '.' && (Path[1] == '/' || Path[1] == '\\'))
+        Path += 2;
+    return Path;
+}
+
+static char NormalizePathChar(char C)
+{
+    return C == '\\' ? '/' : C;
+}
+
+// FNV-1a on the normalized path
+static uint64_t HashPath(const char* Path)
+{
+    uint64_t Hash = 14695981039346656037ull;
+    for (Path = SkipPathPrefix(Path); *Path; ++Path)
+    {
+        Hash ^= (uint8_t)NormalizePathChar(*Path);
+        Hash *= 1099511628211ull;
+    }
+    return Hash;
+}
+
+static bool MatchPath(const char* Path, const char* Name, uint32_t NameLength)
+{
+    Path = SkipPathPrefix(Path);
+    for (uint32_t i = 0; i < NameLength; ++i, ++Path)
+    {
+        if (*Path == '\0' || NormalizePathChar(*Path) != Name[i])
+            return false;
+    }
+    return *Path == '\0';
+}
+
+static bool WritePadding(FILE* File, uint64_t& Offset)
+{
+    static const uint8_t Zeros[PACK_ALIGNMENT] = {};
+    size_t PaddingSize = (size_t)((PACK_ALIGNMENT - Offset % PACK_ALIGNMENT) % PACK_ALIGNMENT);
+    Offset += PaddingSize;
+    return fwrite(Zeros, 1, PaddingSize, File) == PaddingSize;
+}
+
+bool Pack::Write(const char* Filename, const std::vector<std::string>& Files, bool Compress)
+{
+    FILE* File = fopen(Filename, "wb");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write pack: %s\n", Filename);
+        return false;
+    }
+
+    pack_header Header = {};
+    Header.Magic = ASSET_PACK_MAGIC;
+    Header.Version = ASSET_PACK_VERSION;
+    bool Success = fwrite(&Header, sizeof(Header), 1, File) == 1;
+    uint64_t Offset = sizeof(Header);
+
+    std::vector<pack_entry> Entries;
+    std::string Names;
+    std::vector<uint8_t> Compressed;
+    for (const std::string& Path : Files)
+    {
+        std::string Name = SkipPathPrefix(Path.c_str());
+        for (char& C : Name)
+            C = NormalizePathChar(C);
+
+        file_mapping Mapping;
+        if (!File::Map(Mapping, Path.c_str()))
+        {
+            fprintf(stderr, "Cannot pack %s\n", Path.c_str());
+            Success = false;
+            continue;
+        }
+
+        pack_entry Entry = {};
+        Entry.PathHash = HashPath(Name.c_str());
+        Entry.Size = Mapping.Size;
+        Entry.NameOffset = (uint32_t)Names.size();
+        Entry.NameLength = (uint32_t)Name.size();
+        Names += Name;
+
+        const void* Data = Mapping.Data;
+        Entry.StoredSize = Mapping.Size;
+        Entry.Compression = PACK_STORED;
+        if (Compress)
+        {
+            Compressed.resize(GetCompressBound(Mapping.Size));
+            size_t CompressedSize = CompressLZ4(Compressed.data(), (const uint8_t*)Mapping.Data, Mapping.Size);
+            if (CompressedSize < Mapping.Size - Mapping.Size / 8)
+            {
+                Data = Compressed.data();
+                Entry.StoredSize = CompressedSize;
+                Entry.Compression = PACK_LZ4;
+            }
+        }
+
+        Success = Success && WritePadding(File, Offset);
+        Entry.Offset = Offset;
+        Success = Success && fwrite(Data, 1, (size_t)Entry.StoredSize, File) == Entry.StoredSize;
+        Offset += Entry.StoredSize;
+        File::Unmap(Mapping);
+        Entries.push_back(Entry);
+    }
+
+    // Directory
+    uint32_t SlotCount = 16;
+    while (SlotCount < Entries.size() * 2)
+        SlotCount *= 2;
+    std::vector<uint32_t> Slots(SlotCount, 0);
+    for (size_t i = 0; i < Entries.size(); ++i)
+    {
+        uint32_t Slot = (uint32_t)Entries[i].PathHash & (SlotCount - 1);
+        while (Slots[Slot] != 0)
+            Slot = (Slot + 1) & (SlotCount - 1);
+        Slots[Slot] = (uint32_t)i + 1;
+    }
+
+    Success = Success && WritePadding(File, Offset);
+    Header.EntryCount = (uint32_t)Entries.size();
+    Header.SlotCount = SlotCount;
+    Header.EntriesOffset = Offset;
+    Header.SlotsOffset = Header.EntriesOffset + Entries.size() * sizeof(pack_entry);
+    Header.NamesOffset = Header.SlotsOffset + Slots.size() * sizeof(uint32_t);
+    if (!Entries.empty())
+        Success = Success && fwrite(Entries.data(), sizeof(pack_entry), Entries.size(), File) == Entries.size();
+    Success = Success && fwrite(Slots.data(), sizeof(uint32_t), Slots.size(), File) == Slots.size();
+    Success = Success && fwrite(Names.data(), 1, Names.size(), File) == Names.size();
+
+    Success = Success && fseek(File, 0, SEEK_SET) == 0 && fwrite(&Header, sizeof(Header), 1, File) == 1;
+    Success = ferror(File) == 0 && Success;
+    fclose(File);
+    return Success;
+}
+
+bool Pack::Open(asset_pack& Pack, const char* Filename)
+{
+    Pack = {};
+    if (!File::Map(Pack.Mapping, Filename))
+        return false;
+
+    const uint8_t* Data = (const uint8_t*)Pack.Mapping.Data;
+    uint64_t Size = Pack.Mapping.Size;
+    const pack_header& Header = *(const pack_header*)Data;
+    const char* Error = nullptr;
+    if (Size < sizeof(pack_header) || Header.Magic != ASSET_PACK_MAGIC)
+        Error = "not an asset pack";
+    else if (Header.Version != ASSET_PACK_VERSION)
+        Error = "version mismatch";
+    else if (Header.SlotCount == 0 || (Header.SlotCount & (Header.SlotCount - 1)) != 0 || Header.SlotCount < Header.EntryCount * 2ull
+          || Header.EntriesOffset % sizeof(uint64_t) != 0
+          || Header.SlotsOffset != Header.EntriesOffset + (uint64_t)Header.EntryCount * sizeof(pack_entry)
+          || Header.NamesOffset != Header.SlotsOffset + (uint64_t)Header.SlotCount * sizeof(uint32_t) || Header.NamesOffset > Size)
+        Error = "invalid directory";
+
+    if (Error == nullptr)
+    {
+        Pack.Header = &Header;
+        Pack.Entries = (const pack_entry*)(Data + Header.EntriesOffset);
+        Pack.Slots = (const uint32_t*)(Data + Header.SlotsOffset);
+        Pack.Names = (const char*)(Data + Header.NamesOffset);
+
+        // Checked once here, so Find and GetData trust the directory
+        for (uint32_t i = 0; i < Header.EntryCount && Error == nullptr; ++i)
+        {
+            const pack_entry& Entry = Pack.Entries[i];
+            if (Entry.Offset > Size || Entry.StoredSize > Size - Entry.Offset || Header.NamesOffset + Entry.NameOffset + Entry.NameLength > Size
+             || (Entry.Compression != PACK_STORED && Entry.Compression != PACK_LZ4) || (Entry.Compression == PACK_STORED && Entry.StoredSize != Entry.Size))
+                Error = "invalid entry";
+        }
+        for (uint32_t i = 0; i < Header.SlotCount && Error == nullptr; ++i)
+        {
+            if (Pack.Slots[i] > Header.EntryCount)
+                Error = "invalid slot";
+        }
+    }
+
+    if (Error)
+    {
+        fprintf(stderr, "Invalid asset pack %s (%s)\n", Filename, Error);
+        File::Unmap(Pack.Mapping);
+        Pack = {};
+        return false;
+    }
+    return true;
+}
+
+void Pack::Close(asset_pack& Pack)
+{
+    File::Unmap(Pack.Mapping);
+    Pack = {};
+}
+
+const pack_entry* Pack::Find(const asset_pack& Pack, const char* Path)
+{
+    if (Pack.Header == nullptr)
+        return nullptr;
+
+    uint64_t Hash = HashPath(Path);
+    uint32_t Mask = Pack.Header->SlotCount - 1;
+    for (uint32_t Slot = (uint32_t)Hash & Mask; Pack.Slots[Slot] != 0; Slot = (Slot + 1) & Mask)
+    {
+        const pack_entry& Entry = Pack.Entries[Pack.Slots[Slot] - 1];
+        if (Entry.PathHash == Hash && MatchPath(Path, Pack.Names + Entry.NameOffset, Entry.NameLength))
+            return &Entry;
+    }
+    return nullptr;
+}
+
+const uint8_t* Pack::GetData(const asset_pack& Pack, const pack_entry& Entry)
+{
+    return (const uint8_t*)Pack.Mapping.Data + Entry.Offset;
+}
+
+bool Pack::Decompress(const asset_pack& Pack, const pack_entry& Entry, uint8_t* Dst)
+{
+    if (Entry.Compression == PACK_STORED)
+    {
+        memcpy(Dst, GetData(Pack, Entry), (size_t)Entry.Size);
+        return true;
+    }
+    return DecompressLZ4(Dst, (size_t)Entry.Size, GetData(Pack, Entry), (size_t)Entry.StoredSize);
+}
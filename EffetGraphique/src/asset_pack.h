@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_mapping.h"
+
+// Pack written by asset_cook --pack and mounted by ibr at startup (see File::MountPack)
+const char* const ASSET_PACK_FILENAME = "media.pack";
+
+// Layout: header, entry data (each entry starts on a 4 KB boundary), then the directory:
+// entries, hash slots and the path names
+struct pack_header
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint32_t SlotCount;       // Power of 2, at least twice EntryCount
+    uint64_t EntriesOffset;   // pack_entry[EntryCount]
+    uint64_t SlotsOffset;     // uint32_t[SlotCount]: entry index + 1, 0 for empty slots (linear probing)
+    uint64_t NamesOffset;     // Paths, not null terminated
+    uint64_t Padding;
+};
+
+enum pack_compression
+{
+    PACK_STORED,
+    PACK_LZ4,    // LZ4 block format, kept only when it saves more than 1/8 of the entry
+};
+
+struct pack_entry
+{
+    uint64_t PathHash;
+    uint64_t Offset;     // From the start of the pack, aligned on PACK_ALIGNMENT
+    uint64_t Size;       // Uncompressed
+    uint64_t StoredSize;
+    uint32_t NameOffset; // From NamesOffset
+    uint32_t NameLength;
+    uint32_t Compression;
+    uint32_t Padding;
+};
+
+struct asset_pack
+{
+    file_mapping Mapping;
+    const pack_header* Header;
+    const pack_entry* Entries;
+    const uint32_t* Slots;
+    const char* Names;
+};
+
+namespace Pack
+{
+
+// Pack Files (paths relative to the working directory) into Filename
+bool Write(const char* Filename, const std::vector<std::string>& Files, bool Compress);
+
+bool Open(asset_pack& Pack, const char* Filename);
+void Close(asset_pack& Pack);
+// Entry of Path ('\' and '/' are the same, "./" prefixes are ignored) in O(1), nullptr if it isn't in the pack
+const pack_entry* Find(const asset_pack& Pack, const char* Path);
+// Data of a stored entry in the pack mapping
+const uint8_t* GetData(const asset_pack& Pack, const pack_entry& Entry);
+// Decompress an entry to Dst (Entry.Size bytes)
+bool Decompress(const asset_pack& Pack, const pack_entry& Entry, uint8_t* Dst);
+}
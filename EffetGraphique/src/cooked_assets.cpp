@@ -0,0 +1,330 @@
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "maths.h"
+#include "json.h"
+#include "opengl_helpers.h"
+#include "texture_mips.h"
+#include "cooked_assets.h"
+
+const uint32_t COOKED_TEXTURE_MAGIC = 'C' | ('T' << 8) | ('E' << 16) | ('X' << 24);
+const uint32_t COOKED_TEXTURE_VERSION = 2; // 2: mips filtered in linear space, source hash
+const int COOKED_MANIFEST_VERSION = 1;
+
+static int GetCookedRowSize(int Width, int Channels)
+{
+    return (Width * Channels + 3) & ~3;
+}
+
+static int GetCookedLevelCount(int Width, int Height)
+{
+    int LevelCount = 1;
+    while (Width > 1 || Height > 1)
+    {
+        Width = Width > 1 ? Width / 2 : 1;
+        Height = Height > 1 ? Height / 2 : 1;
+        LevelCount++;
+    }
+    return LevelCount;
+}
+
+static uint64_t GetCookedFaceSize(const cooked_texture_header& Header)
+{
+    uint64_t Size = 0;
+    int Width = (int)Header.Width;
+    int Height = (int)Header.Height;
+    for (uint32_t Level = 0; Level < Header.LevelCount; ++Level)
+    {
+        Size += (uint64_t)GetCookedRowSize(Width, Header.Channels) * Height;
+        Width = Width > 1 ? Width / 2 : 1;
+        Height = Height > 1 ? Height / 2 : 1;
+    }
+    return Size;
+}
+
+bool Cook::WriteCookedTexture(const char* Filename, const uint8_t* const* Faces, int FaceCount, int Width, int Height, int Channels, int ImageFlags, bool Mipmaps,
+                              uint64_t SourceHash)
+{
+    cooked_texture_header Header = {};
+    Header.Magic = COOKED_TEXTURE_MAGIC;
+    Header.Version = COOKED_TEXTURE_VERSION;
+    Header.Width = (uint32_t)Width;
+    Header.Height = (uint32_t)Height;
+    Header.Channels = (uint32_t)Channels;
+    Header.FaceCount = (uint32_t)FaceCount;
+    Header.LevelCount = Mipmaps ? (uint32_t)GetCookedLevelCount(Width, Height) : 1;
+    Header.ImageFlags = (uint32_t)ImageFlags;
+    Header.DataSize = GetCookedFaceSize(Header) * FaceCount;
+    Header.SourceHash = SourceHash;
+
+    FILE* File = fopen(Filename, "wb");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write cooked texture: %s\n", Filename);
+        return false;
+    }
+    fwrite(&Header, sizeof(Header), 1, File);
+
+    std::vector<uint8_t> Level;
+    std::vector<std::vector<uint8_t>> Mips;
+    for (int Face = 0; Face < FaceCount; ++Face)
+    {
+        // Level 0 with aligned rows
+        int RowSize = GetCookedRowSize(Width, Channels);
+        Level.assign((size_t)RowSize * Height, 0);
+        for (int y = 0; y < Height; ++y)
+            memcpy(&Level[(size_t)y * RowSize], Faces[Face] + (size_t)y * Width * Channels, (size_t)Width * Channels);
+        fwrite(Level.data(), 1, Level.size(), File);
+
+        Texture::GenerateMips(Mips, Faces[Face], Width * Channels, Width, Height, Channels, (int)Header.LevelCount, !(ImageFlags & IMG_LINEAR));
+        for (const std::vector<uint8_t>& Mip : Mips)
+            fwrite(Mip.data(), 1, Mip.size(), File);
+    }
+
+    bool Success = ferror(File) == 0;
+    fclose(File);
+    return Success;
+}
+
+bool Cook::MapCookedTexture(cooked_texture& Texture, const char* Filename)
+{
+    Texture = {};
+    if (!File::Map(Texture.Mapping, Filename))
+        return false;
+
+    const cooked_texture_header& Header = *(const cooked_texture_header*)Texture.Mapping.Data;
+    const char* Error = nullptr;
+    if (Texture.Mapping.Size < sizeof(cooked_texture_header) || Header.Magic != COOKED_TEXTURE_MAGIC)
+        Error = "not a cooked texture";
+    else if (Header.Version != COOKED_TEXTURE_VERSION)
+        Error = "version mismatch";
+    else if (Header.Width == 0 || Header.Height == 0 || Header.Channels < 1 || Header.Channels > 4 || (Header.FaceCount != 1 && Header.FaceCount != 6)
+          || Header.LevelCount < 1 || Header.LevelCount > (uint32_t)GetCookedLevelCount(Header.Width, Header.Height))
+        Error = "invalid header";
+    else if (Header.DataSize != GetCookedFaceSize(Header) * Header.FaceCount || sizeof(cooked_texture_header) + Header.DataSize > Texture.Mapping.Size)
+        Error = "truncated data";
+
+    if (Error)
+    {
+        fprintf(stderr, "Invalid cooked texture %s (%s)\n", Filename, Error);
+        File::Unmap(Texture.Mapping);
+        return false;
+    }
+
+    Texture.Header = &Header;
+    return true;
+}
+
+void Cook::UnmapCookedTexture(cooked_texture& Texture)
+{
+    File::Unmap(Texture.Mapping);
+    Texture = {};
+}
+
+std::string Cook::GetTextureCacheName(const char* Filename, int FaceCount, int ImageFlags)
+{
+    return std::string(Filename) + (FaceCount == 6 ? ".cubemap." : ".") + std::to_string(ImageFlags) + ".tex";
+}
+
+bool Cook::MapValidTextureCache(cooked_texture& Texture, const char* Filename, int FaceCount, int ImageFlags, uint64_t SourceHash)
+{
+    std::string CacheName = GetTextureCacheName(Filename, FaceCount, ImageFlags);
+    uint64_t CacheSize = 0;
+    if (File::GetSize(CacheName.c_str(), &CacheSize) && MapCookedTexture(Texture, CacheName.c_str()))
+    {
+        const cooked_texture_header& Header = *Texture.Header;
+        if (Header.SourceHash == SourceHash && (int)Header.FaceCount == FaceCount && Header.ImageFlags == (uint32_t)ImageFlags)
+            return true;
+        UnmapCookedTexture(Texture);
+    }
+    return false;
+}
+
+bool Cook::MapTextureCache(cooked_texture& Texture, const char* const* Filenames, int FaceCount, int ImageFlags, uint64_t SourceHash,
+                           const GL::image* Images)
+{
+    if (MapValidTextureCache(Texture, Filenames[0], FaceCount, ImageFlags, SourceHash))
+        return true;
+    std::string CacheName = GetTextureCacheName(Filenames[0], FaceCount, ImageFlags);
+
+    // Cubemap faces are decoded together, they must match
+    std::vector<GL::image> Decoded;
+    bool Success = true;
+    if (!Images)
+    {
+        Decoded.resize(FaceCount);
+        Success = GL::DecodeImages(Decoded.data(), Filenames, FaceCount, ImageFlags);
+        Images = Decoded.data();
+    }
+    std::vector<const uint8_t*> Faces;
+    for (int i = 0; i < FaceCount && Success; ++i)
+    {
+        Success = Images[i].Width == Images[0].Width && Images[i].Height == Images[0].Height && Images[i].Channels == Images[0].Channels;
+        Faces.push_back(Images[i].Data);
+    }
+
+    if (Success)
+    {
+        typedef std::chrono::steady_clock clock;
+        clock::time_point Start = clock::now();
+        const GL::image& Image = Images[0];
+        Success = WriteCookedTexture(CacheName.c_str(), Faces.data(), FaceCount, Image.Width, Image.Height, Image.Channels, ImageFlags,
+                                     (ImageFlags & IMG_GEN_MIPMAPS) != 0, SourceHash)
+               && MapCookedTexture(Texture, CacheName.c_str());
+        if (Success)
+        {
+            printf("Cooked texture: %s (%d levels in %.0f ms)\n", CacheName.c_str(), (int)Texture.Header->LevelCount,
+                   std::chrono::duration<double, std::milli>(clock::now() - Start).count());
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Cannot cook %s\n", Filenames[0]);
+    }
+
+    for (GL::image& Image : Decoded)
+    {
+        if (Image.Data)
+            GL::FreeImage(Image);
+    }
+    return Success;
+}
+
+const uint8_t* Cook::GetCookedLevel(const cooked_texture& Texture, int Face, int Level, int* Width, int* Height)
+{
+    const cooked_texture_header& Header = *Texture.Header;
+    const uint8_t* Data = (const uint8_t*)Texture.Mapping.Data + sizeof(cooked_texture_header) + GetCookedFaceSize(Header) * Face;
+
+    int LevelWidth = (int)Header.Width;
+    int LevelHeight = (int)Header.Height;
+    for (int l = 0; l < Level; ++l)
+    {
+        Data += (size_t)GetCookedRowSize(LevelWidth, Header.Channels) * LevelHeight;
+        LevelWidth = LevelWidth > 1 ? LevelWidth / 2 : 1;
+        LevelHeight = LevelHeight > 1 ? LevelHeight / 2 : 1;
+    }
+
+    *Width = LevelWidth;
+    *Height = LevelHeight;
+    return Data;
+}
+
+static const char* GetCookedTypeName(cooked_asset_type Type)
+{
+    switch (Type)
+    {
+    case COOKED_MESH:    return "mesh";
+    case COOKED_TEXTURE: return "texture";
+    case COOKED_CUBEMAP: return "cubemap";
+    default:             return "";
+    }
+}
+
+bool Cook::LoadManifest(cooked_manifest& Manifest, const char* Filename)
+{
+    Manifest = {};
+
+    file_mapping Mapping;
+    if (!File::Map(Mapping, Filename))
+        return false;
+
+    std::vector<json_node> Json;
+    std::string Error;
+    bool Success = Json::Parse(Json, (const char*)Mapping.Data, Mapping.Size, &Error);
+    File::Unmap(Mapping);
+    if (!Success || Json::GetInt(Json, Json::Find(Json, 0, "version"), 0) != COOKED_MANIFEST_VERSION)
+    {
+        fprintf(stderr, "Ignoring cooked manifest %s (%s)\n", Filename, Success ? "version mismatch" : Error.c_str());
+        return false;
+    }
+
+    std::vector<int> Assets, Sources;
+    Json::GetChildren(Json, Json::Find(Json, 0, "assets"), Assets);
+    for (int AssetNode : Assets)
+    {
+        cooked_asset Asset = {};
+        const char* TypeName = Json::GetString(Json, Json::Find(Json, AssetNode, "type"), "");
+        for (int Type = COOKED_MESH; Type <= COOKED_CUBEMAP; ++Type)
+        {
+            if (strcmp(TypeName, GetCookedTypeName((cooked_asset_type)Type)) == 0)
+                Asset.Type = (cooked_asset_type)Type;
+        }
+        Asset.ImageFlags = Json::GetInt(Json, Json::Find(Json, AssetNode, "flags"), 0);
+        Asset.Cooked = Json::GetString(Json, Json::Find(Json, AssetNode, "cooked"), "");
+
+        Json::GetChildren(Json, Json::Find(Json, AssetNode, "sources"), Sources);
+        for (int SourceNode : Sources)
+        {
+            Asset.Sources.push_back(Json::GetString(Json, Json::Find(Json, SourceNode, "file"), ""));
+            Asset.SourceSizes.push_back((uint64_t)Json::GetNumber(Json, Json::Find(Json, SourceNode, "size"), 0.0));
+        }
+
+        if (!Asset.Sources.empty() && !Asset.Cooked.empty())
+            Manifest.Assets.push_back(Asset);
+    }
+    return true;
+}
+
+static void WriteJsonString(FILE* File, const std::string& String)
+{
+    fputc('"', File);
+    for (char C : String)
+    {
+        if (C == '"' || C == '\\')
+            fputc('\\', File);
+        fputc(C, File);
+    }
+    fputc('"', File);
+}
+
+bool Cook::SaveManifest(const cooked_manifest& Manifest, const char* Filename)
+{
+    FILE* File = fopen(Filename, "wb");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write manifest: %s\n", Filename);
+        return false;
+    }
+
+    fprintf(File, "{\n  \"version\": %d,\n  \"assets\": [", COOKED_MANIFEST_VERSION);
+    for (size_t i = 0; i < Manifest.Assets.size(); ++i)
+    {
+        const cooked_asset& Asset = Manifest.Assets[i];
+        fprintf(File, "%s\n    { \"type\": \"%s\", \"flags\": %d, \"cooked\": ", i > 0 ? "," : "", GetCookedTypeName(Asset.Type), Asset.ImageFlags);
+        WriteJsonString(File, Asset.Cooked);
+        fprintf(File, ", \"sources\": [");
+        for (size_t s = 0; s < Asset.Sources.size(); ++s)
+        {
+            fprintf(File, "%s{ \"file\": ", s > 0 ? ", " : "");
+            WriteJsonString(File, Asset.Sources[s]);
+            fprintf(File, ", \"size\": %llu }", (unsigned long long)Asset.SourceSizes[s]);
+        }
+        fprintf(File, "] }");
+    }
+    fprintf(File, "\n  ]\n}\n");
+
+    bool Success = ferror(File) == 0;
+    fclose(File);
+    return Success;
+}
+
+const char* Cook::FindCooked(const cooked_manifest& Manifest, cooked_asset_type Type, const char* Source, int ImageFlags)
+{
+    for (const cooked_asset& Asset : Manifest.Assets)
+    {
+        if (Asset.Type != Type || Asset.Sources[0] != Source || (Type != COOKED_MESH && Asset.ImageFlags != ImageFlags))
+            continue;
+
+        // Missing sources are fine (cooked assets shipped alone)
+        for (size_t s = 0; s < Asset.Sources.size(); ++s)
+        {
+            uint64_t Size = 0;
+            if (File::GetSize(Asset.Sources[s].c_str(), &Size) && Size != Asset.SourceSizes[s])
+                return nullptr;
+        }
+        return Asset.Cooked.c_str();
+    }
+    return nullptr;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_mapping.h"
+
+namespace GL { struct image; }
+
+// Manifest written by asset_cook and read by GL::cache (paths relative to the working directory, like the demos)
+const char* const COOKED_MANIFEST_FILENAME = "media/cooked.json";
+
+// Texture decoded, converted and mipmapped offline: each level is stored as glTexImage2D reads it
+// (rows aligned on 4 bytes, the default GL_UNPACK_ALIGNMENT), so loading is a file mapping and the uploads
+struct cooked_texture_header
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Channels;   // 1 to 4, 8 bits each
+    uint32_t FaceCount;  // 1, or 6 for cubemaps in GL face order (+X, -X, +Y, -Y, +Z, -Z)
+    uint32_t LevelCount; // Full mip chain, or 1
+    uint32_t ImageFlags; // Flags the source was decoded with (image_flags)
+    uint64_t DataSize;   // Levels of face 0, then levels of face 1...
+    uint64_t SourceHash; // Texture::HashFiles of the sources
+};
+
+struct cooked_texture
+{
+    file_mapping Mapping;
+    const cooked_texture_header* Header;
+};
+
+enum cooked_asset_type
+{
+    COOKED_MESH,    // Mesh cache (see Mesh::MapObj)
+    COOKED_TEXTURE,
+    COOKED_CUBEMAP,
+};
+
+struct cooked_asset
+{
+    cooked_asset_type Type;
+    std::vector<std::string> Sources;  // One file, or the six faces of a cubemap
+    std::vector<uint64_t> SourceSizes; // A source with another size is newer than the cooked file
+    int ImageFlags;
+    std::string Cooked;
+};
+
+struct cooked_manifest
+{
+    std::vector<cooked_asset> Assets;
+};
+
+namespace Cook
+{
+
+// Write the faces (same size and channels) and their mip chain when Mipmaps is set (Kaiser filter in linear space, see Texture::GenerateMips)
+bool WriteCookedTexture(const char* Filename, const uint8_t* const* Faces, int FaceCount, int Width, int Height, int Channels, int ImageFlags, bool Mipmaps,
+                        uint64_t SourceHash);
+bool MapCookedTexture(cooked_texture& Texture, const char* Filename);
+// Cooked copy of an image (or the six faces of a cubemap) decoded with ImageFlags, cached next to the first file as <Filename>.<ImageFlags>.tex
+// (<Filename>.cubemap.<ImageFlags>.tex, the names of asset_cook) and rebuilt when SourceHash (Texture::HashFiles of the sources) changes
+// GL::cache maps it for the loads with IMG_GEN_MIPMAPS, so the mip chain is computed once. Runs on any thread
+std::string GetTextureCacheName(const char* Filename, int FaceCount, int ImageFlags);
+// Images: the sources when the caller already decoded them (GL::cache::LoadTextures), decoded here otherwise
+bool MapTextureCache(cooked_texture& Texture, const char* const* Filenames, int FaceCount, int ImageFlags, uint64_t SourceHash,
+                     const GL::image* Images = nullptr);
+// The cache above only when it is already written and up to date, nothing is decoded
+bool MapValidTextureCache(cooked_texture& Texture, const char* Filename, int FaceCount, int ImageFlags, uint64_t SourceHash);
+void UnmapCookedTexture(cooked_texture& Texture);
+// Pixels of a level of a face (rows aligned on 4 bytes)
+const uint8_t* GetCookedLevel(const cooked_texture& Texture, int Face, int Level, int* Width, int* Height);
+
+bool LoadManifest(cooked_manifest& Manifest, const char* Filename);
+bool SaveManifest(const cooked_manifest& Manifest, const char* Filename);
+// Cooked file of Source (first face of a cubemap) decoded with ImageFlags, nullptr if it wasn't cooked or if a source changed since
+const char* FindCooked(const cooked_manifest& Manifest, cooked_asset_type Type, const char* Source, int ImageFlags);
+}
@@ -18,7 +18,7 @@ static const char* gVertexShaderStr = R"GLSL(
 // Attributes
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
-layout(location = 2) in vec3 aNormal;
+layout(location = 2) in vec2 aNormal; // Octahedral encoding
 
 // Uniforms
 uniform mat4 uProjection;
@@ -36,7 +36,7 @@ void main()
     vUV = aUV;
     vec4 pos4 = (uModel * vec4(aPosition, 1.0));
     vPos = pos4.xyz / pos4.w;
-    vNormal = (uModelNormalMatrix * vec4(aNormal, 0.0)).xyz;
+    vNormal = (uModelNormalMatrix * vec4(octDecode(aNormal), 0.0)).xyz;
     gl_Position = uProjection * uView * pos4;
 })GLSL";
 
@@ -102,7 +102,8 @@ demo_base::demo_base(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, true);
+        const char* VertexShaderStrs[2] = { GL::GetVertexDecodingFunctions(), gVertexShaderStr };
+        this->Program = GL::CreateProgramEx(2, VertexShaderStrs, 2, FragmentShaderStrs, true);
     }
     
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -110,15 +111,10 @@ demo_base::demo_base(GL::cache& GLCache, GL::debug& GLDebug)
         glGenVertexArrays(1, &VAO);
         glBindVertexArray(VAO);
         
-        glBindBuffer(GL_ARRAY_BUFFER, TavernScene.MeshBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, TavernScene.Mesh->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, TavernScene.Mesh->IndexBuffer);
         
-        vertex_descriptor& Desc = TavernScene.MeshDesc;
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+        GL::VertexAttribPointers(TavernScene.Mesh->Layout, 0, 1, 2);
     }
 
     // Set uniforms that won't change
@@ -155,11 +151,24 @@ void demo_base::Update(const platform_io& IO)
     // Render tavern
     this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix);
 
+    // Click a light to select it (when the cursor is neither over ImGui nor captured by the camera)
+    if (ImGui::IsMouseClicked(0) && !ImGui::GetIO().WantCaptureMouse && !IO.MouseCaptured)
+    {
+        // Ray through the cursor, from the near plane to the far plane
+        v2 Cursor = { 2.f * IO.MouseX / IO.WindowWidth - 1.f, 1.f - 2.f * IO.MouseY / IO.WindowHeight };
+        mat4 InverseViewProjection = Mat4::Inverse(ProjectionMatrix * ViewMatrix);
+        v4 Near = InverseViewProjection * v4 { Cursor.x, Cursor.y, -1.f, 1.f };
+        v4 Far = InverseViewProjection * v4 { Cursor.x, Cursor.y, 1.f, 1.f };
+        v3 Origin = Near.xyz / Near.w;
+        TavernScene.PickLight(Origin, Far.xyz / Far.w - Origin, ModelMatrix);
+    }
+
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(TavernScene.MeshBuffer, TavernScene.MeshDesc.Stride, TavernScene.MeshDesc.PositionOffset, TavernScene.MeshVertexCount);
-        GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
+        const GL::mesh* Mesh = TavernScene.Mesh;
+        GLDebug.Wireframe.BindIndexedBuffer(Mesh->VertexBuffer, Mesh->IndexBuffer, Mesh->IndexType, Mesh->Layout);
+        GLDebug.Wireframe.DrawElements(Mesh->IndexCount, ProjectionMatrix * ViewMatrix * ModelMatrix * Mesh::GetPositionDequantization(Mesh->Layout, Mesh->BoundsMin, Mesh->BoundsMax), Mesh->FirstIndex, Mesh->BaseVertex);
     }
     
     // Display debug UI
@@ -172,6 +181,10 @@ void demo_base::DisplayDebugUI()
     {
         // Debug display
         ImGui::Checkbox("Wireframe", &Wireframe);
+        ImGui::Checkbox("Cluster culling", &ClusterCulling);
+        if (ClusterCulling)
+            ImGui::Checkbox("Backface cone culling", &BackfaceCulling);
+        ImGui::Text("Triangles: %d / %d (%d clusters)", SubmittedTriangleCount, TavernScene.Mesh->IndexCount / 3, (int)TavernScene.Mesh->Clusters.size());
         if (ImGui::TreeNodeEx("Camera"))
         {
             ImGui::Text("Position: (%.2f, %.2f, %.2f)", Camera.Position.x, Camera.Position.y, Camera.Position.z);
@@ -193,9 +206,12 @@ void demo_base::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatri
     glUseProgram(Program);
 
     // Set uniforms
+    // Quantized positions are mapped back to mesh space by uModel only (normals are not quantized by the bounds)
+    const GL::mesh* Mesh = TavernScene.Mesh;
     mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
+    mat4 MeshModelMatrix = ModelMatrix * Mesh::GetPositionDequantization(Mesh->Layout, Mesh->BoundsMin, Mesh->BoundsMax);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
+    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, MeshModelMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
     glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
@@ -210,5 +226,15 @@ void demo_base::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatri
     
     // Draw mesh
     glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+    if (ClusterCulling)
+    {
+        // Camera in mesh space taken from the matrices (callers may render other points of view)
+        v3 CameraPosition = (Mat4::Inverse(ViewMatrix * ModelMatrix) * v4 { 0.f, 0.f, 0.f, 1.f }).xyz;
+        SubmittedTriangleCount = GL::DrawMeshClusters(*Mesh, ProjectionMatrix * ViewMatrix * ModelMatrix, CameraPosition, BackfaceCulling);
+    }
+    else
+    {
+        GL::DrawMeshLod(*Mesh, 0);
+        SubmittedTriangleCount = Mesh->IndexCount / 3;
+    }
 }
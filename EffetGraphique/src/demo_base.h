@@ -33,4 +33,9 @@ private:
     tavern_scene TavernScene;
 
     bool Wireframe = false;
+
+    // Clusters of the tavern culled on cpu
+    bool ClusterCulling = true;
+    bool BackfaceCulling = true;
+    int SubmittedTriangleCount = 0;
 };
@@ -20,7 +20,7 @@ static const char* gVertexShaderStr = R"GLSL(
 // Attributes
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
-layout(location = 2) in vec3 aNormal;
+layout(location = 2) in vec2 aNormal; // Octahedral encoding
 
 // Uniforms
 uniform mat4 uProjection;
@@ -38,7 +38,7 @@ void main()
     vUV = aUV;
     vec4 pos4 = (uModel * vec4(aPosition, 1.0));
     vPos = pos4.xyz / pos4.w;
-    vNormal = (uModelNormalMatrix * vec4(aNormal, 0.0)).xyz;
+    vNormal = (uModelNormalMatrix * vec4(octDecode(aNormal), 0.0)).xyz;
     gl_Position = uProjection * uView * pos4;
 })GLSL";
 
@@ -118,7 +118,8 @@ demo_gamma::demo_gamma(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, true);
+        const char* VertexShaderStrs[2] = { GL::GetVertexDecodingFunctions(), gVertexShaderStr };
+        this->Program = GL::CreateProgramEx(2, VertexShaderStrs, 2, FragmentShaderStrs, true);
     }
 
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -126,15 +127,10 @@ demo_gamma::demo_gamma(GL::cache& GLCache, GL::debug& GLDebug)
         glGenVertexArrays(1, &VAO);
         glBindVertexArray(VAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, TavernScene.MeshBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, TavernScene.Mesh->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, TavernScene.Mesh->IndexBuffer);
 
-        vertex_descriptor& Desc = TavernScene.MeshDesc;
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+        GL::VertexAttribPointers(TavernScene.Mesh->Layout, 0, 1, 2);
     }
 
     // Set uniforms that won't change
@@ -194,8 +190,9 @@ void demo_gamma::Update(const platform_io& IO)
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(TavernScene.MeshBuffer, TavernScene.MeshDesc.Stride, TavernScene.MeshDesc.PositionOffset, TavernScene.MeshVertexCount);
-        GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
+        const GL::mesh* Mesh = TavernScene.Mesh;
+        GLDebug.Wireframe.BindIndexedBuffer(Mesh->VertexBuffer, Mesh->IndexBuffer, Mesh->IndexType, Mesh->Layout);
+        GLDebug.Wireframe.DrawElements(Mesh->IndexCount, ProjectionMatrix * ViewMatrix * ModelMatrix * Mesh::GetPositionDequantization(Mesh->Layout, Mesh->BoundsMin, Mesh->BoundsMax), Mesh->FirstIndex, Mesh->BaseVertex);
     }
 
     // Display debug UI
@@ -237,9 +234,12 @@ void demo_gamma::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatr
     glUseProgram(Program);
 
     // Set uniforms
+    // Quantized positions are mapped back to mesh space by uModel only (normals are not quantized by the bounds)
+    const GL::mesh* Mesh = TavernScene.Mesh;
     mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
+    mat4 MeshModelMatrix = ModelMatrix * Mesh::GetPositionDequantization(Mesh->Layout, Mesh->BoundsMin, Mesh->BoundsMax);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
+    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, MeshModelMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
     glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
@@ -252,7 +252,8 @@ void demo_gamma::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatr
     glBindTexture(GL_TEXTURE_2D, TavernScene.EmissiveTexture);
     glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
 
-    // Draw mesh
+    // Draw visible clusters
     glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+    v3 CameraPosition = (Mat4::Inverse(ViewMatrix * ModelMatrix) * v4 { 0.f, 0.f, 0.f, 1.f }).xyz;
+    GL::DrawMeshClusters(*Mesh, ProjectionMatrix * ViewMatrix * ModelMatrix, CameraPosition, true);
 }
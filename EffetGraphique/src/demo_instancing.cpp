@@ -7,6 +7,8 @@
 #include "opengl_helpers.h"
 #include "maths.h"
 #include "mesh.h"
+#include "mesh_simplifier.h"
+#include "typed_vertex_layout.h"
 #include "color.h"
 
 #include "demo_instancing.h"
@@ -22,6 +24,11 @@ struct vertex
     v2 UV;
 };
 
+typedef typed_vertex_layout<vertex,
+    position_attribute<vertex, &vertex::Position, 0>,
+    normal_attribute<vertex, &vertex::Normal, 1>,
+    uv_attribute<vertex, &vertex::UV, 2>> vertex_layout_type;
+
 #pragma region SHADERS
 #pragma region BASE SHADER
 static const char* gVertexShaderStr = R"GLSL(
@@ -128,75 +135,37 @@ void main()
 #pragma endregion
 #pragma endregion
 
-static void DrawQuad(GLuint Program, mat4 ModelViewProj)
+static void DrawQuad(GLuint Program, const GL::mesh& Quad, mat4 ModelViewProj)
 {
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelViewProj"), 1, GL_FALSE, ModelViewProj.e);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    GL::DrawMeshLod(Quad, 0);
 }
 
 #pragma region CONSTRUCTOR/DESTRUCTOR
-demo_instancing::demo_instancing()
+demo_instancing::demo_instancing(GL::cache& GLCache)
+    : GLCache(GLCache)
 {
     // Create render pipeline
     this->Program = GL::CreateProgram(gVertexShaderStr, gFragmentShaderStr);
     SBProgram = GL::CreateProgram(sbVertexShaderStr, sbFragmentShaderStr);
     INSTProgram = GL::CreateProgram(instVertexShaderStr, instFragmentShaderStr);
 
-    // Create a descriptor based on the `struct vertex` format
-    vertex_descriptor Descriptor = {};
-    Descriptor.Stride = sizeof(vertex);
-    Descriptor.HasNormal = true;
-    Descriptor.HasUV = true;
-    Descriptor.PositionOffset = OFFSETOF(vertex, Position);
-    Descriptor.NormalOffset = OFFSETOF(vertex, Normal);
-    Descriptor.UVOffset = OFFSETOF(vertex, UV);
-
-    // Gen quad
+    // Get quad (vertices converted to the `struct vertex` format by its typed layout)
     {
-        // Create a quad in RAM
-        vertex Quad[6];
-        this->VertexCount = 6;
-        Mesh::BuildQuad(Quad, Quad + this->VertexCount, Descriptor);
-
-        // Upload quad to gpu (VRAM)
-        glGenBuffers(1, &this->VertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, this->VertexCount * sizeof(vertex), Quad, GL_STATIC_DRAW);
-    
+        Quad = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_QUAD);
+
         // Create quad vertex array
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+        VAO = vertex_layout_type::CreateVertexArray(Quad->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Quad->IndexBuffer);
     }
 
-    // Gen cube
+    // Get cube
     {
-        // Create a cube in RAM
-        vertex Cube[36];
-        cubeVertexCount = 36;
-        Mesh::BuildNormalizedCube(Cube, Cube + cubeVertexCount, Descriptor);
-
-        // Upload cube to gpu (VRAM)
-        glGenBuffers(1, &cubeVertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, cubeVertexCount * sizeof(vertex), Cube, GL_STATIC_DRAW);
-    
+        cube = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_NORMALIZED_CUBE);
+
         // Create cube vertex array
-        glGenVertexArrays(1, &cubeVAO);
-        glBindVertexArray(cubeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, this->cubeVertexBuffer);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+        cubeVAO = vertex_layout_type::CreateVertexArray(cube->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cube->IndexBuffer);
     }
 
     // Gen texture
@@ -210,26 +179,22 @@ demo_instancing::demo_instancing()
 
     // Gen custom texture
     {
-        glGenTextures(1, &customTexture);
+        customTexture = GLCache.LoadTexture("media/roh.png", image_flags::IMG_FLIP, &texWidth, &texHeight);
         glBindTexture(GL_TEXTURE_2D, customTexture);
-        GL::UploadTexture("media/roh.png", image_flags::IMG_FLIP, &texWidth, &texHeight);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     }
 
     // Gen skybox
     {
-        std::string sbName = "media/skybox/skybox";
-        std::string fileExtension = ".jpg";
-
-        glGenTextures(1, &skybox);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-
-        for (int i = 0; i < 6; i++)
+        const char* Faces[6] =
         {
-            std::string texName = sbName + std::to_string(i) + fileExtension;
-            GL::UploadCubemapTexture(texName.c_str(), i, image_flags::IMG_FORCE_RGB, &texWidth, &texHeight);
-        }
+            "media/skybox/skybox0.jpg", "media/skybox/skybox1.jpg", "media/skybox/skybox2.jpg",
+            "media/skybox/skybox3.jpg", "media/skybox/skybox4.jpg", "media/skybox/skybox5.jpg",
+        };
+        skybox = GLCache.LoadCubemap(Faces, image_flags::IMG_FORCE_RGB | image_flags::IMG_COMPRESS, &texWidth);
+        texHeight = texWidth;
+        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
 
         // Texture filters
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -251,35 +216,20 @@ demo_instancing::demo_instancing()
             }
     }
 
-    // Gen sphere
+    // Get sphere and its LODs (same as demo_reflection)
     {
         const int lon = 25;
         const int lat = 25;
-        // Create a sphere in RAM
-        vertex Sphere[lon * lat * 6];
-        sphereVertexCount = lon * lat * 6;
-        Mesh::BuildSphere(Sphere, Sphere + sphereVertexCount, Descriptor, lon, lat);
-
-        // Upload sphere to gpu (VRAM)
-        glGenBuffers(1, &sphereVertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, sphereVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, sphereVertexCount * sizeof(vertex), Sphere, GL_STATIC_DRAW);
+        sphere = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_SPHERE, lon, lat);
 
         glGenBuffers(1, &instanceBuffer);
         glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(v3) * 100, &translations[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(v3) * 100, &translations[0], GL_DYNAMIC_DRAW);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         // Create sphere vertex array
-        glGenVertexArrays(1, &sphereVAO);
-        glBindVertexArray(sphereVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, sphereVertexBuffer);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+        sphereVAO = vertex_layout_type::CreateVertexArray(sphere->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere->IndexBuffer);
 
         // Bind instance relative pos
         glEnableVertexAttribArray(3);
@@ -294,12 +244,9 @@ demo_instancing::~demo_instancing()
 {
     // Cleanup GL
     glDeleteTextures(1, &Texture);
-    glDeleteTextures(1, &customTexture);
-    glDeleteTextures(1, &skybox);
+    GLCache.ReleaseTexture(customTexture);
+    GLCache.ReleaseTexture(skybox);
 
-    glDeleteBuffers(1, &VertexBuffer);
-    glDeleteBuffers(1, &cubeVertexBuffer);
-    glDeleteBuffers(1, &sphereVertexBuffer);
     glDeleteBuffers(1, &instanceBuffer);
 
     glDeleteVertexArrays(1, &VAO);
@@ -350,7 +297,7 @@ void demo_instancing::Render(const platform_io& IO)
     glBindTexture(GL_TEXTURE_2D, Texture);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelViewProj"), 1, GL_FALSE, mvp.e);
     glBindVertexArray(sphereVAO);
-    glDrawArrays(GL_TRIANGLES, 0, sphereVertexCount);
+    GL::DrawMeshLod(*sphere, 0);
 
     // Spheres
     {
@@ -365,8 +312,38 @@ void demo_instancing::Render(const platform_io& IO)
             glUniform3fv(glGetUniformLocation(INSTProgram, uniformName.c_str()), 1, translations[i].e);
         }
 
+        // Pick a LOD per instance from its distance and group the instances by LOD
+        float ProjectionScale = Mesh::GetProjectionScale(ProjectionMatrix, (float)IO.WindowHeight);
+        v3 SortedTranslations[100];
+        int InstanceCount = 0;
+        for (int Lod = 0; Lod < sphere->LodCount; ++Lod)
+            instanceCountPerLod[Lod] = 0;
+        for (int i = 0; i < 100; i++)
+        {
+            float Distance = Vec3::Length(translations[i] - Camera.Position);
+            instanceLods[i] = Mesh::SelectLod(sphere->Lods, sphere->LodCount, instanceLods[i], Distance, ProjectionScale, lodThresholdPixels);
+            instanceCountPerLod[instanceLods[i]]++;
+        }
+        for (int Lod = 0; Lod < sphere->LodCount; ++Lod)
+            for (int i = 0; i < 100; i++)
+                if (instanceLods[i] == Lod)
+                    SortedTranslations[InstanceCount++] = translations[i];
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(SortedTranslations), SortedTranslations);
+
+        // One instanced draw per LOD, the instance attribute starts at the first instance of the LOD
         glBindVertexArray(sphereVAO);
-        glDrawArraysInstanced(GL_TRIANGLES, 0, sphereVertexCount, 100);
+        int FirstInstance = 0;
+        for (int Lod = 0; Lod < sphere->LodCount; ++Lod)
+        {
+            if (instanceCountPerLod[Lod] == 0)
+                continue;
+
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(FirstInstance * sizeof(v3)));
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, sphere->Lods[Lod].IndexCount, sphere->IndexType, GL::GetIndexOffset(*sphere, sphere->Lods[Lod].FirstIndex), instanceCountPerLod[Lod], sphere->BaseVertex);
+            FirstInstance += instanceCountPerLod[Lod];
+        }
     }
 
     // Skybox
@@ -387,7 +364,7 @@ void demo_instancing::Render(const platform_io& IO)
         glUniformMatrix4fv(glGetUniformLocation(SBProgram, "uViewProj"), 1, GL_FALSE, vp.e);
         glBindVertexArray(cubeVAO);
         glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        GL::DrawMeshLod(*cube, 0);
 
         glDepthMask(GL_TRUE);
     }
@@ -433,6 +410,11 @@ void demo_instancing::DisplayDebugUI()
             ImGui::Image((void*)(intptr_t)customTexture, ImVec2(128, 128));
             //ImGui::Image((void*)(intptr_t)skybox, ImVec2(128, 128));
         }
+
+        // Sphere LODs
+        ImGui::SliderFloat("LOD error threshold (pixels)", &lodThresholdPixels, 0.1f, 10.f);
+        for (int Lod = 0; Lod < sphere->LodCount; ++Lod)
+            ImGui::Text("LOD %d: %d triangles, %d instances", Lod, (int)sphere->Lods[Lod].IndexCount / 3, instanceCountPerLod[Lod]);
         
         ImGui::TreePop();
     }
@@ -3,19 +3,22 @@
 #include "demo.h"
 
 #include "opengl_headers.h"
+#include "opengl_helpers.h"
 
 #include "maths.h"
+#include "mesh.h"
 #include "camera.h"
 
 class demo_instancing : public demo
 {
 public:
-    demo_instancing();
+    demo_instancing(GL::cache& GLCache);
     virtual ~demo_instancing();
     virtual void Update(const platform_io& IO);
     void DisplayDebugUI();
     void Render(const platform_io& IO);
 private:
+    GL::cache& GLCache;
 
     // 3d camera
     camera Camera = { {0.f, 0.f, 4.f}, 0, 0 };
@@ -30,22 +33,19 @@ private:
     GLuint customTexture = 0;
     GLuint skybox = 0;
 
-    // Meshes
+    // Meshes (owned by GL::cache)
     // Quad
     GLuint VAO = 0;
-    GLuint VertexBuffer = 0;
-    int VertexCount = 0;
+    const GL::mesh* Quad = nullptr;
 
     // Cube
     GLuint cubeVAO = 0;
-    GLuint cubeVertexBuffer = 0;
-    int cubeVertexCount = 0;
+    const GL::mesh* cube = nullptr;
 
-    // Sphere
+    // Sphere (LODs after the full resolution indices)
     GLuint sphereVAO = 0;
-    GLuint sphereVertexBuffer = 0;
+    const GL::mesh* sphere = nullptr;
     GLuint instanceBuffer = 0;
-    int sphereVertexCount = 0;
 
     int texWidth = 0;
     int texHeight = 0;
@@ -56,4 +56,9 @@ private:
     float timeScale = 0.75f;
     int amountToInstantiate = 100;
     v3 translations[100] = {};
+
+    // Sphere LOD of each instance (instances are sorted by LOD in instanceBuffer)
+    int instanceLods[100] = {};
+    int instanceCountPerLod[MESH_MAX_LODS] = {};
+    float lodThresholdPixels = 1.f;
 };
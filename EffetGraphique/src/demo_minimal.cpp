@@ -6,6 +6,7 @@
 #include "opengl_helpers.h"
 #include "maths.h"
 #include "mesh.h"
+#include "typed_vertex_layout.h"
 #include "color.h"
 
 #include "demo_minimal.h"
@@ -20,6 +21,10 @@ struct vertex
     v2 UV;
 };
 
+typedef typed_vertex_layout<vertex,
+    position_attribute<vertex, &vertex::Position, 0>,
+    uv_attribute<vertex, &vertex::UV, 1>> vertex_layout_type;
+
 // Shaders
 // ==================================================
 static const char* gVertexShaderStr = R"GLSL(
@@ -54,30 +59,13 @@ void main()
     oColor = texture(uColorTexture, vUV);
 })GLSL";
 
-demo_minimal::demo_minimal()
+demo_minimal::demo_minimal(GL::cache& GLCache)
 {
     // Create render pipeline
     this->Program = GL::CreateProgram(gVertexShaderStr, gFragmentShaderStr);
     
-    // Gen mesh
-    {
-        // Create a descriptor based on the `struct vertex` format
-        vertex_descriptor Descriptor = {};
-        Descriptor.Stride = sizeof(vertex);
-        Descriptor.HasUV = true;
-        Descriptor.PositionOffset = OFFSETOF(vertex, Position);
-        Descriptor.UVOffset = OFFSETOF(vertex, UV);
-
-        // Create a cube in RAM
-        vertex Quad[6];
-        this->VertexCount = 6;
-        Mesh::BuildQuad(Quad, Quad + this->VertexCount, Descriptor);
-
-        // Upload cube to gpu (VRAM)
-        glGenBuffers(1, &this->VertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, this->VertexCount * sizeof(vertex), Quad, GL_STATIC_DRAW);
-    }
+    // Get mesh (generated on gpu by the first demo using this vertex format)
+    this->Quad = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_QUAD);
 
     // Gen texture
     {
@@ -89,28 +77,22 @@ demo_minimal::demo_minimal()
     }
     
     // Create a vertex array
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+    VAO = vertex_layout_type::CreateVertexArray(this->Quad->VertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->Quad->IndexBuffer);
 }
 
 demo_minimal::~demo_minimal()
 {
     // Cleanup GL
     glDeleteTextures(1, &Texture);
-    glDeleteBuffers(1, &VertexBuffer);
     glDeleteVertexArrays(1, &VAO);
     glDeleteProgram(Program);
 }
 
-static void DrawQuad(GLuint Program, mat4 ModelViewProj)
+static void DrawQuad(GLuint Program, const GL::mesh& Quad, mat4 ModelViewProj)
 {
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelViewProj"), 1, GL_FALSE, ModelViewProj.e);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    GL::DrawMeshLod(Quad, 0);
 }
 
 void demo_minimal::Update(const platform_io& IO)
@@ -143,6 +125,6 @@ void demo_minimal::Update(const platform_io& IO)
     v3 ObjectPosition = { 0.f, 0.f, -3.f };
     {
         mat4 ModelMatrix = Mat4::Translate(ObjectPosition);
-        DrawQuad(Program, ProjectionMatrix * ViewMatrix * ModelMatrix);
+        DrawQuad(Program, *Quad, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 }
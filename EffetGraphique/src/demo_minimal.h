@@ -3,13 +3,14 @@
 #include "demo.h"
 
 #include "opengl_headers.h"
+#include "opengl_helpers.h"
 
 #include "camera.h"
 
 class demo_minimal : public demo
 {
 public:
-    demo_minimal();
+    demo_minimal(GL::cache& GLCache);
     virtual ~demo_minimal();
     virtual void Update(const platform_io& IO);
 
@@ -22,7 +23,6 @@ private:
     GLuint Texture = 0;
 
     GLuint VAO = 0;
-    GLuint VertexBuffer = 0;
-    int VertexCount = 0;
+    const GL::mesh* Quad = nullptr; // Owned by GL::cache
 
 };
@@ -9,6 +9,7 @@
 #include "color.h"
 #include "maths.h"
 #include "mesh.h"
+#include "mesh_simplifier.h"
 
 #include "demo_npr_gooch.h"
 
@@ -20,7 +21,7 @@ static const char* gVertexShaderStr = R"GLSL(
 // Attributes
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
-layout(location = 2) in vec3 aNormal;
+layout(location = 2) in vec2 aNormal; // Octahedral encoding
 
 // Uniforms
 uniform mat4 uProjection;
@@ -38,7 +39,7 @@ void main()
     vUV = aUV;
     vec4 pos4 = (uModel * vec4(aPosition, 1.0));
     vPos = pos4.xyz / pos4.w;
-    vNormal = (uModelNormalMatrix * vec4(aNormal, 0.0)).xyz;
+    vNormal = (uModelNormalMatrix * vec4(octDecode(aNormal), 0.0)).xyz;
     gl_Position = uProjection * uView * pos4;
 })GLSL";
 
@@ -141,7 +142,8 @@ demo_npr_gooch::demo_npr_gooch(GL::cache& GLCache, GL::debug& GLDebug)
         char FragmentShaderConfig[] = "";
         const char* FragmentShaderStrs[2] = { FragmentShaderConfig, gFragmentShaderStr };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, true);
+        const char* VertexShaderStrs[2] = { GL::GetVertexDecodingFunctions(), gVertexShaderStr };
+        this->Program = GL::CreateProgramEx(2, VertexShaderStrs, 2, FragmentShaderStrs, true);
     }
 
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -149,15 +151,10 @@ demo_npr_gooch::demo_npr_gooch(GL::cache& GLCache, GL::debug& GLDebug)
         glGenVertexArrays(1, &VAO_NPR);
         glBindVertexArray(VAO_NPR);
 
-        glBindBuffer(GL_ARRAY_BUFFER, NPRScene.MeshBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, NPRScene.Mesh->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, NPRScene.Mesh->IndexBuffer);
 
-        vertex_descriptor& Desc = NPRScene.MeshDesc;
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+        GL::VertexAttribPointers(NPRScene.Mesh->Layout, 0, 1, 2);
     }
 
     // Set uniforms that won't change
@@ -189,7 +186,17 @@ void demo_npr_gooch::Update(const platform_io& IO)
 
     mat4 ProjectionMatrix = Mat4::Perspective(Math::ToRadians(60.f), AspectRatio, 0.1f, 100.f);
     mat4 ViewMatrix = CameraGetInverseMatrix(Camera);
-    mat4 ModelMatrix = Mat4::Scale({ 0.01f, 0.01f, 0.01f });
+    const float ModelScale = 0.01f;
+    mat4 ModelMatrix = Mat4::Scale({ ModelScale, ModelScale, ModelScale });
+
+    // Select the LOD from the error projected at the distance of the model bounding sphere (in mesh units)
+    {
+        const GL::mesh* Mesh = NPRScene.Mesh;
+        v3 Center = (Mesh->BoundsMin + Mesh->BoundsMax) * 0.5f;
+        float Radius = Vec3::Length(Mesh->BoundsMax - Mesh->BoundsMin) * 0.5f;
+        float Distance = Math::Max(Vec3::Length(Center - Camera.Position / ModelScale) - Radius, 0.f);
+        MeshLod = Mesh::SelectLod(Mesh->Lods, Mesh->LodCount, MeshLod, Distance, Mesh::GetProjectionScale(ProjectionMatrix, (float)IO.WindowHeight), LodThresholdPixels);
+    }
 
     // Render Model
     this->RenderNPRModel(ProjectionMatrix, ViewMatrix, ModelMatrix);
@@ -203,6 +210,8 @@ void demo_npr_gooch::DisplayDebugUI()
     if (ImGui::TreeNodeEx("demo_npr_gooch", ImGuiTreeNodeFlags_Framed))
     {
         ImGui::Checkbox("GoochShading", &GoochShading);
+        ImGui::SliderFloat("LOD error threshold (pixels)", &LodThresholdPixels, 0.1f, 10.f);
+        ImGui::Text("LOD %d / %d (%d triangles)", MeshLod, NPRScene.Mesh->LodCount, (int)NPRScene.Mesh->Lods[Math::Clamp(MeshLod, 0, NPRScene.Mesh->LodCount - 1)].IndexCount / 3);
 
         // Debug display
         if (ImGui::TreeNodeEx("Camera"))
@@ -227,9 +236,12 @@ void demo_npr_gooch::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vi
     glUseProgram(Program);
 
     // Set uniforms
+    // Quantized positions are mapped back to mesh space by uModel only (normals are not quantized by the bounds)
+    const GL::mesh* Mesh = NPRScene.Mesh;
     mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
+    mat4 MeshModelMatrix = ModelMatrix * Mesh::GetPositionDequantization(Mesh->Layout, Mesh->BoundsMin, Mesh->BoundsMax);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
+    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, MeshModelMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
     glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
@@ -247,7 +259,7 @@ void demo_npr_gooch::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vi
     {
         //DRAW MESH A FIRST TIME
         glBindVertexArray(VAO_NPR);
-        glDrawArrays(GL_TRIANGLES, 0, NPRScene.MeshVertexCount);
+        GL::DrawMeshLod(*NPRScene.Mesh, MeshLod);
 
         glUniform1i(glGetUniformLocation(Program, "uIsOutline"), 1);
 
@@ -259,7 +271,7 @@ void demo_npr_gooch::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vi
 
         //DRAW MESH A SECOND TIME
         glBindVertexArray(VAO_NPR);
-        glDrawArrays(GL_TRIANGLES, 0, NPRScene.MeshVertexCount);
+        GL::DrawMeshLod(*NPRScene.Mesh, MeshLod);
 
         glUniform1i(glGetUniformLocation(Program, "uIsOutline"), 0);
 
@@ -270,6 +282,6 @@ void demo_npr_gooch::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vi
     else
     {
         glBindVertexArray(VAO_NPR);
-        glDrawArrays(GL_TRIANGLES, 0, NPRScene.MeshVertexCount);
+        GL::DrawMeshLod(*NPRScene.Mesh, MeshLod);
     }
 }
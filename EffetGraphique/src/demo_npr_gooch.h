@@ -30,4 +30,8 @@ private:
     npr_gooch_scene NPRScene;
 
     bool GoochShading = false;
+
+    // Level of detail of the model (selected each frame with hysteresis)
+    int MeshLod = 0;
+    float LodThresholdPixels = 1.f;
 };
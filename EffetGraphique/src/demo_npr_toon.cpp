@@ -20,7 +20,7 @@ static const char* gVertexShaderStr = R"GLSL(
 // Attributes
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
-layout(location = 2) in vec3 aNormal;
+layout(location = 2) in vec2 aNormal; // Octahedral encoding
 
 // Uniforms
 uniform mat4 uProjection;
@@ -38,7 +38,7 @@ void main()
     vUV = aUV;
     vec4 pos4 = (uModel * vec4(aPosition, 1.0));
     vPos = pos4.xyz / pos4.w;
-    vNormal = (uModelNormalMatrix * vec4(aNormal, 0.0)).xyz;
+    vNormal = (uModelNormalMatrix * vec4(octDecode(aNormal), 0.0)).xyz;
     gl_Position = uProjection * uView * pos4;
 })GLSL";
 
@@ -139,7 +139,8 @@ demo_npr_toon::demo_npr_toon(GL::cache& GLCache, GL::debug& GLDebug)
         char FragmentShaderConfig[] = "";
         const char* FragmentShaderStrs[2] = { FragmentShaderConfig, gFragmentShaderStr };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, true);
+        const char* VertexShaderStrs[2] = { GL::GetVertexDecodingFunctions(), gVertexShaderStr };
+        this->Program = GL::CreateProgramEx(2, VertexShaderStrs, 2, FragmentShaderStrs, true);
     }
 
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -147,15 +148,10 @@ demo_npr_toon::demo_npr_toon(GL::cache& GLCache, GL::debug& GLDebug)
         glGenVertexArrays(1, &VAO_NPR);
         glBindVertexArray(VAO_NPR);
 
-        glBindBuffer(GL_ARRAY_BUFFER, NPRScene.MeshBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, NPRScene.Mesh->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, NPRScene.Mesh->IndexBuffer);
 
-        vertex_descriptor& Desc = NPRScene.MeshDesc;
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+        GL::VertexAttribPointers(NPRScene.Mesh->Layout, 0, 1, 2);
     }
 
     // Set uniforms that won't change
@@ -236,9 +232,12 @@ void demo_npr_toon::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vie
     glUseProgram(Program);
 
     // Set uniforms
+    // Quantized positions are mapped back to mesh space by uModel only (normals are not quantized by the bounds)
+    const GL::mesh* Mesh = NPRScene.Mesh;
     mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
+    mat4 MeshModelMatrix = ModelMatrix * Mesh::GetPositionDequantization(Mesh->Layout, Mesh->BoundsMin, Mesh->BoundsMax);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
+    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, MeshModelMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
     glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
@@ -257,7 +256,7 @@ void demo_npr_toon::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vie
    {
         //DRAW MESH A FIRST TIME
         glBindVertexArray(VAO_NPR);
-        glDrawArrays(GL_TRIANGLES, 0, NPRScene.MeshVertexCount);
+        GL::DrawMeshLod(*NPRScene.Mesh, 0);
 
         glUniform1i(glGetUniformLocation(Program, "uIsOutline"), 1);
 
@@ -269,7 +268,7 @@ void demo_npr_toon::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vie
 
         //DRAW MESH A SECOND TIME
         glBindVertexArray(VAO_NPR);
-        glDrawArrays(GL_TRIANGLES, 0, NPRScene.MeshVertexCount);
+        GL::DrawMeshLod(*NPRScene.Mesh, 0);
 
         glUniform1i(glGetUniformLocation(Program, "uIsOutline"), 0);
 
@@ -280,6 +279,6 @@ void demo_npr_toon::RenderNPRModel(const mat4& ProjectionMatrix, const mat4& Vie
    else
    {
        glBindVertexArray(VAO_NPR);
-       glDrawArrays(GL_TRIANGLES, 0, NPRScene.MeshVertexCount);
+       GL::DrawMeshLod(*NPRScene.Mesh, 0);
    }
 }
@@ -7,6 +7,7 @@
 #include "opengl_helpers.h"
 #include "maths.h"
 #include "mesh.h"
+#include "typed_vertex_layout.h"
 #include "color.h"
 
 #include "demo_reflection.h"
@@ -25,6 +26,11 @@ struct vertex
     v2 UV;
 };
 
+typedef typed_vertex_layout<vertex,
+    position_attribute<vertex, &vertex::Position, 0>,
+    normal_attribute<vertex, &vertex::Normal, 1>,
+    uv_attribute<vertex, &vertex::UV, 2>> vertex_layout_type;
+
 #pragma region SHADERS
 #pragma region BASE SHADER
 static const char* gVertexShaderStr = R"GLSL(
@@ -163,14 +169,15 @@ void main()
 #pragma endregion
 #pragma endregion
 
-static void DrawQuad(GLuint Program, mat4 ModelViewProj)
+static void DrawQuad(GLuint Program, const GL::mesh& Quad, mat4 ModelViewProj)
 {
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelViewProj"), 1, GL_FALSE, ModelViewProj.e);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    GL::DrawMeshLod(Quad, 0);
 }
 
 #pragma region CONSTRUCTOR/DESTRUCTOR
-demo_reflection::demo_reflection()
+demo_reflection::demo_reflection(GL::cache& GLCache)
+    : GLCache(GLCache)
 {
     // Create render pipeline
     this->Program = GL::CreateProgram(gVertexShaderStr, gFragmentShaderStr);
@@ -197,87 +204,33 @@ demo_reflection::demo_reflection()
     }
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-    // Create a descriptor based on the `struct vertex` format
-    vertex_descriptor Descriptor = {};
-    Descriptor.Stride = sizeof(vertex);
-    Descriptor.HasNormal = true;
-    Descriptor.HasUV = true;
-    Descriptor.PositionOffset = OFFSETOF(vertex, Position);
-    Descriptor.NormalOffset = OFFSETOF(vertex, Normal);
-    Descriptor.UVOffset = OFFSETOF(vertex, UV);
-
-    // Gen mesh
+    // Get quad (vertices converted to the `struct vertex` format by its typed layout)
     {
-        // Create a quad in RAM
-        vertex Quad[6];
-        this->VertexCount = 6;
-        Mesh::BuildQuad(Quad, Quad + this->VertexCount, Descriptor);
-
-        // Upload quad to gpu (VRAM)
-        glGenBuffers(1, &this->VertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, this->VertexCount * sizeof(vertex), Quad, GL_STATIC_DRAW);
-    
+        Quad = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_QUAD);
+
         // Create quad vertex array
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+        VAO = vertex_layout_type::CreateVertexArray(Quad->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Quad->IndexBuffer);
     }
 
-    // Gen cube
+    // Get cube
     {
-        // Create a cube in RAM
-        vertex Cube[36];
-        cubeVertexCount = 36;
-        Mesh::BuildNormalizedCube(Cube, Cube + cubeVertexCount, Descriptor);
-
-        // Upload cube to gpu (VRAM)
-        glGenBuffers(1, &cubeVertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, cubeVertexCount * sizeof(vertex), Cube, GL_STATIC_DRAW);
-    
+        cube = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_NORMALIZED_CUBE);
+
         // Create cube vertex array
-        glGenVertexArrays(1, &cubeVAO);
-        glBindVertexArray(cubeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, this->cubeVertexBuffer);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+        cubeVAO = vertex_layout_type::CreateVertexArray(cube->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cube->IndexBuffer);
     }
 
-    // Gen sphere
+    // Get sphere (same as demo_instancing)
     {
         const int lon = 25;
         const int lat = 25;
-        // Create a sphere in RAM
-        vertex Sphere[lon * lat * 6];
-        sphereVertexCount = lon * lat * 6;
-        Mesh::BuildSphere(Sphere, Sphere + sphereVertexCount, Descriptor, lon, lat);
-
-        // Upload sphere to gpu (VRAM)
-        glGenBuffers(1, &sphereVertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, sphereVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, sphereVertexCount * sizeof(vertex), Sphere, GL_STATIC_DRAW);
+        sphere = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_SPHERE, lon, lat);
 
         // Create sphere vertex array
-        glGenVertexArrays(1, &sphereVAO);
-        glBindVertexArray(sphereVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, this->sphereVertexBuffer);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+        sphereVAO = vertex_layout_type::CreateVertexArray(sphere->VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere->IndexBuffer);
     }
 
     // Gen texture
@@ -291,26 +244,22 @@ demo_reflection::demo_reflection()
 
     // Gen custom texture
     {
-        glGenTextures(1, &customTexture);
+        customTexture = GLCache.LoadTexture("media/roh.png", image_flags::IMG_FLIP, &texWidth, &texHeight);
         glBindTexture(GL_TEXTURE_2D, customTexture);
-        GL::UploadTexture("media/roh.png", image_flags::IMG_FLIP, &texWidth, &texHeight);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     }
 
     // Gen skybox
     {
-        std::string sbName = "media/skybox/skybox";
-        std::string fileExtension = ".jpg";
-
-        glGenTextures(1, &skybox);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-
-        for (int i = 0; i < 6; i++)
+        const char* Faces[6] =
         {
-            std::string texName = sbName + std::to_string(i) + fileExtension;
-            GL::UploadCubemapTexture(texName.c_str(), i, image_flags::IMG_FORCE_RGB, &texWidth, &texHeight);
-        }
+            "media/skybox/skybox0.jpg", "media/skybox/skybox1.jpg", "media/skybox/skybox2.jpg",
+            "media/skybox/skybox3.jpg", "media/skybox/skybox4.jpg", "media/skybox/skybox5.jpg",
+        };
+        skybox = GLCache.LoadCubemap(Faces, image_flags::IMG_FORCE_RGB | image_flags::IMG_COMPRESS, &texWidth);
+        texHeight = texWidth;
+        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
 
         // Texture filters
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -326,14 +275,10 @@ demo_reflection::~demo_reflection()
 {
     // Cleanup GL
     glDeleteTextures(1, &Texture);
-    glDeleteTextures(1, &customTexture);
-    glDeleteTextures(1, &skybox);
+    GLCache.ReleaseTexture(customTexture);
+    GLCache.ReleaseTexture(skybox);
     glDeleteTextures(1, &reflectionCubemap);
 
-    glDeleteBuffers(1, &VertexBuffer);
-    glDeleteBuffers(1, &cubeVertexBuffer);
-    glDeleteBuffers(1, &sphereVertexBuffer);
-
     glDeleteVertexArrays(1, &VAO);
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &sphereVAO);
@@ -395,14 +340,14 @@ void demo_reflection::Render(const platform_io& IO, bool renderMirrorEffects, ca
         glUniformMatrix4fv(glGetUniformLocation(Program, "uModelViewProj"), 1, GL_FALSE, mvp.e);
 
         glBindVertexArray(sphereVAO);
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertexCount);
+        GL::DrawMeshLod(*sphere, 0);
 
         ModelMatrix = Mat4::Translate({ 3.f, 0.f, 0.f });
         mvp = ProjectionMatrix * ViewMatrix * ModelMatrix;
         glUniformMatrix4fv(glGetUniformLocation(Program, "uModelViewProj"), 1, GL_FALSE, mvp.e);
 
         glBindTexture(GL_TEXTURE_2D, Texture);
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertexCount);
+        GL::DrawMeshLod(*sphere, 0);
     }
 
     glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
@@ -436,7 +381,7 @@ void demo_reflection::Render(const platform_io& IO, bool renderMirrorEffects, ca
         glUniformMatrix4fv(glGetUniformLocation(showRefraction ? RFRProgram : RFXProgram, "uModel"), 1, GL_FALSE, ModelMatrix.e);
 
         glBindVertexArray(sphereVAO);
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertexCount);
+        GL::DrawMeshLod(*sphere, 0);
     }
 
     // Skybox
@@ -454,7 +399,7 @@ void demo_reflection::Render(const platform_io& IO, bool renderMirrorEffects, ca
         glUniformMatrix4fv(glGetUniformLocation(SBProgram, "uViewProj"), 1, GL_FALSE, vp.e);
         glBindVertexArray(cubeVAO);
         glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        GL::DrawMeshLod(*cube, 0);
 
         glDepthMask(GL_TRUE);
     }
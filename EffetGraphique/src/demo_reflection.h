@@ -3,18 +3,21 @@
 #include "demo.h"
 
 #include "opengl_headers.h"
+#include "opengl_helpers.h"
 
 #include "camera.h"
 
 class demo_reflection : public demo
 {
 public:
-    demo_reflection();
+    demo_reflection(GL::cache& GLCache);
     virtual ~demo_reflection();
     virtual void Update(const platform_io& IO);
     void DisplayDebugUI();
     void Render(const platform_io& IO, bool renderMirrorEffects, camera* customCamera = nullptr, mat4* projMat = nullptr);
 private:
+    GL::cache& GLCache;
+
     void CreateCubemapFromModelMat(mat4 modelMat, const platform_io& IO);
 
     // 3d camera
@@ -32,20 +35,17 @@ private:
     GLuint skybox = 0;
     GLuint reflectionCubemap = 0;
 
-    // Meshes
+    // Meshes (owned by GL::cache)
     // Quad
     GLuint VAO = 0;
-    GLuint VertexBuffer = 0;
-    int VertexCount = 0;
+    const GL::mesh* Quad = nullptr;
 
     // Cube
     GLuint cubeVAO = 0;
-    GLuint cubeVertexBuffer = 0;
-    int cubeVertexCount = 0;
+    const GL::mesh* cube = nullptr;
 
     GLuint sphereVAO = 0;
-    GLuint sphereVertexBuffer = 0;
-    int sphereVertexCount = 0;
+    const GL::mesh* sphere = nullptr;
 
     int texWidth = 0;
     int texHeight = 0;
@@ -181,7 +181,7 @@ demo_shader::demo_shader(GL::cache& GLCache, GL::debug& GLDebug)
         glGenVertexArrays(1, &VAO);
         glBindVertexArray(VAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, ShaderScene.MeshBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, ShaderScene.MeshRange->VertexBuffer);
 
         vertex_descriptor& Desc = ShaderScene.MeshDesc;
         glEnableVertexAttribArray(0);
@@ -291,5 +291,5 @@ void demo_shader::Render(const mat4& ProjectionMatrix, const mat4& ViewMatrix, c
     glUniform1f(glGetUniformLocation(Program, "uShininess"), shininess);
 
     glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, ShaderScene.MeshVertexCount);
+    glDrawArrays(GL_TRIANGLES, ShaderScene.MeshRange->BaseVertex, ShaderScene.MeshRange->VertexCount);
 }
\ No newline at end of file
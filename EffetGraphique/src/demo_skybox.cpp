@@ -6,6 +6,7 @@
 #include "opengl_helpers.h"
 #include "maths.h"
 #include "mesh.h"
+#include "typed_vertex_layout.h"
 #include "color.h"
 
 #include "demo_skybox.h"
@@ -20,6 +21,10 @@ struct vertex
     v2 UV;
 };
 
+typedef typed_vertex_layout<vertex,
+    position_attribute<vertex, &vertex::Position, 0>,
+    uv_attribute<vertex, &vertex::UV, 1>> vertex_layout_type;
+
 #pragma region SHADERS
 #pragma region BASE SHADER
 static const char* gVertexShaderStr = R"GLSL(
@@ -89,56 +94,24 @@ void main()
 #pragma endregion
 #pragma endregion
 
-static void DrawQuad(GLuint Program, mat4 ModelViewProj)
+static void DrawQuad(GLuint Program, const GL::mesh& Quad, mat4 ModelViewProj)
 {
     glUniformMatrix4fv(glGetUniformLocation(Program, "uModelViewProj"), 1, GL_FALSE, ModelViewProj.e);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    GL::DrawMeshLod(Quad, 0);
 }
 
 #pragma region CONSTRUCTOR/DESTRUCTOR
-demo_skybox::demo_skybox()
+demo_skybox::demo_skybox(GL::cache& GLCache)
+    : GLCache(GLCache)
 {
     // Create render pipeline
     this->Program = GL::CreateProgram(gVertexShaderStr, gFragmentShaderStr);
     SBProgram = GL::CreateProgram(sbVertexShaderStr, sbFragmentShaderStr);
-    // Gen mesh
-    {
-        // Create a descriptor based on the `struct vertex` format
-        vertex_descriptor Descriptor = {};
-        Descriptor.Stride = sizeof(vertex);
-        Descriptor.HasUV = true;
-        Descriptor.PositionOffset = OFFSETOF(vertex, Position);
-        Descriptor.UVOffset = OFFSETOF(vertex, UV);
-
-        // Create a quad in RAM
-        vertex Quad[6];
-        this->VertexCount = 6;
-        Mesh::BuildQuad(Quad, Quad + this->VertexCount, Descriptor);
-
-        // Upload quad to gpu (VRAM)
-        glGenBuffers(1, &this->VertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, this->VertexCount * sizeof(vertex), Quad, GL_STATIC_DRAW);
-    }
-
-    // Gen cube
+    // Get meshes (shared with the demos using the same vertex format)
     {
-        // Create a descriptor based on the `struct vertex` format
-        vertex_descriptor Descriptor = {};
-        Descriptor.Stride = sizeof(vertex);
-        Descriptor.HasUV = true;
-        Descriptor.PositionOffset = OFFSETOF(vertex, Position);
-        Descriptor.UVOffset = OFFSETOF(vertex, UV);
-
-        // Create a cube in RAM
-        vertex Cube[36];
-        cubeVertexCount = 36;
-        Mesh::BuildNormalizedCube(Cube, Cube + cubeVertexCount, Descriptor);
-
-        // Upload cube to gpu (VRAM)
-        glGenBuffers(1, &cubeVertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, cubeVertexCount * sizeof(vertex), Cube, GL_STATIC_DRAW);
+        // Vertices converted to the `struct vertex` format by its typed layout
+        Quad = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_QUAD);
+        cube = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_NORMALIZED_CUBE);
     }
 
     // Gen texture
@@ -152,17 +125,14 @@ demo_skybox::demo_skybox()
 
     // Gen skybox
     {
-        std::string sbName = "media/skybox/skybox";
-        std::string fileExtension = ".jpg";
-
-        glGenTextures(1, &skybox);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-
-        for (int i = 0; i < 6; i++)
+        const char* Faces[6] =
         {
-            std::string texName = sbName + std::to_string(i) + fileExtension;
-            GL::UploadCubemapTexture(texName.c_str(), i, image_flags::IMG_FORCE_RGB, &texWidth, &texHeight);
-        }
+            "media/skybox/skybox0.jpg", "media/skybox/skybox1.jpg", "media/skybox/skybox2.jpg",
+            "media/skybox/skybox3.jpg", "media/skybox/skybox4.jpg", "media/skybox/skybox5.jpg",
+        };
+        skybox = GLCache.LoadCubemap(Faces, image_flags::IMG_FORCE_RGB | image_flags::IMG_COMPRESS, &texWidth);
+        texHeight = texWidth;
+        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
 
         // Texture filters
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -174,29 +144,21 @@ demo_skybox::demo_skybox()
     }
 
     // Create quad vertex array
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VertexBuffer);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, UV));
+    VAO = vertex_layout_type::CreateVertexArray(Quad->VertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Quad->IndexBuffer);
 
     // Create cube vertex array
-    glGenVertexArrays(1, &cubeVAO);
-    glBindVertexArray(cubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->cubeVertexBuffer);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)OFFSETOF(vertex, Position));
+    cubeVAO = vertex_layout_type::CreateVertexArray(cube->VertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cube->IndexBuffer);
 }
 
 demo_skybox::~demo_skybox()
 {
     // Cleanup GL
     glDeleteTextures(1, &Texture);
-    glDeleteTextures(1, &skybox);
-    glDeleteBuffers(1, &VertexBuffer);
+    GLCache.ReleaseTexture(skybox);
     glDeleteVertexArrays(1, &VAO);
+    glDeleteVertexArrays(1, &cubeVAO);
     glDeleteProgram(Program);
     glDeleteProgram(SBProgram);
 }
@@ -234,9 +196,9 @@ void demo_skybox::Update(const platform_io& IO)
     {
         mat4 ModelMatrix = Mat4::Translate(ObjectPosition);
         debugMatrix = ModelMatrix;
-        DrawQuad(Program, ProjectionMatrix * ViewMatrix * ModelMatrix);
+        DrawQuad(Program, *Quad, ProjectionMatrix * ViewMatrix * ModelMatrix);
         ModelMatrix = ModelMatrix * Mat4::RotateY(-1.f, 0.f);
-        DrawQuad(Program, ProjectionMatrix * ViewMatrix * ModelMatrix);
+        DrawQuad(Program, *Quad, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
     mat4 rotateOnlyViewMatrix = ViewMatrix;
@@ -250,7 +212,7 @@ void demo_skybox::Update(const platform_io& IO)
     glUniformMatrix4fv(glGetUniformLocation(SBProgram, "uViewProj"), 1, GL_FALSE, vp.e);
     glBindVertexArray(cubeVAO);
     glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    GL::DrawMeshLod(*cube, 0);
     glDepthMask(GL_TRUE);
 
     DisplayDebugUI();
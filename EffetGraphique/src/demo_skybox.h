@@ -3,17 +3,20 @@
 #include "demo.h"
 
 #include "opengl_headers.h"
+#include "opengl_helpers.h"
 
 #include "camera.h"
 
 class demo_skybox : public demo
 {
 public:
-    demo_skybox();
+    demo_skybox(GL::cache& GLCache);
     virtual ~demo_skybox();
     virtual void Update(const platform_io& IO);
     void DisplayDebugUI();
 private:
+    GL::cache& GLCache;
+
     // 3d camera
     camera Camera = {};
     
@@ -25,14 +28,12 @@ private:
     GLuint Texture = 0;
     GLuint skybox = 0;
 
-    // Meshes
+    // Meshes (owned by GL::cache)
     GLuint VAO = 0;
-    GLuint VertexBuffer = 0;
-    int VertexCount = 0;
+    const GL::mesh* Quad = nullptr;
 
     GLuint cubeVAO = 0;
-    GLuint cubeVertexBuffer = 0;
-    int cubeVertexCount = 0;
+    const GL::mesh* cube = nullptr;
 
     int texWidth = 0;
     int texHeight = 0;
@@ -0,0 +1,161 @@
+
+#include <cstdio>
+
+#include "asset_pack.h"
+#include "file_mapping.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static asset_pack MountedPack;
+
+static bool MapFromPack(file_mapping& Mapping, const pack_entry& Entry)
+{
+    if (Entry.Size == 0)
+        return false;
+
+    if (Entry.Compression == PACK_STORED)
+    {
+        Mapping.Data = Pack::GetData(MountedPack, Entry);
+        Mapping.Size = (size_t)Entry.Size;
+        Mapping.Source = FILE_PACKED;
+        return true;
+    }
+
+    uint8_t* Data = new uint8_t[(size_t)Entry.Size];
+    if (!Pack::Decompress(MountedPack, Entry, Data))
+    {
+        fprintf(stderr, "Corrupted pack entry: %.*s\n", (int)Entry.NameLength, MountedPack.Names + Entry.NameOffset);
+        delete[] Data;
+        return false;
+    }
+    Mapping.Data = Data;
+    Mapping.Size = (size_t)Entry.Size;
+    Mapping.Source = FILE_DECOMPRESSED;
+    return true;
+}
+
+bool File::Map(file_mapping& Mapping, const char* Filename)
+{
+    Mapping = {};
+
+    if (const pack_entry* Entry = Pack::Find(MountedPack, Filename))
+        return MapFromPack(Mapping, *Entry);
+
+#ifdef _WIN32
+    HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (FileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(FileHandle, &FileSize) || FileSize.QuadPart == 0)
+    {
+        CloseHandle(FileHandle);
+        return false;
+    }
+
+    // The mapping object keeps the file open
+    HANDLE MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(FileHandle);
+    if (MappingHandle == nullptr)
+        return false;
+
+    void* Data = MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (Data == nullptr)
+    {
+        CloseHandle(MappingHandle);
+        return false;
+    }
+
+    Mapping.Data = Data;
+    Mapping.Size = (size_t)FileSize.QuadPart;
+    Mapping.Handle = MappingHandle;
+#else
+    int FileDescriptor = open(Filename, O_RDONLY);
+    if (FileDescriptor < 0)
+        return false;
+
+    struct stat FileStat;
+    if (fstat(FileDescriptor, &FileStat) != 0 || FileStat.st_size == 0)
+    {
+        close(FileDescriptor);
+        return false;
+    }
+
+    // The mapping keeps the file open
+    void* Data = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+    close(FileDescriptor);
+    if (Data == MAP_FAILED)
+        return false;
+
+    Mapping.Data = Data;
+    Mapping.Size = (size_t)FileStat.st_size;
+#endif
+
+    return true;
+}
+
+void File::Unmap(file_mapping& Mapping)
+{
+    if (Mapping.Data == nullptr)
+        return;
+
+    if (Mapping.Source != FILE_MAPPED)
+    {
+        if (Mapping.Source == FILE_DECOMPRESSED)
+            delete[] (const uint8_t*)Mapping.Data;
+        Mapping = {};
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(Mapping.Data);
+    CloseHandle((HANDLE)Mapping.Handle);
+#else
+    munmap((void*)Mapping.Data, Mapping.Size);
+#endif
+
+    Mapping = {};
+}
+
+bool File::GetSize(const char* Filename, uint64_t* Size)
+{
+    if (const pack_entry* Entry = Pack::Find(MountedPack, Filename))
+    {
+        *Size = Entry->Size;
+        return true;
+    }
+
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA Attributes;
+    if (!GetFileAttributesExA(Filename, GetFileExInfoStandard, &Attributes))
+        return false;
+    *Size = ((uint64_t)Attributes.nFileSizeHigh << 32) | Attributes.nFileSizeLow;
+#else
+    struct stat FileStat;
+    if (stat(Filename, &FileStat) != 0)
+        return false;
+    *Size = (uint64_t)FileStat.st_size;
+#endif
+
+    return true;
+}
+
+bool File::MountPack(const char* Filename)
+{
+    UnmountPack();
+    return Pack::Open(MountedPack, Filename);
+}
+
+void File::UnmountPack()
+{
+    Pack::Close(MountedPack);
+}
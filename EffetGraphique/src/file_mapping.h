@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum file_mapping_source
+{
+    FILE_MAPPED,       // Mapped from disk
+    FILE_PACKED,       // Stored in the mounted pack, Data points in its mapping
+    FILE_DECOMPRESSED, // Compressed in the mounted pack, Data is a buffer owned by the mapping
+};
+
+// Read-only memory mapped file
+struct file_mapping
+{
+    const void* Data;
+    size_t Size;
+    void* Handle; // HANDLE of the file mapping object (Windows only)
+    file_mapping_source Source;
+};
+
+namespace File
+{
+
+// Map the whole file in memory (from the mounted pack when it has the file), returns false if the file can't be opened or is empty
+bool Map(file_mapping& Mapping, const char* Filename);
+void Unmap(file_mapping& Mapping);
+// Size in bytes without opening the file, returns false if it doesn't exist
+bool GetSize(const char* Filename, uint64_t* Size);
+
+// Resolve Map and GetSize through an asset pack before the disk (see Pack::Write)
+// Mount before the loading threads start, files mapped from the pack must be unmapped before UnmountPack
+bool MountPack(const char* Filename);
+void UnmountPack();
+}
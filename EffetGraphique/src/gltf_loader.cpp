@@ -0,0 +1,548 @@
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "maths.h"
+#include "json.h"
+#include "obj_parser.h"
+#include "gltf_loader.h"
+
+using namespace Mesh;
+
+// .glb: [uint32_t Magic][uint32_t Version][uint32_t Length] then chunks [uint32_t Length][uint32_t Type][data], little endian
+const uint32_t GLB_MAGIC      = 0x46546C67; // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+const uint32_t GLB_CHUNK_BIN  = 0x004E4942; // "BIN\0"
+
+const uint32_t GLTF_BYTE           = 5120;
+const uint32_t GLTF_UNSIGNED_BYTE  = 5121;
+const uint32_t GLTF_SHORT          = 5122;
+const uint32_t GLTF_UNSIGNED_SHORT = 5123;
+const uint32_t GLTF_UNSIGNED_INT   = 5125;
+const uint32_t GLTF_FLOAT          = 5126;
+const int GLTF_MODE_TRIANGLES      = 4;
+
+// Parsed JSON and the arrays used by index
+struct gltf_document
+{
+    std::vector<json_node> Json;
+    std::vector<int> Accessors;
+    std::vector<int> BufferViews;
+};
+
+static int GetGltfComponentSize(uint32_t ComponentType)
+{
+    switch (ComponentType)
+    {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:  return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT: return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:          return 4;
+    default:                  return 0;
+    }
+}
+
+static int GetGltfComponentCount(const char* Type)
+{
+    if (strcmp(Type, "SCALAR") == 0) return 1;
+    if (strcmp(Type, "VEC2") == 0)   return 2;
+    if (strcmp(Type, "VEC3") == 0)   return 3;
+    if (strcmp(Type, "VEC4") == 0)   return 4;
+    return 0;
+}
+
+static v3 GetGltfVec3(const std::vector<json_node>& Json, int Array, v3 Default)
+{
+    std::vector<int> Elements;
+    Json::GetChildren(Json, Array, Elements);
+    if (Elements.size() < 3)
+        return Default;
+    return { (float)Json::GetNumber(Json, Elements[0], Default.x), (float)Json::GetNumber(Json, Elements[1], Default.y), (float)Json::GetNumber(Json, Elements[2], Default.z) };
+}
+
+// Check the accessor against its buffer view and buffer, the attribute then points in place in the buffer
+static bool ReadGltfAccessor(gltf_attribute& Attribute, int* Count, const gltf_document& Doc, const gltf_scene& Scene, int Accessor)
+{
+    const std::vector<json_node>& Json = Doc.Json;
+    Attribute = {};
+    Attribute.Buffer = -1;
+    if (Accessor < 0 || Accessor >= (int)Doc.Accessors.size())
+        return false;
+
+    int AccessorNode = Doc.Accessors[Accessor];
+    if (Json::Find(Json, AccessorNode, "sparse") >= 0)
+    {
+        fprintf(stderr, "Sparse glTF accessors are not supported (accessor %d)\n", Accessor);
+        return false;
+    }
+
+    int View = Json::GetInt(Json, Json::Find(Json, AccessorNode, "bufferView"), -1);
+    if (View < 0 || View >= (int)Doc.BufferViews.size())
+    {
+        fprintf(stderr, "glTF accessor %d has no buffer view\n", Accessor);
+        return false;
+    }
+    int ViewNode = Doc.BufferViews[View];
+
+    Attribute.Buffer = Json::GetInt(Json, Json::Find(Json, ViewNode, "buffer"), -1);
+    Attribute.ComponentType = (uint32_t)Json::GetInt(Json, Json::Find(Json, AccessorNode, "componentType"), 0);
+    Attribute.ComponentCount = GetGltfComponentCount(Json::GetString(Json, Json::Find(Json, AccessorNode, "type"), ""));
+    Attribute.Normalized = Json::GetBool(Json, Json::Find(Json, AccessorNode, "normalized"), false);
+    *Count = Json::GetInt(Json, Json::Find(Json, AccessorNode, "count"), 0);
+
+    int ComponentSize = GetGltfComponentSize(Attribute.ComponentType);
+    int ElementSize = ComponentSize * Attribute.ComponentCount;
+    int ViewOffset = Json::GetInt(Json, Json::Find(Json, ViewNode, "byteOffset"), 0);
+    int ViewLength = Json::GetInt(Json, Json::Find(Json, ViewNode, "byteLength"), 0);
+    int AccessorOffset = Json::GetInt(Json, Json::Find(Json, AccessorNode, "byteOffset"), 0);
+    Attribute.Stride = Json::GetInt(Json, Json::Find(Json, ViewNode, "byteStride"), ElementSize);
+    Attribute.Offset = (uint32_t)(ViewOffset + AccessorOffset);
+
+    if (Attribute.Buffer < 0 || Attribute.Buffer >= (int)Scene.Buffers.size() || ElementSize == 0 || *Count <= 0
+        || ViewOffset < 0 || ViewLength < 0 || AccessorOffset < 0 || Attribute.Stride < ElementSize
+        || (uint64_t)ViewOffset + ViewLength > Scene.Buffers[Attribute.Buffer].Size
+        || (uint64_t)AccessorOffset + (uint64_t)(*Count - 1) * Attribute.Stride + ElementSize > (uint64_t)ViewLength)
+    {
+        fprintf(stderr, "Invalid glTF accessor %d\n", Accessor);
+        return false;
+    }
+
+    // GL reads the attributes in place: they must be aligned on their component size
+    if (Attribute.Offset % ComponentSize != 0 || Attribute.Stride % ComponentSize != 0)
+    {
+        fprintf(stderr, "Misaligned glTF accessor %d\n", Accessor);
+        return false;
+    }
+    return true;
+}
+
+// Layout for Mesh:: vertex functions when the float attributes are interleaved in one buffer with the same stride
+static void BuildGltfDescriptor(gltf_primitive& Primitive)
+{
+    Primitive.Descriptor = {};
+    Primitive.VertexOffset = 0;
+
+    const gltf_attribute* Attributes[3] = { &Primitive.Position, &Primitive.Normal, &Primitive.TexCoord };
+    uint32_t Base = Primitive.Position.Offset;
+    for (const gltf_attribute* Attribute : Attributes)
+    {
+        if (Attribute->Buffer < 0)
+            continue;
+        if (Attribute->ComponentType != GLTF_FLOAT || Attribute->Buffer != Primitive.Position.Buffer || Attribute->Stride != Primitive.Position.Stride)
+            return;
+        Base = Math::Min(Base, Attribute->Offset);
+    }
+    for (const gltf_attribute* Attribute : Attributes)
+    {
+        if (Attribute->Buffer >= 0 && Attribute->Offset - Base + Attribute->ComponentCount * sizeof(float) > (uint32_t)Primitive.Position.Stride)
+            return;
+    }
+
+    Primitive.VertexOffset = Base;
+    Primitive.Descriptor.Stride = Primitive.Position.Stride;
+    Primitive.Descriptor.PositionOffset = (int)(Primitive.Position.Offset - Base);
+    Primitive.Descriptor.HasNormal = Primitive.Normal.Buffer >= 0;
+    Primitive.Descriptor.NormalOffset = Primitive.Descriptor.HasNormal ? (int)(Primitive.Normal.Offset - Base) : 0;
+    Primitive.Descriptor.HasUV = Primitive.TexCoord.Buffer >= 0;
+    Primitive.Descriptor.UVOffset = Primitive.Descriptor.HasUV ? (int)(Primitive.TexCoord.Offset - Base) : 0;
+}
+
+static bool ReadGltfPrimitive(gltf_primitive& Primitive, const gltf_document& Doc, const gltf_scene& Scene, int PrimitiveNode)
+{
+    const std::vector<json_node>& Json = Doc.Json;
+    Primitive = {};
+    Primitive.Normal.Buffer = -1;
+    Primitive.TexCoord.Buffer = -1;
+    Primitive.Indices.Buffer = -1;
+
+    int Attributes = Json::Find(Json, PrimitiveNode, "attributes");
+    int PositionAccessor = Json::GetInt(Json, Json::Find(Json, Attributes, "POSITION"), -1);
+    if (!ReadGltfAccessor(Primitive.Position, &Primitive.VertexCount, Doc, Scene, PositionAccessor))
+        return false;
+    if (Primitive.Position.ComponentType != GLTF_FLOAT || Primitive.Position.ComponentCount != 3)
+    {
+        fprintf(stderr, "glTF positions must be float vec3\n");
+        return false;
+    }
+    int PositionNode = Doc.Accessors[PositionAccessor];
+    Primitive.BoundsMin = GetGltfVec3(Json, Json::Find(Json, PositionNode, "min"), { 0.f, 0.f, 0.f });
+    Primitive.BoundsMax = GetGltfVec3(Json, Json::Find(Json, PositionNode, "max"), { 0.f, 0.f, 0.f });
+
+    // Optional attributes must have as many elements as the positions
+    int Count = 0;
+    int NormalAccessor = Json::GetInt(Json, Json::Find(Json, Attributes, "NORMAL"), -1);
+    if (NormalAccessor >= 0 && (!ReadGltfAccessor(Primitive.Normal, &Count, Doc, Scene, NormalAccessor) || Count != Primitive.VertexCount))
+        return false;
+    int TexCoordAccessor = Json::GetInt(Json, Json::Find(Json, Attributes, "TEXCOORD_0"), -1);
+    if (TexCoordAccessor >= 0 && (!ReadGltfAccessor(Primitive.TexCoord, &Count, Doc, Scene, TexCoordAccessor) || Count != Primitive.VertexCount))
+        return false;
+
+    int IndicesAccessor = Json::GetInt(Json, Json::Find(Json, PrimitiveNode, "indices"), -1);
+    if (IndicesAccessor >= 0)
+    {
+        if (!ReadGltfAccessor(Primitive.Indices, &Primitive.IndexCount, Doc, Scene, IndicesAccessor))
+            return false;
+        // Indices are read by glDrawElements: they must be tightly packed
+        uint32_t IndexType = Primitive.Indices.ComponentType;
+        if ((IndexType != GLTF_UNSIGNED_BYTE && IndexType != GLTF_UNSIGNED_SHORT && IndexType != GLTF_UNSIGNED_INT)
+            || Primitive.Indices.ComponentCount != 1 || Primitive.Indices.Stride != GetGltfComponentSize(IndexType))
+        {
+            fprintf(stderr, "Invalid glTF indices (accessor %d)\n", IndicesAccessor);
+            return false;
+        }
+    }
+
+    Primitive.Material = Json::GetInt(Json, Json::Find(Json, PrimitiveNode, "material"), -1);
+    BuildGltfDescriptor(Primitive);
+    return true;
+}
+
+// Local = T * R * S, or the node matrix (column major as mat4)
+static mat4 GetGltfLocalTransform(const std::vector<json_node>& Json, int Node)
+{
+    std::vector<int> Elements;
+    Json::GetChildren(Json, Json::Find(Json, Node, "matrix"), Elements);
+    if (Elements.size() == 16)
+    {
+        mat4 Matrix;
+        for (int i = 0; i < 16; ++i)
+            Matrix.e[i] = (float)Json::GetNumber(Json, Elements[i], 0.0);
+        return Matrix;
+    }
+
+    v3 T = GetGltfVec3(Json, Json::Find(Json, Node, "translation"), { 0.f, 0.f, 0.f });
+    v3 S = GetGltfVec3(Json, Json::Find(Json, Node, "scale"), { 1.f, 1.f, 1.f });
+    float Q[4] = { 0.f, 0.f, 0.f, 1.f };
+    Json::GetChildren(Json, Json::Find(Json, Node, "rotation"), Elements);
+    if (Elements.size() == 4)
+    {
+        for (int i = 0; i < 4; ++i)
+            Q[i] = (float)Json::GetNumber(Json, Elements[i], Q[i]);
+    }
+
+    float X = Q[0], Y = Q[1], Z = Q[2], W = Q[3];
+    return
+    {
+        (1.f - 2.f * (Y * Y + Z * Z)) * S.x, 2.f * (X * Y + W * Z) * S.x, 2.f * (X * Z - W * Y) * S.x, 0.f,
+        2.f * (X * Y - W * Z) * S.y, (1.f - 2.f * (X * X + Z * Z)) * S.y, 2.f * (Y * Z + W * X) * S.y, 0.f,
+        2.f * (X * Z + W * Y) * S.z, 2.f * (Y * Z - W * X) * S.z, (1.f - 2.f * (X * X + Y * Y)) * S.z, 0.f,
+        T.x, T.y, T.z, 1.f,
+    };
+}
+
+// Breadth first from the scene roots so the parents come first, nodes out of the scene are dropped
+static void ReadGltfNodes(gltf_scene& Scene, const std::vector<json_node>& Json)
+{
+    std::vector<int> NodeArray;
+    Json::GetChildren(Json, Json::Find(Json, 0, "nodes"), NodeArray);
+
+    std::vector<int> Roots;
+    std::vector<int> Scenes;
+    Json::GetChildren(Json, Json::Find(Json, 0, "scenes"), Scenes);
+    int SceneIndex = Json::GetInt(Json, Json::Find(Json, 0, "scene"), 0);
+    if (SceneIndex >= 0 && SceneIndex < (int)Scenes.size())
+    {
+        Json::GetChildren(Json, Json::Find(Json, Scenes[SceneIndex], "nodes"), Roots);
+        for (int& Root : Roots)
+            Root = Json::GetInt(Json, Root, -1);
+    }
+    else
+    {
+        // No scene: every node without parent is a root
+        std::vector<bool> HasParent(NodeArray.size(), false);
+        std::vector<int> Children;
+        for (int Node : NodeArray)
+        {
+            Json::GetChildren(Json, Json::Find(Json, Node, "children"), Children);
+            for (int Child : Children)
+            {
+                int ChildIndex = Json::GetInt(Json, Child, -1);
+                if (ChildIndex >= 0 && ChildIndex < (int)NodeArray.size())
+                    HasParent[ChildIndex] = true;
+            }
+        }
+        for (int i = 0; i < (int)NodeArray.size(); ++i)
+        {
+            if (!HasParent[i])
+                Roots.push_back(i);
+        }
+    }
+
+    // Queue of (source node, parent in Scene.Nodes)
+    std::vector<bool> Visited(NodeArray.size(), false);
+    std::vector<std::pair<int, int>> Queue;
+    for (int Root : Roots)
+        Queue.push_back({ Root, -1 });
+
+    std::vector<int> Children;
+    for (size_t Next = 0; Next < Queue.size(); ++Next)
+    {
+        int Source = Queue[Next].first;
+        if (Source < 0 || Source >= (int)NodeArray.size() || Visited[Source])
+            continue;
+        Visited[Source] = true;
+
+        int SourceNode = NodeArray[Source];
+        gltf_node Node = {};
+        Node.Parent = Queue[Next].second;
+        Node.Mesh = Json::GetInt(Json, Json::Find(Json, SourceNode, "mesh"), -1);
+        if (Node.Mesh >= (int)Scene.Meshes.size())
+            Node.Mesh = -1;
+        Node.Local = GetGltfLocalTransform(Json, SourceNode);
+        int Index = (int)Scene.Nodes.size();
+        Scene.Nodes.push_back(Node);
+
+        Json::GetChildren(Json, Json::Find(Json, SourceNode, "children"), Children);
+        for (int Child : Children)
+            Queue.push_back({ Json::GetInt(Json, Child, -1), Index });
+    }
+
+    UpdateGltfTransforms(Scene.Nodes);
+}
+
+static void ReadGltfMaterials(gltf_scene& Scene, const std::vector<json_node>& Json)
+{
+    std::vector<int> Materials, Textures, Images;
+    Json::GetChildren(Json, Json::Find(Json, 0, "materials"), Materials);
+    Json::GetChildren(Json, Json::Find(Json, 0, "textures"), Textures);
+    Json::GetChildren(Json, Json::Find(Json, 0, "images"), Images);
+
+    for (int MaterialNode : Materials)
+    {
+        mesh_material Material = {};
+        snprintf(Material.Name, sizeof(Material.Name), "%s", Json::GetString(Json, Json::Find(Json, MaterialNode, "name"), ""));
+
+        int Pbr = Json::Find(Json, MaterialNode, "pbrMetallicRoughness");
+        Material.Diffuse = GetGltfVec3(Json, Json::Find(Json, Pbr, "baseColorFactor"), { 1.f, 1.f, 1.f });
+
+        // Blinn-Phong exponent close to the roughness
+        float Roughness = Math::Max(0.05f, (float)Json::GetNumber(Json, Json::Find(Json, Pbr, "roughnessFactor"), 1.0));
+        Material.Shininess = 2.f / (Roughness * Roughness * Roughness * Roughness) - 2.f;
+        Material.Specular = { 0.04f, 0.04f, 0.04f };
+
+        // Only images referenced by uri (images in buffer views are skipped)
+        int Texture = Json::GetInt(Json, Json::Find(Json, Json::Find(Json, Pbr, "baseColorTexture"), "index"), -1);
+        int Image = (Texture >= 0 && Texture < (int)Textures.size()) ? Json::GetInt(Json, Json::Find(Json, Textures[Texture], "source"), -1) : -1;
+        const char* Uri = (Image >= 0 && Image < (int)Images.size()) ? Json::GetString(Json, Json::Find(Json, Images[Image], "uri"), "") : "";
+        if (strncmp(Uri, "data:", 5) != 0)
+            snprintf(Material.DiffuseMap, sizeof(Material.DiffuseMap), "%s", Uri);
+
+        Scene.Materials.push_back(Material);
+    }
+}
+
+static bool ReadFileU32(const uint8_t* Data, size_t Size, size_t Offset, uint32_t* Value)
+{
+    if (Offset + sizeof(uint32_t) > Size)
+        return false;
+    memcpy(Value, Data + Offset, sizeof(uint32_t));
+    return true;
+}
+
+// JSON chunk and optional binary chunk of a .glb
+static bool ReadGlbChunks(const uint8_t* Data, size_t Size, const char** JsonText, size_t* JsonSize, gltf_buffer* Bin)
+{
+    uint32_t Magic = 0, Version = 0, Length = 0;
+    if (!ReadFileU32(Data, Size, 0, &Magic) || !ReadFileU32(Data, Size, 4, &Version) || !ReadFileU32(Data, Size, 8, &Length)
+        || Magic != GLB_MAGIC || Version != 2 || Length > Size)
+        return false;
+
+    *JsonText = nullptr;
+    *Bin = {};
+    for (size_t Offset = 12; Offset + 8 <= Length;)
+    {
+        uint32_t ChunkLength = 0, ChunkType = 0;
+        ReadFileU32(Data, Size, Offset, &ChunkLength);
+        ReadFileU32(Data, Size, Offset + 4, &ChunkType);
+        Offset += 8;
+        if (ChunkLength > Length - Offset)
+            return false;
+
+        if (ChunkType == GLB_CHUNK_JSON && *JsonText == nullptr)
+        {
+            *JsonText = (const char*)Data + Offset;
+            *JsonSize = ChunkLength;
+        }
+        else if (ChunkType == GLB_CHUNK_BIN && Bin->Data == nullptr)
+        {
+            Bin->Data = Data + Offset;
+            Bin->Size = ChunkLength;
+        }
+        Offset += (ChunkLength + 3) & ~3u;
+    }
+    return *JsonText != nullptr;
+}
+
+bool Mesh::MapGltf(gltf_scene& Scene, const char* Filename)
+{
+    Scene = {};
+
+    file_mapping Mapping;
+    if (!File::Map(Mapping, Filename))
+    {
+        fprintf(stderr, "Cannot open %s\n", Filename);
+        return false;
+    }
+    Scene.Mappings.push_back(Mapping);
+
+    // .glb starts with its magic, anything else is read as .gltf text
+    const uint8_t* Data = (const uint8_t*)Mapping.Data;
+    const char* JsonText = (const char*)Data;
+    size_t JsonSize = Mapping.Size;
+    gltf_buffer Bin = {};
+    uint32_t Magic = 0;
+    if (ReadFileU32(Data, Mapping.Size, 0, &Magic) && Magic == GLB_MAGIC && !ReadGlbChunks(Data, Mapping.Size, &JsonText, &JsonSize, &Bin))
+    {
+        fprintf(stderr, "Invalid glb file %s\n", Filename);
+        UnmapGltf(Scene);
+        return false;
+    }
+
+    gltf_document Doc;
+    std::string Error;
+    if (!Json::Parse(Doc.Json, JsonText, JsonSize, &Error) || Doc.Json[0].Type != JSON_OBJECT)
+    {
+        fprintf(stderr, "Invalid glTF json in %s: %s\n", Filename, Error.c_str());
+        UnmapGltf(Scene);
+        return false;
+    }
+    const std::vector<json_node>& Json = Doc.Json;
+    Json::GetChildren(Json, Json::Find(Json, 0, "accessors"), Doc.Accessors);
+    Json::GetChildren(Json, Json::Find(Json, 0, "bufferViews"), Doc.BufferViews);
+
+    // Buffers: the binary chunk for the first buffer without uri, mapped files for the others
+    std::string Directory = GetObjDirectory(Filename);
+    std::vector<int> Buffers;
+    Json::GetChildren(Json, Json::Find(Json, 0, "buffers"), Buffers);
+    for (int BufferNode : Buffers)
+    {
+        size_t ByteLength = (size_t)Json::GetNumber(Json, Json::Find(Json, BufferNode, "byteLength"), 0.0);
+        const char* Uri = Json::GetString(Json, Json::Find(Json, BufferNode, "uri"), nullptr);
+        gltf_buffer Buffer = {};
+        if (Uri == nullptr)
+        {
+            Buffer = Bin;
+            Bin = {};
+        }
+        else if (strncmp(Uri, "data:", 5) == 0)
+        {
+            fprintf(stderr, "Embedded glTF buffers are not supported in %s\n", Filename);
+        }
+        else if (File::Map(Mapping, (Directory + Uri).c_str()))
+        {
+            Scene.Mappings.push_back(Mapping);
+            Buffer.Data = (const uint8_t*)Mapping.Data;
+            Buffer.Size = Mapping.Size;
+        }
+
+        if (Buffer.Data == nullptr || Buffer.Size < ByteLength)
+        {
+            fprintf(stderr, "Missing glTF buffer %d in %s\n", (int)Scene.Buffers.size(), Filename);
+            UnmapGltf(Scene);
+            return false;
+        }
+        Buffer.Size = ByteLength;
+        Scene.Buffers.push_back(Buffer);
+    }
+
+    // Meshes: triangle primitives only
+    std::vector<int> Meshes, Primitives;
+    Json::GetChildren(Json, Json::Find(Json, 0, "meshes"), Meshes);
+    for (int MeshNode : Meshes)
+    {
+        gltf_mesh Mesh = {};
+        Mesh.FirstPrimitive = (int)Scene.Primitives.size();
+        Json::GetChildren(Json, Json::Find(Json, MeshNode, "primitives"), Primitives);
+        for (int PrimitiveNode : Primitives)
+        {
+            if (Json::GetInt(Json, Json::Find(Json, PrimitiveNode, "mode"), GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES)
+                continue;
+
+            gltf_primitive Primitive;
+            if (!ReadGltfPrimitive(Primitive, Doc, Scene, PrimitiveNode))
+            {
+                fprintf(stderr, "Invalid glTF primitive in mesh %d of %s\n", (int)Scene.Meshes.size(), Filename);
+                UnmapGltf(Scene);
+                return false;
+            }
+            Scene.Primitives.push_back(Primitive);
+        }
+        Mesh.PrimitiveCount = (int)Scene.Primitives.size() - Mesh.FirstPrimitive;
+        Scene.Meshes.push_back(Mesh);
+    }
+
+    ReadGltfMaterials(Scene, Json);
+    for (gltf_primitive& Primitive : Scene.Primitives)
+    {
+        if (Primitive.Material >= (int)Scene.Materials.size())
+            Primitive.Material = -1;
+    }
+
+    ReadGltfNodes(Scene, Json);
+    return true;
+}
+
+void Mesh::UnmapGltf(gltf_scene& Scene)
+{
+    for (file_mapping& Mapping : Scene.Mappings)
+        File::Unmap(Mapping);
+    Scene = {};
+}
+
+void Mesh::UpdateGltfTransforms(std::vector<gltf_node>& Nodes)
+{
+    for (gltf_node& Node : Nodes)
+        Node.World = Node.Parent < 0 ? Node.Local : Nodes[Node.Parent].World * Node.Local;
+}
+
+void Mesh::ReportGltf(const char* Filename)
+{
+    typedef std::chrono::high_resolution_clock clock;
+
+    // Best of a few imports (the first one also reads the file from disk)
+    double BestTime = 1e30;
+    gltf_scene Scene;
+    for (int i = 0; i < 10; ++i)
+    {
+        UnmapGltf(Scene);
+        clock::time_point Start = clock::now();
+        if (!MapGltf(Scene, Filename))
+            return;
+        BestTime = Math::Min(BestTime, std::chrono::duration<double, std::milli>(clock::now() - Start).count());
+    }
+
+    size_t BufferSize = 0;
+    for (const gltf_buffer& Buffer : Scene.Buffers)
+        BufferSize += Buffer.Size;
+
+    int VertexCount = 0;
+    int TriangleCount = 0;
+    int InterleavedCount = 0;
+    for (const gltf_primitive& Primitive : Scene.Primitives)
+    {
+        VertexCount += Primitive.VertexCount;
+        TriangleCount += (Primitive.Indices.Buffer >= 0 ? Primitive.IndexCount : Primitive.VertexCount) / 3;
+        InterleavedCount += Primitive.Descriptor.Stride != 0 ? 1 : 0;
+    }
+
+    int MaxDepth = 0;
+    std::vector<int> Depths(Scene.Nodes.size(), 0);
+    for (int i = 0; i < (int)Scene.Nodes.size(); ++i)
+    {
+        Depths[i] = Scene.Nodes[i].Parent < 0 ? 0 : Depths[Scene.Nodes[i].Parent] + 1;
+        MaxDepth = Math::Max(MaxDepth, Depths[i]);
+    }
+
+    printf("%s: imported in %.3f ms\n", Filename, BestTime);
+    printf("  %d buffers (%.2f MB, used in place)\n", (int)Scene.Buffers.size(), BufferSize / (1024.0 * 1024.0));
+    printf("  %d meshes, %d primitives (%d interleaved), %d vertices, %d triangles, %d materials\n",
+           (int)Scene.Meshes.size(), (int)Scene.Primitives.size(), InterleavedCount, VertexCount, TriangleCount, (int)Scene.Materials.size());
+    printf("  %d nodes, depth %d\n", (int)Scene.Nodes.size(), MaxDepth);
+
+    UnmapGltf(Scene);
+}
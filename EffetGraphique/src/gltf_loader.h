@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "mesh.h"
+#include "file_mapping.h"
+
+// Accessor read in place in a buffer (no conversion): the layout is given as is to glVertexAttribPointer
+struct gltf_attribute
+{
+    int Buffer;             // -1 when the attribute is missing
+    uint32_t Offset;        // Bytes from the start of the buffer
+    int Stride;             // Bytes between two elements (byteStride or the element size)
+    uint32_t ComponentType; // glTF component types are the GL enums (5126 = GL_FLOAT, 5123 = GL_UNSIGNED_SHORT...)
+    int ComponentCount;
+    bool Normalized;
+};
+
+// Triangles of a glTF mesh with one material
+struct gltf_primitive
+{
+    gltf_attribute Position;
+    gltf_attribute Normal;
+    gltf_attribute TexCoord;
+    gltf_attribute Indices; // Buffer is -1 for non indexed primitives
+    int VertexCount;
+    int IndexCount;
+    int Material;           // -1 without material
+    v3 BoundsMin;           // From the min/max of the position accessor
+    v3 BoundsMax;
+    // When the float attributes are interleaved in one buffer: vertices start at VertexOffset and Descriptor gives their layout
+    // (Descriptor.Stride is 0 for separate streams or non float attributes)
+    uint32_t VertexOffset;
+    vertex_descriptor Descriptor;
+};
+
+struct gltf_mesh
+{
+    int FirstPrimitive;
+    int PrimitiveCount;
+};
+
+// Hierarchy stored flat: a parent is always before its children, so transforms are updated in one pass
+struct gltf_node
+{
+    int Parent; // -1 for roots
+    int Mesh;   // -1 when the node has no mesh
+    mat4 Local;
+    mat4 World; // See UpdateGltfTransforms
+};
+
+struct gltf_buffer
+{
+    const uint8_t* Data;
+    size_t Size;
+};
+
+struct gltf_scene
+{
+    std::vector<gltf_buffer> Buffers;   // Binary chunk of the .glb or mapped .bin files
+    std::vector<gltf_mesh> Meshes;
+    std::vector<gltf_primitive> Primitives;
+    std::vector<mesh_material> Materials;
+    std::vector<gltf_node> Nodes;
+    std::vector<file_mapping> Mappings; // Kept until UnmapGltf, the buffers point in them
+};
+
+namespace Mesh
+{
+
+// Map a .glb (or a .gltf with external .bin buffers): only the JSON is parsed, vertex and index data stay in the mapped files
+// Only triangle primitives are kept; embedded base64 buffers and sparse accessors are not supported
+bool MapGltf(gltf_scene& Scene, const char* Filename);
+void UnmapGltf(gltf_scene& Scene);
+// World = Parent.World * Local, in order
+void UpdateGltfTransforms(std::vector<gltf_node>& Nodes);
+
+// Print the import time and the content of a glTF file
+void ReportGltf(const char* Filename);
+}
@@ -0,0 +1,146 @@
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maths.h"
+#include "jobs.h"
+
+struct job_system
+{
+    std::vector<std::thread> Workers;
+    std::deque<std::function<void()>> Tasks;
+    std::mutex Mutex;
+    std::condition_variable TaskAvailable;
+    bool Quit = false;
+
+    job_system()
+    {
+        int WorkerCount = Math::Max((int)std::thread::hardware_concurrency() - 1, 1);
+        for (int i = 0; i < WorkerCount; ++i)
+            Workers.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    ~job_system()
+    {
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Quit = true;
+        }
+        TaskAvailable.notify_all();
+        for (std::thread& Worker : Workers)
+            Worker.join();
+    }
+
+    void Push(std::function<void()> Task)
+    {
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Tasks.push_back(std::move(Task));
+        }
+        TaskAvailable.notify_one();
+    }
+
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> Task;
+            {
+                std::unique_lock<std::mutex> Lock(Mutex);
+                TaskAvailable.wait(Lock, [this]() { return Quit || !Tasks.empty(); });
+                if (Quit)
+                    return;
+                Task = std::move(Tasks.front());
+                Tasks.pop_front();
+            }
+            Task();
+        }
+    }
+};
+
+static job_system& GetJobSystem()
+{
+    static job_system JobSystem;
+    return JobSystem;
+}
+
+int Jobs::GetThreadCount()
+{
+    return (int)GetJobSystem().Workers.size() + 1;
+}
+
+// Shared with the helper tasks, which can start after ParallelFor has returned (they then find no batch left)
+struct parallel_for_state
+{
+    std::atomic<int> NextBatch;
+    std::atomic<int> DoneBatches;
+    int BatchCount;
+    int BatchSize;
+    int Count;
+    const std::function<void(int, int)>* Function;
+
+    std::mutex Mutex;
+    std::condition_variable Done;
+};
+
+static void RunBatches(parallel_for_state& State)
+{
+    for (;;)
+    {
+        int Batch = State.NextBatch++;
+        if (Batch >= State.BatchCount)
+            return;
+
+        int Begin = Batch * State.BatchSize;
+        (*State.Function)(Begin, Math::Min(Begin + State.BatchSize, State.Count));
+
+        if (++State.DoneBatches == State.BatchCount)
+        {
+            std::lock_guard<std::mutex> Lock(State.Mutex);
+            State.Done.notify_all();
+        }
+    }
+}
+
+void Jobs::ParallelFor(int Count, int BatchSize, const std::function<void(int Begin, int End)>& Function)
+{
+    if (Count <= 0)
+        return;
+
+    BatchSize = Math::Max(BatchSize, 1);
+    int BatchCount = (Count + BatchSize - 1) / BatchSize;
+    if (BatchCount == 1)
+    {
+        Function(0, Count);
+        return;
+    }
+
+    std::shared_ptr<parallel_for_state> State = std::make_shared<parallel_for_state>();
+    State->NextBatch = 0;
+    State->DoneBatches = 0;
+    State->BatchCount = BatchCount;
+    State->BatchSize = BatchSize;
+    State->Count = Count;
+    State->Function = &Function;
+
+    job_system& JobSystem = GetJobSystem();
+    int HelperCount = Math::Min(BatchCount - 1, (int)JobSystem.Workers.size());
+    for (int i = 0; i < HelperCount; ++i)
+        JobSystem.Push([State]() { RunBatches(*State); });
+
+    // The calling thread works too, so this completes even if all workers are busy
+    RunBatches(*State);
+
+    std::unique_lock<std::mutex> Lock(State->Mutex);
+    State->Done.wait(Lock, [&]() { return State->DoneBatches == BatchCount; });
+}
+
+void Jobs::Run(std::function<void()> Function)
+{
+    GetJobSystem().Push(std::move(Function));
+}
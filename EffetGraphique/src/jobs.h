@@ -0,0 +1,18 @@
+#pragma once
+
+#include <functional>
+
+// Minimal thread pool (workers are started on first use)
+namespace Jobs
+{
+
+// Worker threads + calling thread
+int GetThreadCount();
+
+// Call Function(Begin, End) on [0;Count) split in batches of BatchSize, on the workers and the calling thread
+// Returns when all batches are done
+void ParallelFor(int Count, int BatchSize, const std::function<void(int Begin, int End)>& Function);
+
+// Call Function on a worker thread (returns immediately)
+void Run(std::function<void()> Function);
+}
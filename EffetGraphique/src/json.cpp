@@ -0,0 +1,349 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "json.h"
+
+// Nesting limit (the parser is recursive)
+const int JSON_MAX_DEPTH = 256;
+
+struct json_parser
+{
+    const char* Cur;
+    const char* Begin;
+    const char* End;
+    std::vector<json_node>* Nodes;
+    const char* Error;
+};
+
+static void SkipJsonSpaces(json_parser& Parser)
+{
+    while (Parser.Cur < Parser.End && (*Parser.Cur == ' ' || *Parser.Cur == '\t' || *Parser.Cur == '\n' || *Parser.Cur == '\r'))
+        Parser.Cur++;
+}
+
+static bool ParseJsonLiteral(json_parser& Parser, const char* Literal)
+{
+    size_t Length = strlen(Literal);
+    if ((size_t)(Parser.End - Parser.Cur) < Length || memcmp(Parser.Cur, Literal, Length) != 0)
+    {
+        Parser.Error = "invalid literal";
+        return false;
+    }
+    Parser.Cur += Length;
+    return true;
+}
+
+static int ParseJsonHexDigit(char C)
+{
+    if (C >= '0' && C <= '9') return C - '0';
+    if (C >= 'a' && C <= 'f') return C - 'a' + 10;
+    if (C >= 'A' && C <= 'F') return C - 'A' + 10;
+    return -1;
+}
+
+static bool ParseJsonCodeUnit(json_parser& Parser, uint32_t* CodeUnit)
+{
+    if (Parser.End - Parser.Cur < 4)
+        return false;
+    *CodeUnit = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        int Digit = ParseJsonHexDigit(Parser.Cur[i]);
+        if (Digit < 0)
+            return false;
+        *CodeUnit = *CodeUnit * 16 + Digit;
+    }
+    Parser.Cur += 4;
+    return true;
+}
+
+static void AppendUtf8(std::string& String, uint32_t CodePoint)
+{
+    if (CodePoint < 0x80)
+    {
+        String += (char)CodePoint;
+    }
+    else if (CodePoint < 0x800)
+    {
+        String += (char)(0xC0 | (CodePoint >> 6));
+        String += (char)(0x80 | (CodePoint & 0x3F));
+    }
+    else if (CodePoint < 0x10000)
+    {
+        String += (char)(0xE0 | (CodePoint >> 12));
+        String += (char)(0x80 | ((CodePoint >> 6) & 0x3F));
+        String += (char)(0x80 | (CodePoint & 0x3F));
+    }
+    else
+    {
+        String += (char)(0xF0 | (CodePoint >> 18));
+        String += (char)(0x80 | ((CodePoint >> 12) & 0x3F));
+        String += (char)(0x80 | ((CodePoint >> 6) & 0x3F));
+        String += (char)(0x80 | (CodePoint & 0x3F));
+    }
+}
+
+static bool ParseJsonString(json_parser& Parser, std::string& String)
+{
+    Parser.Cur++; // '"'
+    String.clear();
+    for (;;)
+    {
+        // Copy the runs without escapes at once
+        const char* Run = Parser.Cur;
+        while (Parser.Cur < Parser.End && *Parser.Cur != '"' && *Parser.Cur != '\\')
+            Parser.Cur++;
+        String.append(Run, Parser.Cur);
+
+        if (Parser.Cur == Parser.End)
+        {
+            Parser.Error = "unterminated string";
+            return false;
+        }
+        if (*Parser.Cur++ == '"')
+            return true;
+
+        if (Parser.Cur == Parser.End)
+        {
+            Parser.Error = "unterminated string";
+            return false;
+        }
+        char Escape = *Parser.Cur++;
+        switch (Escape)
+        {
+        case '"':  String += '"';  break;
+        case '\\': String += '\\'; break;
+        case '/':  String += '/';  break;
+        case 'b':  String += '\b'; break;
+        case 'f':  String += '\f'; break;
+        case 'n':  String += '\n'; break;
+        case 'r':  String += '\r'; break;
+        case 't':  String += '\t'; break;
+        case 'u':
+        {
+            uint32_t CodePoint;
+            if (!ParseJsonCodeUnit(Parser, &CodePoint))
+            {
+                Parser.Error = "invalid unicode escape";
+                return false;
+            }
+            // Surrogate pair
+            uint32_t Low;
+            if (CodePoint >= 0xD800 && CodePoint < 0xDC00 && Parser.End - Parser.Cur >= 6 && Parser.Cur[0] == '\\' && Parser.Cur[1] == 'u')
+            {
+                Parser.Cur += 2;
+                if (!ParseJsonCodeUnit(Parser, &Low) || Low < 0xDC00 || Low >= 0xE000)
+                {
+                    Parser.Error = "invalid surrogate pair";
+                    return false;
+                }
+                CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (Low - 0xDC00);
+            }
+            AppendUtf8(String, CodePoint);
+        } break;
+        default:
+            Parser.Error = "invalid escape";
+            return false;
+        }
+    }
+}
+
+static bool ParseJsonNumber(json_parser& Parser, double* Number)
+{
+    // strtod needs a terminated string: copy the number characters
+    char Buffer[64];
+    int Length = 0;
+    while (Parser.Cur < Parser.End && Length < (int)sizeof(Buffer) - 1
+        && (strchr("+-.eE", *Parser.Cur) != nullptr || (*Parser.Cur >= '0' && *Parser.Cur <= '9')))
+        Buffer[Length++] = *Parser.Cur++;
+    Buffer[Length] = '\0';
+
+    char* NumberEnd = nullptr;
+    *Number = strtod(Buffer, &NumberEnd);
+    if (Length == 0 || NumberEnd != Buffer + Length)
+    {
+        Parser.Error = "invalid number";
+        return false;
+    }
+    return true;
+}
+
+static int AddJsonNode(json_parser& Parser, json_type Type)
+{
+    json_node Node = {};
+    Node.Type = Type;
+    Node.FirstChild = -1;
+    Node.NextSibling = -1;
+    Parser.Nodes->push_back(Node);
+    return (int)Parser.Nodes->size() - 1;
+}
+
+static int ParseJsonValue(json_parser& Parser, int Depth)
+{
+    SkipJsonSpaces(Parser);
+    if (Parser.Cur == Parser.End)
+    {
+        Parser.Error = "unexpected end";
+        return -1;
+    }
+    if (Depth > JSON_MAX_DEPTH)
+    {
+        Parser.Error = "too deep";
+        return -1;
+    }
+
+    std::vector<json_node>& Nodes = *Parser.Nodes;
+    char C = *Parser.Cur;
+    if (C == '{' || C == '[')
+    {
+        bool IsObject = C == '{';
+        char Close = IsObject ? '}' : ']';
+        int Node = AddJsonNode(Parser, IsObject ? JSON_OBJECT : JSON_ARRAY);
+        int LastChild = -1;
+        Parser.Cur++;
+
+        SkipJsonSpaces(Parser);
+        if (Parser.Cur < Parser.End && *Parser.Cur == Close)
+        {
+            Parser.Cur++;
+            return Node;
+        }
+
+        for (;;)
+        {
+            std::string Key;
+            if (IsObject)
+            {
+                SkipJsonSpaces(Parser);
+                if (Parser.Cur == Parser.End || *Parser.Cur != '"')
+                {
+                    Parser.Error = "expected member name";
+                    return -1;
+                }
+                if (!ParseJsonString(Parser, Key))
+                    return -1;
+                SkipJsonSpaces(Parser);
+                if (Parser.Cur == Parser.End || *Parser.Cur != ':')
+                {
+                    Parser.Error = "expected ':'";
+                    return -1;
+                }
+                Parser.Cur++;
+            }
+
+            int Child = ParseJsonValue(Parser, Depth + 1);
+            if (Child < 0)
+                return -1;
+            Nodes[Child].Key.swap(Key);
+            if (LastChild < 0)
+                Nodes[Node].FirstChild = Child;
+            else
+                Nodes[LastChild].NextSibling = Child;
+            LastChild = Child;
+            Nodes[Node].ChildCount++;
+
+            SkipJsonSpaces(Parser);
+            if (Parser.Cur < Parser.End && *Parser.Cur == ',')
+            {
+                Parser.Cur++;
+                continue;
+            }
+            if (Parser.Cur < Parser.End && *Parser.Cur == Close)
+            {
+                Parser.Cur++;
+                return Node;
+            }
+            Parser.Error = IsObject ? "expected ',' or '}'" : "expected ',' or ']'";
+            return -1;
+        }
+    }
+
+    if (C == '"')
+    {
+        int Node = AddJsonNode(Parser, JSON_STRING);
+        return ParseJsonString(Parser, Nodes[Node].String) ? Node : -1;
+    }
+    if (C == 't' || C == 'f')
+    {
+        int Node = AddJsonNode(Parser, JSON_BOOL);
+        Nodes[Node].Number = C == 't' ? 1.0 : 0.0;
+        return ParseJsonLiteral(Parser, C == 't' ? "true" : "false") ? Node : -1;
+    }
+    if (C == 'n')
+    {
+        int Node = AddJsonNode(Parser, JSON_NULL);
+        return ParseJsonLiteral(Parser, "null") ? Node : -1;
+    }
+
+    int Node = AddJsonNode(Parser, JSON_NUMBER);
+    return ParseJsonNumber(Parser, &Nodes[Node].Number) ? Node : -1;
+}
+
+bool Json::Parse(std::vector<json_node>& Nodes, const char* Text, size_t Size, std::string* Error)
+{
+    Nodes.clear();
+    json_parser Parser = { Text, Text, Text + Size, &Nodes, nullptr };
+
+    if (ParseJsonValue(Parser, 0) >= 0)
+    {
+        SkipJsonSpaces(Parser);
+        if (Parser.Cur != Parser.End)
+            Parser.Error = "trailing characters";
+    }
+
+    if (Parser.Error)
+    {
+        if (Error)
+        {
+            char Message[128];
+            snprintf(Message, sizeof(Message), "%s at offset %d", Parser.Error, (int)(Parser.Cur - Parser.Begin));
+            *Error = Message;
+        }
+        Nodes.clear();
+        return false;
+    }
+    return true;
+}
+
+int Json::Find(const std::vector<json_node>& Nodes, int Object, const char* Key)
+{
+    if (Object < 0 || Nodes[Object].Type != JSON_OBJECT)
+        return -1;
+    for (int Child = Nodes[Object].FirstChild; Child >= 0; Child = Nodes[Child].NextSibling)
+    {
+        if (Nodes[Child].Key == Key)
+            return Child;
+    }
+    return -1;
+}
+
+void Json::GetChildren(const std::vector<json_node>& Nodes, int Node, std::vector<int>& Children)
+{
+    Children.clear();
+    if (Node < 0)
+        return;
+    for (int Child = Nodes[Node].FirstChild; Child >= 0; Child = Nodes[Child].NextSibling)
+        Children.push_back(Child);
+}
+
+double Json::GetNumber(const std::vector<json_node>& Nodes, int Node, double Default)
+{
+    return (Node >= 0 && Nodes[Node].Type == JSON_NUMBER) ? Nodes[Node].Number : Default;
+}
+
+int Json::GetInt(const std::vector<json_node>& Nodes, int Node, int Default)
+{
+    return (Node >= 0 && Nodes[Node].Type == JSON_NUMBER) ? (int)Nodes[Node].Number : Default;
+}
+
+bool Json::GetBool(const std::vector<json_node>& Nodes, int Node, bool Default)
+{
+    return (Node >= 0 && Nodes[Node].Type == JSON_BOOL) ? Nodes[Node].Number != 0.0 : Default;
+}
+
+const char* Json::GetString(const std::vector<json_node>& Nodes, int Node, const char* Default)
+{
+    return (Node >= 0 && Nodes[Node].Type == JSON_STRING) ? Nodes[Node].String.c_str() : Default;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum json_type
+{
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+};
+
+// Node of a parsed JSON document, children are linked by index (the root is node 0)
+struct json_node
+{
+    json_type Type;
+    double Number;      // Numbers, 0 or 1 for booleans
+    std::string String; // Strings (escapes decoded)
+    std::string Key;    // Member name when the parent is an object
+    int FirstChild;     // -1 when empty
+    int NextSibling;    // -1 for the last child
+    int ChildCount;
+};
+
+namespace Json
+{
+
+// Returns false on syntax errors (Error gets the message and offset)
+bool Parse(std::vector<json_node>& Nodes, const char* Text, size_t Size, std::string* Error);
+
+// Member of an object, -1 if missing (or if Object is -1 or not an object)
+int Find(const std::vector<json_node>& Nodes, int Object, const char* Key);
+// Indices of the children of an array or object (random access without walking the siblings each time)
+void GetChildren(const std::vector<json_node>& Nodes, int Node, std::vector<int>& Children);
+
+// Value of a node, Default when the node is missing (-1) or of another type
+double GetNumber(const std::vector<json_node>& Nodes, int Node, double Default);
+int GetInt(const std::vector<json_node>& Nodes, int Node, int Default);
+bool GetBool(const std::vector<json_node>& Nodes, int Node, bool Default);
+const char* GetString(const std::vector<json_node>& Nodes, int Node, const char* Default);
+}
@@ -1,6 +1,7 @@
 
 #include <memory>
 #include <cstdio>
+#include <cstring>
 #include <typeinfo>
 
 #define GLFW_INCLUDE_NONE
@@ -17,6 +18,15 @@
 #include "maths.h"
 #include "camera.h"
 #include "platform.h"
+#include "obj_parser.h"
+#include "3ds_parser.h"
+#include "gltf_loader.h"
+#include "vertex_encoding.h"
+#include "mesh_transform.h"
+#include "mesh_codec.h"
+#include "texture_codec.h"
+#include "texture_mips.h"
+#include "asset_pack.h"
 
 #include "pg.h"
 
@@ -180,6 +190,62 @@ int main(int argc, char* argv[])
     
     app App = {};
 
+    // Compare obj parsers without opening a window (--benchmark-obj <file.obj>)
+    if (argc == 3 && strcmp(argv[1], "--benchmark-obj") == 0)
+    {
+        Mesh::BenchmarkObjParsers(argv[2], 10);
+        return 0;
+    }
+
+    // Compare the .3ds parser with the obj parsers on a conversion of the same model (--benchmark-3ds <file.3ds>)
+    if (argc == 3 && strcmp(argv[1], "--benchmark-3ds") == 0)
+    {
+        Mesh::Benchmark3dsParser(argv[2], 10);
+        return 0;
+    }
+
+    // Print the import time and content of a glTF scene (--gltf-info <file.glb|file.gltf>)
+    if (argc == 3 && strcmp(argv[1], "--gltf-info") == 0)
+    {
+        Mesh::ReportGltf(argv[2]);
+        return 0;
+    }
+
+    // Print size and error of the compressed vertex formats (--vertex-encodings <file.obj>)
+    if (argc == 3 && strcmp(argv[1], "--vertex-encodings") == 0)
+    {
+        Mesh::ReportVertexEncodings(argv[2]);
+        return 0;
+    }
+
+    // Print the compressed size and decoding speed of a mesh cache (--benchmark-mesh-codec <file.obj|file.3ds>)
+    if (argc == 3 && strcmp(argv[1], "--benchmark-mesh-codec") == 0)
+    {
+        Mesh::BenchmarkMeshCodec(argv[2], 20);
+        return 0;
+    }
+
+    // Compare the SIMD transform kernels with the scalar one (--benchmark-transform)
+    if (argc == 2 && strcmp(argv[1], "--benchmark-transform") == 0)
+    {
+        Mesh::BenchmarkTransform(1000000, 10);
+        return 0;
+    }
+
+    // Print the error and speed of the block compressed formats on an image (--benchmark-texture-codec <file>)
+    if (argc == 3 && strcmp(argv[1], "--benchmark-texture-codec") == 0)
+    {
+        Texture::BenchmarkTextureCodec(argv[2], IMG_FLIP);
+        return 0;
+    }
+
+    // Compare the mip filters on an image, in gamma and linear space (--benchmark-mips <file>)
+    if (argc == 3 && strcmp(argv[1], "--benchmark-mips") == 0)
+    {
+        Texture::BenchmarkMips(argv[2], IMG_FLIP);
+        return 0;
+    }
+
     // Init GLFW
     glfwSetErrorCallback(GLFWErrorCallback);
     if (glfwInit() != GLFW_TRUE)
@@ -219,6 +285,9 @@ int main(int argc, char* argv[])
 	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
 	glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
 	glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_OTHER, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+
+    // Persistent upload ring of the async textures when the driver has it
+    GL::LoadBufferStorage((GLADloadproc)glfwGetProcAddress);
     
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -238,6 +307,10 @@ int main(int argc, char* argv[])
 
     double StartTime = glfwGetTime();
 
+    // media/ files are read from the pack when asset_cook --pack wrote one
+    if (File::MountPack(ASSET_PACK_FILENAME))
+        printf("Mounted %s\n", ASSET_PACK_FILENAME);
+
     // Demo scope
     {
         PG::Init();
@@ -251,17 +324,17 @@ int main(int argc, char* argv[])
         std::unique_ptr<demo> Demos[] =
         {
             std::make_unique<demo_base>(GLCache, GLDebug),
-            std::make_unique<demo_minimal>(),
+            std::make_unique<demo_minimal>(GLCache),
             std::make_unique<demo_pg_skybox>(GLCache, GLDebug),
             std::make_unique<demo_pg_billboard>(GLCache, GLDebug),
             std::make_unique<demo_pg_billboard2>(),
             std::make_unique<demo_pg_postprocess>(App.IO, GLCache, GLDebug),
-            std::make_unique<demo_skybox>(),
-            std::make_unique<demo_reflection>(),
+            std::make_unique<demo_skybox>(GLCache),
+            std::make_unique<demo_reflection>(GLCache),
             std::make_unique<demo_npr_gooch>(GLCache, GLDebug),
             std::make_unique<demo_npr_toon>(GLCache, GLDebug),
             std::make_unique<demo_gamma>(GLCache, GLDebug),
-            std::make_unique<demo_instancing>(),
+            std::make_unique<demo_instancing>(GLCache),
             std::make_unique<demo_shader>(GLCache, GLDebug),
             //std::make_unique<demo_pg_fbx>(GLDebug.Wireframe, GLCache),
             // TODO(demo): Add other demos here
@@ -315,6 +388,9 @@ int main(int argc, char* argv[])
             if (App.IO.MouseCaptured)
                 ImGui::GetIO().MousePos = ImVec2(-FLT_MAX,-FLT_MAX);
             ImGui::NewFrame();
+
+            // Upload assets loaded in background
+            GLCache.ProcessUploads(2.f);
             
             // Demo id selector
             {
@@ -327,6 +403,11 @@ int main(int argc, char* argv[])
                     DemoId = Math::TrueMod(DemoId + 1, (int)ARRAY_SIZE(Demos));
                 ImGui::SameLine();
                 ImGui::Text("[%s]", typeid(*Demos[DemoId]).name());
+                if (GLCache.GetPendingCount() > 0)
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("Loading %d assets...", GLCache.GetPendingCount());
+                }
             }
 
             // Display GPU infos
@@ -339,6 +420,32 @@ int main(int argc, char* argv[])
                 ImGui::Text("GL_RENDERER: %s", glGetString(GL_RENDERER));
                 ImGui::Text("GL_SHADING_LANGUAGE_VERSION: %s", glGetString(GL_SHADING_LANGUAGE_VERSION));
             }
+
+            if (ImGui::CollapsingHeader("Shared vertex buffers"))
+            {
+                offset_allocator_stats Stats = GLCache.GetVertexBufferStats();
+                ImGui::Text("%d meshes: %u/%u vertices", Stats.AllocationCount, Stats.UsedSize, Stats.Capacity);
+                ImGui::Text("Free: %u vertices in %d ranges (largest %u, fragmentation %.0f%%)", Stats.FreeSize, Stats.FreeRangeCount, Stats.LargestFreeRange, Stats.Fragmentation * 100.f);
+                offset_allocator_stats IndexStats = GLCache.GetIndexBufferStats();
+                ImGui::Text("Indices: %.1f/%.1f MB (fragmentation %.0f%%)", IndexStats.UsedSize * 4.f / (1024.f * 1024.f), IndexStats.Capacity * 4.f / (1024.f * 1024.f), IndexStats.Fragmentation * 100.f);
+                if (ImGui::Button("Defragment"))
+                    GLCache.DefragmentVertexBuffers();
+            }
+
+            if (ImGui::CollapsingHeader("Texture cache"))
+            {
+                GL::texture_cache_stats Stats = GLCache.GetTextureStats();
+                ImGui::Text("%d textures: %.1f/%.1f MB", Stats.TextureCount, Stats.ResidentBytes / (1024.f * 1024.f), Stats.BudgetBytes / (1024.f * 1024.f));
+                ImGui::Text("Hits: %llu, misses: %llu (%llu shared by content)", (unsigned long long)Stats.Hits, (unsigned long long)Stats.Misses, (unsigned long long)Stats.ContentHits);
+                ImGui::Text("Evictions: %llu", (unsigned long long)Stats.Evictions);
+                GL::upload_ring_stats UploadStats = GLCache.GetUploadStats();
+                ImGui::Text("Streaming: %s, %.1f/%.1f MB in flight", UploadStats.Persistent ? "persistent ring" : "orphaned buffers",
+                            UploadStats.BytesInFlight / (1024.f * 1024.f), UploadStats.Capacity / (1024.f * 1024.f));
+                ImGui::Text("Uploads: %llu, stalls: %llu", (unsigned long long)UploadStats.Uploads, (unsigned long long)UploadStats.Stalls);
+                int BudgetMB = (int)(Stats.BudgetBytes / (1024 * 1024));
+                if (ImGui::SliderInt("Budget (MB)", &BudgetMB, 16, 2048))
+                    GLCache.SetTextureBudget((uint64_t)BudgetMB * 1024 * 1024);
+            }
             
             if (ShowDemoWindow)
                 ImGui::ShowDemoWindow(&ShowDemoWindow);
@@ -358,6 +465,7 @@ int main(int argc, char* argv[])
 
         PG::Destroy();
     }
+    File::UnmountPack();
 
     double Duration = glfwGetTime() - StartTime;
     printf("Duration %.2fs\n", Duration);
@@ -16,6 +16,7 @@ namespace Math
     inline float Tan(float V) { return std::tan(V); }
     inline float Atan(float V) { return std::atan(V); }
     inline float Atan2(float Y, float X) { return std::atan2(Y, X); }
+    inline float Acos(float V) { return std::acos(V); }
     
     inline float Sqrt(float Value) { return std::sqrt(Value); }
     
@@ -100,6 +101,16 @@ namespace Vec3
         R.z = A.x * B.y - A.y * B.x;
         return R;
     }
+
+    inline v3 Min(v3 A, v3 B)
+    {
+        return { Math::Min(A.x, B.x), Math::Min(A.y, B.y), Math::Min(A.z, B.z) };
+    }
+
+    inline v3 Max(v3 A, v3 B)
+    {
+        return { Math::Max(A.x, B.x), Math::Max(A.y, B.y), Math::Max(A.z, B.z) };
+    }
 }
 
 // ========================================================================
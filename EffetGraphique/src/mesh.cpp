@@ -2,35 +2,47 @@
 #include <cstdint>
 #include <cstdio>
 #include <cassert>
+#include <cstring>
 #include <vector>
 #include <string>
 
-#include <tiny_obj_loader.h>
-
 #include "maths.h"
 #include "mesh.h"
+#include "mesh_optimizer.h"
+#include "mesh_transform.h"
+#include "mesh_clusters.h"
+#include "mesh_simplifier.h"
+#include "mesh_codec.h"
+#include "mesh_normals.h"
+#include "vertex_encoding.h"
+#include "obj_parser.h"
+#include "3ds_parser.h"
+#include "jobs.h"
+#include "platform.h"
 
 using namespace Mesh;
 
-static void* ConvertVertices(void* VerticesDst, const vertex_descriptor& Descriptor, vertex_full* VerticesSrc, int Count)
+// One kernel per attribute set to keep the per vertex loop branch free
+template<bool HasNormal, bool HasUV>
+static void* ConvertVerticesKernel(void* VerticesDst, const vertex_descriptor& Descriptor, const vertex_full* VerticesSrc, int Count)
 {
     uint8_t* Buffer = (uint8_t*)VerticesDst;
 
     for (int i = 0; i < Count; ++i)
     {
-        vertex_full& VertexSrc = VerticesSrc[i];
+        const vertex_full& VertexSrc = VerticesSrc[i];
         uint8_t* VertexStart = Buffer + i * Descriptor.Stride;
 
         v3* PositionDst = (v3*)(VertexStart + Descriptor.PositionOffset);
         *PositionDst = VertexSrc.Position;
 
-        if (Descriptor.HasNormal)
+        if (HasNormal)
         {
             v3* NormalDst = (v3*)(VertexStart + Descriptor.NormalOffset);
             *NormalDst = VertexSrc.Normal;
         }
 
-        if (Descriptor.HasUV)
+        if (HasUV)
         {
             v2* UVDst = (v2*)(VertexStart + Descriptor.UVOffset);
             *UVDst = VertexSrc.UV;
@@ -40,6 +52,29 @@ static void* ConvertVertices(void* VerticesDst, const vertex_descriptor& Descrip
     return Buffer + Descriptor.Stride * Count;
 }
 
+void* Mesh::ConvertVertices(void* VerticesDst, const vertex_descriptor& Descriptor, const vertex_full* VerticesSrc, int Count)
+{
+    // Same layout as vertex_full: one bulk copy (vectorized by the C runtime)
+    if (Descriptor.Stride == sizeof(vertex_full) && Descriptor.PositionOffset == OFFSETOF(vertex_full, Position)
+        && Descriptor.HasNormal && Descriptor.NormalOffset == OFFSETOF(vertex_full, Normal)
+        && Descriptor.HasUV && Descriptor.UVOffset == OFFSETOF(vertex_full, UV))
+    {
+        memcpy(VerticesDst, VerticesSrc, Count * sizeof(vertex_full));
+        return (uint8_t*)VerticesDst + Count * sizeof(vertex_full);
+    }
+
+    if (Descriptor.HasNormal)
+    {
+        return Descriptor.HasUV
+            ? ConvertVerticesKernel<true, true>(VerticesDst, Descriptor, VerticesSrc, Count)
+            : ConvertVerticesKernel<true, false>(VerticesDst, Descriptor, VerticesSrc, Count);
+    }
+
+    return Descriptor.HasUV
+        ? ConvertVerticesKernel<false, true>(VerticesDst, Descriptor, VerticesSrc, Count)
+        : ConvertVerticesKernel<false, false>(VerticesDst, Descriptor, VerticesSrc, Count);
+}
+
 static int GetVertexCount(void* Vertices, void* End, const vertex_descriptor& Descriptor)
 {
     int SizeInBytes = (int)((uint8_t*)End - (uint8_t*)Vertices);
@@ -51,22 +86,9 @@ void* Mesh::Transform(void* Vertices, void* End, const vertex_descriptor& Descri
     uint8_t* Buffer = (uint8_t*)Vertices;
     int Count = GetVertexCount(Vertices, End, Descriptor);
 
+    // Normal matrix computed once for the whole batch, vertices transformed by the best SIMD kernel
     mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(Transform));
-    for (int i = 0; i < Count; ++i)
-    {
-        uint8_t* VertexStart = Buffer + i * Descriptor.Stride;
-        
-        v3* Position = (v3*)(VertexStart + Descriptor.PositionOffset);
-        v4 TransformedPosition = Transform * Vec4::vec4(*Position, 1.f);
-        *Position = TransformedPosition.xyz / TransformedPosition.w; // normalized homogeneous coordinate
-
-        if (Descriptor.HasNormal)
-        {
-            v3* Normal           = (v3*)(VertexStart + Descriptor.NormalOffset);
-            v4 TransformedNormal = NormalMatrix * Vec4::vec4(*Normal, 0.f);
-            *Normal              = Vec3::Normalize(TransformedNormal.xyz);
-        }
-    }
+    TransformVertices(GetTransformKernel(), Buffer, Count, Descriptor, Transform, NormalMatrix);
     return Buffer + Descriptor.Stride * Count;
 }
 
@@ -294,128 +316,467 @@ void* Mesh::BuildSphere(void* Vertices, void* End, const vertex_descriptor& Desc
     return Mesh::Transform(Vertices, Cur, Descriptor, Mat4::Scale({ 0.5f, 0.5f, 0.5f }));
 }
 
-// Implement dumb caching to avoid parsing .obj again and again
-bool LoadObjFromCache(std::vector<vertex_full>& Mesh, const char* Filename)
+// Hash the raw bits of a vertex (position/normal/uv tuple)
+static uint32_t HashVertex(const vertex_full& Vertex)
 {
-    std::string CachedFile = Filename;
-    CachedFile += ".cache";
+    static_assert(sizeof(vertex_full) == 8 * sizeof(uint32_t), "vertex_full must not contain padding");
 
-    FILE* File = fopen(CachedFile.c_str(), "rb");
-    if (File == nullptr)
-        return false;
+    const uint32_t* Words = (const uint32_t*)&Vertex;
+    uint32_t Hash = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        uint32_t Word = Words[i] * 0x5bd1e995;
+        Word ^= Word >> 24;
+        Hash = (Hash * 0x5bd1e995) ^ (Word * 0x5bd1e995);
+    }
+    Hash ^= Hash >> 13;
+    Hash *= 0x5bd1e995;
+    Hash ^= Hash >> 15;
+    return Hash;
+}
 
-    size_t VertexCount = 0;
-    fread(&VertexCount, sizeof(size_t), 1, File);
-    Mesh.resize(VertexCount);
-    fread(&Mesh[0], sizeof(vertex_full), VertexCount, File);
-    fclose(File);
+void Mesh::BuildIndexedMesh(indexed_mesh& Mesh, const vertex_full* Vertices, int VertexCount)
+{
+    Mesh.Vertices.clear();
+    Mesh.Vertices.reserve(VertexCount);
+    Mesh.Indices.resize(VertexCount);
+
+    // Open addressing hash table (power of two size, load factor <= 0.5)
+    const uint32_t EmptySlot = ~0u;
+    uint32_t TableSize = 1;
+    while (TableSize < (uint32_t)VertexCount * 2)
+        TableSize *= 2;
+    std::vector<uint32_t> Table(TableSize, EmptySlot);
+
+    for (int i = 0; i < VertexCount; ++i)
+    {
+        const vertex_full& Vertex = Vertices[i];
 
-    printf("Loaded from cache: %s (%d vertices)\n", Filename, (int)VertexCount);
+        uint32_t Slot = HashVertex(Vertex) & (TableSize - 1);
+        while (Table[Slot] != EmptySlot && memcmp(&Mesh.Vertices[Table[Slot]], &Vertex, sizeof(vertex_full)) != 0)
+            Slot = (Slot + 1) & (TableSize - 1);
 
-    return true;
+        if (Table[Slot] == EmptySlot)
+        {
+            Table[Slot] = (uint32_t)Mesh.Vertices.size();
+            Mesh.Vertices.push_back(Vertex);
+        }
+
+        Mesh.Indices[i] = Table[Slot];
+    }
 }
 
-void SaveObjToCache(const std::vector<vertex_full>& Mesh, const char* Filename)
+void Mesh::BuildPositionRemap(std::vector<uint32_t>& Remap, const vertex_full* Vertices, int VertexCount)
 {
-    std::string CachedFile = Filename;
-    CachedFile += ".cache";
+    Remap.resize(VertexCount);
 
-    FILE* File = fopen(CachedFile.c_str(), "wb");
-    size_t VertexCount = Mesh.size();
-    fwrite(&VertexCount, sizeof(size_t), 1, File);
-    fwrite(&Mesh[0], sizeof(vertex_full), VertexCount, File);
-    fclose(File);
+    // Open addressing hash table on the position only
+    const uint32_t EmptySlot = ~0u;
+    uint32_t TableSize = 1;
+    while (TableSize < (uint32_t)VertexCount * 2)
+        TableSize *= 2;
+    std::vector<uint32_t> Table(TableSize, EmptySlot);
+
+    for (int i = 0; i < VertexCount; ++i)
+    {
+        const v3& Position = Vertices[i].Position;
+        uint32_t Bits[3];
+        memcpy(Bits, &Position, sizeof(Bits));
+        uint32_t Hash = (Bits[0] * 73856093u) ^ (Bits[1] * 19349663u) ^ (Bits[2] * 83492791u);
+
+        uint32_t Slot = Hash & (TableSize - 1);
+        while (Table[Slot] != EmptySlot && memcmp(&Vertices[Table[Slot]].Position, &Position, sizeof(v3)) != 0)
+            Slot = (Slot + 1) & (TableSize - 1);
+
+        if (Table[Slot] == EmptySlot)
+            Table[Slot] = (uint32_t)i;
 
-    printf("Saved to cache: %s (%d vertices)\n", Filename, (int)VertexCount);
+        Remap[i] = Table[Slot];
+    }
 }
 
-bool Mesh::LoadObjNoConvertion(std::vector<vertex_full>& Mesh, const char* Filename, float Scale)
+// .obj.cache file format (native endianness):
+// [mesh_cache_header][vertex_full * VertexCount][uint16_t or uint32_t * IndexCount (LODs back to back)][mesh_cluster * ClusterCount]
+// [mesh_submesh * SubmeshCount][mesh_material * MaterialCount]
+// Data is laid out to be uploaded to gpu straight from the memory mapped file
+// Compressed caches store the vertex and index sections encoded with the mesh codec (EncodedVertexSize and EncodedIndexSize bytes)
+const uint32_t MESH_CACHE_MAGIC = 'M' | ('S' << 8) | ('H' << 16) | ('C' << 24);
+const uint32_t MESH_CACHE_VERSION = 6;        // Increment when the format or the optimizations change
+const uint32_t MESH_CACHE_ENDIANNESS = 0x01020304;
+const uint32_t MESH_CACHE_ALIGNMENT = 16;
+
+struct mesh_cache_header
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Endianness;
+    uint32_t HeaderSize;
+    uint64_t SourceHash;     // Hash of the .obj content
+
+    // Vertex layout (vertex_full)
+    uint32_t VertexStride;
+    uint32_t PositionOffset;
+    uint32_t NormalOffset;
+    uint32_t UVOffset;
+
+    uint32_t VertexCount;
+    uint32_t IndexCount;
+    uint32_t IndexSize;
+    uint32_t Encoding;       // mesh_cache_encoding
+    uint64_t VertexDataOffset;
+    uint64_t IndexDataOffset;
+
+    v3 BoundsMin;
+    v3 BoundsMax;
+
+    uint32_t ClusterCount;
+    uint32_t ClusterPadding;
+    uint64_t ClusterDataOffset;
+
+    uint32_t LodCount;
+    uint32_t LodPadding[3];
+    mesh_lod Lods[MESH_MAX_LODS];
+
+    uint32_t SubmeshCount;
+    uint32_t MaterialCount;
+    uint64_t SubmeshDataOffset;
+    uint64_t MaterialDataOffset;
+    uint32_t EncodedVertexSize; // Compressed caches only
+    uint32_t EncodedIndexSize;
+};
+static_assert(sizeof(mesh_cache_header) % MESH_CACHE_ALIGNMENT == 0, "mesh_cache_header size must keep vertex data aligned");
+
+static uint64_t AlignCacheOffset(uint64_t Offset)
+{
+    return (Offset + MESH_CACHE_ALIGNMENT - 1) & ~(uint64_t)(MESH_CACHE_ALIGNMENT - 1);
+}
+
+// Vertex format of quantized caches, decoded over the mesh bounds
+static vertex_layout GetQuantizedCacheLayout()
+{
+    return Mesh::MakeVertexLayout(VERTEX_FORMAT_UNORM16, VERTEX_FORMAT_OCT16, VERTEX_FORMAT_HALF);
+}
+
+// FNV-1a hash of the source file
+// Carriage returns are skipped so that CRLF and LF checkouts of the same .obj share the cache
+static bool HashSourceFile(const char* Filename, uint64_t* HashOut)
 {
-    if (!LoadObjFromCache(Mesh, Filename))
+    file_mapping Source;
+    if (!File::Map(Source, Filename))
+        return false;
+
+    const uint8_t* Bytes = (const uint8_t*)Source.Data;
+    uint64_t Hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < Source.Size; ++i)
     {
-        std::string Warn;
-        std::string Err;
-        tinyobj::attrib_t Attrib;
-        std::vector<tinyobj::shape_t> Shapes;
+        if (Bytes[i] == '\r')
+            continue;
+        Hash ^= Bytes[i];
+        Hash *= 0x100000001b3ull;
+    }
 
-        tinyobj::LoadObj(&Attrib, &Shapes, nullptr, &Warn, &Err, Filename, "media/", true);
-        if (!Err.empty())
+    File::Unmap(Source);
+    *HashOut = Hash;
+    return true;
+}
+
+// Returns the reason why the cache can't be used, nullptr if valid
+static const char* ValidateCache(const file_mapping& Mapping, bool HasSource, uint64_t SourceHash, mesh_cache_encoding Encoding)
+{
+    if (Mapping.Size < sizeof(mesh_cache_header))
+        return "truncated header";
+
+    const mesh_cache_header& Header = *(const mesh_cache_header*)Mapping.Data;
+    if (Header.Magic != MESH_CACHE_MAGIC)
+        return "not a mesh cache";
+    if (Header.Endianness != MESH_CACHE_ENDIANNESS)
+        return "incompatible endianness";
+    if (Header.Version != MESH_CACHE_VERSION || Header.HeaderSize != sizeof(mesh_cache_header))
+        return "version mismatch";
+    if (Header.VertexStride   != sizeof(vertex_full)
+     || Header.PositionOffset != OFFSETOF(vertex_full, Position)
+     || Header.NormalOffset   != OFFSETOF(vertex_full, Normal)
+     || Header.UVOffset       != OFFSETOF(vertex_full, UV))
+        return "vertex layout mismatch";
+    if (Header.IndexSize != sizeof(uint16_t) && Header.IndexSize != sizeof(uint32_t))
+        return "invalid index size";
+    if (Header.Encoding != MESH_CACHE_RAW && Header.Encoding != MESH_CACHE_COMPRESSED && Header.Encoding != MESH_CACHE_QUANTIZED)
+        return "invalid encoding";
+    bool Raw = Header.Encoding == MESH_CACHE_RAW;
+    if (Header.VertexDataOffset % MESH_CACHE_ALIGNMENT != 0 || Header.IndexDataOffset % MESH_CACHE_ALIGNMENT != 0
+     || Header.VertexDataOffset + (Raw ? (uint64_t)Header.VertexCount * Header.VertexStride : Header.EncodedVertexSize) > Mapping.Size
+     || Header.IndexDataOffset + (Raw ? (uint64_t)Header.IndexCount * Header.IndexSize : Header.EncodedIndexSize) > Mapping.Size
+     || Header.ClusterDataOffset % MESH_CACHE_ALIGNMENT != 0
+     || Header.ClusterDataOffset + (uint64_t)Header.ClusterCount * sizeof(mesh_cluster) > Mapping.Size
+     || Header.SubmeshDataOffset % MESH_CACHE_ALIGNMENT != 0 || Header.MaterialDataOffset % MESH_CACHE_ALIGNMENT != 0
+     || Header.SubmeshDataOffset + (uint64_t)Header.SubmeshCount * sizeof(mesh_submesh) > Mapping.Size
+     || Header.MaterialDataOffset + (uint64_t)Header.MaterialCount * sizeof(mesh_material) > Mapping.Size)
+        return "truncated data";
+    if (Header.LodCount < 1 || Header.LodCount > MESH_MAX_LODS || Header.Lods[0].FirstIndex != 0)
+        return "invalid lods";
+    for (uint32_t i = 0; i < Header.LodCount; ++i)
+    {
+        if ((uint64_t)Header.Lods[i].FirstIndex + Header.Lods[i].IndexCount > Header.IndexCount)
+            return "invalid lods";
+    }
+    // Clusters are drawn as ranges of LOD 0
+    const mesh_cluster* Clusters = (const mesh_cluster*)((const uint8_t*)Mapping.Data + Header.ClusterDataOffset);
+    for (uint32_t c = 0; c < Header.ClusterCount; ++c)
+    {
+        if ((uint64_t)Clusters[c].FirstIndex + Clusters[c].IndexCount > Header.Lods[0].IndexCount || Clusters[c].IndexCount % 3 != 0)
+            return "invalid clusters";
+    }
+    const mesh_submesh* Submeshes = (const mesh_submesh*)((const uint8_t*)Mapping.Data + Header.SubmeshDataOffset);
+    for (uint32_t s = 0; s < Header.SubmeshCount; ++s)
+    {
+        if (Submeshes[s].MaterialId < -1 || Submeshes[s].MaterialId >= (int32_t)Header.MaterialCount)
+            return "invalid submeshes";
+        for (uint32_t i = 0; i < Header.LodCount; ++i)
         {
-            fprintf(stderr, "Warning loading obj: %s\n", Err.c_str());
+            if ((uint64_t)Submeshes[s].FirstIndex[i] + Submeshes[s].IndexCount[i] > Header.IndexCount)
+                return "invalid submeshes";
         }
-        if (!Err.empty())
+    }
+    // Keep using the cache if the .obj is not shipped
+    if (HasSource && Header.SourceHash != SourceHash)
+        return "source changed";
+    if (Encoding != MESH_CACHE_DEFAULT && Header.Encoding != (uint32_t)Encoding)
+        return "encoding changed";
+
+    return nullptr;
+}
+
+// Decode the vertices and indices of a compressed cache in Mesh.DecodedData
+static bool DecodeCache(mapped_mesh& Mesh, const mesh_cache_header& Header)
+{
+    const uint8_t* Data = (const uint8_t*)Mesh.Mapping.Data;
+    size_t VertexSize = (size_t)Header.VertexCount * sizeof(vertex_full);
+    Mesh.DecodedData = new uint8_t[VertexSize + (size_t)Header.IndexCount * Header.IndexSize];
+
+    bool Success;
+    if (Header.Encoding == MESH_CACHE_QUANTIZED)
+    {
+        vertex_layout Layout = GetQuantizedCacheLayout();
+        std::vector<uint8_t> Quantized((size_t)Header.VertexCount * Layout.Stride);
+        Success = Mesh::DecodeVertexBuffer(Quantized.data(), (int)Header.VertexCount, Layout.Stride, Data + Header.VertexDataOffset, Header.EncodedVertexSize);
+        if (Success)
+            Mesh::DecodeVertices((vertex_full*)Mesh.DecodedData, Layout, Quantized.data(), (int)Header.VertexCount, Header.BoundsMin, Header.BoundsMax);
+    }
+    else
+    {
+        Success = Mesh::DecodeVertexBuffer(Mesh.DecodedData, (int)Header.VertexCount, sizeof(vertex_full), Data + Header.VertexDataOffset, Header.EncodedVertexSize);
+    }
+    Success = Success && Mesh::DecodeIndexBuffer(Mesh.DecodedData + VertexSize, (int)Header.IndexCount, (int)Header.IndexSize, Data + Header.IndexDataOffset, Header.EncodedIndexSize);
+
+    Mesh.Vertices = (const vertex_full*)Mesh.DecodedData;
+    Mesh.Indices = Mesh.DecodedData + VertexSize;
+    return Success;
+}
+
+static bool MapObjFromCache(mapped_mesh& Mesh, const char* CachedFile, bool HasSource, uint64_t SourceHash, mesh_cache_encoding Encoding)
+{
+    if (!File::Map(Mesh.Mapping, CachedFile))
+        return false;
+
+    const char* Error = ValidateCache(Mesh.Mapping, HasSource, SourceHash, Encoding);
+    const uint8_t* Data = (const uint8_t*)Mesh.Mapping.Data;
+    const mesh_cache_header& Header = *(const mesh_cache_header*)Data;
+    if (Error == nullptr && Header.Encoding != MESH_CACHE_RAW && !DecodeCache(Mesh, Header))
+        Error = "corrupted data";
+    if (Error)
+    {
+        printf("Outdated cache: %s (%s)\n", CachedFile, Error);
+        Mesh::UnmapObj(Mesh);
+        return false;
+    }
+
+    if (Header.Encoding == MESH_CACHE_RAW)
+    {
+        Mesh.Vertices = (const vertex_full*)(Data + Header.VertexDataOffset);
+        Mesh.Indices = Data + Header.IndexDataOffset;
+    }
+    Mesh.VertexCount = (int)Header.VertexCount;
+    Mesh.IndexCount = (int)Header.Lods[0].IndexCount;
+    Mesh.IndexSize = (int)Header.IndexSize;
+    Mesh.BoundsMin = Header.BoundsMin;
+    Mesh.BoundsMax = Header.BoundsMax;
+    Mesh.Clusters = (const mesh_cluster*)(Data + Header.ClusterDataOffset);
+    Mesh.ClusterCount = (int)Header.ClusterCount;
+    Mesh.LodCount = (int)Header.LodCount;
+    memcpy(Mesh.Lods, Header.Lods, sizeof(Mesh.Lods));
+    Mesh.Submeshes = (const mesh_submesh*)(Data + Header.SubmeshDataOffset);
+    Mesh.SubmeshCount = (int)Header.SubmeshCount;
+    Mesh.Materials = (const mesh_material*)(Data + Header.MaterialDataOffset);
+    Mesh.MaterialCount = (int)Header.MaterialCount;
+
+    return true;
+}
+
+// Zeros up to Offset (sections start on MESH_CACHE_ALIGNMENT)
+static bool WriteCachePadding(FILE* File, uint64_t Offset)
+{
+    static const uint8_t Padding[MESH_CACHE_ALIGNMENT] = {};
+    size_t Size = (size_t)(Offset - (uint64_t)ftell(File));
+    return Size < MESH_CACHE_ALIGNMENT && fwrite(Padding, 1, Size, File) == Size;
+}
+
+static bool SaveObjToCache(const indexed_mesh& Mesh, const std::vector<mesh_cluster>& Clusters, const mesh_lod* Lods, int LodCount,
+                           const std::vector<mesh_submesh>& Submeshes, const std::vector<mesh_material>& Materials, const char* CachedFile, uint64_t SourceHash,
+                           mesh_cache_encoding Encoding)
+{
+    FILE* File = fopen(CachedFile, "wb");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write cache: %s\n", CachedFile);
+        return false;
+    }
+
+    mesh_cache_header Header = {};
+    Header.Magic = MESH_CACHE_MAGIC;
+    Header.Version = MESH_CACHE_VERSION;
+    Header.Endianness = MESH_CACHE_ENDIANNESS;
+    Header.HeaderSize = sizeof(mesh_cache_header);
+    Header.SourceHash = SourceHash;
+    Header.VertexStride = sizeof(vertex_full);
+    Header.PositionOffset = OFFSETOF(vertex_full, Position);
+    Header.NormalOffset = OFFSETOF(vertex_full, Normal);
+    Header.UVOffset = OFFSETOF(vertex_full, UV);
+    Header.VertexCount = (uint32_t)Mesh.Vertices.size();
+    Header.IndexCount = (uint32_t)Mesh.Indices.size();
+    Header.IndexSize = Header.VertexCount <= 0xFFFF ? sizeof(uint16_t) : sizeof(uint32_t);
+    Header.Encoding = (uint32_t)(Encoding == MESH_CACHE_DEFAULT ? MESH_CACHE_RAW : Encoding);
+    Header.LodCount = (uint32_t)LodCount;
+    memcpy(Header.Lods, Lods, LodCount * sizeof(mesh_lod));
+    Header.SubmeshCount = (uint32_t)Submeshes.size();
+    Header.MaterialCount = (uint32_t)Materials.size();
+
+    if (!Mesh.Vertices.empty())
+    {
+        Header.BoundsMin = Header.BoundsMax = Mesh.Vertices[0].Position;
+        for (const vertex_full& Vertex : Mesh.Vertices)
         {
-            fprintf(stderr, "Error loading obj: %s\n", Err.c_str());
-            return false;
+            Header.BoundsMin = Vec3::Min(Header.BoundsMin, Vertex.Position);
+            Header.BoundsMax = Vec3::Max(Header.BoundsMax, Vertex.Position);
         }
+    }
 
-        bool HasNormals = !Attrib.normals.empty();
-        bool HasTexCoords = !Attrib.texcoords.empty();
+    // Sections are written as is, or encoded in memory first
+    const void* VertexData = Mesh.Vertices.data();
+    uint64_t VertexDataSize = Header.VertexCount * sizeof(vertex_full);
+    std::vector<uint16_t> Indices16;
+    const void* IndexData = Mesh.Indices.data();
+    if (Header.IndexSize == sizeof(uint16_t))
+    {
+        Indices16.assign(Mesh.Indices.begin(), Mesh.Indices.end());
+        IndexData = Indices16.data();
+    }
+    uint64_t IndexDataSize = Header.IndexCount * Header.IndexSize;
 
-        // Build all meshes
-        for (int MeshId = 0; MeshId < (int)Shapes.size(); ++MeshId)
+    std::vector<uint8_t> EncodedVertices, EncodedIndices;
+    if (Header.Encoding != MESH_CACHE_RAW)
+    {
+        int Stride = sizeof(vertex_full);
+        std::vector<uint8_t> Quantized;
+        if (Header.Encoding == MESH_CACHE_QUANTIZED)
         {
-            const tinyobj::mesh_t& MeshDef = Shapes[MeshId].mesh;
+            vertex_layout Layout = GetQuantizedCacheLayout();
+            Stride = Layout.Stride;
+            Quantized.resize((size_t)Header.VertexCount * Stride);
+            Mesh::EncodeVertices(Quantized.data(), Layout, Mesh.Vertices.data(), (int)Header.VertexCount, Header.BoundsMin, Header.BoundsMax);
+            VertexData = Quantized.data();
+        }
+        EncodedVertices.resize(Mesh::GetEncodedVertexBound((int)Header.VertexCount, Stride));
+        EncodedVertices.resize(Mesh::EncodeVertexBuffer(EncodedVertices.data(), VertexData, (int)Header.VertexCount, Stride));
+        EncodedIndices.resize(Mesh::GetEncodedIndexBound((int)Header.IndexCount));
+        EncodedIndices.resize(Mesh::EncodeIndexBuffer(EncodedIndices.data(), Mesh.Indices.data(), (int)Header.IndexCount));
+
+        VertexData = EncodedVertices.data();
+        VertexDataSize = Header.EncodedVertexSize = (uint32_t)EncodedVertices.size();
+        IndexData = EncodedIndices.data();
+        IndexDataSize = Header.EncodedIndexSize = (uint32_t)EncodedIndices.size();
+    }
 
-            int IndexId = 0;
-            for (int FaceId = 0; FaceId < (int)MeshDef.num_face_vertices.size(); ++FaceId)
-            {
-                int FaceVertices = MeshDef.num_face_vertices[FaceId];
-                assert(FaceVertices == 3);
+    Header.VertexDataOffset = AlignCacheOffset(sizeof(mesh_cache_header));
+    Header.IndexDataOffset = AlignCacheOffset(Header.VertexDataOffset + VertexDataSize);
+    Header.ClusterCount = (uint32_t)Clusters.size();
+    Header.ClusterDataOffset = AlignCacheOffset(Header.IndexDataOffset + IndexDataSize);
+    Header.SubmeshDataOffset = AlignCacheOffset(Header.ClusterDataOffset + Header.ClusterCount * sizeof(mesh_cluster));
+    Header.MaterialDataOffset = AlignCacheOffset(Header.SubmeshDataOffset + Header.SubmeshCount * sizeof(mesh_submesh));
+
+    bool Success = fwrite(&Header, sizeof(Header), 1, File) == 1;
+    Success = Success && WriteCachePadding(File, Header.VertexDataOffset);
+    Success = Success && fwrite(VertexData, 1, (size_t)VertexDataSize, File) == VertexDataSize;
+    Success = Success && WriteCachePadding(File, Header.IndexDataOffset);
+    Success = Success && fwrite(IndexData, 1, (size_t)IndexDataSize, File) == IndexDataSize;
+    Success = Success && WriteCachePadding(File, Header.ClusterDataOffset);
+    Success = Success && fwrite(Clusters.data(), sizeof(mesh_cluster), Header.ClusterCount, File) == Header.ClusterCount;
+    Success = Success && WriteCachePadding(File, Header.SubmeshDataOffset);
+    Success = Success && fwrite(Submeshes.data(), sizeof(mesh_submesh), Header.SubmeshCount, File) == Header.SubmeshCount;
+    Success = Success && WriteCachePadding(File, Header.MaterialDataOffset);
+    Success = Success && fwrite(Materials.data(), sizeof(mesh_material), Header.MaterialCount, File) == Header.MaterialCount;
+    fclose(File);
 
-                for (int j = 0; j < FaceVertices; ++j)
-                {
-                    const tinyobj::index_t& Index = MeshDef.indices[IndexId];
-                    vertex_full V = {};
-                    V.Position = {
-                        Attrib.vertices[Index.vertex_index * 3 + 0],
-                        Attrib.vertices[Index.vertex_index * 3 + 1],
-                        Attrib.vertices[Index.vertex_index * 3 + 2]
-                    };
-
-                    if (HasNormals)
-                    {
-                        V.Normal = {
-                            Attrib.normals[Index.normal_index * 3 + 0],
-                            Attrib.normals[Index.normal_index * 3 + 1],
-                            Attrib.normals[Index.normal_index * 3 + 2]
-                        };
-                    }
-
-                    if (HasTexCoords)
-                    {
-                        V.UV = {
-                            Attrib.texcoords[Index.texcoord_index * 2 + 0],
-                            Attrib.texcoords[Index.texcoord_index * 2 + 1]
-                        };
-                    }
-
-                    Mesh.push_back(V);
-
-                    IndexId++;
-                }
-            }
-        }
+    if (!Success)
+    {
+        fprintf(stderr, "Cannot write cache: %s\n", CachedFile);
+        remove(CachedFile);
+        return false;
+    }
 
-        // Build normals if missing
-        if (!HasNormals)
-        {
-            for (int i = 0; i < (int)Mesh.size(); i += 3)
-            {
-                vertex_full& V0 = Mesh[i + 0];
-                vertex_full& V1 = Mesh[i + 1];
-                vertex_full& V2 = Mesh[i + 2];
+    printf("Saved to cache: %s (%d vertices, %d indices, %d clusters, %d lods, %d submeshes)\n", CachedFile, (int)Header.VertexCount, (int)Header.Lods[0].IndexCount,
+           (int)Header.ClusterCount, (int)Header.LodCount, (int)Header.SubmeshCount);
+    for (int i = 1; i < LodCount; ++i)
+        printf("    LOD %d: %d triangles (error %.2e)\n", i, (int)Lods[i].IndexCount / 3, Lods[i].Error);
+    if (Header.Encoding != MESH_CACHE_RAW)
+    {
+        printf("    %s: vertices %.1f KB, indices %.1f KB (raw %.1f KB, %.1f KB)\n", Header.Encoding == MESH_CACHE_QUANTIZED ? "Quantized" : "Compressed",
+               Header.EncodedVertexSize / 1024.0, Header.EncodedIndexSize / 1024.0, Header.VertexCount * sizeof(vertex_full) / 1024.0, Header.IndexCount * Header.IndexSize / 1024.0);
+    }
 
-                v3 Normal = Vec3::Cross((V1.Position - V0.Position), (V2.Position - V0.Position));
-                V0.Normal = V1.Normal = V2.Normal = Normal;
-            }
-        }
+    return true;
+}
 
-        // Build UVs if missing
-        if (!HasTexCoords)
+static bool Has3dsExtension(const char* Filename)
+{
+    size_t Length = strlen(Filename);
+    if (Length < 4)
+        return false;
+    const char* Extension = Filename + Length - 4;
+    return Extension[0] == '.' && Extension[1] == '3' && (Extension[2] | 0x20) == 'd' && (Extension[3] | 0x20) == 's';
+}
+
+// Parse .obj or .3ds as a list of triangles
+static bool ParseMeshFile(std::vector<vertex_full>& Mesh, std::vector<int>& TriangleMaterials, std::vector<mesh_material>& Materials, const char* Filename)
+{
+    bool HasNormals = false;
+    bool HasTexCoords = false;
+    if (Has3dsExtension(Filename))
+    {
+        // Binary chunks, normals are built from the smoothing groups
+        if (!Parse3ds(Mesh, TriangleMaterials, Materials, &HasTexCoords, Filename))
+            return false;
+        HasNormals = true;
+    }
+    else if (!ParseObjParallel(Mesh, TriangleMaterials, Materials, &HasNormals, &HasTexCoords, Filename))
+    {
+        Mesh.clear();
+        TriangleMaterials.clear();
+        Materials.clear();
+        if (!ParseObjTinyObj(Mesh, TriangleMaterials, Materials, &HasNormals, &HasTexCoords, Filename))
+            return false;
+    }
+
+    // Build smooth normals if missing (stored in the cache)
+    if (!HasNormals)
+        Mesh::BuildSmoothNormals(Mesh.data(), (int)Mesh.size());
+
+    // Build UVs if missing
+    if (!HasTexCoords)
+    {
+        // TODO: Maybe triplanar texturing can make best results
+        Jobs::ParallelFor((int)Mesh.size(), 4096, [&](int Begin, int End)
         {
-            // TODO: Maybe triplanar texturing can make best results
-            for (int i = 0; i < (int)Mesh.size(); ++i)
+            for (int i = Begin; i < End; ++i)
             {
                 vertex_full& V = Mesh[i];
 
@@ -427,18 +788,158 @@ bool Mesh::LoadObjNoConvertion(std::vector<vertex_full>& Mesh, const char* Filen
                     V.UV.y = Pos.y;
                 }
             }
-        }
+        });
+    }
+
+    return true;
+}
+
+// Group the triangles by material (stable counting sort), one submesh per used material in material order
+static void SortTrianglesByMaterial(std::vector<vertex_full>& Triangles, const std::vector<int>& TriangleMaterials, int MaterialCount,
+                                    std::vector<mesh_submesh>& Submeshes)
+{
+    int TriangleCount = (int)Triangles.size() / 3;
+
+    // Bucket 0 holds the triangles without material
+    std::vector<int> Buckets(TriangleCount);
+    std::vector<int> BucketStarts(MaterialCount + 2, 0);
+    for (int t = 0; t < TriangleCount; ++t)
+    {
+        int Material = TriangleMaterials[t];
+        Buckets[t] = (Material >= 0 && Material < MaterialCount) ? Material + 1 : 0;
+        BucketStarts[Buckets[t] + 1]++;
+    }
+    for (int b = 0; b <= MaterialCount; ++b)
+        BucketStarts[b + 1] += BucketStarts[b];
 
-        SaveObjToCache(Mesh, Filename);
+    Submeshes.clear();
+    for (int b = 0; b <= MaterialCount; ++b)
+    {
+        if (BucketStarts[b + 1] == BucketStarts[b])
+            continue;
+        mesh_submesh Submesh = {};
+        Submesh.FirstIndex[0] = (uint32_t)BucketStarts[b] * 3;
+        Submesh.IndexCount[0] = (uint32_t)(BucketStarts[b + 1] - BucketStarts[b]) * 3;
+        Submesh.MaterialId = b - 1;
+        Submeshes.push_back(Submesh);
     }
 
-    // Rescale positions
+    std::vector<vertex_full> Sorted(Triangles.size());
+    for (int t = 0; t < TriangleCount; ++t)
+    {
+        int Dst = BucketStarts[Buckets[t]]++;
+        memcpy(&Sorted[Dst * 3], &Triangles[t * 3], 3 * sizeof(vertex_full));
+    }
+    Triangles.swap(Sorted);
+}
+
+bool Mesh::MapObj(mapped_mesh& Mesh, const char* Filename, mesh_cache_encoding Encoding)
+{
+    Mesh = {};
+
+    std::string CachedFile = Filename;
+    CachedFile += ".cache";
+
+    uint64_t SourceHash = 0;
+    bool HasSource = HashSourceFile(Filename, &SourceHash);
+
+    if (MapObjFromCache(Mesh, CachedFile.c_str(), HasSource, SourceHash, Encoding))
+    {
+        printf("Loaded from cache: %s (%d vertices, %d indices)\n", Filename, Mesh.VertexCount, Mesh.IndexCount);
+        return true;
+    }
+
+    // Parse, weld and optimize the .obj then map the rebuilt cache
+    std::vector<vertex_full> Triangles;
+    std::vector<int> TriangleMaterials;
+    std::vector<mesh_material> Materials;
+    if (!ParseMeshFile(Triangles, TriangleMaterials, Materials, Filename))
+        return false;
+
+    // Triangles of a material stay contiguous through all the steps below (one draw per material)
+    std::vector<mesh_submesh> Submeshes;
+    SortTrianglesByMaterial(Triangles, TriangleMaterials, (int)Materials.size(), Submeshes);
+
+    indexed_mesh IndexedMesh;
+    BuildIndexedMesh(IndexedMesh, Triangles.data(), (int)Triangles.size());
+    printf("Indexed: %s (%d vertices welded to %d)\n", Filename, (int)Triangles.size(), (int)IndexedMesh.Vertices.size());
+
+    Mesh::Optimize(IndexedMesh, Submeshes);
+
+    // Clusters move triangles around, vertices are reordered again for fetch locality
+    std::vector<mesh_cluster> Clusters;
+    Mesh::BuildClusters(Clusters, IndexedMesh, Submeshes);
+    Mesh::OptimizeVertexFetch(IndexedMesh);
+
+    // Simplified LODs are appended to the indices and share the vertices
+    mesh_lod Lods[MESH_MAX_LODS];
+    int LodCount = Mesh::BuildLods(Lods, Submeshes, IndexedMesh);
+
+    if (!SaveObjToCache(IndexedMesh, Clusters, Lods, LodCount, Submeshes, Materials, CachedFile.c_str(), SourceHash, Encoding))
+        return false;
+
+    return MapObjFromCache(Mesh, CachedFile.c_str(), HasSource, SourceHash, Encoding);
+}
+
+bool Mesh::MapObjCache(mapped_mesh& Mesh, const char* CachedFile)
+{
+    Mesh = {};
+    return MapObjFromCache(Mesh, CachedFile, false, 0, MESH_CACHE_DEFAULT);
+}
+
+void Mesh::UnmapObj(mapped_mesh& Mesh)
+{
+    File::Unmap(Mesh.Mapping);
+    delete[] Mesh.DecodedData;
+    Mesh = {};
+}
+
+static uint32_t GetIndex(const mapped_mesh& Mesh, int i)
+{
+    if (Mesh.IndexSize == sizeof(uint16_t))
+        return ((const uint16_t*)Mesh.Indices)[i];
+    return ((const uint32_t*)Mesh.Indices)[i];
+}
+
+bool Mesh::LoadObjNoConvertion(std::vector<vertex_full>& Mesh, const char* Filename, float Scale)
+{
+    mapped_mesh MappedMesh;
+    if (!MapObj(MappedMesh, Filename))
+        return false;
+
+    // Expand indices to a list of triangles and rescale positions
+    Mesh.resize(MappedMesh.IndexCount);
     for (int i = 0; i < (int)Mesh.size(); ++i)
     {
-        v3& Position = Mesh[i].Position;
+        Mesh[i] = MappedMesh.Vertices[GetIndex(MappedMesh, i)];
+        Mesh[i].Position *= Scale;
+    }
+
+    UnmapObj(MappedMesh);
+
+    return true;
+}
+
+bool Mesh::LoadObjIndexed(indexed_mesh& Mesh, const char* Filename, float Scale)
+{
+    mapped_mesh MappedMesh;
+    if (!MapObj(MappedMesh, Filename))
+        return false;
+
+    // Copy and rescale positions
+    Mesh.Vertices.assign(MappedMesh.Vertices, MappedMesh.Vertices + MappedMesh.VertexCount);
+    for (int i = 0; i < (int)Mesh.Vertices.size(); ++i)
+    {
+        v3& Position = Mesh.Vertices[i].Position;
         Position *= Scale;
     }
 
+    Mesh.Indices.resize(MappedMesh.IndexCount);
+    for (int i = 0; i < MappedMesh.IndexCount; ++i)
+        Mesh.Indices[i] = GetIndex(MappedMesh, i);
+
+    UnmapObj(MappedMesh);
+
     return true;
 }
 
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "types.h"
+#include "file_mapping.h"
 
 // Descriptor for interleaved vertex formats
 struct vertex_descriptor
@@ -22,10 +24,93 @@ struct vertex_full
 	v2 UV;
 };
 
+// Indexed mesh (identical vertices welded together)
+struct indexed_mesh
+{
+	std::vector<vertex_full> Vertices;
+	std::vector<uint32_t> Indices;
+};
+
+// Group of neighbouring triangles culled as a whole (contiguous range of the index buffer)
+struct mesh_cluster
+{
+	v3 Center;           // Bounding sphere
+	float Radius;
+	v3 ConeAxis;         // Normal cone: all triangles face away from cameras where
+	float ConeCutoff;    // Dot(Center - Camera, ConeAxis) >= ConeCutoff * Length(Center - Camera) + Radius (1 when never)
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+};
+
+// Simplified versions of a mesh share its vertices, LOD 0 is the full resolution mesh
+const int MESH_MAX_LODS = 4;
+
+struct mesh_lod
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	float Error;         // Estimated distance to the full resolution surface (mesh units)
+	uint32_t Padding;
+};
+
+// Material read from the .mtl files of an .obj or from a .3ds
+struct mesh_material
+{
+	char Name[64];
+	char DiffuseMap[128]; // Relative to the model directory, empty if none
+	v3 Ambient;
+	v3 Diffuse;
+	v3 Specular;
+	float Shininess;
+};
+
+// Triangles of one material: contiguous range of each LOD, submeshes are sorted by material
+struct mesh_submesh
+{
+	uint32_t FirstIndex[MESH_MAX_LODS];
+	uint32_t IndexCount[MESH_MAX_LODS];
+	int32_t MaterialId;  // -1 when the triangles have no material
+	uint32_t Padding[3];
+};
+
+// Encoding of the vertices and indices of a mesh cache (see mesh_codec.h)
+enum mesh_cache_encoding
+{
+	MESH_CACHE_DEFAULT = -1, // Keep the encoding of a valid cache, raw when the cache is (re)built
+	MESH_CACHE_RAW,          // Read in place
+	MESH_CACHE_COMPRESSED,   // Lossless codec, decoded when mapped
+	MESH_CACHE_QUANTIZED,    // Unorm16 positions, oct16 normals and half UVs compressed with the codec, decoded to vertex_full when mapped
+};
+
+// Indexed mesh read in place from a memory mapped .obj.cache file
+struct mapped_mesh
+{
+	const vertex_full* Vertices;
+	const void* Indices; // uint16_t or uint32_t, all LODs back to back
+	int VertexCount;
+	int IndexCount;      // LOD 0 only
+	int IndexSize;       // 2 or 4 bytes
+	v3 BoundsMin;
+	v3 BoundsMax;
+	const mesh_cluster* Clusters; // Covers the LOD 0 indices
+	int ClusterCount;
+	mesh_lod Lods[MESH_MAX_LODS];
+	int LodCount;
+	const mesh_submesh* Submeshes; // Draw list, one draw per material
+	int SubmeshCount;
+	const mesh_material* Materials;
+	int MaterialCount;
+
+	file_mapping Mapping;
+	uint8_t* DecodedData; // Vertices and indices of a compressed cache (freed by UnmapObj), nullptr for raw caches
+};
+
 namespace Mesh
 {
 
 void* Transform(void* Vertices, void* End, const vertex_descriptor& Descriptor, const mat4& Transform);
+// Copy the attributes of Descriptor from full vertices, returns the end of the written vertices
+void* ConvertVertices(void* VerticesDst, const vertex_descriptor& Descriptor, const vertex_full* VerticesSrc, int Count);
 void* BuildQuad(void* Vertices, void* End, const vertex_descriptor& Descriptor);
 void* BuildUnitQuad(void* Vertices, void* End, const vertex_descriptor& Descriptor);
 void* BuildCube(void* Vertices, void* End, const vertex_descriptor& Descriptor);
@@ -34,4 +119,14 @@ void* BuildInvertedCube(void* Vertices, void* End, const vertex_descriptor& Desc
 void* BuildSphere(void* Vertices, void* End, const vertex_descriptor& Descriptor, int Lon, int Lat);
 void* LoadObj(void* Vertices, void* End, const vertex_descriptor& Descriptor, const char* Filename, float Scale);
 bool LoadObjNoConvertion(std::vector<vertex_full>& Mesh, const char* Filename, float Scale);
+bool LoadObjIndexed(indexed_mesh& Mesh, const char* Filename, float Scale);
+void BuildIndexedMesh(indexed_mesh& Mesh, const vertex_full* Vertices, int VertexCount);
+// First vertex with the same position for each vertex (vertices split by normal or UV seams share it)
+void BuildPositionRemap(std::vector<uint32_t>& Remap, const vertex_full* Vertices, int VertexCount);
+// Map the .obj.cache/.3ds.cache file (rebuilt from the .obj or .3ds if missing, stale or incompatible), positions are unscaled
+// The cache is also rebuilt when it doesn't have the requested encoding
+bool MapObj(mapped_mesh& Mesh, const char* Filename, mesh_cache_encoding Encoding = MESH_CACHE_DEFAULT);
+// Map a cache file built by MapObj (or cooked by asset_cook) as is: the source is not hashed nor parsed, false if the cache is invalid
+bool MapObjCache(mapped_mesh& Mesh, const char* CachedFile);
+void UnmapObj(mapped_mesh& Mesh);
 }
\ No newline at end of file
@@ -0,0 +1,752 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "maths.h"
+#include "jobs.h"
+#include "mesh_bvh.h"
+
+// SSE2 is always available on x64
+#if defined(_M_X64) || defined(__x86_64__)
+#define MESH_BVH_SIMD
+#include <emmintrin.h>
+#endif
+
+// .bvh file format (native endianness): [bvh_file_header][bvh_node * NodeCount][bvh_triangle * TriangleCount]
+const uint32_t BVH_FILE_MAGIC = 'B' | ('V' << 8) | ('H' << 16) | ('4' << 24);
+const uint32_t BVH_FILE_VERSION = 1;        // Increment when the format or the build change
+const uint32_t BVH_FILE_ENDIANNESS = 0x01020304;
+
+struct bvh_file_header
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Endianness;
+    uint32_t HeaderSize;
+    uint64_t MeshHash;       // Positions and indices the BVH was built from
+    uint32_t NodeCount;
+    uint32_t TriangleCount;
+    v3 BoundsMin;
+    v3 BoundsMax;
+    uint32_t Padding[2];
+};
+static_assert(sizeof(bvh_file_header) % 16 == 0, "bvh_file_header size must keep nodes aligned");
+
+// Relative cost of a node visit against a triangle test
+const float BVH_TRAVERSAL_COST = 1.f;
+// Ranges binned on the job threads during the top of the build
+const uint32_t BVH_PARALLEL_BINNING_SIZE = 64 * 1024;
+// Each visited node pushes at most 4 entries and pops one, median splits add at most 32 levels
+const int BVH_STACK_SIZE = 3 * (BVH_MAX_DEPTH + 32) + 4;
+
+// Binary node of the build, collapsed to bvh_node once the tree is complete
+struct build_node
+{
+    v3 Min;
+    v3 Max;
+    v3 CentroidMin;
+    v3 CentroidMax;
+    int32_t Left;     // -1 for a leaf
+    int32_t Right;
+    uint32_t First;   // Range of bvh_builder::Refs
+    uint32_t Count;
+};
+
+struct bvh_builder
+{
+    const v3* TriangleMin;
+    const v3* TriangleMax;
+    const v3* Centroids;
+    uint32_t* Refs;   // Triangles, partitioned in place as the nodes are split
+};
+
+struct bvh_bin
+{
+    v3 Min;
+    v3 Max;
+    uint32_t Count;
+};
+
+// Node of the top of the tree left to BuildNode on a job thread
+struct deferred_node
+{
+    int Index;
+    int Depth;
+};
+
+static float GetHalfArea(v3 Min, v3 Max)
+{
+    v3 Size = Max - Min;
+    return Size.x * Size.y + Size.y * Size.z + Size.z * Size.x;
+}
+
+static build_node MakeLeaf(uint32_t First, uint32_t Count)
+{
+    build_node Node;
+    Node.Min = Node.CentroidMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+    Node.Max = Node.CentroidMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    Node.Left = Node.Right = -1;
+    Node.First = First;
+    Node.Count = Count;
+    return Node;
+}
+
+static void GrowBounds(build_node& Node, const build_node& Other)
+{
+    Node.Min = Vec3::Min(Node.Min, Other.Min);
+    Node.Max = Vec3::Max(Node.Max, Other.Max);
+    Node.CentroidMin = Vec3::Min(Node.CentroidMin, Other.CentroidMin);
+    Node.CentroidMax = Vec3::Max(Node.CentroidMax, Other.CentroidMax);
+}
+
+// Batches of a range for the job threads (a single batch for small ranges)
+static int GetBatchCount(uint32_t Count)
+{
+    return Count < BVH_PARALLEL_BINNING_SIZE ? 1 : Jobs::GetThreadCount() * 4;
+}
+
+static uint32_t GetBatchStart(uint32_t First, uint32_t Count, int Batch, int BatchCount)
+{
+    return First + (uint32_t)((uint64_t)Count * Batch / BatchCount);
+}
+
+// Bounds of the triangles and of their centroids
+static void ComputeBounds(build_node& Node, const bvh_builder& Builder)
+{
+    int BatchCount = GetBatchCount(Node.Count);
+    std::vector<build_node> Batches(BatchCount, MakeLeaf(0, 0));
+    Jobs::ParallelFor(BatchCount, 1, [&](int Begin, int End)
+    {
+        for (int b = Begin; b < End; ++b)
+        {
+            build_node& Batch = Batches[b];
+            for (uint32_t i = GetBatchStart(Node.First, Node.Count, b, BatchCount); i < GetBatchStart(Node.First, Node.Count, b + 1, BatchCount); ++i)
+            {
+                uint32_t Ref = Builder.Refs[i];
+                Batch.Min = Vec3::Min(Batch.Min, Builder.TriangleMin[Ref]);
+                Batch.Max = Vec3::Max(Batch.Max, Builder.TriangleMax[Ref]);
+                Batch.CentroidMin = Vec3::Min(Batch.CentroidMin, Builder.Centroids[Ref]);
+                Batch.CentroidMax = Vec3::Max(Batch.CentroidMax, Builder.Centroids[Ref]);
+            }
+        }
+    });
+
+    build_node Bounds = MakeLeaf(0, 0);
+    for (const build_node& Batch : Batches)
+        GrowBounds(Bounds, Batch);
+    Node.Min = Bounds.Min;
+    Node.Max = Bounds.Max;
+    Node.CentroidMin = Bounds.CentroidMin;
+    Node.CentroidMax = Bounds.CentroidMax;
+}
+
+static int GetBin(float Centroid, float CentroidMin, float BinScale)
+{
+    return Math::Min((int)((Centroid - CentroidMin) * BinScale), BVH_BIN_COUNT - 1);
+}
+
+// Partition point of the node range, or 0 when the node stays a leaf
+static uint32_t SplitNode(const build_node& Node, const bvh_builder& Builder, int Depth)
+{
+    if (Node.Count <= 1)
+        return 0;
+
+    uint32_t* Refs = Builder.Refs + Node.First;
+    v3 CentroidSize = Node.CentroidMax - Node.CentroidMin;
+    int LargestAxis = CentroidSize.x >= CentroidSize.y && CentroidSize.x >= CentroidSize.z ? 0 : (CentroidSize.y >= CentroidSize.z ? 1 : 2);
+
+    // Same centroids or too deep: median split of the large nodes
+    if (CentroidSize.e[LargestAxis] <= 0.f || Depth >= BVH_MAX_DEPTH)
+    {
+        if (Node.Count <= (uint32_t)BVH_MAX_LEAF_SIZE)
+            return 0;
+        uint32_t Half = Node.Count / 2;
+        std::nth_element(Refs, Refs + Half, Refs + Node.Count, [&](uint32_t A, uint32_t B)
+        {
+            return Builder.Centroids[A].e[LargestAxis] < Builder.Centroids[B].e[LargestAxis];
+        });
+        return Node.First + Half;
+    }
+
+    // Bin the centroids on the 3 axes
+    int BatchCount = GetBatchCount(Node.Count);
+    std::vector<bvh_bin> Bins(BatchCount * 3 * BVH_BIN_COUNT, bvh_bin{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX }, 0 });
+    v3 BinScale;
+    for (int Axis = 0; Axis < 3; ++Axis)
+        BinScale.e[Axis] = CentroidSize.e[Axis] > 0.f ? BVH_BIN_COUNT / CentroidSize.e[Axis] : 0.f;
+
+    Jobs::ParallelFor(BatchCount, 1, [&](int Begin, int End)
+    {
+        for (int b = Begin; b < End; ++b)
+        {
+            bvh_bin* BatchBins = &Bins[b * 3 * BVH_BIN_COUNT];
+            for (uint32_t i = GetBatchStart(Node.First, Node.Count, b, BatchCount); i < GetBatchStart(Node.First, Node.Count, b + 1, BatchCount); ++i)
+            {
+                uint32_t Ref = Builder.Refs[i];
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    bvh_bin& Bin = BatchBins[Axis * BVH_BIN_COUNT + GetBin(Builder.Centroids[Ref].e[Axis], Node.CentroidMin.e[Axis], BinScale.e[Axis])];
+                    Bin.Min = Vec3::Min(Bin.Min, Builder.TriangleMin[Ref]);
+                    Bin.Max = Vec3::Max(Bin.Max, Builder.TriangleMax[Ref]);
+                    Bin.Count++;
+                }
+            }
+        }
+    });
+    for (int b = 1; b < BatchCount; ++b)
+    {
+        for (int i = 0; i < 3 * BVH_BIN_COUNT; ++i)
+        {
+            bvh_bin& Bin = Bins[i];
+            const bvh_bin& Other = Bins[b * 3 * BVH_BIN_COUNT + i];
+            Bin.Min = Vec3::Min(Bin.Min, Other.Min);
+            Bin.Max = Vec3::Max(Bin.Max, Other.Max);
+            Bin.Count += Other.Count;
+        }
+    }
+
+    // Surface area heuristic: sweep the bins from the right, then from the left
+    float BestCost = FLT_MAX;
+    int BestAxis = -1;
+    int BestBin = 0;
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        if (CentroidSize.e[Axis] <= 0.f)
+            continue;
+
+        const bvh_bin* AxisBins = &Bins[Axis * BVH_BIN_COUNT];
+        float RightCosts[BVH_BIN_COUNT];
+        bvh_bin Right = AxisBins[BVH_BIN_COUNT - 1];
+        for (int i = BVH_BIN_COUNT - 1; i > 0; --i)
+        {
+            Right.Min = Vec3::Min(Right.Min, AxisBins[i].Min);
+            Right.Max = Vec3::Max(Right.Max, AxisBins[i].Max);
+            Right.Count += i < BVH_BIN_COUNT - 1 ? AxisBins[i].Count : 0;
+            RightCosts[i] = Right.Count > 0 ? GetHalfArea(Right.Min, Right.Max) * Right.Count : FLT_MAX;
+        }
+
+        bvh_bin Left = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX }, 0 };
+        for (int i = 1; i < BVH_BIN_COUNT; ++i)
+        {
+            Left.Min = Vec3::Min(Left.Min, AxisBins[i - 1].Min);
+            Left.Max = Vec3::Max(Left.Max, AxisBins[i - 1].Max);
+            Left.Count += AxisBins[i - 1].Count;
+            if (Left.Count == 0 || RightCosts[i] == FLT_MAX)
+                continue;
+            float Cost = GetHalfArea(Left.Min, Left.Max) * Left.Count + RightCosts[i];
+            if (Cost < BestCost)
+            {
+                BestCost = Cost;
+                BestAxis = Axis;
+                BestBin = i;
+            }
+        }
+    }
+
+    // Leaf when testing the triangles is cheaper than visiting two children
+    float LeafCost = (float)Node.Count;
+    float SplitCost = BVH_TRAVERSAL_COST + BestCost / Math::Max(GetHalfArea(Node.Min, Node.Max), FLT_MIN);
+    if (BestAxis < 0 || (Node.Count <= (uint32_t)BVH_MAX_LEAF_SIZE && LeafCost <= SplitCost))
+        return 0;
+
+    uint32_t* Middle = std::partition(Refs, Refs + Node.Count, [&](uint32_t Ref)
+    {
+        return GetBin(Builder.Centroids[Ref].e[BestAxis], Node.CentroidMin.e[BestAxis], BinScale.e[BestAxis]) < BestBin;
+    });
+    return Node.First + (uint32_t)(Middle - Refs);
+}
+
+// Split Nodes[Index] recursively, with Deferred the nodes smaller than ParallelSize are left for the job threads
+static void BuildNode(std::vector<build_node>& Nodes, const bvh_builder& Builder, int Index, int Depth, std::vector<deferred_node>* Deferred, uint32_t ParallelSize)
+{
+    if (Deferred && Nodes[Index].Count < ParallelSize)
+    {
+        Deferred->push_back({ Index, Depth });
+        return;
+    }
+
+    build_node Node = Nodes[Index];
+    uint32_t Split = SplitNode(Node, Builder, Depth);
+    if (Split == 0)
+        return;
+
+    build_node Left = MakeLeaf(Node.First, Split - Node.First);
+    build_node Right = MakeLeaf(Split, Node.First + Node.Count - Split);
+    ComputeBounds(Left, Builder);
+    ComputeBounds(Right, Builder);
+
+    Nodes[Index].Left = (int32_t)Nodes.size();
+    Nodes.push_back(Left);
+    Nodes[Index].Right = (int32_t)Nodes.size();
+    Nodes.push_back(Right);
+    BuildNode(Nodes, Builder, Nodes[Index].Left, Depth + 1, Deferred, ParallelSize);
+    BuildNode(Nodes, Builder, Nodes[Index].Right, Depth + 1, Deferred, ParallelSize);
+}
+
+// Collapse the binary node Index and its descendants to 4 wide nodes, returns the index of the first one
+static int CollapseNode(mesh_bvh& Bvh, const std::vector<build_node>& Nodes, int Index)
+{
+    // Open the largest inner children until there are 4 of them (a leaf root gets a single child)
+    int Children[4] = { Index };
+    int ChildCount = 1;
+    if (Nodes[Index].Left >= 0)
+    {
+        Children[0] = Nodes[Index].Left;
+        Children[1] = Nodes[Index].Right;
+        ChildCount = 2;
+    }
+    while (ChildCount < 4)
+    {
+        int Largest = -1;
+        float LargestArea = -1.f;
+        for (int c = 0; c < ChildCount; ++c)
+        {
+            const build_node& Child = Nodes[Children[c]];
+            float Area = GetHalfArea(Child.Min, Child.Max);
+            if (Child.Left >= 0 && Area > LargestArea)
+            {
+                Largest = c;
+                LargestArea = Area;
+            }
+        }
+        if (Largest < 0)
+            break;
+        const build_node& Opened = Nodes[Children[Largest]];
+        Children[Largest] = Opened.Left;
+        Children[ChildCount++] = Opened.Right;
+    }
+
+    int NodeIndex = (int)Bvh.Nodes.size();
+    bvh_node Empty;
+    for (int c = 0; c < 4; ++c)
+    {
+        Empty.MinX[c] = Empty.MinY[c] = Empty.MinZ[c] = FLT_MAX;
+        Empty.MaxX[c] = Empty.MaxY[c] = Empty.MaxZ[c] = -FLT_MAX;
+        Empty.Children[c] = -1;
+        Empty.Counts[c] = 0;
+    }
+    Bvh.Nodes.push_back(Empty);
+
+    for (int c = 0; c < ChildCount; ++c)
+    {
+        const build_node& Child = Nodes[Children[c]];
+        int32_t ChildIndex = Child.Left < 0 ? (int32_t)Child.First : CollapseNode(Bvh, Nodes, Children[c]);
+
+        bvh_node& Node = Bvh.Nodes[NodeIndex];
+        Node.MinX[c] = Child.Min.x;
+        Node.MinY[c] = Child.Min.y;
+        Node.MinZ[c] = Child.Min.z;
+        Node.MaxX[c] = Child.Max.x;
+        Node.MaxY[c] = Child.Max.y;
+        Node.MaxZ[c] = Child.Max.z;
+        Node.Children[c] = ChildIndex;
+        Node.Counts[c] = Child.Left < 0 ? Child.Count : 0;
+    }
+    return NodeIndex;
+}
+
+void Mesh::BuildBvh(mesh_bvh& Bvh, const vertex_full* Vertices, const void* Indices, int IndexCount, int IndexSize)
+{
+    Bvh.Nodes.clear();
+    Bvh.Triangles.clear();
+    Bvh.BoundsMin = Bvh.BoundsMax = {};
+
+    int TriangleCount = IndexCount / 3;
+    if (TriangleCount == 0)
+        return;
+
+    std::vector<bvh_triangle> Triangles(TriangleCount);
+    std::vector<v3> TriangleMin(TriangleCount);
+    std::vector<v3> TriangleMax(TriangleCount);
+    std::vector<v3> Centroids(TriangleCount);
+    std::vector<uint32_t> Refs(TriangleCount);
+    Jobs::ParallelFor(TriangleCount, 4096, [&](int Begin, int End)
+    {
+        for (int t = Begin; t < End; ++t)
+        {
+            v3 V[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t Index = IndexSize == sizeof(uint16_t) ? ((const uint16_t*)Indices)[t * 3 + c] : ((const uint32_t*)Indices)[t * 3 + c];
+                V[c] = Vertices[Index].Position;
+            }
+            Triangles[t] = { V[0], V[1] - V[0], V[2] - V[0], (uint32_t)t };
+            TriangleMin[t] = Vec3::Min(V[0], Vec3::Min(V[1], V[2]));
+            TriangleMax[t] = Vec3::Max(V[0], Vec3::Max(V[1], V[2]));
+            Centroids[t] = (TriangleMin[t] + TriangleMax[t]) * 0.5f;
+            Refs[t] = (uint32_t)t;
+        }
+    });
+
+    bvh_builder Builder = { TriangleMin.data(), TriangleMax.data(), Centroids.data(), Refs.data() };
+    std::vector<build_node> Nodes;
+    Nodes.reserve(TriangleCount);
+    Nodes.push_back(MakeLeaf(0, (uint32_t)TriangleCount));
+    ComputeBounds(Nodes[0], Builder);
+
+    // Top of the tree on this thread (with parallel binning), then the subtrees on the job threads
+    std::vector<deferred_node> Deferred;
+    uint32_t ParallelSize = Math::Max((uint32_t)TriangleCount / (Jobs::GetThreadCount() * 8), 1024u);
+    BuildNode(Nodes, Builder, 0, 0, &Deferred, ParallelSize);
+
+    std::vector<std::vector<build_node>> Subtrees(Deferred.size());
+    Jobs::ParallelFor((int)Deferred.size(), 1, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            Subtrees[i].push_back(Nodes[Deferred[i].Index]);
+            BuildNode(Subtrees[i], Builder, 0, Deferred[i].Depth, nullptr, 0);
+        }
+    });
+
+    // Subtree roots replace their deferred node, the other nodes are appended
+    for (size_t i = 0; i < Subtrees.size(); ++i)
+    {
+        int32_t Base = (int32_t)Nodes.size() - 1;
+        for (build_node& Node : Subtrees[i])
+        {
+            if (Node.Left >= 0)
+            {
+                Node.Left += Base;
+                Node.Right += Base;
+            }
+        }
+        Nodes[Deferred[i].Index] = Subtrees[i][0];
+        Nodes.insert(Nodes.end(), Subtrees[i].begin() + 1, Subtrees[i].end());
+    }
+
+    // Leaves index the triangles in Refs order
+    Bvh.Triangles.resize(TriangleCount);
+    for (int i = 0; i < TriangleCount; ++i)
+        Bvh.Triangles[i] = Triangles[Refs[i]];
+    Bvh.BoundsMin = Nodes[0].Min;
+    Bvh.BoundsMax = Nodes[0].Max;
+    Bvh.Nodes.reserve(Nodes.size() / 2 + 1);
+    CollapseNode(Bvh, Nodes, 0);
+}
+
+// FNV-1a of the positions and LOD 0 indices (whatever the encoding of the cache they come from)
+static uint64_t HashMesh(const mapped_mesh& Mesh)
+{
+    uint64_t Hash = 0xcbf29ce484222325ull;
+    auto HashBytes = [&Hash](const void* Data, size_t Size)
+    {
+        const uint8_t* Bytes = (const uint8_t*)Data;
+        for (size_t i = 0; i < Size; ++i)
+            Hash = (Hash ^ Bytes[i]) * 0x100000001b3ull;
+    };
+    for (int i = 0; i < Mesh.VertexCount; ++i)
+        HashBytes(&Mesh.Vertices[i].Position, sizeof(v3));
+    HashBytes(Mesh.Indices, (size_t)Mesh.IndexCount * Mesh.IndexSize);
+    return Hash;
+}
+
+// Returns the reason why the file can't be used, nullptr if Bvh was read
+static const char* ReadBvhFile(mesh_bvh& Bvh, const char* BvhFile, uint64_t MeshHash, bool* Exists)
+{
+    file_mapping Mapping;
+    *Exists = File::Map(Mapping, BvhFile);
+    if (!*Exists)
+        return "missing";
+
+    const char* Error = nullptr;
+    const bvh_file_header& Header = *(const bvh_file_header*)Mapping.Data;
+    if (Mapping.Size < sizeof(bvh_file_header) || Header.Magic != BVH_FILE_MAGIC)
+        Error = "not a BVH";
+    else if (Header.Version != BVH_FILE_VERSION || Header.Endianness != BVH_FILE_ENDIANNESS || Header.HeaderSize != sizeof(bvh_file_header))
+        Error = "version changed";
+    else if (Header.MeshHash != MeshHash)
+        Error = "mesh changed";
+    else if (Header.NodeCount == 0 || Mapping.Size != sizeof(bvh_file_header) + (uint64_t)Header.NodeCount * sizeof(bvh_node) + (uint64_t)Header.TriangleCount * sizeof(bvh_triangle))
+        Error = "truncated";
+
+    if (Error == nullptr)
+    {
+        const bvh_node* Nodes = (const bvh_node*)((const uint8_t*)Mapping.Data + sizeof(bvh_file_header));
+        const bvh_triangle* Triangles = (const bvh_triangle*)(Nodes + Header.NodeCount);
+        Bvh.Nodes.assign(Nodes, Nodes + Header.NodeCount);
+        Bvh.Triangles.assign(Triangles, Triangles + Header.TriangleCount);
+        Bvh.BoundsMin = Header.BoundsMin;
+        Bvh.BoundsMax = Header.BoundsMax;
+
+        // Children are followed without checks by the traversal
+        for (const bvh_node& Node : Bvh.Nodes)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                bool Leaf = Node.Counts[c] > 0;
+                if ((Leaf && (Node.Children[c] < 0 || (uint64_t)Node.Children[c] + Node.Counts[c] > Header.TriangleCount))
+                    || (!Leaf && Node.Children[c] >= (int32_t)Header.NodeCount))
+                    Error = "corrupted data";
+            }
+        }
+    }
+
+    File::Unmap(Mapping);
+    return Error;
+}
+
+bool Mesh::LoadBvh(mesh_bvh& Bvh, const char* Filename, const mapped_mesh& Mesh)
+{
+    std::string BvhFile = std::string(Filename) + ".bvh";
+    uint64_t MeshHash = HashMesh(Mesh);
+
+    bool Exists;
+    const char* Error = ReadBvhFile(Bvh, BvhFile.c_str(), MeshHash, &Exists);
+    if (Error == nullptr)
+    {
+        printf("Loaded BVH: %s (%d nodes, %d triangles)\n", BvhFile.c_str(), (int)Bvh.Nodes.size(), (int)Bvh.Triangles.size());
+        return true;
+    }
+    if (Exists)
+        printf("Outdated BVH: %s (%s)\n", BvhFile.c_str(), Error);
+
+    typedef std::chrono::high_resolution_clock clock;
+    clock::time_point Start = clock::now();
+    BuildBvh(Bvh, Mesh.Vertices, Mesh.Indices, Mesh.IndexCount, Mesh.IndexSize);
+    if (Bvh.Nodes.empty())
+        return false;
+    printf("Built BVH: %s (%d nodes, %d triangles, %.1f ms)\n", BvhFile.c_str(), (int)Bvh.Nodes.size(), (int)Bvh.Triangles.size(),
+           std::chrono::duration<double, std::milli>(clock::now() - Start).count());
+
+    // Rebuilt on each load if it can't be saved
+    SaveBvh(Bvh, BvhFile.c_str(), MeshHash);
+    return true;
+}
+
+bool Mesh::SaveBvh(const mesh_bvh& Bvh, const char* BvhFile, uint64_t MeshHash)
+{
+    FILE* File = fopen(BvhFile, "wb");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write BVH: %s\n", BvhFile);
+        return false;
+    }
+
+    bvh_file_header Header = {};
+    Header.Magic = BVH_FILE_MAGIC;
+    Header.Version = BVH_FILE_VERSION;
+    Header.Endianness = BVH_FILE_ENDIANNESS;
+    Header.HeaderSize = sizeof(bvh_file_header);
+    Header.MeshHash = MeshHash;
+    Header.NodeCount = (uint32_t)Bvh.Nodes.size();
+    Header.TriangleCount = (uint32_t)Bvh.Triangles.size();
+    Header.BoundsMin = Bvh.BoundsMin;
+    Header.BoundsMax = Bvh.BoundsMax;
+
+    bool Success = fwrite(&Header, sizeof(Header), 1, File) == 1
+        && fwrite(Bvh.Nodes.data(), sizeof(bvh_node), Bvh.Nodes.size(), File) == Bvh.Nodes.size()
+        && fwrite(Bvh.Triangles.data(), sizeof(bvh_triangle), Bvh.Triangles.size(), File) == Bvh.Triangles.size();
+    Success = fclose(File) == 0 && Success;
+    if (!Success)
+    {
+        fprintf(stderr, "Cannot write BVH: %s\n", BvhFile);
+        remove(BvhFile);
+        return false;
+    }
+
+    printf("Saved BVH: %s\n", BvhFile);
+    return true;
+}
+
+void Mesh::ScaleBvh(mesh_bvh& Bvh, float Scale)
+{
+    // Empty slots stay inverted (Scale is positive)
+    for (bvh_node& Node : Bvh.Nodes)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            Node.MinX[c] *= Scale; Node.MinY[c] *= Scale; Node.MinZ[c] *= Scale;
+            Node.MaxX[c] *= Scale; Node.MaxY[c] *= Scale; Node.MaxZ[c] *= Scale;
+        }
+    }
+    for (bvh_triangle& Triangle : Bvh.Triangles)
+    {
+        Triangle.V0 *= Scale;
+        Triangle.Edge1 *= Scale;
+        Triangle.Edge2 *= Scale;
+    }
+    Bvh.BoundsMin *= Scale;
+    Bvh.BoundsMax *= Scale;
+}
+
+struct bvh_ray
+{
+    v3 Origin;
+    v3 InvDirection;   // Finite, so that no 0 * infinity turns into a NaN
+    int NearOffsets[3]; // Floats of bvh_node holding the planes entered first on each axis (Min or Max)
+    int FarOffsets[3];
+};
+
+struct bvh_stack_entry
+{
+    int32_t Child;
+    uint32_t Count;
+    float Distance;    // Entry in the child box
+};
+
+static bvh_ray MakeRay(v3 Origin, v3 Direction)
+{
+    bvh_ray Ray;
+    Ray.Origin = Origin;
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        float D = Direction.e[Axis];
+        Ray.InvDirection.e[Axis] = (D > 1e-20f || D < -1e-20f) ? 1.f / D : (D < 0.f ? -1e20f : 1e20f);
+        bool Negative = Ray.InvDirection.e[Axis] < 0.f;
+        Ray.NearOffsets[Axis] = Axis * 4 + (Negative ? 12 : 0);
+        Ray.FarOffsets[Axis] = Axis * 4 + (Negative ? 0 : 12);
+    }
+    return Ray;
+}
+
+// Entry distances in the four children boxes, returns the mask of the boxes entered before MaxDistance
+static int IntersectChildren(const bvh_node& Node, const bvh_ray& Ray, float MaxDistance, float* Distances)
+{
+    const float* Planes = Node.MinX;
+#ifdef MESH_BVH_SIMD
+    __m128 OriginX = _mm_set1_ps(Ray.Origin.x), OriginY = _mm_set1_ps(Ray.Origin.y), OriginZ = _mm_set1_ps(Ray.Origin.z);
+    __m128 InvX = _mm_set1_ps(Ray.InvDirection.x), InvY = _mm_set1_ps(Ray.InvDirection.y), InvZ = _mm_set1_ps(Ray.InvDirection.z);
+    __m128 NearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Planes + Ray.NearOffsets[0]), OriginX), InvX);
+    __m128 NearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Planes + Ray.NearOffsets[1]), OriginY), InvY);
+    __m128 NearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Planes + Ray.NearOffsets[2]), OriginZ), InvZ);
+    __m128 FarX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Planes + Ray.FarOffsets[0]), OriginX), InvX);
+    __m128 FarY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Planes + Ray.FarOffsets[1]), OriginY), InvY);
+    __m128 FarZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Planes + Ray.FarOffsets[2]), OriginZ), InvZ);
+    __m128 Near = _mm_max_ps(_mm_max_ps(NearX, NearY), _mm_max_ps(NearZ, _mm_setzero_ps()));
+    __m128 Far = _mm_min_ps(_mm_min_ps(FarX, FarY), _mm_min_ps(FarZ, _mm_set1_ps(MaxDistance)));
+    _mm_storeu_ps(Distances, Near);
+    return _mm_movemask_ps(_mm_cmple_ps(Near, Far));
+#else
+    int Mask = 0;
+    for (int c = 0; c < 4; ++c)
+    {
+        float Near = 0.f;
+        float Far = MaxDistance;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Near = Math::Max(Near, (Planes[Ray.NearOffsets[Axis] + c] - Ray.Origin.e[Axis]) * Ray.InvDirection.e[Axis]);
+            Far = Math::Min(Far, (Planes[Ray.FarOffsets[Axis] + c] - Ray.Origin.e[Axis]) * Ray.InvDirection.e[Axis]);
+        }
+        Distances[c] = Near;
+        if (Near <= Far)
+            Mask |= 1 << c;
+    }
+    return Mask;
+#endif
+}
+
+// Moller-Trumbore, both faces
+static bool IntersectTriangle(const bvh_triangle& Triangle, v3 Origin, v3 Direction, float MaxDistance, bvh_hit* Hit)
+{
+    v3 P = Vec3::Cross(Direction, Triangle.Edge2);
+    float Determinant = Vec3::Dot(Triangle.Edge1, P);
+    if (Determinant == 0.f)
+        return false;
+
+    float InvDeterminant = 1.f / Determinant;
+    v3 S = Origin - Triangle.V0;
+    float U = Vec3::Dot(S, P) * InvDeterminant;
+    if (U < 0.f || U > 1.f)
+        return false;
+    v3 Q = Vec3::Cross(S, Triangle.Edge1);
+    float V = Vec3::Dot(Direction, Q) * InvDeterminant;
+    if (V < 0.f || U + V > 1.f)
+        return false;
+    float Distance = Vec3::Dot(Triangle.Edge2, Q) * InvDeterminant;
+    if (Distance < 0.f || Distance >= MaxDistance)
+        return false;
+
+    *Hit = { Distance, Triangle.Id, U, V };
+    return true;
+}
+
+bool Mesh::IntersectBvh(const mesh_bvh& Bvh, v3 Origin, v3 Direction, float MaxDistance, bvh_hit* Hit)
+{
+    if (Bvh.Nodes.empty())
+        return false;
+
+    bvh_ray Ray = MakeRay(Origin, Direction);
+    bvh_stack_entry Stack[BVH_STACK_SIZE];
+    int StackSize = 0;
+    Stack[StackSize++] = { 0, 0, 0.f };
+
+    bool Found = false;
+    while (StackSize > 0)
+    {
+        bvh_stack_entry Entry = Stack[--StackSize];
+        if (Entry.Distance >= MaxDistance)
+            continue;
+
+        if (Entry.Count > 0)
+        {
+            for (uint32_t i = 0; i < Entry.Count; ++i)
+            {
+                if (IntersectTriangle(Bvh.Triangles[Entry.Child + i], Origin, Direction, MaxDistance, Hit))
+                {
+                    MaxDistance = Hit->Distance;
+                    Found = true;
+                }
+            }
+            continue;
+        }
+
+        // Entered children sorted farthest first, the nearest is popped next
+        const bvh_node& Node = Bvh.Nodes[Entry.Child];
+        float Distances[4];
+        int Mask = IntersectChildren(Node, Ray, MaxDistance, Distances);
+        int First = StackSize;
+        for (int c = 0; c < 4; ++c)
+        {
+            if ((Mask & (1 << c)) == 0)
+                continue;
+            bvh_stack_entry Child = { Node.Children[c], Node.Counts[c], Distances[c] };
+            int i = StackSize++;
+            for (; i > First && Stack[i - 1].Distance < Child.Distance; --i)
+                Stack[i] = Stack[i - 1];
+            Stack[i] = Child;
+        }
+    }
+    return Found;
+}
+
+bool Mesh::IsOccludedBvh(const mesh_bvh& Bvh, v3 Origin, v3 Direction, float MaxDistance)
+{
+    if (Bvh.Nodes.empty())
+        return false;
+
+    bvh_ray Ray = MakeRay(Origin, Direction);
+    bvh_stack_entry Stack[BVH_STACK_SIZE];
+    int StackSize = 0;
+    Stack[StackSize++] = { 0, 0, 0.f };
+
+    while (StackSize > 0)
+    {
+        bvh_stack_entry Entry = Stack[--StackSize];
+        if (Entry.Count > 0)
+        {
+            bvh_hit Hit;
+            for (uint32_t i = 0; i < Entry.Count; ++i)
+            {
+                if (IntersectTriangle(Bvh.Triangles[Entry.Child + i], Origin, Direction, MaxDistance, &Hit))
+                    return true;
+            }
+            continue;
+        }
+
+        const bvh_node& Node = Bvh.Nodes[Entry.Child];
+        float Distances[4];
+        int Mask = IntersectChildren(Node, Ray, MaxDistance, Distances);
+        for (int c = 0; c < 4; ++c)
+        {
+            if (Mask & (1 << c))
+                Stack[StackSize++] = { Node.Children[c], Node.Counts[c], Distances[c] };
+        }
+    }
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// Bounding volume hierarchy over the LOD 0 triangles of a mesh, for ray queries (picking, visibility, baking)
+// Built top-down with the surface area heuristic over binned centroids, then collapsed to 4 wide nodes
+// whose children boxes are tested at once (SSE2 on x64)
+const int BVH_BIN_COUNT = 16;
+const int BVH_MAX_LEAF_SIZE = 8;
+const int BVH_MAX_DEPTH = 64;     // Binary levels, deeper nodes are split at the median (bounds the traversal stack)
+
+// Four children boxes (structure of arrays), empty slots have inverted boxes that rays never enter
+struct bvh_node
+{
+    float MinX[4], MinY[4], MinZ[4];
+    float MaxX[4], MaxY[4], MaxZ[4];
+    int32_t Children[4];  // Node index, or first triangle of a leaf
+    uint32_t Counts[4];   // Triangles of a leaf, 0 for a node or an empty slot
+};
+
+// Triangle stored with its edges for the intersection test
+struct bvh_triangle
+{
+    v3 V0;
+    v3 Edge1;             // V1 - V0
+    v3 Edge2;             // V2 - V0
+    uint32_t Id;          // Triangle index in the LOD 0 indices (FirstIndex / 3)
+};
+
+struct mesh_bvh
+{
+    std::vector<bvh_node> Nodes; // Root first, empty for a mesh without triangles
+    std::vector<bvh_triangle> Triangles;
+    v3 BoundsMin;
+    v3 BoundsMax;
+};
+
+struct bvh_hit
+{
+    float Distance;       // Hit point is Origin + Distance * Direction
+    uint32_t Triangle;    // bvh_triangle::Id
+    float U, V;           // Barycentric coordinates of V1 and V2
+};
+
+namespace Mesh
+{
+
+// Build over the LOD 0 triangles of an indexed mesh (IndexSize is 2 or 4 bytes), binning and subtrees run on the job threads
+void BuildBvh(mesh_bvh& Bvh, const vertex_full* Vertices, const void* Indices, int IndexCount, int IndexSize);
+// Load the BVH saved next to the mesh cache (<Filename>.bvh), rebuilt from Mesh and saved when missing or stale
+bool LoadBvh(mesh_bvh& Bvh, const char* Filename, const mapped_mesh& Mesh);
+bool SaveBvh(const mesh_bvh& Bvh, const char* BvhFile, uint64_t MeshHash);
+// Scale positions (GL::cache meshes loaded with a scale)
+void ScaleBvh(mesh_bvh& Bvh, float Scale);
+
+// Closest triangle hit by the ray in [0;MaxDistance) (Direction needs not be normalized, both triangle faces are hit)
+bool IntersectBvh(const mesh_bvh& Bvh, v3 Origin, v3 Direction, float MaxDistance, bvh_hit* Hit);
+// Any triangle hit in [0;MaxDistance), faster than IntersectBvh for visibility tests
+bool IsOccludedBvh(const mesh_bvh& Bvh, v3 Origin, v3 Direction, float MaxDistance);
+}
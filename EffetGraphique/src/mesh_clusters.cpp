@@ -0,0 +1,287 @@
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include "maths.h"
+#include "mesh_clusters.h"
+
+using namespace Mesh;
+
+// Triangles deviating more than 60 degrees from the cluster normal start a new cluster (keeps the cones cullable)
+const float CLUSTER_MIN_NORMAL_DOT = 0.5f;
+
+// Bounding sphere and normal cone of TriangleCount triangles from FirstTriangle
+static mesh_cluster ComputeClusterBounds(const indexed_mesh& Mesh, const uint32_t* Indices, int FirstTriangle, int TriangleCount, const std::vector<v3>& Normals)
+{
+    mesh_cluster Cluster = {};
+    Cluster.FirstIndex = (uint32_t)FirstTriangle * 3;
+    Cluster.IndexCount = (uint32_t)TriangleCount * 3;
+
+    // Sphere centered on the bounding box
+    v3 Min = Mesh.Vertices[Indices[FirstTriangle * 3]].Position;
+    v3 Max = Min;
+    for (int i = FirstTriangle * 3; i < (FirstTriangle + TriangleCount) * 3; ++i)
+    {
+        Min = Vec3::Min(Min, Mesh.Vertices[Indices[i]].Position);
+        Max = Vec3::Max(Max, Mesh.Vertices[Indices[i]].Position);
+    }
+    Cluster.Center = (Min + Max) * 0.5f;
+    for (int i = FirstTriangle * 3; i < (FirstTriangle + TriangleCount) * 3; ++i)
+        Cluster.Radius = Math::Max(Cluster.Radius, Vec3::Length(Mesh.Vertices[Indices[i]].Position - Cluster.Center));
+
+    // Cone around the mean normal, culling is disabled when it opens to 90 degrees or more
+    v3 NormalSum = {};
+    for (int t = FirstTriangle; t < FirstTriangle + TriangleCount; ++t)
+        NormalSum += Normals[t];
+
+    Cluster.ConeCutoff = 1.f;
+    float NormalSumLength = Vec3::Length(NormalSum);
+    if (NormalSumLength < 1e-6f)
+        return Cluster;
+
+    Cluster.ConeAxis = NormalSum / NormalSumLength;
+    float MinDot = 1.f;
+    for (int t = FirstTriangle; t < FirstTriangle + TriangleCount; ++t)
+    {
+        // Degenerate triangles are never rasterized
+        if (Normals[t].x != 0.f || Normals[t].y != 0.f || Normals[t].z != 0.f)
+            MinDot = Math::Min(MinDot, Vec3::Dot(Normals[t], Cluster.ConeAxis));
+    }
+
+    // Sine of the half angle with a small margin for precision
+    if (MinDot > 0.f)
+        Cluster.ConeCutoff = Math::Min(1.f, Math::Sqrt(1.f - MinDot * MinDot) + 1e-3f);
+
+    return Cluster;
+}
+
+void Mesh::BuildClusters(std::vector<mesh_cluster>& Clusters, indexed_mesh& Mesh, int MaxTriangles)
+{
+    mesh_submesh Submesh = {};
+    Submesh.IndexCount[0] = (uint32_t)Mesh.Indices.size();
+    Submesh.MaterialId = -1;
+    BuildClusters(Clusters, Mesh, std::vector<mesh_submesh>(1, Submesh), MaxTriangles);
+}
+
+void Mesh::BuildClusters(std::vector<mesh_cluster>& Clusters, indexed_mesh& Mesh, const std::vector<mesh_submesh>& Submeshes, int MaxTriangles)
+{
+    Clusters.clear();
+    int TriangleCount = (int)Mesh.Indices.size() / 3;
+    int VertexCount = (int)Mesh.Vertices.size();
+    const uint32_t* Indices = Mesh.Indices.data();
+
+    // Seeds are taken in order and clusters only grow inside their submesh:
+    // submeshes are consumed one after the other and keep their ranges
+    std::vector<int> SubmeshOf(TriangleCount, 0);
+    for (int s = 0; s < (int)Submeshes.size(); ++s)
+    {
+        int FirstTriangle = (int)Submeshes[s].FirstIndex[0] / 3;
+        std::fill(SubmeshOf.begin() + FirstTriangle, SubmeshOf.begin() + FirstTriangle + Submeshes[s].IndexCount[0] / 3, s);
+    }
+
+    // Triangle centroids and unit normals (zero for degenerate triangles)
+    std::vector<v3> Centroids(TriangleCount);
+    std::vector<v3> Normals(TriangleCount);
+    for (int t = 0; t < TriangleCount; ++t)
+    {
+        v3 P0 = Mesh.Vertices[Indices[t * 3 + 0]].Position;
+        v3 P1 = Mesh.Vertices[Indices[t * 3 + 1]].Position;
+        v3 P2 = Mesh.Vertices[Indices[t * 3 + 2]].Position;
+        Centroids[t] = (P0 + P1 + P2) / 3.f;
+
+        v3 Normal = Vec3::Cross(P1 - P0, P2 - P0);
+        float Length = Vec3::Length(Normal);
+        Normals[t] = Length > 0.f ? Normal / Length : v3 {};
+    }
+
+    // Vertices sharing a position (split by UV or normal seams) are connected
+    std::vector<uint32_t> PositionIds;
+    BuildPositionRemap(PositionIds, Mesh.Vertices.data(), VertexCount);
+
+    // Position to triangles adjacency (offsets + list)
+    std::vector<int> AdjacencyOffsets(VertexCount + 1, 0);
+    for (int i = 0; i < TriangleCount * 3; ++i)
+        AdjacencyOffsets[PositionIds[Indices[i]] + 1]++;
+    for (int v = 0; v < VertexCount; ++v)
+        AdjacencyOffsets[v + 1] += AdjacencyOffsets[v];
+    std::vector<int> AdjacentTriangles(TriangleCount * 3);
+    {
+        std::vector<int> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+        for (int i = 0; i < TriangleCount * 3; ++i)
+            AdjacentTriangles[Fill[PositionIds[Indices[i]]]++] = i / 3;
+    }
+
+    // Greedy growth from the first free triangle (in the vertex cache order) to its neighbours:
+    // the next triangle is the closest to the cluster center, weighted by the deviation from the cluster normal
+    // (meshes made of boxes give small clusters, consecutive visible clusters are merged when drawn)
+    std::vector<int> ClusterOf(TriangleCount, -1);
+    std::vector<int> CandidateOf(TriangleCount, -1); // Cluster for which the triangle is already a candidate
+    std::vector<int> Candidates;
+    std::vector<int> ClusterTriangles;
+    std::vector<uint32_t> SortedIndices;
+    SortedIndices.reserve(TriangleCount * 3);
+
+    int NextSeed = 0;
+    int ClusterIndex = 0;
+    for (;;)
+    {
+        while (NextSeed < TriangleCount && ClusterOf[NextSeed] != -1)
+            NextSeed++;
+        if (NextSeed == TriangleCount)
+            break;
+
+        ClusterTriangles.clear();
+        Candidates.clear();
+        v3 CentroidSum = {};
+        v3 NormalSum = {};
+
+        int Triangle = NextSeed;
+        while (Triangle != -1)
+        {
+            ClusterOf[Triangle] = ClusterIndex;
+            ClusterTriangles.push_back(Triangle);
+            CentroidSum += Centroids[Triangle];
+            NormalSum += Normals[Triangle];
+
+            if ((int)ClusterTriangles.size() == MaxTriangles)
+                break;
+
+            for (int Corner = 0; Corner < 3; ++Corner)
+            {
+                uint32_t Vertex = PositionIds[Indices[Triangle * 3 + Corner]];
+                for (int a = AdjacencyOffsets[Vertex]; a < AdjacencyOffsets[Vertex + 1]; ++a)
+                {
+                    int Neighbour = AdjacentTriangles[a];
+                    if (ClusterOf[Neighbour] == -1 && CandidateOf[Neighbour] != ClusterIndex && SubmeshOf[Neighbour] == SubmeshOf[Triangle])
+                    {
+                        CandidateOf[Neighbour] = ClusterIndex;
+                        Candidates.push_back(Neighbour);
+                    }
+                }
+            }
+
+            // Pick the best candidate
+            v3 Center = CentroidSum / (float)ClusterTriangles.size();
+            float NormalLength = Vec3::Length(NormalSum);
+            v3 Normal = NormalLength > 0.f ? NormalSum / NormalLength : v3 {};
+
+            Triangle = -1;
+            int BestCandidate = -1;
+            float BestScore = 0.f;
+            for (int c = 0; c < (int)Candidates.size(); ++c)
+            {
+                int Candidate = Candidates[c];
+                if (Vec3::Dot(Normals[Candidate], Normal) < CLUSTER_MIN_NORMAL_DOT)
+                    continue;
+                float Score = Vec3::Length(Centroids[Candidate] - Center) * (2.f - Vec3::Dot(Normals[Candidate], Normal));
+                if (BestCandidate == -1 || Score < BestScore)
+                {
+                    BestCandidate = c;
+                    BestScore = Score;
+                }
+            }
+            if (BestCandidate != -1)
+            {
+                Triangle = Candidates[BestCandidate];
+                Candidates[BestCandidate] = Candidates.back();
+                Candidates.pop_back();
+            }
+        }
+
+        // Keep the vertex cache order inside the cluster
+        std::sort(ClusterTriangles.begin(), ClusterTriangles.end());
+        for (int t : ClusterTriangles)
+        {
+            SortedIndices.push_back(Indices[t * 3 + 0]);
+            SortedIndices.push_back(Indices[t * 3 + 1]);
+            SortedIndices.push_back(Indices[t * 3 + 2]);
+        }
+
+        mesh_cluster Cluster = {};
+        Cluster.FirstIndex = (uint32_t)(SortedIndices.size() - ClusterTriangles.size() * 3);
+        Cluster.IndexCount = (uint32_t)ClusterTriangles.size() * 3;
+        Clusters.push_back(Cluster);
+        ClusterIndex++;
+    }
+
+    // Bounds with the triangles in their final order
+    Mesh.Indices.swap(SortedIndices);
+    Indices = Mesh.Indices.data();
+    for (int t = 0; t < TriangleCount; ++t)
+    {
+        v3 P0 = Mesh.Vertices[Indices[t * 3 + 0]].Position;
+        v3 P1 = Mesh.Vertices[Indices[t * 3 + 1]].Position;
+        v3 P2 = Mesh.Vertices[Indices[t * 3 + 2]].Position;
+        v3 Normal = Vec3::Cross(P1 - P0, P2 - P0);
+        float Length = Vec3::Length(Normal);
+        Normals[t] = Length > 0.f ? Normal / Length : v3 {};
+    }
+    for (mesh_cluster& Cluster : Clusters)
+        Cluster = ComputeClusterBounds(Mesh, Indices, Cluster.FirstIndex / 3, Cluster.IndexCount / 3, Normals);
+}
+
+void Mesh::GetFrustumPlanes(v4 Planes[6], const mat4& M)
+{
+    // Rows of the matrix (Gribb/Hartmann), clip space z in [-w;w]
+    v4 Rows[4];
+    for (int r = 0; r < 4; ++r)
+        Rows[r] = { M.c[0].e[r], M.c[1].e[r], M.c[2].e[r], M.c[3].e[r] };
+
+    Planes[0] = Rows[3] + Rows[0]; // Left
+    Planes[1] = Rows[3] - Rows[0]; // Right
+    Planes[2] = Rows[3] + Rows[1]; // Bottom
+    Planes[3] = Rows[3] - Rows[1]; // Top
+    Planes[4] = Rows[3] + Rows[2]; // Near
+    Planes[5] = Rows[3] - Rows[2]; // Far
+
+    for (int i = 0; i < 6; ++i)
+        Planes[i] = Planes[i] / Vec3::Length(Planes[i].xyz);
+}
+
+bool Mesh::IsClusterInFrustum(const mesh_cluster& Cluster, const v4 Planes[6])
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if (Vec3::Dot(Planes[i].xyz, Cluster.Center) + Planes[i].w < -Cluster.Radius)
+            return false;
+    }
+    return true;
+}
+
+bool Mesh::IsClusterBackfacing(const mesh_cluster& Cluster, v3 CameraPosition)
+{
+    v3 Direction = Cluster.Center - CameraPosition;
+    return Vec3::Dot(Direction, Cluster.ConeAxis) >= Cluster.ConeCutoff * Vec3::Length(Direction) + Cluster.Radius;
+}
+
+int Mesh::CullClusters(std::vector<uint32_t>& FirstIndices, std::vector<int>& IndexCounts, const mesh_cluster* Clusters, int ClusterCount,
+                       const mat4& ModelViewProjection, v3 CameraPosition, bool BackfaceCulling)
+{
+    FirstIndices.clear();
+    IndexCounts.clear();
+
+    v4 Planes[6];
+    GetFrustumPlanes(Planes, ModelViewProjection);
+
+    int IndexCount = 0;
+    for (int i = 0; i < ClusterCount; ++i)
+    {
+        const mesh_cluster& Cluster = Clusters[i];
+        if (!IsClusterInFrustum(Cluster, Planes) || (BackfaceCulling && IsClusterBackfacing(Cluster, CameraPosition)))
+            continue;
+
+        // Extend the previous range when contiguous
+        if (!FirstIndices.empty() && FirstIndices.back() + IndexCounts.back() == Cluster.FirstIndex)
+        {
+            IndexCounts.back() += Cluster.IndexCount;
+        }
+        else
+        {
+            FirstIndices.push_back(Cluster.FirstIndex);
+            IndexCounts.push_back(Cluster.IndexCount);
+        }
+        IndexCount += Cluster.IndexCount;
+    }
+
+    return IndexCount / 3;
+}
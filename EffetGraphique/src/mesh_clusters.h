@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// Triangles per cluster (clusters of disconnected parts can be smaller)
+const int CLUSTER_MAX_TRIANGLES = 128;
+
+namespace Mesh
+{
+
+// Split the triangles in clusters of spatially close triangles with similar normals
+// Indices are reordered cluster by cluster, the triangle order inside a cluster is kept
+void BuildClusters(std::vector<mesh_cluster>& Clusters, indexed_mesh& Mesh, int MaxTriangles = CLUSTER_MAX_TRIANGLES);
+// Same, clusters never cross submeshes so their LOD 0 ranges stay valid
+void BuildClusters(std::vector<mesh_cluster>& Clusters, indexed_mesh& Mesh, const std::vector<mesh_submesh>& Submeshes, int MaxTriangles = CLUSTER_MAX_TRIANGLES);
+
+// Frustum planes of a clip space matrix (a point P is inside when Dot(Plane.xyz, P) + Plane.w >= 0)
+void GetFrustumPlanes(v4 Planes[6], const mat4& ModelViewProjection);
+
+// Planes and camera position are in mesh space
+bool IsClusterInFrustum(const mesh_cluster& Cluster, const v4 Planes[6]);
+bool IsClusterBackfacing(const mesh_cluster& Cluster, v3 CameraPosition);
+
+// Index ranges of the visible clusters (consecutive clusters are merged), returns the number of visible triangles
+int CullClusters(std::vector<uint32_t>& FirstIndices, std::vector<int>& IndexCounts, const mesh_cluster* Clusters, int ClusterCount,
+                 const mat4& ModelViewProjection, v3 CameraPosition, bool BackfaceCulling);
+}
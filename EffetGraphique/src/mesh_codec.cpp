@@ -0,0 +1,486 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "maths.h"
+#include "mesh.h"
+#include "mesh_codec.h"
+
+// SSE2 is always available on x64
+#if defined(_M_X64) || defined(__x86_64__)
+#define MESH_CODEC_SIMD
+#include <emmintrin.h>
+#endif
+
+const int CODEC_BLOCK_SIZE = 256;  // Vertices or indices per block, multiple of 16
+const int CODEC_GROUP_SIZE = 16;
+const int CODEC_MAX_STRIDE = 256;
+
+// Bytes of packed data of a group for each header code (0, 2, 4 or 8 bits per byte)
+static const int GroupDataSizes[4] = { 0, 4, 8, 16 };
+
+static uint8_t ZigZag8(uint8_t Delta)
+{
+    return (uint8_t)((Delta << 1) ^ (uint8_t)((int8_t)Delta >> 7));
+}
+
+static uint8_t UnZigZag8(uint8_t Value)
+{
+    return (uint8_t)((Value >> 1) ^ (uint8_t)-(Value & 1));
+}
+
+static uint32_t ZigZag32(uint32_t Delta)
+{
+    return (Delta << 1) ^ (uint32_t)((int32_t)Delta >> 31);
+}
+
+static uint32_t UnZigZag32(uint32_t Value)
+{
+    return (Value >> 1) ^ (uint32_t)-(int32_t)(Value & 1);
+}
+
+static int GetGroupCount(int Count)
+{
+    return (Count + CODEC_GROUP_SIZE - 1) / CODEC_GROUP_SIZE;
+}
+
+// Header (2 bits per group) then the packed groups, Plane holds GroupCount * 16 bytes
+static uint8_t* EncodePlane(uint8_t* Dst, const uint8_t* Plane, int GroupCount)
+{
+    uint8_t* Header = Dst;
+    int HeaderSize = (GroupCount + 3) / 4;
+    memset(Header, 0, HeaderSize);
+    Dst += HeaderSize;
+
+    for (int g = 0; g < GroupCount; ++g)
+    {
+        const uint8_t* Group = Plane + g * CODEC_GROUP_SIZE;
+        uint8_t Max = 0;
+        for (int i = 0; i < CODEC_GROUP_SIZE; ++i)
+            Max = Group[i] > Max ? Group[i] : Max;
+
+        int Code = Max == 0 ? 0 : Max < 4 ? 1 : Max < 16 ? 2 : 3;
+        Header[g / 4] |= (uint8_t)(Code << ((g % 4) * 2));
+        if (Code == 1)
+        {
+            for (int i = 0; i < CODEC_GROUP_SIZE; i += 4)
+                *Dst++ = (uint8_t)(Group[i] | (Group[i + 1] << 2) | (Group[i + 2] << 4) | (Group[i + 3] << 6));
+        }
+        else if (Code == 2)
+        {
+            for (int i = 0; i < CODEC_GROUP_SIZE; i += 2)
+                *Dst++ = (uint8_t)(Group[i] | (Group[i + 1] << 4));
+        }
+        else if (Code == 3)
+        {
+            memcpy(Dst, Group, CODEC_GROUP_SIZE);
+            Dst += CODEC_GROUP_SIZE;
+        }
+    }
+    return Dst;
+}
+
+static void DecodeGroupScalar(uint8_t* Dst, const uint8_t* Data, int Code)
+{
+    switch (Code)
+    {
+    case 0:
+        memset(Dst, 0, CODEC_GROUP_SIZE);
+        break;
+    case 1:
+        for (int i = 0; i < CODEC_GROUP_SIZE; ++i)
+            Dst[i] = (Data[i / 4] >> ((i % 4) * 2)) & 3;
+        break;
+    case 2:
+        for (int i = 0; i < CODEC_GROUP_SIZE; ++i)
+            Dst[i] = (Data[i / 2] >> ((i % 2) * 4)) & 15;
+        break;
+    default:
+        memcpy(Dst, Data, CODEC_GROUP_SIZE);
+        break;
+    }
+}
+
+#ifdef MESH_CODEC_SIMD
+
+// Unpacked with shifts, masks and interleaves (loads never read past the group data)
+static void DecodeGroupSSE(uint8_t* Dst, const uint8_t* Data, int Code)
+{
+    __m128i Result;
+    switch (Code)
+    {
+    case 0:
+        Result = _mm_setzero_si128();
+        break;
+    case 1:
+    {
+        int32_t Packed;
+        memcpy(&Packed, Data, sizeof(Packed));
+        __m128i Bits = _mm_cvtsi32_si128(Packed);
+        __m128i Mask = _mm_set1_epi8(3);
+        __m128i A = _mm_and_si128(Bits, Mask);
+        __m128i B = _mm_and_si128(_mm_srli_epi16(Bits, 2), Mask);
+        __m128i C = _mm_and_si128(_mm_srli_epi16(Bits, 4), Mask);
+        __m128i D = _mm_and_si128(_mm_srli_epi16(Bits, 6), Mask);
+        Result = _mm_unpacklo_epi16(_mm_unpacklo_epi8(A, B), _mm_unpacklo_epi8(C, D));
+        break;
+    }
+    case 2:
+    {
+        __m128i Bits = _mm_loadl_epi64((const __m128i*)Data);
+        __m128i Mask = _mm_set1_epi8(15);
+        Result = _mm_unpacklo_epi8(_mm_and_si128(Bits, Mask), _mm_and_si128(_mm_srli_epi16(Bits, 4), Mask));
+        break;
+    }
+    default:
+        Result = _mm_loadu_si128((const __m128i*)Data);
+        break;
+    }
+    _mm_storeu_si128((__m128i*)Dst, Result);
+}
+
+static __m128i UnZigZag8SSE(__m128i Value)
+{
+    __m128i Half = _mm_and_si128(_mm_srli_epi16(Value, 1), _mm_set1_epi8(0x7F));
+    __m128i Sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(Value, _mm_set1_epi8(1)));
+    return _mm_xor_si128(Half, Sign);
+}
+
+// 16x16 bytes transpose: each pass interleaves rows i and i + 8 (4 passes rotate the row/column bits back to a transpose)
+static void Transpose16x16(__m128i* Rows)
+{
+    for (int Pass = 0; Pass < 4; ++Pass)
+    {
+        __m128i Result[16];
+        for (int i = 0; i < 8; ++i)
+        {
+            Result[2 * i + 0] = _mm_unpacklo_epi8(Rows[i], Rows[i + 8]);
+            Result[2 * i + 1] = _mm_unpackhi_epi8(Rows[i], Rows[i + 8]);
+        }
+        memcpy(Rows, Result, sizeof(Result));
+    }
+}
+
+#endif
+
+// Returns the end of the plane, nullptr if Src is too short
+static const uint8_t* DecodePlane(uint8_t* Plane, int GroupCount, const uint8_t* Src, const uint8_t* SrcEnd, bool Simd)
+{
+    int HeaderSize = (GroupCount + 3) / 4;
+    if (SrcEnd - Src < HeaderSize)
+        return nullptr;
+
+    const uint8_t* Header = Src;
+    const uint8_t* Data = Src + HeaderSize;
+    for (int g = 0; g < GroupCount; ++g)
+    {
+        int Code = (Header[g / 4] >> ((g % 4) * 2)) & 3;
+        if (SrcEnd - Data < GroupDataSizes[Code])
+            return nullptr;
+#ifdef MESH_CODEC_SIMD
+        if (Simd)
+            DecodeGroupSSE(Plane + g * CODEC_GROUP_SIZE, Data, Code);
+        else
+#endif
+            DecodeGroupScalar(Plane + g * CODEC_GROUP_SIZE, Data, Code);
+        Data += GroupDataSizes[Code];
+    }
+    (void)Simd;
+    return Data;
+}
+
+size_t Mesh::GetEncodedVertexBound(int Count, int Stride)
+{
+    int BlockCount = (Count + CODEC_BLOCK_SIZE - 1) / CODEC_BLOCK_SIZE;
+    int GroupCount = GetGroupCount(CODEC_BLOCK_SIZE);
+    return (size_t)BlockCount * Stride * ((GroupCount + 3) / 4 + GroupCount * CODEC_GROUP_SIZE);
+}
+
+size_t Mesh::EncodeVertexBuffer(uint8_t* Dst, const void* Vertices, int Count, int Stride)
+{
+    const uint8_t* Src = (const uint8_t*)Vertices;
+    uint8_t* Out = Dst;
+    uint8_t Last[CODEC_MAX_STRIDE] = {};
+    std::vector<uint8_t> Plane(CODEC_BLOCK_SIZE);
+
+    for (int BlockStart = 0; BlockStart < Count; BlockStart += CODEC_BLOCK_SIZE)
+    {
+        int BlockCount = Math::Min(CODEC_BLOCK_SIZE, Count - BlockStart);
+        int GroupCount = GetGroupCount(BlockCount);
+        for (int k = 0; k < Stride; ++k)
+        {
+            // Padding of the last group decodes to unchanged bytes
+            uint8_t Previous = Last[k];
+            std::fill(Plane.begin(), Plane.end(), 0);
+            for (int v = 0; v < BlockCount; ++v)
+            {
+                uint8_t Byte = Src[(size_t)(BlockStart + v) * Stride + k];
+                Plane[v] = ZigZag8((uint8_t)(Byte - Previous));
+                Previous = Byte;
+            }
+            Last[k] = Previous;
+            Out = EncodePlane(Out, Plane.data(), GroupCount);
+        }
+    }
+    return Out - Dst;
+}
+
+static bool DecodeVertexBufferImpl(void* Vertices, int Count, int Stride, const uint8_t* Src, size_t SrcSize, bool Simd)
+{
+    if (Stride <= 0 || Stride > CODEC_MAX_STRIDE || Stride % 4 != 0)
+        return false;
+
+    uint8_t* Dst = (uint8_t*)Vertices;
+    const uint8_t* SrcEnd = Src + SrcSize;
+    alignas(16) uint8_t Last[CODEC_MAX_STRIDE] = {};
+    std::vector<uint8_t> Planes((size_t)Stride * CODEC_BLOCK_SIZE);
+
+    for (int BlockStart = 0; BlockStart < Count; BlockStart += CODEC_BLOCK_SIZE)
+    {
+        int BlockCount = Math::Min(CODEC_BLOCK_SIZE, Count - BlockStart);
+        int GroupCount = GetGroupCount(BlockCount);
+        for (int k = 0; k < Stride && Src; ++k)
+            Src = DecodePlane(&Planes[(size_t)k * CODEC_BLOCK_SIZE], GroupCount, Src, SrcEnd, Simd);
+        if (Src == nullptr)
+            return false;
+
+        uint8_t* BlockDst = Dst + (size_t)BlockStart * Stride;
+#ifdef MESH_CODEC_SIMD
+        // 16 bytes of 16 vertices at a time: transpose the planes to vertices and accumulate the deltas
+        if (Simd && Stride % 16 == 0)
+        {
+            for (int Column = 0; Column < Stride; Column += 16)
+            {
+                __m128i Accumulator = _mm_load_si128((const __m128i*)&Last[Column]);
+                for (int g = 0; g < GroupCount; ++g)
+                {
+                    __m128i Rows[16];
+                    for (int k = 0; k < 16; ++k)
+                        Rows[k] = _mm_loadu_si128((const __m128i*)&Planes[(size_t)(Column + k) * CODEC_BLOCK_SIZE + g * CODEC_GROUP_SIZE]);
+                    Transpose16x16(Rows);
+
+                    int GroupVertexCount = Math::Min(CODEC_GROUP_SIZE, BlockCount - g * CODEC_GROUP_SIZE);
+                    for (int v = 0; v < GroupVertexCount; ++v)
+                    {
+                        Accumulator = _mm_add_epi8(Accumulator, UnZigZag8SSE(Rows[v]));
+                        _mm_storeu_si128((__m128i*)(BlockDst + (size_t)(g * CODEC_GROUP_SIZE + v) * Stride + Column), Accumulator);
+                    }
+                }
+                _mm_store_si128((__m128i*)&Last[Column], Accumulator);
+            }
+            continue;
+        }
+#endif
+        for (int v = 0; v < BlockCount; ++v)
+        {
+            uint8_t* Vertex = BlockDst + (size_t)v * Stride;
+            for (int k = 0; k < Stride; ++k)
+            {
+                Last[k] = (uint8_t)(Last[k] + UnZigZag8(Planes[(size_t)k * CODEC_BLOCK_SIZE + v]));
+                Vertex[k] = Last[k];
+            }
+        }
+    }
+    return Src == SrcEnd;
+}
+
+bool Mesh::DecodeVertexBuffer(void* Vertices, int Count, int Stride, const uint8_t* Src, size_t SrcSize)
+{
+    return DecodeVertexBufferImpl(Vertices, Count, Stride, Src, SrcSize, true);
+}
+
+size_t Mesh::GetEncodedIndexBound(int Count)
+{
+    return GetEncodedVertexBound(Count, sizeof(uint32_t));
+}
+
+size_t Mesh::EncodeIndexBuffer(uint8_t* Dst, const uint32_t* Indices, int Count)
+{
+    uint8_t* Out = Dst;
+    uint32_t Previous = 0;
+    std::vector<uint8_t> Planes(sizeof(uint32_t) * CODEC_BLOCK_SIZE);
+
+    for (int BlockStart = 0; BlockStart < Count; BlockStart += CODEC_BLOCK_SIZE)
+    {
+        int BlockCount = Math::Min(CODEC_BLOCK_SIZE, Count - BlockStart);
+        std::fill(Planes.begin(), Planes.end(), 0);
+        for (int i = 0; i < BlockCount; ++i)
+        {
+            uint32_t Value = ZigZag32(Indices[BlockStart + i] - Previous);
+            Previous = Indices[BlockStart + i];
+            for (int k = 0; k < 4; ++k)
+                Planes[k * CODEC_BLOCK_SIZE + i] = (uint8_t)(Value >> (k * 8));
+        }
+        for (int k = 0; k < 4; ++k)
+            Out = EncodePlane(Out, &Planes[k * CODEC_BLOCK_SIZE], GetGroupCount(BlockCount));
+    }
+    return Out - Dst;
+}
+
+static void StoreIndices(void* Indices, int First, int Count, int IndexSize, const uint32_t* Values)
+{
+    if (IndexSize == sizeof(uint16_t))
+    {
+        for (int i = 0; i < Count; ++i)
+            ((uint16_t*)Indices)[First + i] = (uint16_t)Values[i];
+    }
+    else
+    {
+        memcpy((uint32_t*)Indices + First, Values, Count * sizeof(uint32_t));
+    }
+}
+
+static bool DecodeIndexBufferImpl(void* Indices, int Count, int IndexSize, const uint8_t* Src, size_t SrcSize, bool Simd)
+{
+    if (IndexSize != sizeof(uint16_t) && IndexSize != sizeof(uint32_t))
+        return false;
+
+    const uint8_t* SrcEnd = Src + SrcSize;
+    uint32_t Previous = 0;
+    std::vector<uint8_t> Planes(sizeof(uint32_t) * CODEC_BLOCK_SIZE);
+
+    for (int BlockStart = 0; BlockStart < Count; BlockStart += CODEC_BLOCK_SIZE)
+    {
+        int BlockCount = Math::Min(CODEC_BLOCK_SIZE, Count - BlockStart);
+        int GroupCount = GetGroupCount(BlockCount);
+        for (int k = 0; k < 4 && Src; ++k)
+            Src = DecodePlane(&Planes[k * CODEC_BLOCK_SIZE], GroupCount, Src, SrcEnd, Simd);
+        if (Src == nullptr)
+            return false;
+
+        for (int g = 0; g < GroupCount; ++g)
+        {
+            alignas(16) uint32_t Values[CODEC_GROUP_SIZE];
+            int Offset = g * CODEC_GROUP_SIZE;
+#ifdef MESH_CODEC_SIMD
+            // Interleave the 4 planes to 32 bits values, then prefix sums of the deltas 4 lanes at a time
+            if (Simd)
+            {
+                __m128i P0 = _mm_loadu_si128((const __m128i*)&Planes[0 * CODEC_BLOCK_SIZE + Offset]);
+                __m128i P1 = _mm_loadu_si128((const __m128i*)&Planes[1 * CODEC_BLOCK_SIZE + Offset]);
+                __m128i P2 = _mm_loadu_si128((const __m128i*)&Planes[2 * CODEC_BLOCK_SIZE + Offset]);
+                __m128i P3 = _mm_loadu_si128((const __m128i*)&Planes[3 * CODEC_BLOCK_SIZE + Offset]);
+                __m128i Low01 = _mm_unpacklo_epi8(P0, P1);
+                __m128i High01 = _mm_unpackhi_epi8(P0, P1);
+                __m128i Low23 = _mm_unpacklo_epi8(P2, P3);
+                __m128i High23 = _mm_unpackhi_epi8(P2, P3);
+                __m128i Words[4] =
+                {
+                    _mm_unpacklo_epi16(Low01, Low23), _mm_unpackhi_epi16(Low01, Low23),
+                    _mm_unpacklo_epi16(High01, High23), _mm_unpackhi_epi16(High01, High23),
+                };
+
+                __m128i Sum = _mm_set1_epi32((int)Previous);
+                for (int i = 0; i < 4; ++i)
+                {
+                    __m128i Delta = _mm_xor_si128(_mm_srli_epi32(Words[i], 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(Words[i], _mm_set1_epi32(1))));
+                    Delta = _mm_add_epi32(Delta, _mm_slli_si128(Delta, 4));
+                    Delta = _mm_add_epi32(Delta, _mm_slli_si128(Delta, 8));
+                    Sum = _mm_add_epi32(Delta, _mm_shuffle_epi32(Sum, _MM_SHUFFLE(3, 3, 3, 3)));
+                    Words[i] = Sum;
+                }
+
+                int GroupIndexCount = Math::Min(CODEC_GROUP_SIZE, BlockCount - Offset);
+                if (GroupIndexCount == CODEC_GROUP_SIZE && IndexSize == sizeof(uint16_t))
+                {
+                    // Signed saturation is exact on values shifted to [-32768;32767]
+                    __m128i Bias32 = _mm_set1_epi32(32768);
+                    __m128i Bias16 = _mm_set1_epi16(-32768);
+                    uint16_t* Dst = (uint16_t*)Indices + BlockStart + Offset;
+                    __m128i Packed0 = _mm_packs_epi32(_mm_sub_epi32(Words[0], Bias32), _mm_sub_epi32(Words[1], Bias32));
+                    __m128i Packed1 = _mm_packs_epi32(_mm_sub_epi32(Words[2], Bias32), _mm_sub_epi32(Words[3], Bias32));
+                    _mm_storeu_si128((__m128i*)Dst, _mm_add_epi16(Packed0, Bias16));
+                    _mm_storeu_si128((__m128i*)(Dst + 8), _mm_add_epi16(Packed1, Bias16));
+                }
+                else if (GroupIndexCount == CODEC_GROUP_SIZE)
+                {
+                    uint32_t* Dst = (uint32_t*)Indices + BlockStart + Offset;
+                    for (int i = 0; i < 4; ++i)
+                        _mm_storeu_si128((__m128i*)(Dst + i * 4), Words[i]);
+                }
+                else
+                {
+                    for (int i = 0; i < 4; ++i)
+                        _mm_store_si128((__m128i*)(Values + i * 4), Words[i]);
+                    StoreIndices(Indices, BlockStart + Offset, GroupIndexCount, IndexSize, Values);
+                }
+                Previous = (uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi32(Words[3], _MM_SHUFFLE(3, 3, 3, 3)));
+                continue;
+            }
+#endif
+            for (int i = 0; i < CODEC_GROUP_SIZE; ++i)
+            {
+                uint32_t Value = Planes[Offset + i] | (Planes[CODEC_BLOCK_SIZE + Offset + i] << 8)
+                               | (Planes[2 * CODEC_BLOCK_SIZE + Offset + i] << 16) | ((uint32_t)Planes[3 * CODEC_BLOCK_SIZE + Offset + i] << 24);
+                Previous += UnZigZag32(Value);
+                Values[i] = Previous;
+            }
+            StoreIndices(Indices, BlockStart + Offset, Math::Min(CODEC_GROUP_SIZE, BlockCount - Offset), IndexSize, Values);
+        }
+    }
+    return Src == SrcEnd;
+}
+
+bool Mesh::DecodeIndexBuffer(void* Indices, int Count, int IndexSize, const uint8_t* Src, size_t SrcSize)
+{
+    return DecodeIndexBufferImpl(Indices, Count, IndexSize, Src, SrcSize, true);
+}
+
+void Mesh::BenchmarkMeshCodec(const char* Filename, int Iterations)
+{
+    mapped_mesh Mesh;
+    if (!MapObj(Mesh, Filename))
+        return;
+
+    int IndexCount = 0;
+    for (int i = 0; i < Mesh.LodCount; ++i)
+        IndexCount = Math::Max(IndexCount, (int)(Mesh.Lods[i].FirstIndex + Mesh.Lods[i].IndexCount));
+    std::vector<uint32_t> Indices(IndexCount);
+    for (int i = 0; i < IndexCount; ++i)
+        Indices[i] = Mesh.IndexSize == sizeof(uint16_t) ? ((const uint16_t*)Mesh.Indices)[i] : ((const uint32_t*)Mesh.Indices)[i];
+
+    size_t VertexSize = (size_t)Mesh.VertexCount * sizeof(vertex_full);
+    size_t IndexSize = (size_t)IndexCount * Mesh.IndexSize;
+    std::vector<uint8_t> EncodedVertices(GetEncodedVertexBound(Mesh.VertexCount, sizeof(vertex_full)));
+    std::vector<uint8_t> EncodedIndices(GetEncodedIndexBound(IndexCount));
+    EncodedVertices.resize(EncodeVertexBuffer(EncodedVertices.data(), Mesh.Vertices, Mesh.VertexCount, sizeof(vertex_full)));
+    EncodedIndices.resize(EncodeIndexBuffer(EncodedIndices.data(), Indices.data(), IndexCount));
+
+    printf("%s: %d vertices, %d indices (%d bits)\n", Filename, Mesh.VertexCount, IndexCount, Mesh.IndexSize * 8);
+    printf("  vertices %8.1f KB -> %8.1f KB (x%.2f)\n", VertexSize / 1024.0, EncodedVertices.size() / 1024.0, (double)VertexSize / EncodedVertices.size());
+    printf("  indices  %8.1f KB -> %8.1f KB (x%.2f)\n", IndexSize / 1024.0, EncodedIndices.size() / 1024.0, (double)IndexSize / EncodedIndices.size());
+
+    std::vector<uint8_t> Vertices(VertexSize);
+    std::vector<uint8_t> DecodedIndices(IndexSize);
+    for (int Simd = 1; Simd >= 0; --Simd)
+    {
+#ifndef MESH_CODEC_SIMD
+        if (Simd)
+            continue;
+#endif
+        float VertexTime = 0.f;
+        float IndexTime = 0.f;
+        bool Success = true;
+        for (int i = 0; i < Iterations; ++i)
+        {
+            std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+            Success &= DecodeVertexBufferImpl(Vertices.data(), Mesh.VertexCount, sizeof(vertex_full), EncodedVertices.data(), EncodedVertices.size(), Simd != 0);
+            std::chrono::steady_clock::time_point Middle = std::chrono::steady_clock::now();
+            Success &= DecodeIndexBufferImpl(DecodedIndices.data(), IndexCount, Mesh.IndexSize, EncodedIndices.data(), EncodedIndices.size(), Simd != 0);
+            std::chrono::steady_clock::time_point End = std::chrono::steady_clock::now();
+
+            float Time = std::chrono::duration<float, std::milli>(Middle - Start).count();
+            VertexTime = (i == 0) ? Time : Math::Min(VertexTime, Time);
+            Time = std::chrono::duration<float, std::milli>(End - Middle).count();
+            IndexTime = (i == 0) ? Time : Math::Min(IndexTime, Time);
+        }
+
+        bool Identical = Success && memcmp(Vertices.data(), Mesh.Vertices, VertexSize) == 0 && memcmp(DecodedIndices.data(), Mesh.Indices, IndexSize) == 0;
+        printf("  %-6s vertices %6.2f ms (%5.2f GB/s), indices %6.2f ms (%5.2f GB/s) %s\n", Simd ? "SSE2" : "scalar",
+               VertexTime, VertexSize / (VertexTime * 1e6), IndexTime, IndexSize / (IndexTime * 1e6), Identical ? "identical" : "DIFFERENT");
+    }
+
+    UnmapObj(Mesh);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Lossless vertex and index buffer compression (used by compressed mesh caches, see mesh_cache_encoding)
+// Vertices are cut in blocks of 256, each byte of the vertex is delta encoded against the previous vertex
+// and stored as a byte plane, in groups of 16 bytes packed on 0, 2, 4 or 8 bits
+// Indices are delta encoded against the previous index, then packed the same way as 4 bytes planes
+namespace Mesh
+{
+
+// Stride is a multiple of 4, at most 256 bytes
+size_t GetEncodedVertexBound(int Count, int Stride);
+size_t EncodeVertexBuffer(uint8_t* Dst, const void* Vertices, int Count, int Stride);
+// False if Src is not exactly an encoding of Count vertices
+bool DecodeVertexBuffer(void* Vertices, int Count, int Stride, const uint8_t* Src, size_t SrcSize);
+
+size_t GetEncodedIndexBound(int Count);
+size_t EncodeIndexBuffer(uint8_t* Dst, const uint32_t* Indices, int Count);
+// IndexSize is 2 or 4 bytes
+bool DecodeIndexBuffer(void* Indices, int Count, int IndexSize, const uint8_t* Src, size_t SrcSize);
+
+// Encoded sizes and decoding speed (SIMD and scalar) of the mesh cache of a .obj or .3ds
+void BenchmarkMeshCodec(const char* Filename, int Iterations);
+}
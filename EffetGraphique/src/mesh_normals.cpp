@@ -0,0 +1,165 @@
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+#include "maths.h"
+#include "jobs.h"
+#include "mesh_normals.h"
+
+struct weld_cell
+{
+    int64_t X, Y, Z;
+    uint32_t First; // First vertex kept in the cell, then WeldNext
+};
+
+static uint32_t HashCell(int64_t X, int64_t Y, int64_t Z)
+{
+    return (uint32_t)X * 73856093u ^ (uint32_t)Y * 19349663u ^ (uint32_t)Z * 83492791u;
+}
+
+void Mesh::WeldPositions(std::vector<uint32_t>& Remap, const vertex_full* Vertices, int VertexCount, float Tolerance)
+{
+    Remap.resize(VertexCount);
+    if (VertexCount == 0)
+        return;
+
+    v3 BoundsMin = Vertices[0].Position;
+    for (int i = 1; i < VertexCount; ++i)
+        BoundsMin = Vec3::Min(BoundsMin, Vertices[i].Position);
+
+    // Open addressing table of the non empty cells, kept vertices are chained per cell
+    const uint32_t EmptySlot = ~0u;
+    uint32_t TableSize = 1;
+    while (TableSize < (uint32_t)VertexCount * 2)
+        TableSize *= 2;
+    std::vector<uint32_t> Table(TableSize, EmptySlot);
+    std::vector<weld_cell> Cells;
+    std::vector<uint32_t> WeldNext(VertexCount, EmptySlot);
+
+    float CellSize = Math::Max(Tolerance, 1e-30f);
+    float SquaredTolerance = Tolerance * Tolerance;
+    auto FindSlot = [&](int64_t X, int64_t Y, int64_t Z)
+    {
+        uint32_t Slot = HashCell(X, Y, Z) & (TableSize - 1);
+        while (Table[Slot] != EmptySlot && (Cells[Table[Slot]].X != X || Cells[Table[Slot]].Y != Y || Cells[Table[Slot]].Z != Z))
+            Slot = (Slot + 1) & (TableSize - 1);
+        return Slot;
+    };
+
+    for (int i = 0; i < VertexCount; ++i)
+    {
+        v3 Position = Vertices[i].Position;
+        int64_t X = (int64_t)((Position.x - BoundsMin.x) / CellSize);
+        int64_t Y = (int64_t)((Position.y - BoundsMin.y) / CellSize);
+        int64_t Z = (int64_t)((Position.z - BoundsMin.z) / CellSize);
+
+        // Closer than Tolerance means in the same or a neighbour cell
+        uint32_t Weld = EmptySlot;
+        for (int Neighbour = 0; Neighbour < 27 && Weld == EmptySlot; ++Neighbour)
+        {
+            uint32_t Slot = FindSlot(X + Neighbour % 3 - 1, Y + (Neighbour / 3) % 3 - 1, Z + Neighbour / 9 - 1);
+            if (Table[Slot] == EmptySlot)
+                continue;
+            for (uint32_t Other = Cells[Table[Slot]].First; Other != EmptySlot; Other = WeldNext[Other])
+            {
+                v3 Delta = Vertices[Other].Position - Position;
+                if (Vec3::Dot(Delta, Delta) <= SquaredTolerance)
+                {
+                    Weld = Other;
+                    break;
+                }
+            }
+        }
+
+        if (Weld == EmptySlot)
+        {
+            uint32_t Slot = FindSlot(X, Y, Z);
+            if (Table[Slot] == EmptySlot)
+            {
+                Table[Slot] = (uint32_t)Cells.size();
+                Cells.push_back({ X, Y, Z, EmptySlot });
+            }
+            WeldNext[i] = Cells[Table[Slot]].First;
+            Cells[Table[Slot]].First = (uint32_t)i;
+            Weld = (uint32_t)i;
+        }
+        Remap[i] = Weld;
+    }
+}
+
+// Angle between the two edges leaving Corner
+static float GetCornerAngle(v3 Corner, v3 A, v3 B)
+{
+    v3 EdgeA = A - Corner;
+    v3 EdgeB = B - Corner;
+    float Lengths = Vec3::Length(EdgeA) * Vec3::Length(EdgeB);
+    if (Lengths == 0.f)
+        return 0.f;
+    return Math::Acos(Math::Clamp(Vec3::Dot(EdgeA, EdgeB) / Lengths, -1.f, 1.f));
+}
+
+void Mesh::BuildSmoothNormals(vertex_full* Triangles, int VertexCount, float CreaseAngle)
+{
+    int TriangleCount = VertexCount / 3;
+    if (TriangleCount == 0)
+        return;
+
+    v3 BoundsMin = Triangles[0].Position;
+    v3 BoundsMax = Triangles[0].Position;
+    for (int i = 1; i < VertexCount; ++i)
+    {
+        BoundsMin = Vec3::Min(BoundsMin, Triangles[i].Position);
+        BoundsMax = Vec3::Max(BoundsMax, Triangles[i].Position);
+    }
+    std::vector<uint32_t> Remap;
+    WeldPositions(Remap, Triangles, VertexCount, Vec3::Length(BoundsMax - BoundsMin) * NORMALS_WELD_TOLERANCE);
+
+    // Face normals: unit for the crease test, and weighted by area (length of the cross product) and angle for each corner
+    std::vector<v3> FaceNormals(TriangleCount);
+    std::vector<v3> CornerNormals(VertexCount);
+    Jobs::ParallelFor(TriangleCount, 4096, [&](int Begin, int End)
+    {
+        for (int t = Begin; t < End; ++t)
+        {
+            const vertex_full* V = &Triangles[t * 3];
+            v3 Cross = Vec3::Cross(V[1].Position - V[0].Position, V[2].Position - V[0].Position);
+            float Length = Vec3::Length(Cross);
+            FaceNormals[t] = Length > 0.f ? Cross / Length : v3{};
+            for (int c = 0; c < 3; ++c)
+                CornerNormals[t * 3 + c] = Cross * GetCornerAngle(V[c].Position, V[(c + 1) % 3].Position, V[(c + 2) % 3].Position);
+        }
+    });
+
+    // Corners of each welded position (counting sort)
+    std::vector<uint32_t> FirstCorner(VertexCount + 1, 0);
+    for (int i = 0; i < VertexCount; ++i)
+        FirstCorner[Remap[i] + 1]++;
+    for (int i = 0; i < VertexCount; ++i)
+        FirstCorner[i + 1] += FirstCorner[i];
+    std::vector<uint32_t> Corners(VertexCount);
+    std::vector<uint32_t> Cursor(FirstCorner.begin(), FirstCorner.end() - 1);
+    for (int i = 0; i < VertexCount; ++i)
+        Corners[Cursor[Remap[i]]++] = (uint32_t)i;
+
+    bool Crease = CreaseAngle < Math::Pi();
+    float CosCrease = Math::Cos(CreaseAngle);
+    Jobs::ParallelFor(VertexCount, 4096, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            v3 Face = FaceNormals[i / 3];
+            v3 Normal = {};
+            uint32_t Position = Remap[i];
+            for (uint32_t c = FirstCorner[Position]; c < FirstCorner[Position + 1]; ++c)
+            {
+                uint32_t Corner = Corners[c];
+                if (!Crease || Vec3::Dot(Face, FaceNormals[Corner / 3]) >= CosCrease)
+                    Normal += CornerNormals[Corner];
+            }
+
+            // Degenerated faces keep their (null) face normal
+            float Length = Vec3::Length(Normal);
+            Triangles[i].Normal = Length > 0.f ? Normal / Length : Face;
+        }
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// Faces further apart keep separated normals (hard edges), 60 degrees
+const float NORMALS_CREASE_ANGLE = 1.0471976f;
+// Positions closer than this fraction of the mesh size share their normals
+const float NORMALS_WELD_TOLERANCE = 1e-6f;
+
+namespace Mesh
+{
+
+// Weld positions closer than Tolerance with a spatial hash (grid of Tolerance sized cells)
+// Remap gives the first vertex of the weld of each vertex
+void WeldPositions(std::vector<uint32_t>& Remap, const vertex_full* Vertices, int VertexCount, float Tolerance);
+
+// Smooth normals of a list of triangles (built once by MapObj for meshes without normals and stored in the cache)
+// Each corner sums the face normals around its welded position, weighted by face area and corner angle,
+// skipping the faces more than CreaseAngle (radians) away from its own face (Pi or more: fully smooth)
+void BuildSmoothNormals(vertex_full* Triangles, int VertexCount, float CreaseAngle = NORMALS_CREASE_ANGLE);
+}
@@ -0,0 +1,292 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#include "maths.h"
+#include "mesh_optimizer.h"
+
+using namespace Mesh;
+
+// Vertex to triangles adjacency (compressed in one array)
+struct triangle_adjacency
+{
+    std::vector<int> Offsets;   // VertexCount + 1
+    std::vector<int> Triangles; // IndexCount
+};
+
+static void BuildTriangleAdjacency(triangle_adjacency& Adjacency, const uint32_t* Indices, int IndexCount, int VertexCount)
+{
+    Adjacency.Offsets.assign(VertexCount + 1, 0);
+    Adjacency.Triangles.resize(IndexCount);
+
+    for (int i = 0; i < IndexCount; ++i)
+        Adjacency.Offsets[Indices[i] + 1]++;
+
+    for (int i = 0; i < VertexCount; ++i)
+        Adjacency.Offsets[i + 1] += Adjacency.Offsets[i];
+
+    std::vector<int> Cursors(Adjacency.Offsets.begin(), Adjacency.Offsets.end() - 1);
+    for (int i = 0; i < IndexCount; ++i)
+        Adjacency.Triangles[Cursors[Indices[i]]++] = i / 3;
+}
+
+vertex_cache_stats Mesh::AnalyzeVertexCache(const uint32_t* Indices, int IndexCount, int VertexCount, int CacheSize)
+{
+    vertex_cache_stats Stats = {};
+    if (IndexCount == 0 || VertexCount == 0)
+        return Stats;
+
+    // FIFO cache simulation: a vertex is in cache if it has been pushed less than CacheSize misses ago
+    std::vector<int> CacheTimestamps(VertexCount, 0);
+    int Timestamp = CacheSize + 1;
+    int Misses = 0;
+
+    for (int i = 0; i < IndexCount; ++i)
+    {
+        uint32_t Index = Indices[i];
+        if (Timestamp - CacheTimestamps[Index] > CacheSize)
+        {
+            CacheTimestamps[Index] = Timestamp++;
+            Misses++;
+        }
+    }
+
+    Stats.ACMR = (float)Misses / (IndexCount / 3);
+    Stats.ATVR = (float)Misses / VertexCount;
+    return Stats;
+}
+
+// Tipsify: "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab, Barczak 2007)
+static int SkipDeadEnd(const std::vector<int>& LiveTriangles, std::vector<uint32_t>& DeadEnds, int& Cursor, int VertexCount)
+{
+    // Next vertex with live triangles from the recently used vertices
+    while (!DeadEnds.empty())
+    {
+        uint32_t Vertex = DeadEnds.back();
+        DeadEnds.pop_back();
+        if (LiveTriangles[Vertex] > 0)
+            return (int)Vertex;
+    }
+
+    // Otherwise next vertex with live triangles in input order
+    while (Cursor < VertexCount)
+    {
+        if (LiveTriangles[Cursor] > 0)
+            return Cursor;
+        Cursor++;
+    }
+
+    return -1;
+}
+
+static int GetNextVertex(const std::vector<uint32_t>& Candidates, const std::vector<int>& LiveTriangles, const std::vector<int>& CacheTimestamps,
+    int Timestamp, int CacheSize, std::vector<uint32_t>& DeadEnds, int& Cursor, int VertexCount)
+{
+    int BestVertex = -1;
+    int BestPriority = -1;
+
+    for (uint32_t Vertex : Candidates)
+    {
+        if (LiveTriangles[Vertex] == 0)
+            continue;
+
+        // Prefer the oldest vertex that will still be in cache after emitting its remaining triangles
+        int Priority = 0;
+        if (Timestamp - CacheTimestamps[Vertex] + 2 * LiveTriangles[Vertex] <= CacheSize)
+            Priority = Timestamp - CacheTimestamps[Vertex];
+
+        if (Priority > BestPriority)
+        {
+            BestPriority = Priority;
+            BestVertex = (int)Vertex;
+        }
+    }
+
+    if (BestVertex == -1)
+        BestVertex = SkipDeadEnd(LiveTriangles, DeadEnds, Cursor, VertexCount);
+
+    return BestVertex;
+}
+
+void Mesh::OptimizeVertexCache(uint32_t* Indices, int IndexCount, int VertexCount, int CacheSize)
+{
+    int TriangleCount = IndexCount / 3;
+    if (TriangleCount == 0)
+        return;
+
+    triangle_adjacency Adjacency;
+    BuildTriangleAdjacency(Adjacency, Indices, IndexCount, VertexCount);
+
+    std::vector<int> LiveTriangles(VertexCount);
+    for (int i = 0; i < VertexCount; ++i)
+        LiveTriangles[i] = Adjacency.Offsets[i + 1] - Adjacency.Offsets[i];
+
+    std::vector<int> CacheTimestamps(VertexCount, 0);
+    std::vector<bool> Emitted(TriangleCount, false);
+    std::vector<uint32_t> DeadEnds;
+    std::vector<uint32_t> Candidates;
+    std::vector<uint32_t> Output;
+    Output.reserve(IndexCount);
+
+    int Timestamp = CacheSize + 1;
+    int Cursor = 0;
+    int FanningVertex = 0;
+
+    while (FanningVertex >= 0)
+    {
+        Candidates.clear();
+
+        // Emit all the live triangles around the fanning vertex
+        for (int j = Adjacency.Offsets[FanningVertex]; j < Adjacency.Offsets[FanningVertex + 1]; ++j)
+        {
+            int Triangle = Adjacency.Triangles[j];
+            if (Emitted[Triangle])
+                continue;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t Vertex = Indices[Triangle * 3 + k];
+                Output.push_back(Vertex);
+                DeadEnds.push_back(Vertex);
+                Candidates.push_back(Vertex);
+                LiveTriangles[Vertex]--;
+
+                if (Timestamp - CacheTimestamps[Vertex] > CacheSize)
+                    CacheTimestamps[Vertex] = Timestamp++;
+            }
+            Emitted[Triangle] = true;
+        }
+
+        FanningVertex = GetNextVertex(Candidates, LiveTriangles, CacheTimestamps, Timestamp, CacheSize, DeadEnds, Cursor, VertexCount);
+    }
+
+    std::copy(Output.begin(), Output.end(), Indices);
+}
+
+void Mesh::OptimizeOverdraw(uint32_t* Indices, int IndexCount, const vertex_full* Vertices, int VertexCount, int CacheSize)
+{
+    int TriangleCount = IndexCount / 3;
+    if (TriangleCount == 0)
+        return;
+
+    // Split in clusters where the cache is flushed (all vertices of a triangle miss)
+    // Reordering clusters only adds a few misses at the cluster boundaries
+    std::vector<int> ClusterStarts;
+    {
+        std::vector<int> CacheTimestamps(VertexCount, 0);
+        int Timestamp = CacheSize + 1;
+        for (int Triangle = 0; Triangle < TriangleCount; ++Triangle)
+        {
+            int Misses = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t Vertex = Indices[Triangle * 3 + k];
+                if (Timestamp - CacheTimestamps[Vertex] > CacheSize)
+                {
+                    CacheTimestamps[Vertex] = Timestamp++;
+                    Misses++;
+                }
+            }
+
+            if (Triangle == 0 || Misses == 3)
+                ClusterStarts.push_back(Triangle);
+        }
+    }
+    int ClusterCount = (int)ClusterStarts.size();
+    ClusterStarts.push_back(TriangleCount);
+
+    // Mesh centroid
+    v3 MeshCentroid = {};
+    for (int i = 0; i < IndexCount; ++i)
+        MeshCentroid += Vertices[Indices[i]].Position;
+    MeshCentroid /= (float)IndexCount;
+
+    // Sort clusters by how much they face outward of the mesh
+    std::vector<float> ClusterSortKeys(ClusterCount);
+    for (int Cluster = 0; Cluster < ClusterCount; ++Cluster)
+    {
+        v3 Centroid = {};
+        v3 Normal = {};
+        float Area = 0.f;
+        for (int Triangle = ClusterStarts[Cluster]; Triangle < ClusterStarts[Cluster + 1]; ++Triangle)
+        {
+            v3 P0 = Vertices[Indices[Triangle * 3 + 0]].Position;
+            v3 P1 = Vertices[Indices[Triangle * 3 + 1]].Position;
+            v3 P2 = Vertices[Indices[Triangle * 3 + 2]].Position;
+
+            v3 AreaNormal = Vec3::Cross(P1 - P0, P2 - P0); // Length is twice the triangle area
+            float TriangleArea = Vec3::Length(AreaNormal);
+
+            Centroid += (P0 + P1 + P2) * (TriangleArea / 3.f);
+            Normal += AreaNormal;
+            Area += TriangleArea;
+        }
+
+        float NormalLength = Vec3::Length(Normal);
+        if (Area > 0.f && NormalLength > 0.f)
+            ClusterSortKeys[Cluster] = Vec3::Dot(Centroid / Area - MeshCentroid, Normal / NormalLength);
+        else
+            ClusterSortKeys[Cluster] = 0.f;
+    }
+
+    std::vector<int> ClusterOrder(ClusterCount);
+    for (int i = 0; i < ClusterCount; ++i)
+        ClusterOrder[i] = i;
+    std::stable_sort(ClusterOrder.begin(), ClusterOrder.end(), [&](int A, int B) { return ClusterSortKeys[A] > ClusterSortKeys[B]; });
+
+    std::vector<uint32_t> Output;
+    Output.reserve(IndexCount);
+    for (int Cluster : ClusterOrder)
+        Output.insert(Output.end(), Indices + ClusterStarts[Cluster] * 3, Indices + ClusterStarts[Cluster + 1] * 3);
+
+    std::copy(Output.begin(), Output.end(), Indices);
+}
+
+void Mesh::OptimizeVertexFetch(indexed_mesh& Mesh)
+{
+    const uint32_t Unused = ~0u;
+    std::vector<uint32_t> Remap(Mesh.Vertices.size(), Unused);
+    std::vector<vertex_full> Vertices;
+    Vertices.reserve(Mesh.Vertices.size());
+
+    for (uint32_t& Index : Mesh.Indices)
+    {
+        if (Remap[Index] == Unused)
+        {
+            Remap[Index] = (uint32_t)Vertices.size();
+            Vertices.push_back(Mesh.Vertices[Index]);
+        }
+        Index = Remap[Index];
+    }
+
+    Mesh.Vertices.swap(Vertices);
+}
+
+void Mesh::Optimize(indexed_mesh& Mesh)
+{
+    mesh_submesh Submesh = {};
+    Submesh.IndexCount[0] = (uint32_t)Mesh.Indices.size();
+    Submesh.MaterialId = -1;
+    Optimize(Mesh, std::vector<mesh_submesh>(1, Submesh));
+}
+
+void Mesh::Optimize(indexed_mesh& Mesh, const std::vector<mesh_submesh>& Submeshes)
+{
+    int IndexCount = (int)Mesh.Indices.size();
+    int VertexCount = (int)Mesh.Vertices.size();
+
+    vertex_cache_stats Before = AnalyzeVertexCache(Mesh.Indices.data(), IndexCount, VertexCount);
+
+    for (const mesh_submesh& Submesh : Submeshes)
+    {
+        uint32_t* Indices = Mesh.Indices.data() + Submesh.FirstIndex[0];
+        OptimizeVertexCache(Indices, (int)Submesh.IndexCount[0], VertexCount);
+        OptimizeOverdraw(Indices, (int)Submesh.IndexCount[0], Mesh.Vertices.data(), VertexCount);
+    }
+    OptimizeVertexFetch(Mesh);
+
+    vertex_cache_stats After = AnalyzeVertexCache(Mesh.Indices.data(), IndexCount, (int)Mesh.Vertices.size());
+
+    printf("Optimized: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (cache size %d)\n", Before.ACMR, After.ACMR, Before.ATVR, After.ATVR, VERTEX_CACHE_SIZE);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// Size of the simulated post-transform vertex cache (FIFO)
+const int VERTEX_CACHE_SIZE = 16;
+
+struct vertex_cache_stats
+{
+    float ACMR; // Average cache miss ratio (transformed vertices per triangle)
+    float ATVR; // Average transformed vertex ratio (transformed vertices per vertex)
+};
+
+namespace Mesh
+{
+
+// Reorder triangles for post-transform cache locality (Tipsify)
+void OptimizeVertexCache(uint32_t* Indices, int IndexCount, int VertexCount, int CacheSize = VERTEX_CACHE_SIZE);
+// Reorder clusters of triangles (split on cache flushes) from the outside to the inside to reduce overdraw
+void OptimizeOverdraw(uint32_t* Indices, int IndexCount, const vertex_full* Vertices, int VertexCount, int CacheSize = VERTEX_CACHE_SIZE);
+// Reorder vertices in first use order for vertex fetch locality (indices are remapped)
+void OptimizeVertexFetch(indexed_mesh& Mesh);
+// Run all the optimizations above
+void Optimize(indexed_mesh& Mesh);
+// Same, triangles are only reordered inside each submesh (LOD 0 ranges of Submeshes stay valid)
+void Optimize(indexed_mesh& Mesh, const std::vector<mesh_submesh>& Submeshes);
+
+vertex_cache_stats AnalyzeVertexCache(const uint32_t* Indices, int IndexCount, int VertexCount, int CacheSize = VERTEX_CACHE_SIZE);
+}
@@ -0,0 +1,345 @@
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "maths.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+
+using namespace Mesh;
+
+// Sum of squared distances to planes (area weighted): Q(P) = P.A.P + 2 B.P + C
+struct quadric
+{
+    float A00, A11, A22, A01, A02, A12;
+    float B0, B1, B2;
+    float C;
+    float Weight;
+};
+
+static void AddPlaneQuadric(quadric& Q, v3 Normal, float Distance, float Weight)
+{
+    Q.A00 += Weight * Normal.x * Normal.x;
+    Q.A11 += Weight * Normal.y * Normal.y;
+    Q.A22 += Weight * Normal.z * Normal.z;
+    Q.A01 += Weight * Normal.x * Normal.y;
+    Q.A02 += Weight * Normal.x * Normal.z;
+    Q.A12 += Weight * Normal.y * Normal.z;
+    Q.B0 += Weight * Normal.x * Distance;
+    Q.B1 += Weight * Normal.y * Distance;
+    Q.B2 += Weight * Normal.z * Distance;
+    Q.C += Weight * Distance * Distance;
+    Q.Weight += Weight;
+}
+
+static void AddQuadric(quadric& Q, const quadric& R)
+{
+    Q.A00 += R.A00; Q.A11 += R.A11; Q.A22 += R.A22;
+    Q.A01 += R.A01; Q.A02 += R.A02; Q.A12 += R.A12;
+    Q.B0 += R.B0; Q.B1 += R.B1; Q.B2 += R.B2;
+    Q.C += R.C;
+    Q.Weight += R.Weight;
+}
+
+// Mean squared distance to the planes
+static float QuadricError(const quadric& Q, v3 P)
+{
+    float Error = Q.A00 * P.x * P.x + Q.A11 * P.y * P.y + Q.A22 * P.z * P.z
+                + 2.f * (Q.A01 * P.x * P.y + Q.A02 * P.x * P.z + Q.A12 * P.y * P.z)
+                + 2.f * (Q.B0 * P.x + Q.B1 * P.y + Q.B2 * P.z)
+                + Q.C;
+    return Q.Weight > 0.f ? Math::Max(Error, 0.f) / Q.Weight : 0.f;
+}
+
+struct collapse
+{
+    uint32_t From;
+    uint32_t To;
+    float Error;
+};
+
+// Vertices that can't move: attribute seams (position shared by several vertices), open and non manifold edges
+static void FindLockedVertices(std::vector<bool>& Locked, const uint32_t* Indices, int IndexCount, const vertex_full* Vertices, int VertexCount)
+{
+    std::vector<uint32_t> PositionIds;
+    BuildPositionRemap(PositionIds, Vertices, VertexCount);
+
+    std::vector<int> VerticesPerPosition(VertexCount, 0);
+    for (int v = 0; v < VertexCount; ++v)
+        VerticesPerPosition[PositionIds[v]]++;
+
+    Locked.assign(VertexCount, false);
+    for (int v = 0; v < VertexCount; ++v)
+        Locked[v] = VerticesPerPosition[PositionIds[v]] > 1;
+
+    // Edges used by exactly two triangles (in opposite directions) are manifold
+    std::unordered_map<uint64_t, int> EdgeUses;
+    EdgeUses.reserve(IndexCount);
+    for (int i = 0; i < IndexCount; i += 3)
+    {
+        for (int e = 0; e < 3; ++e)
+        {
+            uint32_t A = PositionIds[Indices[i + e]];
+            uint32_t B = PositionIds[Indices[i + (e + 1) % 3]];
+            uint64_t Key = A < B ? ((uint64_t)A << 32) | B : ((uint64_t)B << 32) | A;
+            EdgeUses[Key]++;
+        }
+    }
+    for (int i = 0; i < IndexCount; i += 3)
+    {
+        for (int e = 0; e < 3; ++e)
+        {
+            uint32_t A = Indices[i + e];
+            uint32_t B = Indices[i + (e + 1) % 3];
+            uint32_t PA = PositionIds[A];
+            uint32_t PB = PositionIds[B];
+            uint64_t Key = PA < PB ? ((uint64_t)PA << 32) | PB : ((uint64_t)PB << 32) | PA;
+            if (EdgeUses[Key] != 2)
+                Locked[A] = Locked[B] = true;
+        }
+    }
+}
+
+static v3 TriangleNormal(v3 P0, v3 P1, v3 P2)
+{
+    return Vec3::Cross(P1 - P0, P2 - P0);
+}
+
+int Mesh::Simplify(uint32_t* DstIndices, const uint32_t* Indices, int IndexCount, const vertex_full* Vertices, int VertexCount, int TargetIndexCount, float* ErrorOut)
+{
+    memcpy(DstIndices, Indices, IndexCount * sizeof(uint32_t));
+    float MaxError = 0.f;
+
+    std::vector<bool> Locked;
+    FindLockedVertices(Locked, Indices, IndexCount, Vertices, VertexCount);
+
+    // Plane quadrics of the triangles around each vertex
+    std::vector<quadric> Quadrics(VertexCount, quadric {});
+    for (int i = 0; i < IndexCount; i += 3)
+    {
+        v3 P0 = Vertices[Indices[i + 0]].Position;
+        v3 Normal = TriangleNormal(P0, Vertices[Indices[i + 1]].Position, Vertices[Indices[i + 2]].Position);
+        float Length = Vec3::Length(Normal);
+        if (Length == 0.f)
+            continue;
+
+        Normal = Normal / Length;
+        float Distance = -Vec3::Dot(Normal, P0);
+        for (int Corner = 0; Corner < 3; ++Corner)
+            AddPlaneQuadric(Quadrics[Indices[i + Corner]], Normal, Distance, Length * 0.5f);
+    }
+
+    std::vector<collapse> Collapses;
+    std::vector<uint32_t> Remap(VertexCount);
+    std::vector<bool> CollapseLocked(VertexCount);
+    std::vector<int> AdjacencyOffsets(VertexCount + 1);
+    std::vector<int> AdjacentTriangles;
+
+    // Passes of independent collapses (cheapest first) until the target is reached
+    while (IndexCount > TargetIndexCount)
+    {
+        // Half edge collapses moving an unlocked vertex onto a neighbour
+        Collapses.clear();
+        for (int i = 0; i < IndexCount; i += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                uint32_t A = DstIndices[i + e];
+                uint32_t B = DstIndices[i + (e + 1) % 3];
+                if (!Locked[A])
+                    Collapses.push_back({ A, B, QuadricError(Quadrics[A], Vertices[B].Position) });
+                if (!Locked[B])
+                    Collapses.push_back({ B, A, QuadricError(Quadrics[B], Vertices[A].Position) });
+            }
+        }
+        std::sort(Collapses.begin(), Collapses.end(), [](const collapse& X, const collapse& Y) { return X.Error < Y.Error; });
+
+        // Vertex to triangles adjacency
+        std::fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end(), 0);
+        for (int i = 0; i < IndexCount; ++i)
+            AdjacencyOffsets[DstIndices[i] + 1]++;
+        for (int v = 0; v < VertexCount; ++v)
+            AdjacencyOffsets[v + 1] += AdjacencyOffsets[v];
+        AdjacentTriangles.resize(IndexCount);
+        {
+            std::vector<int> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+            for (int i = 0; i < IndexCount; ++i)
+                AdjacentTriangles[Fill[DstIndices[i]]++] = i / 3;
+        }
+
+        for (int v = 0; v < VertexCount; ++v)
+            Remap[v] = (uint32_t)v;
+        std::fill(CollapseLocked.begin(), CollapseLocked.end(), false);
+
+        int RemovedTriangles = 0;
+        int CollapseCount = 0;
+        for (const collapse& Collapse : Collapses)
+        {
+            if (IndexCount - RemovedTriangles * 3 <= TargetIndexCount)
+                break;
+            if (CollapseLocked[Collapse.From] || CollapseLocked[Collapse.To])
+                continue;
+
+            // Reject collapses flipping a triangle
+            bool Flips = false;
+            int Removed = 0;
+            v3 Target = Vertices[Collapse.To].Position;
+            for (int a = AdjacencyOffsets[Collapse.From]; a < AdjacencyOffsets[Collapse.From + 1] && !Flips; ++a)
+            {
+                const uint32_t* Triangle = &DstIndices[AdjacentTriangles[a] * 3];
+                if (Triangle[0] == Collapse.To || Triangle[1] == Collapse.To || Triangle[2] == Collapse.To)
+                {
+                    Removed++;
+                    continue;
+                }
+
+                v3 P[3];
+                for (int Corner = 0; Corner < 3; ++Corner)
+                    P[Corner] = Vertices[Triangle[Corner]].Position;
+                v3 Before = TriangleNormal(P[0], P[1], P[2]);
+                for (int Corner = 0; Corner < 3; ++Corner)
+                    if (Triangle[Corner] == Collapse.From)
+                        P[Corner] = Target;
+                v3 After = TriangleNormal(P[0], P[1], P[2]);
+                Flips = Vec3::Dot(Before, After) <= 0.f;
+            }
+            if (Flips)
+                continue;
+
+            Remap[Collapse.From] = Collapse.To;
+            AddQuadric(Quadrics[Collapse.To], Quadrics[Collapse.From]);
+            MaxError = Math::Max(MaxError, Collapse.Error);
+            RemovedTriangles += Removed;
+            CollapseCount++;
+
+            // The triangles around the collapse are not up to date anymore for this pass
+            for (int a = AdjacencyOffsets[Collapse.From]; a < AdjacencyOffsets[Collapse.From + 1]; ++a)
+            {
+                const uint32_t* Triangle = &DstIndices[AdjacentTriangles[a] * 3];
+                CollapseLocked[Triangle[0]] = CollapseLocked[Triangle[1]] = CollapseLocked[Triangle[2]] = true;
+            }
+        }
+
+        if (CollapseCount == 0)
+            break;
+
+        // Apply and remove degenerate triangles
+        int NewIndexCount = 0;
+        for (int i = 0; i < IndexCount; i += 3)
+        {
+            uint32_t I0 = Remap[DstIndices[i + 0]];
+            uint32_t I1 = Remap[DstIndices[i + 1]];
+            uint32_t I2 = Remap[DstIndices[i + 2]];
+            if (I0 == I1 || I1 == I2 || I0 == I2)
+                continue;
+            DstIndices[NewIndexCount++] = I0;
+            DstIndices[NewIndexCount++] = I1;
+            DstIndices[NewIndexCount++] = I2;
+        }
+        IndexCount = NewIndexCount;
+    }
+
+    if (ErrorOut)
+        *ErrorOut = Math::Sqrt(MaxError);
+    return IndexCount;
+}
+
+int Mesh::BuildLods(mesh_lod Lods[MESH_MAX_LODS], indexed_mesh& Mesh)
+{
+    std::vector<mesh_submesh> Submeshes(1);
+    Submeshes[0].IndexCount[0] = (uint32_t)Mesh.Indices.size();
+    Submeshes[0].MaterialId = -1;
+    return BuildLods(Lods, Submeshes, Mesh);
+}
+
+int Mesh::BuildLods(mesh_lod Lods[MESH_MAX_LODS], std::vector<mesh_submesh>& Submeshes, indexed_mesh& Mesh)
+{
+    int IndexCount = (int)Mesh.Indices.size();
+    Lods[0] = { 0, (uint32_t)IndexCount, 0.f, 0 };
+    int LodCount = 1;
+
+    std::vector<uint32_t> FullIndices = Mesh.Indices;
+    std::vector<uint32_t> LodIndices(IndexCount);
+    std::vector<uint32_t> SubmeshIndexCounts(Submeshes.size());
+    for (int i = 0; i < MESH_MAX_LODS - 1; ++i)
+    {
+        // Every LOD is simplified from the full resolution mesh to measure its error against it
+        int LodIndexCount = 0;
+        float Error = 0.f;
+        for (int s = 0; s < (int)Submeshes.size(); ++s)
+        {
+            const mesh_submesh& Submesh = Submeshes[s];
+            int SubmeshIndexCount = (int)Submesh.IndexCount[0];
+            int TargetIndexCount = (int)(SubmeshIndexCount / 3 * LOD_TRIANGLE_RATIOS[i]) * 3;
+            float SubmeshError = 0.f;
+            int SimplifiedCount = Simplify(LodIndices.data() + LodIndexCount, FullIndices.data() + Submesh.FirstIndex[0], SubmeshIndexCount,
+                                           Mesh.Vertices.data(), (int)Mesh.Vertices.size(), TargetIndexCount, &SubmeshError);
+
+            SubmeshIndexCounts[s] = (uint32_t)SimplifiedCount;
+            LodIndexCount += SimplifiedCount;
+            Error = Math::Max(Error, SubmeshError);
+        }
+
+        // Not worth a LOD when the simplification is blocked (seams and borders are kept)
+        const mesh_lod& Previous = Lods[LodCount - 1];
+        if (LodIndexCount == 0 || LodIndexCount > (int)(Previous.IndexCount * 0.8f))
+            break;
+
+        mesh_lod& Lod = Lods[LodCount];
+        Lod.FirstIndex = (uint32_t)Mesh.Indices.size();
+        Lod.IndexCount = (uint32_t)LodIndexCount;
+        Lod.Error = Math::Max(Error, Previous.Error);
+        Lod.Padding = 0;
+
+        uint32_t FirstIndex = 0;
+        for (int s = 0; s < (int)Submeshes.size(); ++s)
+        {
+            OptimizeVertexCache(LodIndices.data() + FirstIndex, (int)SubmeshIndexCounts[s], (int)Mesh.Vertices.size());
+            Submeshes[s].FirstIndex[LodCount] = Lod.FirstIndex + FirstIndex;
+            Submeshes[s].IndexCount[LodCount] = SubmeshIndexCounts[s];
+            FirstIndex += SubmeshIndexCounts[s];
+        }
+
+        Mesh.Indices.insert(Mesh.Indices.end(), LodIndices.begin(), LodIndices.begin() + LodIndexCount);
+        LodCount++;
+    }
+
+    return LodCount;
+}
+
+float Mesh::GetProjectionScale(const mat4& Projection, float ViewportHeight)
+{
+    // Projection.c[1].e[1] = 1 / tan(fovy / 2)
+    return Projection.c[1].e[1] * ViewportHeight * 0.5f;
+}
+
+int Mesh::SelectLod(const mesh_lod* Lods, int LodCount, int CurrentLod, float Distance, float ProjectionScale, float ThresholdPixels, float Hysteresis)
+{
+    CurrentLod = Math::Clamp(CurrentLod, 0, LodCount - 1);
+    if (Distance <= 0.f)
+        return 0;
+
+    float PixelsPerUnit = ProjectionScale / Distance;
+    int Lod = 0;
+    for (int i = 1; i < LodCount; ++i)
+    {
+        if (Lods[i].Error * PixelsPerUnit <= ThresholdPixels)
+            Lod = i;
+    }
+
+    // Finer LODs are taken immediately, coarser ones once clearly under the threshold (avoids popping back and forth)
+    if (Lod > CurrentLod)
+    {
+        int Coarser = CurrentLod;
+        for (int i = CurrentLod + 1; i <= Lod; ++i)
+        {
+            if (Lods[i].Error * PixelsPerUnit <= ThresholdPixels * Hysteresis)
+                Coarser = i;
+        }
+        Lod = Coarser;
+    }
+
+    return Lod;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// Triangle count of the generated LODs relative to the full resolution mesh
+const float LOD_TRIANGLE_RATIOS[MESH_MAX_LODS - 1] = { 0.5f, 0.25f, 0.125f };
+
+namespace Mesh
+{
+
+// Quadric error edge collapse: vertices are kept, only the indices change (DstIndices needs IndexCount entries)
+// Vertices on attribute seams and open borders never move. Returns the simplified index count
+int Simplify(uint32_t* DstIndices, const uint32_t* Indices, int IndexCount, const vertex_full* Vertices, int VertexCount, int TargetIndexCount, float* ErrorOut);
+
+// Append the simplified LODs to the indices (stops when the target can't be reached), returns the LOD count
+int BuildLods(mesh_lod Lods[MESH_MAX_LODS], indexed_mesh& Mesh);
+// Same, submeshes are simplified separately (their borders are open so they don't crack) and stored back to back in each LOD
+int BuildLods(mesh_lod Lods[MESH_MAX_LODS], std::vector<mesh_submesh>& Submeshes, indexed_mesh& Mesh);
+
+// Pixels covered by one unit at distance 1 (perspective projection)
+float GetProjectionScale(const mat4& Projection, float ViewportHeight);
+
+// Coarsest LOD whose error projected on screen stays under ThresholdPixels
+// Hysteresis: a coarser LOD than CurrentLod is only taken when its error is under ThresholdPixels * Hysteresis
+int SelectLod(const mesh_lod* Lods, int LodCount, int CurrentLod, float Distance, float ProjectionScale, float ThresholdPixels = 1.f, float Hysteresis = 0.75f);
+}
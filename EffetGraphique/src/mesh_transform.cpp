@@ -0,0 +1,434 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "maths.h"
+#include "mesh_transform.h"
+#include "platform.h"
+
+using namespace Mesh;
+
+// SSE2 is always available on x64, AVX2 is detected at runtime
+#if defined(_M_X64) || defined(__x86_64__)
+#define MESH_TRANSFORM_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Same operations in the same order than operator*(mat4, v4), Vec3::Normalize and operator/(v3, float)
+// so that every kernel gives bit identical results
+static void TransformScalar(uint8_t* Buffer, int Count, const vertex_descriptor& Descriptor, const mat4& Transform, const mat4& NormalMatrix)
+{
+    for (int i = 0; i < Count; ++i)
+    {
+        uint8_t* VertexStart = Buffer + i * Descriptor.Stride;
+
+        v3* Position = (v3*)(VertexStart + Descriptor.PositionOffset);
+        v4 TransformedPosition = Transform * Vec4::vec4(*Position, 1.f);
+        *Position = TransformedPosition.xyz / TransformedPosition.w; // normalized homogeneous coordinate
+
+        if (Descriptor.HasNormal)
+        {
+            v3* Normal           = (v3*)(VertexStart + Descriptor.NormalOffset);
+            v4 TransformedNormal = NormalMatrix * Vec4::vec4(*Normal, 0.f);
+            *Normal              = Vec3::Normalize(TransformedNormal.xyz);
+        }
+    }
+}
+
+#ifdef MESH_TRANSFORM_SIMD
+
+// Strided attribute access for a batch of vertices
+// When the attribute is followed by at least one float of the same vertex (Offset + 16 <= Stride),
+// vertices are loaded as 16 bytes windows and transposed (AoS -> SoA), the 4th lane keeps the following
+// float which is written back unchanged. Otherwise lanes are gathered/scattered one by one
+struct strided_attribute
+{
+    uint8_t* Base;
+    int Stride;
+    bool Window;
+};
+
+static strided_attribute MakeStridedAttribute(uint8_t* Buffer, int Stride, int Offset)
+{
+    strided_attribute Attribute = { Buffer + Offset, Stride, Offset + 16 <= Stride };
+    return Attribute;
+}
+
+// Window of the other attribute (stored last) must not restore an old value over the attribute stored first
+static bool StoreNormalFirst(const vertex_descriptor& Descriptor)
+{
+    int NormalLastLane = Descriptor.NormalOffset + 12;
+    return NormalLastLane >= Descriptor.PositionOffset && NormalLastLane < Descriptor.PositionOffset + 12;
+}
+
+static inline void LoadSoA4(const strided_attribute& A, int First, __m128& X, __m128& Y, __m128& Z, __m128& W)
+{
+    const uint8_t* V = A.Base + First * A.Stride;
+    if (A.Window)
+    {
+        X = _mm_loadu_ps((const float*)(V));
+        Y = _mm_loadu_ps((const float*)(V + A.Stride));
+        Z = _mm_loadu_ps((const float*)(V + 2 * A.Stride));
+        W = _mm_loadu_ps((const float*)(V + 3 * A.Stride));
+        _MM_TRANSPOSE4_PS(X, Y, Z, W);
+    }
+    else
+    {
+        const float* P0 = (const float*)(V);
+        const float* P1 = (const float*)(V + A.Stride);
+        const float* P2 = (const float*)(V + 2 * A.Stride);
+        const float* P3 = (const float*)(V + 3 * A.Stride);
+        X = _mm_set_ps(P3[0], P2[0], P1[0], P0[0]);
+        Y = _mm_set_ps(P3[1], P2[1], P1[1], P0[1]);
+        Z = _mm_set_ps(P3[2], P2[2], P1[2], P0[2]);
+        W = _mm_setzero_ps();
+    }
+}
+
+static inline void StoreSoA4(const strided_attribute& A, int First, __m128 X, __m128 Y, __m128 Z, __m128 W)
+{
+    uint8_t* V = A.Base + First * A.Stride;
+    if (A.Window)
+    {
+        _MM_TRANSPOSE4_PS(X, Y, Z, W);
+        _mm_storeu_ps((float*)(V), X);
+        _mm_storeu_ps((float*)(V + A.Stride), Y);
+        _mm_storeu_ps((float*)(V + 2 * A.Stride), Z);
+        _mm_storeu_ps((float*)(V + 3 * A.Stride), W);
+    }
+    else
+    {
+        alignas(16) float Lanes[3][4];
+        _mm_store_ps(Lanes[0], X);
+        _mm_store_ps(Lanes[1], Y);
+        _mm_store_ps(Lanes[2], Z);
+        for (int i = 0; i < 4; ++i)
+        {
+            float* P = (float*)(V + i * A.Stride);
+            P[0] = Lanes[0][i];
+            P[1] = Lanes[1][i];
+            P[2] = Lanes[2][i];
+        }
+    }
+}
+
+// Matrix elements broadcasted once ([column][row]), Last is the 4th column times w (1 for points, 0 for normals)
+struct sse_matrix
+{
+    __m128 M[3][4];
+    __m128 Last[4];
+};
+
+static sse_matrix MakeSSEMatrix(const mat4& Matrix, float W)
+{
+    sse_matrix Result;
+    for (int Column = 0; Column < 3; ++Column)
+        for (int Row = 0; Row < 4; ++Row)
+            Result.M[Column][Row] = _mm_set1_ps(Matrix.c[Column].e[Row]);
+    for (int Row = 0; Row < 4; ++Row)
+        Result.Last[Row] = _mm_set1_ps(W * Matrix.c[3].e[Row]);
+    return Result;
+}
+
+static inline __m128 DotRow4(const sse_matrix& M, int Row, __m128 X, __m128 Y, __m128 Z)
+{
+    __m128 R = _mm_add_ps(_mm_mul_ps(X, M.M[0][Row]), _mm_mul_ps(Y, M.M[1][Row]));
+    R = _mm_add_ps(R, _mm_mul_ps(Z, M.M[2][Row]));
+    return _mm_add_ps(R, M.Last[Row]);
+}
+
+static void TransformSSE(uint8_t* Buffer, int Count, const vertex_descriptor& Descriptor, const mat4& Transform, const mat4& NormalMatrix)
+{
+    sse_matrix PositionMatrix = MakeSSEMatrix(Transform, 1.f);
+    sse_matrix NormalMatrix4 = MakeSSEMatrix(NormalMatrix, 0.f);
+    strided_attribute Positions = MakeStridedAttribute(Buffer, Descriptor.Stride, Descriptor.PositionOffset);
+    strided_attribute Normals = MakeStridedAttribute(Buffer, Descriptor.Stride, Descriptor.NormalOffset);
+    bool NormalFirst = Descriptor.HasNormal && StoreNormalFirst(Descriptor);
+    const __m128 One = _mm_set1_ps(1.f);
+
+    int BatchCount = Count / 4 * 4;
+    for (int i = 0; i < BatchCount; i += 4)
+    {
+        __m128 PX, PY, PZ, PW;
+        __m128 NX = _mm_setzero_ps(), NY = NX, NZ = NX, NW = NX;
+        LoadSoA4(Positions, i, PX, PY, PZ, PW);
+        if (Descriptor.HasNormal)
+            LoadSoA4(Normals, i, NX, NY, NZ, NW);
+
+        // Positions: homogeneous transform and divide
+        __m128 InvW = _mm_div_ps(One, DotRow4(PositionMatrix, 3, PX, PY, PZ));
+        __m128 TX = _mm_mul_ps(DotRow4(PositionMatrix, 0, PX, PY, PZ), InvW);
+        __m128 TY = _mm_mul_ps(DotRow4(PositionMatrix, 1, PX, PY, PZ), InvW);
+        __m128 TZ = _mm_mul_ps(DotRow4(PositionMatrix, 2, PX, PY, PZ), InvW);
+
+        if (Descriptor.HasNormal)
+        {
+            // Normals: transform and normalize
+            __m128 X = DotRow4(NormalMatrix4, 0, NX, NY, NZ);
+            __m128 Y = DotRow4(NormalMatrix4, 1, NX, NY, NZ);
+            __m128 Z = DotRow4(NormalMatrix4, 2, NX, NY, NZ);
+            __m128 SquaredLength = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z));
+            __m128 InvLength = _mm_div_ps(One, _mm_sqrt_ps(SquaredLength));
+            NX = _mm_mul_ps(X, InvLength);
+            NY = _mm_mul_ps(Y, InvLength);
+            NZ = _mm_mul_ps(Z, InvLength);
+
+            if (NormalFirst)
+                StoreSoA4(Normals, i, NX, NY, NZ, NW);
+        }
+
+        StoreSoA4(Positions, i, TX, TY, TZ, PW);
+        if (Descriptor.HasNormal && !NormalFirst)
+            StoreSoA4(Normals, i, NX, NY, NZ, NW);
+    }
+
+    TransformScalar(Buffer + BatchCount * Descriptor.Stride, Count - BatchCount, Descriptor, Transform, NormalMatrix);
+}
+
+// AVX2: two SSE transposes per attribute or hardware gathers when windows can't be used
+TARGET_AVX2 static inline void LoadSoA8(const strided_attribute& A, int First, __m256& X, __m256& Y, __m256& Z, __m256& W)
+{
+    if (A.Window)
+    {
+        __m128 X0, Y0, Z0, W0, X1, Y1, Z1, W1;
+        LoadSoA4(A, First, X0, Y0, Z0, W0);
+        LoadSoA4(A, First + 4, X1, Y1, Z1, W1);
+        X = _mm256_insertf128_ps(_mm256_castps128_ps256(X0), X1, 1);
+        Y = _mm256_insertf128_ps(_mm256_castps128_ps256(Y0), Y1, 1);
+        Z = _mm256_insertf128_ps(_mm256_castps128_ps256(Z0), Z1, 1);
+        W = _mm256_insertf128_ps(_mm256_castps128_ps256(W0), W1, 1);
+    }
+    else
+    {
+        // Stride and offsets of float attributes are multiples of 4
+        const float* Base = (const float*)(A.Base + First * A.Stride);
+        int FloatStride = A.Stride / 4;
+        __m256i Indices = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(FloatStride));
+        X = _mm256_i32gather_ps(Base, Indices, 4);
+        Y = _mm256_i32gather_ps(Base + 1, Indices, 4);
+        Z = _mm256_i32gather_ps(Base + 2, Indices, 4);
+        W = _mm256_setzero_ps();
+    }
+}
+
+TARGET_AVX2 static inline void StoreSoA8(const strided_attribute& A, int First, __m256 X, __m256 Y, __m256 Z, __m256 W)
+{
+    StoreSoA4(A, First, _mm256_castps256_ps128(X), _mm256_castps256_ps128(Y), _mm256_castps256_ps128(Z), _mm256_castps256_ps128(W));
+    StoreSoA4(A, First + 4, _mm256_extractf128_ps(X, 1), _mm256_extractf128_ps(Y, 1), _mm256_extractf128_ps(Z, 1), _mm256_extractf128_ps(W, 1));
+}
+
+struct avx_matrix
+{
+    __m256 M[3][4];
+    __m256 Last[4];
+};
+
+TARGET_AVX2 static avx_matrix MakeAVXMatrix(const mat4& Matrix, float W)
+{
+    avx_matrix Result;
+    for (int Column = 0; Column < 3; ++Column)
+        for (int Row = 0; Row < 4; ++Row)
+            Result.M[Column][Row] = _mm256_set1_ps(Matrix.c[Column].e[Row]);
+    for (int Row = 0; Row < 4; ++Row)
+        Result.Last[Row] = _mm256_set1_ps(W * Matrix.c[3].e[Row]);
+    return Result;
+}
+
+// No FMA to keep the rounding of the scalar code
+TARGET_AVX2 static inline __m256 DotRow8(const avx_matrix& M, int Row, __m256 X, __m256 Y, __m256 Z)
+{
+    __m256 R = _mm256_add_ps(_mm256_mul_ps(X, M.M[0][Row]), _mm256_mul_ps(Y, M.M[1][Row]));
+    R = _mm256_add_ps(R, _mm256_mul_ps(Z, M.M[2][Row]));
+    return _mm256_add_ps(R, M.Last[Row]);
+}
+
+TARGET_AVX2 static void TransformAVX2(uint8_t* Buffer, int Count, const vertex_descriptor& Descriptor, const mat4& Transform, const mat4& NormalMatrix)
+{
+    avx_matrix PositionMatrix = MakeAVXMatrix(Transform, 1.f);
+    avx_matrix NormalMatrix8 = MakeAVXMatrix(NormalMatrix, 0.f);
+    strided_attribute Positions = MakeStridedAttribute(Buffer, Descriptor.Stride, Descriptor.PositionOffset);
+    strided_attribute Normals = MakeStridedAttribute(Buffer, Descriptor.Stride, Descriptor.NormalOffset);
+    bool NormalFirst = Descriptor.HasNormal && StoreNormalFirst(Descriptor);
+    const __m256 One = _mm256_set1_ps(1.f);
+
+    int BatchCount = Count / 8 * 8;
+    for (int i = 0; i < BatchCount; i += 8)
+    {
+        __m256 PX, PY, PZ, PW;
+        __m256 NX = _mm256_setzero_ps(), NY = NX, NZ = NX, NW = NX;
+        LoadSoA8(Positions, i, PX, PY, PZ, PW);
+        if (Descriptor.HasNormal)
+            LoadSoA8(Normals, i, NX, NY, NZ, NW);
+
+        __m256 InvW = _mm256_div_ps(One, DotRow8(PositionMatrix, 3, PX, PY, PZ));
+        __m256 TX = _mm256_mul_ps(DotRow8(PositionMatrix, 0, PX, PY, PZ), InvW);
+        __m256 TY = _mm256_mul_ps(DotRow8(PositionMatrix, 1, PX, PY, PZ), InvW);
+        __m256 TZ = _mm256_mul_ps(DotRow8(PositionMatrix, 2, PX, PY, PZ), InvW);
+
+        if (Descriptor.HasNormal)
+        {
+            __m256 X = DotRow8(NormalMatrix8, 0, NX, NY, NZ);
+            __m256 Y = DotRow8(NormalMatrix8, 1, NX, NY, NZ);
+            __m256 Z = DotRow8(NormalMatrix8, 2, NX, NY, NZ);
+            __m256 SquaredLength = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(X, X), _mm256_mul_ps(Y, Y)), _mm256_mul_ps(Z, Z));
+            __m256 InvLength = _mm256_div_ps(One, _mm256_sqrt_ps(SquaredLength));
+            NX = _mm256_mul_ps(X, InvLength);
+            NY = _mm256_mul_ps(Y, InvLength);
+            NZ = _mm256_mul_ps(Z, InvLength);
+
+            if (NormalFirst)
+                StoreSoA8(Normals, i, NX, NY, NZ, NW);
+        }
+
+        StoreSoA8(Positions, i, TX, TY, TZ, PW);
+        if (Descriptor.HasNormal && !NormalFirst)
+            StoreSoA8(Normals, i, NX, NY, NZ, NW);
+    }
+
+    // Remaining vertices with the 4 wide kernel
+    TransformSSE(Buffer + BatchCount * Descriptor.Stride, Count - BatchCount, Descriptor, Transform, NormalMatrix);
+}
+
+static bool CpuSupportsAVX2()
+{
+#if defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 0);
+    if (Info[0] < 7)
+        return false;
+
+    // AVX enabled by the OS (ymm registers saved on context switch)
+    __cpuid(Info, 1);
+    bool OSXSave = (Info[2] & (1 << 27)) != 0;
+    bool AVX = (Info[2] & (1 << 28)) != 0;
+    if (!OSXSave || !AVX || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(Info, 7, 0);
+    return (Info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // MESH_TRANSFORM_SIMD
+
+bool Mesh::IsTransformKernelSupported(transform_kernel Kernel)
+{
+    switch (Kernel)
+    {
+    case TRANSFORM_KERNEL_SCALAR: return true;
+#ifdef MESH_TRANSFORM_SIMD
+    case TRANSFORM_KERNEL_SSE:    return true;
+    case TRANSFORM_KERNEL_AVX2:
+    {
+        static const bool SupportsAVX2 = CpuSupportsAVX2();
+        return SupportsAVX2;
+    }
+#endif
+    default: return false;
+    }
+}
+
+transform_kernel Mesh::GetTransformKernel()
+{
+    static const transform_kernel Kernel =
+          IsTransformKernelSupported(TRANSFORM_KERNEL_AVX2) ? TRANSFORM_KERNEL_AVX2
+        : IsTransformKernelSupported(TRANSFORM_KERNEL_SSE)  ? TRANSFORM_KERNEL_SSE
+        : TRANSFORM_KERNEL_SCALAR;
+    return Kernel;
+}
+
+const char* Mesh::GetTransformKernelName(transform_kernel Kernel)
+{
+    switch (Kernel)
+    {
+    case TRANSFORM_KERNEL_SCALAR: return "scalar";
+    case TRANSFORM_KERNEL_SSE:    return "sse";
+    case TRANSFORM_KERNEL_AVX2:   return "avx2";
+    default:                      return "unknown";
+    }
+}
+
+void Mesh::TransformVertices(transform_kernel Kernel, void* Vertices, int Count, const vertex_descriptor& Descriptor, const mat4& Transform, const mat4& NormalMatrix)
+{
+    uint8_t* Buffer = (uint8_t*)Vertices;
+    if (!IsTransformKernelSupported(Kernel))
+        Kernel = TRANSFORM_KERNEL_SCALAR;
+
+    switch (Kernel)
+    {
+#ifdef MESH_TRANSFORM_SIMD
+    case TRANSFORM_KERNEL_SSE:  TransformSSE(Buffer, Count, Descriptor, Transform, NormalMatrix); break;
+    case TRANSFORM_KERNEL_AVX2: TransformAVX2(Buffer, Count, Descriptor, Transform, NormalMatrix); break;
+#endif
+    default:                    TransformScalar(Buffer, Count, Descriptor, Transform, NormalMatrix); break;
+    }
+}
+
+static void BenchmarkTransformLayout(const char* LayoutName, const vertex_descriptor& Descriptor, int VertexCount, int Iterations)
+{
+    // Deterministic pseudo random vertices (positions in [-1;1], non null normals)
+    std::vector<uint8_t> Source(VertexCount * Descriptor.Stride);
+    uint32_t Seed = 12345;
+    for (size_t i = 0; i < Source.size() / sizeof(float); ++i)
+    {
+        Seed = Seed * 1664525u + 1013904223u;
+        float Value = (float)(Seed >> 8) / (float)(1 << 24) * 2.f - 1.f;
+        memcpy(&Source[i * sizeof(float)], &Value, sizeof(float));
+    }
+
+    mat4 Transform = Mat4::Translate({ 1.f, -2.f, 3.f }) * Mat4::RotateY(0.7f) * Mat4::RotateX(-0.3f) * Mat4::Scale({ 2.f, 0.5f, 1.5f });
+    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(Transform));
+
+    std::vector<uint8_t> Reference = Source;
+    TransformVertices(TRANSFORM_KERNEL_SCALAR, Reference.data(), VertexCount, Descriptor, Transform, NormalMatrix);
+
+    printf("%s (stride %d, %d vertices):\n", LayoutName, Descriptor.Stride, VertexCount);
+    float ScalarTime = 0.f;
+    for (int Kernel = 0; Kernel < TRANSFORM_KERNEL_COUNT; ++Kernel)
+    {
+        if (!IsTransformKernelSupported((transform_kernel)Kernel))
+        {
+            printf("  %-7s not supported by this cpu\n", GetTransformKernelName((transform_kernel)Kernel));
+            continue;
+        }
+
+        std::vector<uint8_t> Vertices;
+        float BestTime = 0.f;
+        for (int i = 0; i < Iterations; ++i)
+        {
+            Vertices = Source;
+            std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+            TransformVertices((transform_kernel)Kernel, Vertices.data(), VertexCount, Descriptor, Transform, NormalMatrix);
+            float Time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - Start).count();
+            BestTime = (i == 0) ? Time : Math::Min(BestTime, Time);
+        }
+        if (Kernel == TRANSFORM_KERNEL_SCALAR)
+            ScalarTime = BestTime;
+
+        bool Identical = memcmp(Vertices.data(), Reference.data(), Vertices.size()) == 0;
+        printf("  %-7s %8.2f ms (x%.2f) %s\n", GetTransformKernelName((transform_kernel)Kernel), BestTime, ScalarTime / BestTime, Identical ? "identical" : "DIFFERENT");
+    }
+}
+
+void Mesh::BenchmarkTransform(int VertexCount, int Iterations)
+{
+    printf("Transform kernel used: %s\n", GetTransformKernelName(GetTransformKernel()));
+
+    vertex_descriptor Full = { sizeof(vertex_full), OFFSETOF(vertex_full, Position), true, OFFSETOF(vertex_full, Normal), true, OFFSETOF(vertex_full, UV) };
+    BenchmarkTransformLayout("vertex_full", Full, VertexCount, Iterations);
+
+    // Normals at the end of the vertex: gathered/scattered lane by lane
+    vertex_descriptor Packed = { 6 * sizeof(float), 0, true, 3 * sizeof(float), false, 0 };
+    BenchmarkTransformLayout("position + normal", Packed, VertexCount, Iterations);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "mesh.h"
+
+enum transform_kernel
+{
+    TRANSFORM_KERNEL_SCALAR,
+    TRANSFORM_KERNEL_SSE,  // 4 vertices per iteration
+    TRANSFORM_KERNEL_AVX2, // 8 vertices per iteration
+    TRANSFORM_KERNEL_COUNT
+};
+
+namespace Mesh
+{
+
+// Best kernel supported by the cpu (detected once), used by Mesh::Transform
+transform_kernel GetTransformKernel();
+bool IsTransformKernelSupported(transform_kernel Kernel);
+const char* GetTransformKernelName(transform_kernel Kernel);
+
+// Transform positions (with perspective divide) and normals (normalized) of strided vertices
+// All kernels give the same results as the scalar one
+void TransformVertices(transform_kernel Kernel, void* Vertices, int Count, const vertex_descriptor& Descriptor, const mat4& Transform, const mat4& NormalMatrix);
+
+// Time each supported kernel on VertexCount vertices (vertex_full and a packed position/normal layout)
+void BenchmarkTransform(int VertexCount, int Iterations);
+}
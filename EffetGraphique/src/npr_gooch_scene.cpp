@@ -6,6 +6,7 @@
 #include "npr_gooch_scene.h"
 
 npr_gooch_scene::npr_gooch_scene(GL::cache& GLCache)
+    : GLCache(GLCache)
 {
     // Init light
     {
@@ -18,22 +19,25 @@ npr_gooch_scene::npr_gooch_scene(GL::cache& GLCache)
 
     // Create mesh
     {
-        // Use vbo from GLCache
-        MeshBuffer = GLCache.LoadObj("media/T-Rex/T-Rex.obj", 1.f, &this->MeshVertexCount);
-        //MeshBuffer = GLCache.LoadObj("media/fantasy_game_inn.obj", 1.f, &this->MeshVertexCount);
+        // Use vbo/ibo from GLCache (placeholder until loaded in background)
+        // Compressed 16 bytes vertices: positions relative to the bounds, octahedral normals, half UVs
+        vertex_layout Layout = Mesh::MakeVertexLayout(VERTEX_FORMAT_UNORM16, VERTEX_FORMAT_OCT16, VERTEX_FORMAT_HALF);
+        Mesh = GLCache.LoadMeshAsync("media/T-Rex/T-Rex.3ds", 1.f, Layout);
+        //Mesh = GLCache.LoadMeshAsync("media/fantasy_game_inn.obj", 1.f, Layout);
 
-        MeshDesc.Stride = sizeof(vertex_full);
+        // Offsets only, attribute formats are given by Mesh->Layout
+        MeshDesc.Stride = Layout.Stride;
         MeshDesc.HasNormal = true;
         MeshDesc.HasUV = true;
-        MeshDesc.PositionOffset = OFFSETOF(vertex_full, Position);
-        MeshDesc.UVOffset = OFFSETOF(vertex_full, UV);
-        MeshDesc.NormalOffset = OFFSETOF(vertex_full, Normal);
+        MeshDesc.PositionOffset = Layout.PositionOffset;
+        MeshDesc.UVOffset = Layout.UVOffset;
+        MeshDesc.NormalOffset = Layout.NormalOffset;
     }
 
     // Gen texture
     {
-        DiffuseTexture = GLCache.LoadTexture("media/fantasy_game_inn_diffuse.png", IMG_FLIP | IMG_GEN_MIPMAPS);
-        EmissiveTexture = GLCache.LoadTexture("media/fantasy_game_inn_emissive.png", IMG_FLIP | IMG_GEN_MIPMAPS);
+        DiffuseTexture = GLCache.LoadTextureAsync("media/fantasy_game_inn_diffuse.png", IMG_FLIP | IMG_GEN_MIPMAPS | IMG_COMPRESS);
+        EmissiveTexture = GLCache.LoadTextureAsync("media/fantasy_game_inn_emissive.png", IMG_FLIP | IMG_GEN_MIPMAPS | IMG_COMPRESS);
     }
 
     // Gen light uniform buffer
@@ -47,9 +51,8 @@ npr_gooch_scene::npr_gooch_scene(GL::cache& GLCache)
 npr_gooch_scene::~npr_gooch_scene()
 {
     glDeleteBuffers(1, &LightsUniformBuffer);
-    glDeleteTextures(1, &EmissiveTexture);   // From cache
-    glDeleteTextures(1, &DiffuseTexture);   // From cache
-    glDeleteBuffers(1, &MeshBuffer); // From cache
+    GLCache.ReleaseTexture(EmissiveTexture);
+    GLCache.ReleaseTexture(DiffuseTexture);
 }
 
 static bool EditLight(GL::light* Light)
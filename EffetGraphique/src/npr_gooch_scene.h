@@ -9,10 +9,11 @@ class npr_gooch_scene
 public:
     npr_gooch_scene(GL::cache& GLCache);
     ~npr_gooch_scene();
-    
-    // Mesh
-    GLuint MeshBuffer = 0;
-    int MeshVertexCount = 0;
+
+    GL::cache& GLCache;
+
+    // Mesh (indexed, owned by GLCache)
+    const GL::mesh* Mesh = nullptr;
     vertex_descriptor MeshDesc;
 
     // Lights buffer
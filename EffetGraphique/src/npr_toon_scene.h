@@ -10,9 +10,10 @@ public:
     npr_toon_scene(GL::cache& GLCache);
     ~npr_toon_scene();
 
-    // Mesh
-    GLuint MeshBuffer = 0;
-    int MeshVertexCount = 0;
+    GL::cache& GLCache;
+
+    // Mesh (indexed, owned by GLCache)
+    const GL::mesh* Mesh = nullptr;
     vertex_descriptor MeshDesc;
 
     // Lights buffer
@@ -0,0 +1,760 @@
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tiny_obj_loader.h>
+
+#include "maths.h"
+#include "jobs.h"
+#include "obj_parser.h"
+
+std::string Mesh::GetObjDirectory(const char* Filename)
+{
+    std::string Directory = Filename;
+    size_t Separator = Directory.find_last_of("/\\");
+    return Separator == std::string::npos ? std::string() : Directory.substr(0, Separator + 1);
+}
+
+static void CopyMaterialString(char* Dst, size_t DstSize, const std::string& Src)
+{
+    snprintf(Dst, DstSize, "%s", Src.c_str());
+}
+
+static void ConvertObjMaterials(std::vector<mesh_material>& Materials, const std::vector<tinyobj::material_t>& ObjMaterials)
+{
+    Materials.resize(ObjMaterials.size());
+    for (int i = 0; i < (int)ObjMaterials.size(); ++i)
+    {
+        const tinyobj::material_t& ObjMaterial = ObjMaterials[i];
+        mesh_material& Material = Materials[i];
+        Material = {};
+        CopyMaterialString(Material.Name, sizeof(Material.Name), ObjMaterial.name);
+        CopyMaterialString(Material.DiffuseMap, sizeof(Material.DiffuseMap), ObjMaterial.diffuse_texname);
+        Material.Ambient = { ObjMaterial.ambient[0], ObjMaterial.ambient[1], ObjMaterial.ambient[2] };
+        Material.Diffuse = { ObjMaterial.diffuse[0], ObjMaterial.diffuse[1], ObjMaterial.diffuse[2] };
+        Material.Specular = { ObjMaterial.specular[0], ObjMaterial.specular[1], ObjMaterial.specular[2] };
+        Material.Shininess = ObjMaterial.shininess;
+    }
+}
+
+bool Mesh::ParseObjTinyObj(std::vector<vertex_full>& Mesh, std::vector<int>& TriangleMaterials, std::vector<mesh_material>& Materials,
+                           bool* HasNormals, bool* HasTexCoords, const char* Filename)
+{
+    std::string Warn;
+    std::string Err;
+    tinyobj::attrib_t Attrib;
+    std::vector<tinyobj::shape_t> Shapes;
+    std::vector<tinyobj::material_t> ObjMaterials;
+
+    std::string Directory = GetObjDirectory(Filename);
+    tinyobj::LoadObj(&Attrib, &Shapes, &ObjMaterials, &Warn, &Err, Filename, Directory.c_str(), true);
+    if (!Err.empty())
+    {
+        fprintf(stderr, "Warning loading obj: %s\n", Err.c_str());
+    }
+    if (!Err.empty())
+    {
+        fprintf(stderr, "Error loading obj: %s\n", Err.c_str());
+        return false;
+    }
+
+    *HasNormals = !Attrib.normals.empty();
+    *HasTexCoords = !Attrib.texcoords.empty();
+    ConvertObjMaterials(Materials, ObjMaterials);
+
+    // Build all meshes
+    for (int MeshId = 0; MeshId < (int)Shapes.size(); ++MeshId)
+    {
+        const tinyobj::mesh_t& MeshDef = Shapes[MeshId].mesh;
+
+        int IndexId = 0;
+        for (int FaceId = 0; FaceId < (int)MeshDef.num_face_vertices.size(); ++FaceId)
+        {
+            int FaceVertices = MeshDef.num_face_vertices[FaceId];
+            assert(FaceVertices == 3);
+            TriangleMaterials.push_back(MeshDef.material_ids[FaceId]);
+
+            for (int j = 0; j < FaceVertices; ++j)
+            {
+                const tinyobj::index_t& Index = MeshDef.indices[IndexId];
+                vertex_full V = {};
+                V.Position = {
+                    Attrib.vertices[Index.vertex_index * 3 + 0],
+                    Attrib.vertices[Index.vertex_index * 3 + 1],
+                    Attrib.vertices[Index.vertex_index * 3 + 2]
+                };
+
+                if (*HasNormals)
+                {
+                    V.Normal = {
+                        Attrib.normals[Index.normal_index * 3 + 0],
+                        Attrib.normals[Index.normal_index * 3 + 1],
+                        Attrib.normals[Index.normal_index * 3 + 2]
+                    };
+                }
+
+                if (*HasTexCoords)
+                {
+                    V.UV = {
+                        Attrib.texcoords[Index.texcoord_index * 2 + 0],
+                        Attrib.texcoords[Index.texcoord_index * 2 + 1]
+                    };
+                }
+
+                Mesh.push_back(V);
+
+                IndexId++;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Parallel parser
+// ===============
+// 1. Split the file in line aligned chunks and count the v/vn/vt/f records of each chunk
+// 2. Prefix sums of the counts give where each chunk writes its records (and resolve relative indices)
+// 3. Parse the chunks in parallel
+// 4. Expand faces to vertex_full in parallel
+// usemtl/mtllib lines are gathered while counting and resolved in file order afterwards (.mtl files are small)
+// Lines are split on '\r' or '\n' and tokens are parsed like tinyobj does to get the same results
+
+// Zero based indices of a face corner (-1 if missing)
+struct obj_corner
+{
+    int Position;
+    int TexCoord;
+    int Normal;
+};
+
+// usemtl or mtllib line
+struct obj_material_line
+{
+    int Face;          // Faces before the line in its chunk
+    bool IsLibrary;
+    std::string Name;  // Material name or .mtl filenames
+};
+
+struct obj_chunk
+{
+    const char* Begin;
+    const char* End;
+
+    int PositionCount;
+    int NormalCount;
+    int TexCoordCount;
+    int FaceCount;
+
+    // Index of the first record of each kind in the whole file (prefix sums)
+    int FirstPosition;
+    int FirstNormal;
+    int FirstTexCoord;
+    int FirstFace;
+
+    std::vector<obj_material_line> MaterialLines;
+
+    const char* Error; // Unsupported content
+};
+
+enum obj_record
+{
+    OBJ_RECORD_NONE,
+    OBJ_RECORD_POSITION,
+    OBJ_RECORD_NORMAL,
+    OBJ_RECORD_TEXCOORD,
+    OBJ_RECORD_FACE,
+    OBJ_RECORD_USEMTL,
+    OBJ_RECORD_MTLLIB,
+    OBJ_RECORD_UNSUPPORTED, // Lines and points
+};
+
+static bool IsObjSpace(char C) { return C == ' ' || C == '\t'; }
+static bool IsObjDigit(char C) { return (unsigned int)(C - '0') < 10u; }
+static bool IsObjNewLine(char C) { return C == '\r' || C == '\n'; }
+
+static const char* SkipObjSpaces(const char* Token, const char* LineEnd)
+{
+    while (Token < LineEnd && IsObjSpace(*Token))
+        Token++;
+    return Token;
+}
+
+// Identify the line record and skip its keyword
+static obj_record GetObjRecord(const char** Token, const char* LineEnd)
+{
+    const char* T = SkipObjSpaces(*Token, LineEnd);
+    int Length = (int)(LineEnd - T);
+
+    obj_record Record = OBJ_RECORD_NONE;
+    int KeywordLength = 0;
+    if (Length >= 2 && T[0] == 'v' && IsObjSpace(T[1]))
+    {
+        Record = OBJ_RECORD_POSITION;
+        KeywordLength = 2;
+    }
+    else if (Length >= 3 && T[0] == 'v' && T[1] == 'n' && IsObjSpace(T[2]))
+    {
+        Record = OBJ_RECORD_NORMAL;
+        KeywordLength = 3;
+    }
+    else if (Length >= 3 && T[0] == 'v' && T[1] == 't' && IsObjSpace(T[2]))
+    {
+        Record = OBJ_RECORD_TEXCOORD;
+        KeywordLength = 3;
+    }
+    else if (Length >= 2 && T[0] == 'f' && IsObjSpace(T[1]))
+    {
+        Record = OBJ_RECORD_FACE;
+        KeywordLength = 2;
+    }
+    else if (Length >= 7 && memcmp(T, "usemtl", 6) == 0 && IsObjSpace(T[6]))
+    {
+        Record = OBJ_RECORD_USEMTL;
+        KeywordLength = 7;
+    }
+    else if (Length >= 7 && memcmp(T, "mtllib", 6) == 0 && IsObjSpace(T[6]))
+    {
+        Record = OBJ_RECORD_MTLLIB;
+        KeywordLength = 7;
+    }
+    else if (Length >= 2 && (T[0] == 'l' || T[0] == 'p') && IsObjSpace(T[1]))
+    {
+        Record = OBJ_RECORD_UNSUPPORTED;
+    }
+
+    *Token = T + KeywordLength;
+    return Record;
+}
+
+static const char* GetObjLineEnd(const char* Line, const char* End)
+{
+    while (Line < End && !IsObjNewLine(*Line))
+        Line++;
+    return Line;
+}
+
+// Same grammar and arithmetic as tinyobj tryParseDouble
+static bool ParseObjDouble(const char* S, const char* SEnd, double* Result)
+{
+    if (S >= SEnd)
+        return false;
+
+    double Mantissa = 0.0;
+    int Exponent = 0;
+    char Sign = '+';
+    char ExponentSign = '+';
+    const char* Cur = S;
+    int Read = 0;
+    bool LeadingDecimalDot = false;
+
+    if (*Cur == '+' || *Cur == '-')
+    {
+        Sign = *Cur;
+        Cur++;
+        if (Cur != SEnd && *Cur == '.')
+            LeadingDecimalDot = true;
+    }
+    else if (*Cur == '.')
+    {
+        LeadingDecimalDot = true;
+    }
+    else if (!IsObjDigit(*Cur))
+    {
+        return false;
+    }
+
+    // Integer part
+    if (!LeadingDecimalDot)
+    {
+        while (Cur != SEnd && IsObjDigit(*Cur))
+        {
+            Mantissa *= 10;
+            Mantissa += (int)(*Cur - '0');
+            Cur++;
+            Read++;
+        }
+        if (Read == 0)
+            return false;
+    }
+
+    // Decimal part
+    if (Cur != SEnd && *Cur == '.')
+    {
+        static const double PowLut[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+
+        Cur++;
+        Read = 1;
+        while (Cur != SEnd && IsObjDigit(*Cur))
+        {
+            Mantissa += (int)(*Cur - '0') * (Read < (int)(sizeof(PowLut) / sizeof(PowLut[0])) ? PowLut[Read] : std::pow(10.0, -Read));
+            Read++;
+            Cur++;
+        }
+    }
+    else if (Cur == SEnd || (*Cur != 'e' && *Cur != 'E'))
+    {
+        *Result = (Sign == '+' ? 1 : -1) * Mantissa;
+        return true;
+    }
+
+    // Exponent part
+    if (Cur != SEnd && (*Cur == 'e' || *Cur == 'E'))
+    {
+        Cur++;
+        if (Cur != SEnd && (*Cur == '+' || *Cur == '-'))
+        {
+            ExponentSign = *Cur;
+            Cur++;
+        }
+        else if (Cur == SEnd || !IsObjDigit(*Cur))
+        {
+            return false;
+        }
+
+        Read = 0;
+        while (Cur != SEnd && IsObjDigit(*Cur))
+        {
+            Exponent *= 10;
+            Exponent += (int)(*Cur - '0');
+            Cur++;
+            Read++;
+        }
+        Exponent *= (ExponentSign == '+' ? 1 : -1);
+        if (Read == 0)
+            return false;
+    }
+
+    *Result = (Sign == '+' ? 1 : -1) * (Exponent ? std::ldexp(Mantissa * std::pow(5.0, Exponent), Exponent) : Mantissa);
+    return true;
+}
+
+static float ParseObjReal(const char** Token, const char* LineEnd)
+{
+    const char* Begin = SkipObjSpaces(*Token, LineEnd);
+    const char* End = Begin;
+    while (End < LineEnd && !IsObjSpace(*End))
+        End++;
+
+    double Value = 0.0;
+    ParseObjDouble(Begin, End, &Value);
+    *Token = End;
+    return (float)Value;
+}
+
+// atoi() equivalent bounded by the line end
+static int ParseObjInt(const char* Token, const char* LineEnd)
+{
+    Token = SkipObjSpaces(Token, LineEnd);
+
+    int Sign = 1;
+    if (Token < LineEnd && (*Token == '+' || *Token == '-'))
+    {
+        Sign = *Token == '-' ? -1 : 1;
+        Token++;
+    }
+
+    int Value = 0;
+    while (Token < LineEnd && IsObjDigit(*Token))
+        Value = Value * 10 + (*Token++ - '0');
+
+    return Sign * Value;
+}
+
+// Make index zero based, negative indices are relative to the record count so far
+static bool FixObjIndex(int Index, int Count, int* Result)
+{
+    if (Index == 0)
+        return false;
+    *Result = Index > 0 ? Index - 1 : Count + Index;
+    return true;
+}
+
+static const char* SkipObjIndex(const char* Token, const char* LineEnd)
+{
+    while (Token < LineEnd && *Token != '/' && !IsObjSpace(*Token))
+        Token++;
+    return Token;
+}
+
+// Parse i, i/j, i//k or i/j/k
+static bool ParseObjCorner(const char** Token, const char* LineEnd, int PositionCount, int NormalCount, int TexCoordCount, obj_corner* Corner)
+{
+    const char* T = *Token;
+    *Corner = { -1, -1, -1 };
+
+    if (!FixObjIndex(ParseObjInt(T, LineEnd), PositionCount, &Corner->Position))
+        return false;
+    T = SkipObjIndex(T, LineEnd);
+
+    if (T < LineEnd && *T == '/')
+    {
+        T++;
+        if (T < LineEnd && *T == '/')
+        {
+            // i//k
+            T++;
+            if (!FixObjIndex(ParseObjInt(T, LineEnd), NormalCount, &Corner->Normal))
+                return false;
+            T = SkipObjIndex(T, LineEnd);
+        }
+        else
+        {
+            // i/j or i/j/k
+            if (!FixObjIndex(ParseObjInt(T, LineEnd), TexCoordCount, &Corner->TexCoord))
+                return false;
+            T = SkipObjIndex(T, LineEnd);
+
+            if (T < LineEnd && *T == '/')
+            {
+                T++;
+                if (!FixObjIndex(ParseObjInt(T, LineEnd), NormalCount, &Corner->Normal))
+                    return false;
+                T = SkipObjIndex(T, LineEnd);
+            }
+        }
+    }
+
+    *Token = T;
+    return true;
+}
+
+static void CountObjChunkRecords(obj_chunk& Chunk)
+{
+    for (const char* Line = Chunk.Begin; Line < Chunk.End; )
+    {
+        const char* LineEnd = GetObjLineEnd(Line, Chunk.End);
+
+        const char* Token = Line;
+        switch (GetObjRecord(&Token, LineEnd))
+        {
+        case OBJ_RECORD_POSITION: Chunk.PositionCount++; break;
+        case OBJ_RECORD_NORMAL:   Chunk.NormalCount++;   break;
+        case OBJ_RECORD_TEXCOORD: Chunk.TexCoordCount++; break;
+        case OBJ_RECORD_FACE:     Chunk.FaceCount++;     break;
+        case OBJ_RECORD_USEMTL:
+        {
+            // First token, like tinyobj
+            const char* NameBegin = SkipObjSpaces(Token, LineEnd);
+            const char* NameEnd = NameBegin;
+            while (NameEnd < LineEnd && !IsObjSpace(*NameEnd))
+                NameEnd++;
+            Chunk.MaterialLines.push_back({ Chunk.FaceCount, false, std::string(NameBegin, NameEnd) });
+        } break;
+        case OBJ_RECORD_MTLLIB:
+            Chunk.MaterialLines.push_back({ Chunk.FaceCount, true, std::string(Token, LineEnd) });
+            break;
+        case OBJ_RECORD_UNSUPPORTED: Chunk.Error = "lines or points"; break;
+        default: break;
+        }
+
+        if (LineEnd == Chunk.End)
+            break;
+        Line = LineEnd + 1;
+    }
+}
+
+static void ParseObjChunk(obj_chunk& Chunk, v3* Positions, v3* Normals, v2* TexCoords, obj_corner* Faces)
+{
+    int PositionCount = Chunk.FirstPosition;
+    int NormalCount = Chunk.FirstNormal;
+    int TexCoordCount = Chunk.FirstTexCoord;
+    int FaceCount = Chunk.FirstFace;
+
+    for (const char* Line = Chunk.Begin; Line < Chunk.End && Chunk.Error == nullptr; )
+    {
+        const char* LineEnd = GetObjLineEnd(Line, Chunk.End);
+
+        const char* Token = Line;
+        switch (GetObjRecord(&Token, LineEnd))
+        {
+        case OBJ_RECORD_POSITION:
+        {
+            v3& Position = Positions[PositionCount++];
+            Position.x = ParseObjReal(&Token, LineEnd);
+            Position.y = ParseObjReal(&Token, LineEnd);
+            Position.z = ParseObjReal(&Token, LineEnd);
+        } break;
+
+        case OBJ_RECORD_NORMAL:
+        {
+            v3& Normal = Normals[NormalCount++];
+            Normal.x = ParseObjReal(&Token, LineEnd);
+            Normal.y = ParseObjReal(&Token, LineEnd);
+            Normal.z = ParseObjReal(&Token, LineEnd);
+        } break;
+
+        case OBJ_RECORD_TEXCOORD:
+        {
+            v2& TexCoord = TexCoords[TexCoordCount++];
+            TexCoord.x = ParseObjReal(&Token, LineEnd);
+            TexCoord.y = ParseObjReal(&Token, LineEnd);
+        } break;
+
+        case OBJ_RECORD_FACE:
+        {
+            obj_corner* Face = &Faces[FaceCount * 3];
+            int CornerCount = 0;
+
+            Token = SkipObjSpaces(Token, LineEnd);
+            while (Token < LineEnd)
+            {
+                obj_corner Corner;
+                if (!ParseObjCorner(&Token, LineEnd, PositionCount, NormalCount, TexCoordCount, &Corner))
+                {
+                    Chunk.Error = "invalid face index";
+                    break;
+                }
+                if (CornerCount == 3)
+                {
+                    Chunk.Error = "polygons";
+                    break;
+                }
+                Face[CornerCount++] = Corner;
+
+                while (Token < LineEnd && IsObjSpace(*Token))
+                    Token++;
+            }
+
+            if (Chunk.Error == nullptr && CornerCount != 3)
+                Chunk.Error = "faces with less than 3 vertices";
+            FaceCount++;
+        } break;
+
+        default: break;
+        }
+
+        if (LineEnd == Chunk.End)
+            break;
+        Line = LineEnd + 1;
+    }
+}
+
+// Load the .mtl files and give its material to each face, with the same rules as tinyobj:
+// the first .mtl found of an mtllib line is loaded, unknown materials give -1
+static void ResolveObjMaterials(std::vector<int>& FaceMaterials, std::vector<mesh_material>& Materials, const std::vector<obj_chunk>& Chunks,
+                                int FaceCount, const std::string& Directory)
+{
+    std::vector<tinyobj::material_t> ObjMaterials;
+    std::map<std::string, int> MaterialMap;
+    FaceMaterials.resize(FaceCount);
+
+    int Material = -1;
+    int Face = 0;
+    for (const obj_chunk& Chunk : Chunks)
+    {
+        for (const obj_material_line& Line : Chunk.MaterialLines)
+        {
+            int LineFace = Chunk.FirstFace + Line.Face;
+            std::fill(FaceMaterials.begin() + Face, FaceMaterials.begin() + LineFace, Material);
+            Face = LineFace;
+
+            if (Line.IsLibrary)
+            {
+                for (const char* Name = Line.Name.c_str(); *Name; )
+                {
+                    size_t NameLength = strcspn(Name, " \t");
+                    if (NameLength > 0)
+                    {
+                        // Mapped to read it from the mounted pack
+                        file_mapping MtlFile;
+                        if (File::Map(MtlFile, (Directory + std::string(Name, NameLength)).c_str()))
+                        {
+                            std::istringstream Stream(std::string((const char*)MtlFile.Data, MtlFile.Size));
+                            File::Unmap(MtlFile);
+                            std::string Warn;
+                            std::string Err;
+                            tinyobj::LoadMtl(&MaterialMap, &ObjMaterials, &Stream, &Warn, &Err);
+                            break;
+                        }
+                    }
+                    Name += NameLength;
+                    Name += strspn(Name, " \t");
+                }
+            }
+            else
+            {
+                auto It = MaterialMap.find(Line.Name);
+                Material = It != MaterialMap.end() ? It->second : -1;
+            }
+        }
+    }
+    std::fill(FaceMaterials.begin() + Face, FaceMaterials.end(), Material);
+
+    ConvertObjMaterials(Materials, ObjMaterials);
+}
+
+bool Mesh::ParseObjParallel(std::vector<vertex_full>& Mesh, std::vector<int>& TriangleMaterials, std::vector<mesh_material>& Materials,
+                            bool* HasNormals, bool* HasTexCoords, const char* Filename)
+{
+    file_mapping File;
+    if (!File::Map(File, Filename))
+        return false;
+
+    const char* FileBegin = (const char*)File.Data;
+    const char* FileEnd = FileBegin + File.Size;
+
+    // Split in line aligned chunks (a few per thread to balance the load)
+    const size_t MinChunkSize = 64 * 1024;
+    int ChunkCount = Math::Max(1, Math::Min(Jobs::GetThreadCount() * 4, (int)(File.Size / MinChunkSize)));
+    std::vector<obj_chunk> Chunks;
+    Chunks.reserve(ChunkCount);
+    for (const char* ChunkBegin = FileBegin; ChunkBegin < FileEnd; )
+    {
+        const char* ChunkEnd = ChunkBegin + Math::Max(File.Size / ChunkCount, (size_t)1);
+        if (ChunkEnd >= FileEnd)
+            ChunkEnd = FileEnd;
+        else
+            ChunkEnd = (const char*)memchr(ChunkEnd, '\n', FileEnd - ChunkEnd);
+        ChunkEnd = ChunkEnd ? Math::Min(ChunkEnd + 1, FileEnd) : FileEnd;
+
+        obj_chunk Chunk = {};
+        Chunk.Begin = ChunkBegin;
+        Chunk.End = ChunkEnd;
+        Chunks.push_back(Chunk);
+
+        ChunkBegin = ChunkEnd;
+    }
+
+    Jobs::ParallelFor((int)Chunks.size(), 1, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+            CountObjChunkRecords(Chunks[i]);
+    });
+
+    // Prefix sums
+    obj_chunk Total = {};
+    for (obj_chunk& Chunk : Chunks)
+    {
+        Chunk.FirstPosition = Total.PositionCount;
+        Chunk.FirstNormal = Total.NormalCount;
+        Chunk.FirstTexCoord = Total.TexCoordCount;
+        Chunk.FirstFace = Total.FaceCount;
+
+        Total.PositionCount += Chunk.PositionCount;
+        Total.NormalCount += Chunk.NormalCount;
+        Total.TexCoordCount += Chunk.TexCoordCount;
+        Total.FaceCount += Chunk.FaceCount;
+    }
+
+    std::vector<v3> Positions(Total.PositionCount);
+    std::vector<v3> Normals(Total.NormalCount);
+    std::vector<v2> TexCoords(Total.TexCoordCount);
+    std::vector<obj_corner> Faces(Total.FaceCount * 3);
+
+    Jobs::ParallelFor((int)Chunks.size(), 1, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            if (Chunks[i].Error == nullptr)
+                ParseObjChunk(Chunks[i], Positions.data(), Normals.data(), TexCoords.data(), Faces.data());
+        }
+    });
+
+    File::Unmap(File);
+
+    for (const obj_chunk& Chunk : Chunks)
+    {
+        if (Chunk.Error)
+        {
+            printf("Parallel obj parser: %s not supported in %s, falling back on tinyobj\n", Chunk.Error, Filename);
+            return false;
+        }
+    }
+
+    *HasNormals = Total.NormalCount > 0;
+    *HasTexCoords = Total.TexCoordCount > 0;
+    ResolveObjMaterials(TriangleMaterials, Materials, Chunks, Total.FaceCount, GetObjDirectory(Filename));
+
+    // Expand faces
+    std::atomic<bool> InvalidIndex(false);
+    Mesh.resize(Faces.size());
+    Jobs::ParallelFor((int)Faces.size(), 16 * 1024, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            const obj_corner& Corner = Faces[i];
+            vertex_full V = {};
+
+            if ((unsigned int)Corner.Position >= (unsigned int)Total.PositionCount
+             || (*HasNormals && (unsigned int)Corner.Normal >= (unsigned int)Total.NormalCount)
+             || (*HasTexCoords && (unsigned int)Corner.TexCoord >= (unsigned int)Total.TexCoordCount))
+            {
+                InvalidIndex = true;
+                continue;
+            }
+
+            V.Position = Positions[Corner.Position];
+            if (*HasNormals)
+                V.Normal = Normals[Corner.Normal];
+            if (*HasTexCoords)
+                V.UV = TexCoords[Corner.TexCoord];
+
+            Mesh[i] = V;
+        }
+    });
+
+    if (InvalidIndex)
+    {
+        printf("Parallel obj parser: out of range indices not supported in %s, falling back on tinyobj\n", Filename);
+        return false;
+    }
+
+    return true;
+}
+
+void Mesh::BenchmarkObjParsers(const char* Filename, int Iterations)
+{
+    typedef std::chrono::high_resolution_clock clock;
+
+    double BestTimes[2] = { 1e30, 1e30 };
+    std::vector<vertex_full> Results[2];
+    std::vector<int> TriangleMaterials[2];
+    std::vector<mesh_material> Materials[2];
+    bool HasNormals[2] = {};
+    bool HasTexCoords[2] = {};
+    bool Success[2] = {};
+
+    for (int i = 0; i < Iterations; ++i)
+    {
+        for (int Parser = 0; Parser < 2; ++Parser)
+        {
+            Results[Parser].clear();
+            TriangleMaterials[Parser].clear();
+
+            clock::time_point Start = clock::now();
+            if (Parser == 0)
+                Success[Parser] = ParseObjTinyObj(Results[Parser], TriangleMaterials[Parser], Materials[Parser], &HasNormals[Parser], &HasTexCoords[Parser], Filename);
+            else
+                Success[Parser] = ParseObjParallel(Results[Parser], TriangleMaterials[Parser], Materials[Parser], &HasNormals[Parser], &HasTexCoords[Parser], Filename);
+            double Time = std::chrono::duration<double, std::milli>(clock::now() - Start).count();
+
+            BestTimes[Parser] = Math::Min(BestTimes[Parser], Time);
+        }
+    }
+
+    bool Identical = Success[0] && Success[1]
+        && HasNormals[0] == HasNormals[1] && HasTexCoords[0] == HasTexCoords[1]
+        && Results[0].size() == Results[1].size()
+        && memcmp(Results[0].data(), Results[1].data(), Results[0].size() * sizeof(vertex_full)) == 0
+        && TriangleMaterials[0] == TriangleMaterials[1]
+        && Materials[0].size() == Materials[1].size()
+        && memcmp(Materials[0].data(), Materials[1].data(), Materials[0].size() * sizeof(mesh_material)) == 0;
+
+    printf("Obj parsers benchmark: %s (%d vertices, best of %d)\n", Filename, (int)Results[0].size(), Iterations);
+    printf("  tinyobj:  %8.2f ms\n", BestTimes[0]);
+    printf("  parallel: %8.2f ms (%d threads, x%.2f)\n", BestTimes[1], Jobs::GetThreadCount(), BestTimes[0] / BestTimes[1]);
+    if (!Success[1])
+        printf("  results:  unsupported by the parallel parser\n");
+    else
+        printf("  results:  %s\n", Identical ? "identical" : "DIFFERENT");
+}
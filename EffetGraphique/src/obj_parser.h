@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+namespace Mesh
+{
+
+// Parse .obj as a list of triangles with tinyobj (single threaded)
+// TriangleMaterials gets the index in Materials of each triangle (-1 without material), .mtl files are next to the .obj
+bool ParseObjTinyObj(std::vector<vertex_full>& Triangles, std::vector<int>& TriangleMaterials, std::vector<mesh_material>& Materials,
+                     bool* HasNormals, bool* HasTexCoords, const char* Filename);
+
+// Parse .obj as a list of triangles on all threads (v/vn/vt/f/usemtl/mtllib records only)
+// Results are identical to ParseObjTinyObj. Returns false on unsupported content (polygons, lines, points,
+// invalid indices) to let the caller fall back on tinyobj
+bool ParseObjParallel(std::vector<vertex_full>& Triangles, std::vector<int>& TriangleMaterials, std::vector<mesh_material>& Materials,
+                      bool* HasNormals, bool* HasTexCoords, const char* Filename);
+
+// Directory of Filename with its trailing separator (empty if none)
+std::string GetObjDirectory(const char* Filename);
+
+// Time both parsers and check that their results are identical
+void BenchmarkObjParsers(const char* Filename, int Iterations);
+}
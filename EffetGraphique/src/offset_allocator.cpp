@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <iterator>
+
+#include "offset_allocator.h"
+
+void offset_allocator::Init(uint32_t Capacity)
+{
+    this->Capacity = Capacity;
+    this->FreeRanges.clear();
+    this->FreeRangesBySize.clear();
+    this->Allocations.clear();
+    if (Capacity > 0)
+        InsertFreeRange(0, Capacity);
+}
+
+void offset_allocator::InsertFreeRange(uint32_t Offset, uint32_t Size)
+{
+    this->FreeRanges[Offset] = Size;
+    this->FreeRangesBySize.insert({ Size, Offset });
+}
+
+void offset_allocator::EraseFreeRange(std::map<uint32_t, uint32_t>::iterator Range)
+{
+    auto Candidates = this->FreeRangesBySize.equal_range(Range->second);
+    for (auto It = Candidates.first; It != Candidates.second; ++It)
+    {
+        if (It->second == Range->first)
+        {
+            this->FreeRangesBySize.erase(It);
+            break;
+        }
+    }
+    this->FreeRanges.erase(Range);
+}
+
+uint32_t offset_allocator::Allocate(uint32_t Size)
+{
+    if (Size == 0)
+        return INVALID_OFFSET;
+
+    // Smallest free range that fits, the remainder stays free
+    auto BestFit = this->FreeRangesBySize.lower_bound(Size);
+    if (BestFit == this->FreeRangesBySize.end())
+        return INVALID_OFFSET;
+
+    uint32_t Offset = BestFit->second;
+    uint32_t RangeSize = BestFit->first;
+    EraseFreeRange(this->FreeRanges.find(Offset));
+    if (RangeSize > Size)
+        InsertFreeRange(Offset + Size, RangeSize - Size);
+
+    this->Allocations[Offset] = Size;
+    return Offset;
+}
+
+void offset_allocator::Free(uint32_t Offset)
+{
+    auto Allocation = this->Allocations.find(Offset);
+    if (Allocation == this->Allocations.end())
+    {
+        fprintf(stderr, "offset_allocator: no allocation at offset %u\n", Offset);
+        return;
+    }
+
+    uint32_t Size = Allocation->second;
+    this->Allocations.erase(Allocation);
+
+    // Merge with the free ranges before and after
+    auto Next = this->FreeRanges.lower_bound(Offset);
+    if (Next != this->FreeRanges.begin())
+    {
+        auto Previous = std::prev(Next);
+        if (Previous->first + Previous->second == Offset)
+        {
+            Offset = Previous->first;
+            Size += Previous->second;
+            EraseFreeRange(Previous);
+        }
+    }
+    if (Next != this->FreeRanges.end() && Offset + Size == Next->first)
+    {
+        Size += Next->second;
+        EraseFreeRange(Next);
+    }
+
+    InsertFreeRange(Offset, Size);
+}
+
+void offset_allocator::Grow(uint32_t Capacity)
+{
+    if (Capacity <= this->Capacity)
+        return;
+
+    uint32_t Offset = this->Capacity;
+    uint32_t Size = Capacity - this->Capacity;
+    if (!this->FreeRanges.empty())
+    {
+        auto Last = std::prev(this->FreeRanges.end());
+        if (Last->first + Last->second == Offset)
+        {
+            Offset = Last->first;
+            Size += Last->second;
+            EraseFreeRange(Last);
+        }
+    }
+
+    InsertFreeRange(Offset, Size);
+    this->Capacity = Capacity;
+}
+
+offset_allocator_stats offset_allocator::GetStats() const
+{
+    offset_allocator_stats Stats = {};
+    Stats.Capacity = this->Capacity;
+    Stats.AllocationCount = (int)this->Allocations.size();
+    Stats.FreeRangeCount = (int)this->FreeRanges.size();
+    for (const auto& Range : this->FreeRanges)
+        Stats.FreeSize += Range.second;
+    Stats.UsedSize = this->Capacity - Stats.FreeSize;
+    if (!this->FreeRangesBySize.empty())
+        Stats.LargestFreeRange = this->FreeRangesBySize.rbegin()->first;
+    if (Stats.FreeSize > 0)
+        Stats.Fragmentation = 1.f - (float)Stats.LargestFreeRange / (float)Stats.FreeSize;
+    return Stats;
+}
+
+void offset_allocator::Defragment(std::vector<offset_allocator_move>& Moves)
+{
+    Moves.clear();
+
+    std::map<uint32_t, uint32_t> Packed;
+    uint32_t Offset = 0;
+    for (const auto& Allocation : this->Allocations)
+    {
+        if (Allocation.first != Offset)
+            Moves.push_back({ Allocation.first, Offset, Allocation.second });
+        Packed[Offset] = Allocation.second;
+        Offset += Allocation.second;
+    }
+
+    this->Allocations.swap(Packed);
+    this->FreeRanges.clear();
+    this->FreeRangesBySize.clear();
+    if (Offset < this->Capacity)
+        InsertFreeRange(Offset, this->Capacity - Offset);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Sizes are in allocator units (vertices, indices, bytes...)
+struct offset_allocator_stats
+{
+    uint32_t Capacity;
+    uint32_t UsedSize;
+    uint32_t FreeSize;
+    uint32_t LargestFreeRange;
+    int AllocationCount;
+    int FreeRangeCount;
+    float Fragmentation; // 1 - LargestFreeRange / FreeSize (0 when the free space is in one range)
+};
+
+// Allocation moved by offset_allocator::Defragment
+struct offset_allocator_move
+{
+    uint32_t SrcOffset;
+    uint32_t DstOffset;
+    uint32_t Size;
+};
+
+// Suballocation of the range [0;Capacity) (no memory is touched, offsets are used in gpu buffers)
+// Best fit in O(log n), freed ranges are merged with their free neighbours
+class offset_allocator
+{
+public:
+    static const uint32_t INVALID_OFFSET = 0xFFFFFFFF;
+
+    void Init(uint32_t Capacity);
+    // Returns INVALID_OFFSET when no free range is large enough
+    uint32_t Allocate(uint32_t Size);
+    void Free(uint32_t Offset);
+    // Extend the range to [0;Capacity), the new space is merged with the free range ending the old one
+    void Grow(uint32_t Capacity);
+    offset_allocator_stats GetStats() const;
+
+    // Pack the allocations at the start of the range, keeping their order
+    // Moves are sorted by offset, the moved allocations end up contiguous (DstOffset < SrcOffset)
+    void Defragment(std::vector<offset_allocator_move>& Moves);
+
+private:
+    void InsertFreeRange(uint32_t Offset, uint32_t Size);
+    void EraseFreeRange(std::map<uint32_t, uint32_t>::iterator Range);
+
+    uint32_t Capacity = 0;
+    std::map<uint32_t, uint32_t> FreeRanges;            // Offset -> size
+    std::multimap<uint32_t, uint32_t> FreeRangesBySize; // Size -> offset (best fit lookup)
+    std::map<uint32_t, uint32_t> Allocations;           // Offset -> size
+};
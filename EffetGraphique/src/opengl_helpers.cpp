@@ -1,5 +1,7 @@
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <vector>
 #include <string>
 #include <map>
@@ -8,6 +10,8 @@
 
 #include "platform.h"
 #include "mesh.h"
+#include "file_mapping.h"
+#include "jobs.h"
 
 #include "opengl_helpers.h"
 #include "opengl_helpers_wireframe.h"
@@ -107,6 +111,19 @@ light_shade_result light_shade(light light, float shininess, vec3 eyePosition, v
 // =================================
 )GLSL";
 
+static const char* VertexDecodingStr = R"GLSL(
+// Octahedral normal decoding (VERTEX_FORMAT_OCT16, int16 components not normalized by GL)
+vec3 octDecode(vec2 e)
+{
+    e /= 32767.0;
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+)GLSL";
+
 void GL::UniformLight(GLuint Program, const char* LightUniformName, const light& Light)
 {
 	glUseProgram(Program);
@@ -216,13 +233,42 @@ const char* GL::GetShaderStructsDefinitions()
 	return ShaderStructsDefinitionsStr;
 }
 
-void GL::UploadTexture(const char* Filename, int ImageFlags, int* WidthOut, int* HeightOut)
+const char* GL::GetVertexDecodingFunctions()
+{
+	return VertexDecodingStr;
+}
+
+static void VertexAttribPointer(GLint Location, vertex_attribute_format Format, int ComponentCount, int Stride, int Offset)
 {
-    // Flip
-    stbi_set_flip_vertically_on_load((ImageFlags & IMG_FLIP) ? 1 : 0);
+	if (Location < 0 || Format == VERTEX_FORMAT_NONE)
+		return;
+
+	void* Pointer = (void*)(size_t)Offset;
+	glEnableVertexAttribArray(Location);
+	switch (Format)
+	{
+	case VERTEX_FORMAT_FLOAT:   glVertexAttribPointer(Location, ComponentCount, GL_FLOAT, GL_FALSE, Stride, Pointer); break;
+	case VERTEX_FORMAT_HALF:    glVertexAttribPointer(Location, ComponentCount, GL_HALF_FLOAT, GL_FALSE, Stride, Pointer); break;
+	case VERTEX_FORMAT_UNORM16: glVertexAttribPointer(Location, ComponentCount, GL_UNSIGNED_SHORT, GL_TRUE, Stride, Pointer); break;
+	// Not normalized: snorm conversion rules differ before GL 4.2, octDecode() does the division
+	case VERTEX_FORMAT_OCT16:   glVertexAttribPointer(Location, 2, GL_SHORT, GL_FALSE, Stride, Pointer); break;
+	default: break;
+	}
+}
+
+void GL::VertexAttribPointers(const vertex_layout& Layout, GLint PositionLocation, GLint UVLocation, GLint NormalLocation)
+{
+	VertexAttribPointer(PositionLocation, Layout.PositionFormat, 3, Layout.Stride, Layout.PositionOffset);
+	VertexAttribPointer(UVLocation, Layout.UVFormat, 2, Layout.Stride, Layout.UVOffset);
+	VertexAttribPointer(NormalLocation, Layout.NormalFormat, 3, Layout.Stride, Layout.NormalOffset);
+}
 
-    // Desired channels
-    int DesiredChannels = 0;
+bool GL::DecodeImage(image& Image, const char* Filename, int ImageFlags)
+{
+	Image = {};
+
+	// Desired channels
+	int DesiredChannels = 0;
 	int Channels = 0;
 	if (ImageFlags & IMG_FORCE_GREY)
 	{
@@ -245,15 +291,64 @@ void GL::UploadTexture(const char* Filename, int ImageFlags, int* WidthOut, int*
 		Channels = 4;
 	}
 
-    // Loading
-    int Width, Height;
-    uint8_t* Image = stbi_load(Filename, &Width, &Height, (DesiredChannels == 0) ? &Channels : nullptr, DesiredChannels);
-    if (Image == nullptr)
-    {
-        fprintf(stderr, "[ERROR] Image loading failed on '%s'\n", Filename);
-		return;
+	// Loading (through File::Map to read from the mounted pack)
+	int Width, Height;
+	uint8_t* Data = nullptr;
+	file_mapping File;
+	if (File::Map(File, Filename))
+	{
+		Data = stbi_load_from_memory((const stbi_uc*)File.Data, (int)File.Size, &Width, &Height, (DesiredChannels == 0) ? &Channels : nullptr, DesiredChannels);
+		File::Unmap(File);
+	}
+	if (Data == nullptr)
+	{
+		fprintf(stderr, "[ERROR] Image loading failed on '%s'\n", Filename);
+		return false;
+	}
+
+	// Flip (done here because stbi_set_flip_vertically_on_load() is global to all threads)
+	if (ImageFlags & IMG_FLIP)
+	{
+		int RowSize = Width * Channels;
+		std::vector<uint8_t> Row(RowSize);
+		for (int y = 0; y < Height / 2; ++y)
+		{
+			uint8_t* Top = Data + y * RowSize;
+			uint8_t* Bottom = Data + (Height - 1 - y) * RowSize;
+			memcpy(Row.data(), Top, RowSize);
+			memcpy(Top, Bottom, RowSize);
+			memcpy(Bottom, Row.data(), RowSize);
+		}
 	}
 
+	Image.Data = Data;
+	Image.Width = Width;
+	Image.Height = Height;
+	Image.Channels = Channels;
+
+	return true;
+}
+
+bool GL::DecodeImages(image* Images, const char* const* Filenames, int Count, int ImageFlags)
+{
+	// One image per job: DecodeImage has no shared state
+	std::vector<uint8_t> Success(Count);
+	Jobs::ParallelFor(Count, 1, [&](int Begin, int End)
+	{
+		for (int i = Begin; i < End; ++i)
+			Success[i] = DecodeImage(Images[i], Filenames[i], ImageFlags);
+	});
+	return std::find(Success.begin(), Success.end(), 0) == Success.end();
+}
+
+void GL::FreeImage(image& Image)
+{
+	stbi_image_free(Image.Data);
+	Image = {};
+}
+
+void GL::UploadImage(GLenum Target, const image& Image)
+{
 	GLint GLImageFormat[] =
 	{
 		-1, // 0 Channels, unused
@@ -263,84 +358,140 @@ void GL::UploadTexture(const char* Filename, int ImageFlags, int* WidthOut, int*
 		GL_RGBA
 	};
 
+	glTexImage2D(Target, 0, GLImageFormat[Image.Channels], Image.Width, Image.Height, 0, GLImageFormat[Image.Channels], GL_UNSIGNED_BYTE, Image.Data);
+}
+
+void GL::UploadCookedTexture(GLenum Target, const cooked_texture& Texture)
+{
+	GLint GLImageFormat[] =
+	{
+		-1, // 0 Channels, unused
+		GL_RED,
+		GL_RG,
+		GL_RGB,
+		GL_RGBA
+	};
+
+	// Rows are aligned on 4 bytes in the cooked file (default GL_UNPACK_ALIGNMENT)
+	const cooked_texture_header& Header = *Texture.Header;
+	GLint Format = GLImageFormat[Header.Channels];
+	for (int Face = 0; Face < (int)Header.FaceCount; ++Face)
+	{
+		GLenum FaceTarget = Target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face : Target;
+		for (int Level = 0; Level < (int)Header.LevelCount; ++Level)
+		{
+			int Width, Height;
+			const uint8_t* Pixels = Cook::GetCookedLevel(Texture, Face, Level, &Width, &Height);
+			glTexImage2D(FaceTarget, Level, Format, Width, Height, 0, Format, GL_UNSIGNED_BYTE, Pixels);
+		}
+	}
+	glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, (GLint)Header.LevelCount - 1);
+}
+
+bool GL::IsTextureFormatSupported(texture_format Format)
+{
+	// RGTC (BC4, BC5) is core since GL 3.0, S3TC (BC1, BC3) and BPTC (BC7) are extensions on a 3.3 context
+	static int Supported = -1;
+	if (Supported < 0)
+	{
+		Supported = 1 << TEXTURE_BC4 | 1 << TEXTURE_BC5;
+		GLint Major = 0, Minor = 0, ExtensionCount = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &Major);
+		glGetIntegerv(GL_MINOR_VERSION, &Minor);
+		if (Major > 4 || (Major == 4 && Minor >= 2))
+			Supported |= 1 << TEXTURE_BC7;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionCount);
+		for (GLint i = 0; i < ExtensionCount; ++i)
+		{
+			const char* Extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+			if (strcmp(Extension, "GL_EXT_texture_compression_s3tc") == 0)
+				Supported |= 1 << TEXTURE_BC1 | 1 << TEXTURE_BC3;
+			else if (strcmp(Extension, "GL_ARB_texture_compression_bptc") == 0)
+				Supported |= 1 << TEXTURE_BC7;
+		}
+	}
+	return (Supported & (1 << Format)) != 0;
+}
+
+void GL::UploadCompressedTexture(GLenum Target, const compressed_texture& Texture)
+{
+	GLenum Format = (GLenum)Texture::GetGLFormat(Texture.Format);
+	for (int Face = 0; Face < Texture.FaceCount; ++Face)
+	{
+		GLenum FaceTarget = Target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face : Target;
+		for (int Level = 0; Level < Texture.LevelCount; ++Level)
+		{
+			int Width = std::max(Texture.Width >> Level, 1);
+			int Height = std::max(Texture.Height >> Level, 1);
+			GLsizei Size = (GLsizei)Texture::GetCompressedSize(Texture.Format, Width, Height);
+			glCompressedTexImage2D(FaceTarget, Level, Format, Width, Height, 0, Size, Texture.Levels[Face][Level]);
+		}
+	}
+	glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, Texture.LevelCount - 1);
+}
+
+void GL::UploadTexture(const char* Filename, int ImageFlags, int* WidthOut, int* HeightOut)
+{
+	image Image;
+	if (!DecodeImage(Image, Filename, ImageFlags))
+		return;
+
 	// Uploading
-	glTexImage2D(GL_TEXTURE_2D, 0, GLImageFormat[Channels], Width, Height, 0, GLImageFormat[Channels], GL_UNSIGNED_BYTE, Image);
-	stbi_image_free(Image);
+	UploadImage(GL_TEXTURE_2D, Image);
 
 	// Mipmaps
 	if (ImageFlags & IMG_GEN_MIPMAPS)
 		glGenerateMipmap(GL_TEXTURE_2D);
 
 	if (WidthOut)
-		*WidthOut = Width;
+		*WidthOut = Image.Width;
 
 	if (HeightOut)
-		*HeightOut = Height;
+		*HeightOut = Image.Height;
 
-	stbi_set_flip_vertically_on_load(0); // Always reset to default value
+	FreeImage(Image);
 }
 
 void GL::UploadCubemapTexture(const char* Filename, int face, int ImageFlags, int* WidthOut, int* HeightOut)
 {
-	// Flip
-	stbi_set_flip_vertically_on_load((ImageFlags & IMG_FLIP) ? 1 : 0);
-
-	// Desired channels
-	int DesiredChannels = 0;
-	int Channels = 0;
-	if (ImageFlags & IMG_FORCE_GREY)
-	{
-		DesiredChannels = STBI_grey;
-		Channels = 1;
-	}
-	if (ImageFlags & IMG_FORCE_GREY_ALPHA)
-	{
-		DesiredChannels = STBI_grey_alpha;
-		Channels = 2;
-	}
-	if (ImageFlags & IMG_FORCE_RGB)
-	{
-		DesiredChannels = STBI_rgb;
-		Channels = 3;
-	}
-	if (ImageFlags & IMG_FORCE_RGBA)
-	{
-		DesiredChannels = STBI_rgb_alpha;
-		Channels = 4;
-	}
-
-	// Loading
-	int Width, Height;
-	uint8_t* Image = stbi_load(Filename, &Width, &Height, (DesiredChannels == 0) ? &Channels : nullptr, DesiredChannels);
-	if (Image == nullptr)
-	{
-		fprintf(stderr, "[ERROR] Image loading failed on '%s'\n", Filename);
+	image Image;
+	if (!DecodeImage(Image, Filename, ImageFlags))
 		return;
-	}
-
-	GLint GLImageFormat[] =	{
-		-1, // 0 Channels, unused
-		GL_RED,
-		GL_RG,
-		GL_RGB,
-		GL_RGBA
-	};
 
 	// Uploading
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GLImageFormat[Channels], Width, Height, 0, GLImageFormat[Channels], GL_UNSIGNED_BYTE, Image);
-	stbi_image_free(Image);
+	UploadImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, Image);
 
 	// Mipmaps
 	if (ImageFlags & IMG_GEN_MIPMAPS)
 		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
 	if (WidthOut)
-		*WidthOut = Width;
+		*WidthOut = Image.Width;
 
 	if (HeightOut)
-		*HeightOut = Height;
+		*HeightOut = Image.Height;
+
+	FreeImage(Image);
+}
 
-	stbi_set_flip_vertically_on_load(0); // Always reset to default value
+void GL::UploadCubemapTextures(const char* const* Faces, int ImageFlags, int* SizeOut)
+{
+	image Images[6];
+	DecodeImages(Images, Faces, 6, ImageFlags);
+
+	// Uploaded in face order on this thread
+	for (int i = 0; i < 6; ++i)
+	{
+		if (Images[i].Data == nullptr)
+			continue;
+		UploadImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, Images[i]);
+		if (SizeOut)
+			*SizeOut = Images[i].Width;
+		FreeImage(Images[i]);
+	}
+
+	if (ImageFlags & IMG_GEN_MIPMAPS)
+		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 }
 
 void GL::UploadCheckerboardTexture(int Width, int Height, int SquareSize)
@@ -2,6 +2,7 @@
 
 #include "opengl_headers.h"
 #include "types.h"
+#include "texture_codec.h"
 #include "opengl_helpers_cache.h"
 #include "opengl_helpers_wireframe.h"
 
@@ -13,6 +14,9 @@ enum image_flags
     IMG_FORCE_RGB        = 1 << 3,
     IMG_FORCE_RGBA       = 1 << 4,
     IMG_GEN_MIPMAPS      = 1 << 5,
+    IMG_COMPRESS         = 1 << 6, // Block compressed by GL::cache (BC1/BC3/BC4/BC5 by channel count), see Texture::MapCompressedCache
+    IMG_COMPRESS_BC7     = 1 << 7, // With IMG_COMPRESS: BC7 for RGB(A) images (better quality, twice the size of BC1)
+    IMG_LINEAR           = 1 << 8, // Data rather than sRGB colors (normals, masks...): mips are filtered without the sRGB conversion
 };
 
 namespace GL
@@ -54,6 +58,15 @@ namespace GL
         GL::wireframe_renderer Wireframe;
     };
 
+    // Image decoded on cpu (DecodeImage can be called from any thread)
+    struct image
+    {
+        uint8_t* Data;
+        int Width;
+        int Height;
+        int Channels;
+    };
+
     void UniformLight(GLuint Program, const char* LightUniformName, const light& Light);
     void UniformMaterial(GLuint Program, const char* MaterialUniformName, const material& Material);
     GLuint CompileShader(GLenum ShaderType, const char* ShaderStr, bool InjectLightShading = false);
@@ -61,8 +74,25 @@ namespace GL
     GLuint CreateProgram(const char* VSString, const char* FSString, bool InjectLightShading = false);
     GLuint CreateProgramEx(int VSStringsCount, const char** VSStrings, int FSStringCount, const char** FSString, bool InjectLightShading = false);
     const char* GetShaderStructsDefinitions();
+    // GLSL functions decoding compressed vertex attributes (octDecode)
+    const char* GetVertexDecodingFunctions();
+    // Enable and setup the attributes of the bound vertex buffer according to the layout (location -1 to skip an attribute)
+    void VertexAttribPointers(const vertex_layout& Layout, GLint PositionLocation, GLint UVLocation, GLint NormalLocation);
+    bool DecodeImage(image& Image, const char* Filename, int ImageFlags = 0);
+    // Decode Count images at once on the job threads, false if one of them failed (its Data is null, the others are decoded)
+    bool DecodeImages(image* Images, const char* const* Filenames, int Count, int ImageFlags = 0);
+    void FreeImage(image& Image);
+    void UploadImage(GLenum Target, const image& Image);
+    // Every face and level of a cooked texture, Target is GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP (no decoding nor glGenerateMipmap)
+    void UploadCookedTexture(GLenum Target, const cooked_texture& Texture);
+    // Block compressed formats the context can sample (BC1/BC3 and BC7 depend on extensions)
+    bool IsTextureFormatSupported(texture_format Format);
+    // Every face and level of a DDS or KTX file with glCompressedTexImage2D, Target is GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+    void UploadCompressedTexture(GLenum Target, const compressed_texture& Texture);
     void UploadTexture(const char* Filename, int ImageFlags = 0, int* WidthOut = nullptr, int* HeightOut = nullptr);
     void UploadCubemapTexture(const char* Filename, int face, int ImageFlags = 0, int* WidthOut = nullptr, int* HeightOut = nullptr);
+    // Six faces in GL order (+X, -X, +Y, -Y, +Z, -Z) decoded together with DecodeImages, mipmaps generated once
+    void UploadCubemapTextures(const char* const* Faces, int ImageFlags = 0, int* SizeOut = nullptr);
     void UploadCheckerboardTexture(int Width, int Height, int SquareSize);
     void UploadBlankCubemapTexture(int Size, int face);
 }
@@ -0,0 +1,166 @@
+
+#include "opengl_helpers_buffer_pool.h"
+
+GL::buffer_pool::buffer_pool(int ElementSize, uint32_t PageCapacity, bool Growable)
+	: ElementSize(ElementSize), PageCapacity(PageCapacity), Growable(Growable)
+{
+}
+
+GL::buffer_pool::~buffer_pool()
+{
+	for (page& Page : this->Pages)
+		glDeleteBuffers(1, &Page.Buffer);
+}
+
+bool GL::buffer_pool::Allocate(buffer_range& Range, uint32_t Count, const void* Data)
+{
+	Range = {};
+	if (Count == 0)
+		return false;
+
+	// First page with a free range large enough
+	int PageIndex = -1;
+	uint32_t Offset = offset_allocator::INVALID_OFFSET;
+	for (int i = 0; i < (int)this->Pages.size() && Offset == offset_allocator::INVALID_OFFSET; ++i)
+	{
+		Offset = this->Pages[i].Allocator.Allocate(Count);
+		PageIndex = i;
+	}
+
+	// Growable pools double their page (the end of the page is free after growing by Count)
+	if (Offset == offset_allocator::INVALID_OFFSET && this->Growable && !this->Pages.empty())
+	{
+		page& Page = this->Pages[0];
+		GrowPage(Page, Page.Capacity + (Count > Page.Capacity ? Count : Page.Capacity));
+		Offset = Page.Allocator.Allocate(Count);
+		PageIndex = 0;
+	}
+
+	// New page (GL_COPY_WRITE_BUFFER leaves the vertex array and array buffer bindings untouched)
+	if (Offset == offset_allocator::INVALID_OFFSET)
+	{
+		page Page = {};
+		uint32_t Capacity = Count > this->PageCapacity ? Count : this->PageCapacity;
+		glGenBuffers(1, &Page.Buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Page.Buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)Capacity * this->ElementSize, nullptr, GL_STATIC_DRAW);
+		Page.Capacity = Capacity;
+		Page.Allocator.Init(Capacity);
+		Offset = Page.Allocator.Allocate(Count);
+		PageIndex = (int)this->Pages.size();
+		this->Pages.push_back(Page);
+	}
+
+	Range.Buffer = this->Pages[PageIndex].Buffer;
+	Range.Page = PageIndex;
+	Range.Offset = Offset;
+	Range.Count = Count;
+
+	if (Data)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Range.Buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)Offset * this->ElementSize, (GLsizeiptr)Count * this->ElementSize, Data);
+	}
+	return true;
+}
+
+void GL::buffer_pool::GrowPage(page& Page, uint32_t Capacity)
+{
+	// The content goes through a temporary buffer while the page gets its new storage
+	GLsizeiptr Size = (GLsizeiptr)Page.Capacity * this->ElementSize;
+	GLuint TmpBuffer = 0;
+	glGenBuffers(1, &TmpBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, TmpBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, Size, nullptr, GL_STREAM_COPY);
+	glBindBuffer(GL_COPY_READ_BUFFER, Page.Buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, Size);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, Page.Buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)Capacity * this->ElementSize, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, TmpBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, Size);
+	glDeleteBuffers(1, &TmpBuffer);
+
+	Page.Capacity = Capacity;
+	Page.Allocator.Grow(Capacity);
+}
+
+void GL::buffer_pool::Write(const buffer_range& Range, const void* Data, size_t Size) const
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, Range.Buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)Range.Offset * this->ElementSize, (GLsizeiptr)Size, Data);
+}
+
+void* GL::buffer_pool::Map(const buffer_range& Range) const
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, Range.Buffer);
+	return glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)Range.Offset * this->ElementSize, (GLsizeiptr)Range.Count * this->ElementSize,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+bool GL::buffer_pool::Unmap() const
+{
+	return glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+}
+
+void GL::buffer_pool::Free(const buffer_range& Range)
+{
+	if (Range.Count == 0 || Range.Page >= (int)this->Pages.size())
+		return;
+	this->Pages[Range.Page].Allocator.Free(Range.Offset);
+}
+
+void GL::buffer_pool::Defragment(std::vector<buffer_move>& Moves)
+{
+	Moves.clear();
+
+	for (int PageIndex = 0; PageIndex < (int)this->Pages.size(); ++PageIndex)
+	{
+		page& Page = this->Pages[PageIndex];
+		Page.Allocator.Defragment(this->AllocatorMoves);
+		if (this->AllocatorMoves.empty())
+			continue;
+
+		// Moved ranges end up contiguous but can overlap their source:
+		// gather them in a temporary buffer, then copy them back in one go
+		uint32_t FirstOffset = this->AllocatorMoves.front().DstOffset;
+		const offset_allocator_move& Last = this->AllocatorMoves.back();
+		uint32_t MovedCount = Last.DstOffset + Last.Size - FirstOffset;
+
+		GLuint TmpBuffer = 0;
+		glGenBuffers(1, &TmpBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, TmpBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)MovedCount * this->ElementSize, nullptr, GL_STREAM_COPY);
+		glBindBuffer(GL_COPY_READ_BUFFER, Page.Buffer);
+		for (const offset_allocator_move& Move : this->AllocatorMoves)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				(GLintptr)Move.SrcOffset * this->ElementSize, (GLintptr)(Move.DstOffset - FirstOffset) * this->ElementSize, (GLsizeiptr)Move.Size * this->ElementSize);
+			Moves.push_back({ PageIndex, Move.SrcOffset, Move.DstOffset });
+		}
+
+		glBindBuffer(GL_COPY_READ_BUFFER, TmpBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Page.Buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (GLintptr)FirstOffset * this->ElementSize, (GLsizeiptr)MovedCount * this->ElementSize);
+		glDeleteBuffers(1, &TmpBuffer);
+	}
+}
+
+offset_allocator_stats GL::buffer_pool::GetStats() const
+{
+	offset_allocator_stats Stats = {};
+	for (const page& Page : this->Pages)
+	{
+		offset_allocator_stats PageStats = Page.Allocator.GetStats();
+		Stats.Capacity += PageStats.Capacity;
+		Stats.UsedSize += PageStats.UsedSize;
+		Stats.FreeSize += PageStats.FreeSize;
+		Stats.AllocationCount += PageStats.AllocationCount;
+		Stats.FreeRangeCount += PageStats.FreeRangeCount;
+		if (PageStats.LargestFreeRange > Stats.LargestFreeRange)
+			Stats.LargestFreeRange = PageStats.LargestFreeRange;
+	}
+	if (Stats.FreeSize > 0)
+		Stats.Fragmentation = 1.f - (float)Stats.LargestFreeRange / (float)Stats.FreeSize;
+	return Stats;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "opengl_headers.h"
+#include "offset_allocator.h"
+
+namespace GL
+{
+	// Elements [Offset;Offset+Count) of one of the buffers of a buffer_pool
+	struct buffer_range
+	{
+		GLuint Buffer;
+		int Page;
+		uint32_t Offset;
+		uint32_t Count;
+	};
+
+	// Range moved inside its page by buffer_pool::Defragment
+	struct buffer_move
+	{
+		int Page;
+		uint32_t SrcOffset;
+		uint32_t DstOffset;
+	};
+
+	// A few big gpu buffers suballocated with offset_allocator, so many meshes can be drawn from one buffer/VAO
+	// Pages are created when needed, an allocation bigger than a page gets its own page
+	// Growable pools keep a single page instead: its storage is reallocated when full under the same buffer name,
+	// so the vertex arrays sourcing it stay valid
+	class buffer_pool
+	{
+	public:
+		buffer_pool(int ElementSize, uint32_t PageCapacity, bool Growable = false);
+		~buffer_pool();
+
+		// Data can be null (range left uninitialized)
+		bool Allocate(buffer_range& Range, uint32_t Count, const void* Data);
+		void Free(const buffer_range& Range);
+
+		// Write Size bytes at the start of Range (GL_COPY_WRITE_BUFFER, the vertex array bindings are left untouched)
+		void Write(const buffer_range& Range, const void* Data, size_t Size) const;
+		// Write only mapping of Range (null on failure), Unmap is false when the content was lost while mapped
+		void* Map(const buffer_range& Range) const;
+		bool Unmap() const;
+
+		// Pack the ranges of each page at its start (gpu copies, buffer names are kept)
+		// Moves lists the ranges whose offset changed
+		void Defragment(std::vector<buffer_move>& Moves);
+
+		// Summed over the pages (the largest free range is the largest of all pages)
+		offset_allocator_stats GetStats() const;
+		int GetPageCount() const { return (int)Pages.size(); }
+
+	private:
+		struct page
+		{
+			GLuint Buffer;
+			uint32_t Capacity;
+			offset_allocator Allocator;
+		};
+
+		void GrowPage(page& Page, uint32_t Capacity);
+
+		int ElementSize;
+		uint32_t PageCapacity;
+		bool Growable;
+		std::vector<page> Pages;
+		std::vector<offset_allocator_move> AllocatorMoves;
+	};
+}
@@ -1,70 +1,1511 @@
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <tuple>
+
 #include "opengl_helpers.h"
+#include "platform.h"
+#include "jobs.h"
+#include "mesh_clusters.h"
+#include "mesh_simplifier.h"
+#include "texture_mips.h"
 
 #include "opengl_helpers_cache.h"
 
+// Texture file uploaded without decoding: cooked levels (.tex), or block compressed (cooked .dds/.ktx, or compressed cache)
+struct mapped_texture
+{
+	cooked_texture Cooked;
+	compressed_texture Compressed;
+};
+
+static void UnmapTexture(mapped_texture& Texture)
+{
+	Cook::UnmapCookedTexture(Texture.Cooked);
+	Texture::UnmapCompressedTexture(Texture.Compressed);
+}
+
+// Level of a texture streamed through the upload ring (pitches are 0 for compressed levels)
+struct stream_level
+{
+	int Width;
+	int Height;
+	const uint8_t* Source;
+	size_t SourcePitch;
+	size_t RowSize; // In the block, aligned on 4 bytes (the default GL_UNPACK_ALIGNMENT)
+	size_t Offset;  // In the block
+	size_t Size;
+};
+
+// Levels of an async texture, copied into an upload block by a worker then uploaded from it
+struct texture_stream
+{
+	std::vector<stream_level> Levels;
+	GLenum Format;
+	bool Compressed;
+	int MaxLevel; // GL_TEXTURE_MAX_LEVEL of cooked and compressed textures, -1 for decoded images
+	bool GenerateMipmaps;
+	size_t Size;
+	GL::upload_block Block;
+	bool Staged; // Levels copied into Block
+};
+
+// Asset decoded on a worker thread, waiting for its gpu upload
+struct GL::cache::upload_request
+{
+	upload_request* Next;
+	std::string Filename;
+	bool Success;
+
+	// Mesh
+	mesh* Mesh;
+	float Scale;
+	mapped_mesh MappedMesh;
+	vertex_layout Layout;
+	std::vector<uint8_t> EncodedVertices;
+	const void* Vertices;
+	vertex_encoding_error EncodingError;
+	int MeshFlags;
+	mesh_bvh Bvh;
+
+	// Texture
+	int Texture = -1; // In cache::Textures
+	int ImageFlags;
+	uint64_t ContentHash;
+	image Image;
+	mapped_texture MappedTexture; // Used instead of Image when the texture was cooked or compressed
+	texture_stream Stream;
+};
+
+// Vertices per shared vertex buffer (8 MB of vertex_full), bigger .obj get their own buffer
+const uint32_t VERTEX_POOL_PAGE_CAPACITY = 256 * 1024;
+// Initial size of the mesh pools (vertices per stride, 32 bits index units), doubled when full
+const uint32_t MESH_VERTEX_POOL_CAPACITY = 64 * 1024;
+const uint32_t MESH_INDEX_POOL_CAPACITY = 256 * 1024;
+// Staging memory of the async texture uploads (a 2048x2048 RGBA mip chain is 22 MB), bigger textures are uploaded directly
+const size_t TEXTURE_UPLOAD_RING_SIZE = 64 * 1024 * 1024;
+
 GL::cache::cache()
+	: VertexPool(sizeof(vertex_full), VERTEX_POOL_PAGE_CAPACITY), IndexPool(sizeof(uint32_t), MESH_INDEX_POOL_CAPACITY, true), ContentCount(0), TextureClock(0), TextureStats(), SupportedFormats(0),
+	  UploadQueue(nullptr), DecodingCount(0), PendingCount(0), UploadRing(TEXTURE_UPLOAD_RING_SIZE)
 {
+	this->TextureStats.BudgetBytes = TEXTURE_CACHE_DEFAULT_BUDGET;
+	for (int Format = TEXTURE_BC1; Format <= TEXTURE_BC7; ++Format)
+		this->SupportedFormats |= GL::IsTextureFormatSupported((texture_format)Format) ? 1 << Format : 0;
+
+	if (Cook::LoadManifest(this->Manifest, COOKED_MANIFEST_FILENAME))
+		printf("Cooked assets: %d (%s)\n", (int)this->Manifest.Assets.size(), COOKED_MANIFEST_FILENAME);
 }
 
 GL::cache::~cache()
 {
-	for (const auto& KeyValue : this->TextureMap)
-		glDeleteTextures(1, &KeyValue.second.TextureID);
+	// Wait for the workers before releasing the decoded assets
+	while (this->DecodingCount > 0)
+		std::this_thread::yield();
 
-	for (const auto& KeyValue : this->VertexBufferMap)
-		glDeleteBuffers(1, &KeyValue.second.VertexBuffer);
+	for (upload_request* Request = this->UploadQueue.exchange(nullptr); Request; )
+	{
+		upload_request* Next = Request->Next;
+		this->PendingUploads.push_back(Request);
+		Request = Next;
+	}
+	for (upload_request* Request : this->PendingUploads)
+	{
+		Mesh::UnmapObj(Request->MappedMesh);
+		if (Request->Image.Data)
+			GL::FreeImage(Request->Image);
+		UnmapTexture(Request->MappedTexture);
+		delete Request;
+	}
+
+	// Mesh buffers are released with their pools
+	for (const texture& Texture : this->Textures)
+		glDeleteTextures(1, &Texture.TextureID);
 }
 
-GLuint GL::cache::LoadObj(const char* Filename, float Scale, int* VertexCountOut)
+const GL::vertex_range* GL::cache::LoadObj(const char* Filename, float Scale)
 {
 	auto Found = this->VertexBufferMap.find(Filename);
 	if (Found != this->VertexBufferMap.end())
 	{
-		if (VertexCountOut)
-			*VertexCountOut = Found->second.Size;
-		return Found->second.VertexBuffer;
+		Found->second.RefCount++;
+		return &Found->second.Range;
 	}
 
 	this->TmpBuffer.clear();
 	Mesh::LoadObjNoConvertion(this->TmpBuffer, Filename, Scale);
 
-	// Upload mesh to gpu
-	GLuint MeshBuffer = 0;
-	glGenBuffers(1, &MeshBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, MeshBuffer);
-	glBufferData(GL_ARRAY_BUFFER, this->TmpBuffer.size() * sizeof(vertex_full), &this->TmpBuffer[0], GL_STATIC_DRAW);
+	// Upload mesh to gpu (in a free range of the shared vertex buffers)
+	vertex_buffer& VertexBuffer = this->VertexBufferMap[Filename];
+	VertexBuffer = {};
+	VertexBuffer.RefCount = 1;
+	if (this->VertexPool.Allocate(VertexBuffer.Allocation, (uint32_t)this->TmpBuffer.size(), this->TmpBuffer.data()))
+	{
+		VertexBuffer.Range.VertexBuffer = VertexBuffer.Allocation.Buffer;
+		VertexBuffer.Range.BaseVertex = (int)VertexBuffer.Allocation.Offset;
+		VertexBuffer.Range.VertexCount = (int)VertexBuffer.Allocation.Count;
+	}
+
+	return &VertexBuffer.Range;
+}
+
+void GL::cache::ReleaseObj(const char* Filename)
+{
+	auto Found = this->VertexBufferMap.find(Filename);
+	if (Found == this->VertexBufferMap.end() || --Found->second.RefCount > 0)
+		return;
+
+	this->VertexPool.Free(Found->second.Allocation);
+	this->VertexBufferMap.erase(Found);
+}
+
+void GL::cache::DefragmentVertexBuffers()
+{
+	this->VertexPool.Defragment(this->VertexMoves);
+
+	for (const buffer_move& Move : this->VertexMoves)
+	{
+		for (auto& KeyValue : this->VertexBufferMap)
+		{
+			vertex_buffer& VertexBuffer = KeyValue.second;
+			if (VertexBuffer.Allocation.Page == Move.Page && VertexBuffer.Allocation.Offset == Move.SrcOffset && VertexBuffer.Allocation.Count > 0)
+			{
+				VertexBuffer.Allocation.Offset = Move.DstOffset;
+				VertexBuffer.Range.BaseVertex = (int)Move.DstOffset;
+				break;
+			}
+		}
+	}
+
+	// Meshes: their vertices in the pool of their stride, then their indices
+	for (auto& StridePool : this->MeshVertexPools)
+	{
+		StridePool.second.Defragment(this->VertexMoves);
+		for (const buffer_move& Move : this->VertexMoves)
+		{
+			for (auto& KeyValue : this->MeshMap)
+			{
+				mesh& Mesh = KeyValue.second;
+				if (Mesh.Layout.Stride == StridePool.first && Mesh.VertexAllocation.Count > 0 && Mesh.VertexAllocation.Offset == Move.SrcOffset)
+				{
+					Mesh.VertexAllocation.Offset = Move.DstOffset;
+					Mesh.BaseVertex = (int)Move.DstOffset;
+					break;
+				}
+			}
+		}
+	}
+
+	this->IndexPool.Defragment(this->VertexMoves);
+	for (const buffer_move& Move : this->VertexMoves)
+	{
+		for (auto& KeyValue : this->MeshMap)
+		{
+			mesh& Mesh = KeyValue.second;
+			if (Mesh.IndexAllocation.Count > 0 && Mesh.IndexAllocation.Offset == Move.SrcOffset)
+			{
+				int IndexSize = Mesh.IndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+				Mesh.IndexAllocation.Offset = Move.DstOffset;
+				Mesh.FirstIndex = (int)(Move.DstOffset * sizeof(uint32_t) / IndexSize);
+				break;
+			}
+		}
+	}
+}
+
+offset_allocator_stats GL::cache::GetVertexBufferStats() const
+{
+	offset_allocator_stats Stats = this->VertexPool.GetStats();
+	for (const auto& StridePool : this->MeshVertexPools)
+	{
+		offset_allocator_stats PoolStats = StridePool.second.GetStats();
+		Stats.Capacity += PoolStats.Capacity;
+		Stats.UsedSize += PoolStats.UsedSize;
+		Stats.FreeSize += PoolStats.FreeSize;
+		Stats.AllocationCount += PoolStats.AllocationCount;
+		Stats.FreeRangeCount += PoolStats.FreeRangeCount;
+		if (PoolStats.LargestFreeRange > Stats.LargestFreeRange)
+			Stats.LargestFreeRange = PoolStats.LargestFreeRange;
+	}
+	Stats.Fragmentation = Stats.FreeSize > 0 ? 1.f - (float)Stats.LargestFreeRange / (float)Stats.FreeSize : 0.f;
+	return Stats;
+}
+
+// Cooked mesh cache when listed in the manifest (no source hashing), MapObj otherwise
+static bool MapMesh(mapped_mesh& MappedMesh, const cooked_manifest& Manifest, const char* Filename)
+{
+	const char* Cooked = Cook::FindCooked(Manifest, COOKED_MESH, Filename, 0);
+	if (Cooked && Mesh::MapObjCache(MappedMesh, Cooked))
+	{
+		printf("Loaded cooked mesh: %s (%d vertices, %d indices)\n", Filename, MappedMesh.VertexCount, MappedMesh.IndexCount);
+		return true;
+	}
+	return Mesh::MapObj(MappedMesh, Filename);
+}
+
+// Cooked file of a texture or cubemap listed in the manifest (.tex levels, or block compressed .dds/.ktx)
+// Compressed files in a format the context can't sample are skipped (the sources are decoded instead)
+static bool MapCookedTexture(mapped_texture& Texture, const cooked_manifest& Manifest, cooked_asset_type Type, const char* Filename, int ImageFlags, int SupportedFormats)
+{
+	Texture = {};
+	int FaceCount = Type == COOKED_CUBEMAP ? 6 : 1;
+	const char* Cooked = Cook::FindCooked(Manifest, Type, Filename, ImageFlags);
+	if (Cooked && Texture::IsCompressedTextureFile(Cooked))
+	{
+		if (!Texture::MapCompressedTexture(Texture.Compressed, Cooked))
+			return false;
+		if (Texture.Compressed.FaceCount == FaceCount && (SupportedFormats & (1 << Texture.Compressed.Format)))
+			return true;
+		Texture::UnmapCompressedTexture(Texture.Compressed);
+		return false;
+	}
+
+	if (Cooked == nullptr || !Cook::MapCookedTexture(Texture.Cooked, Cooked))
+		return false;
+
+	if ((int)Texture.Cooked.Header->FaceCount != FaceCount)
+	{
+		Cook::UnmapCookedTexture(Texture.Cooked);
+		return false;
+	}
+	return true;
+}
+
+// Sources not cooked: their cache, built on the first load
+// IMG_COMPRESS: compressed levels (see Texture::MapCompressedCache), IMG_GEN_MIPMAPS: mip chain filtered on the cpu (see Cook::MapTextureCache)
+// The other textures are decoded (and glGenerateMipmap is the fallback when a cache can't be written)
+// Images: the sources already decoded by the caller (nullptr: decoded here if a cache is built). Build false only maps the caches up to date
+static bool MapTextureCache(mapped_texture& Texture, const char* const* Filenames, int FaceCount, int ImageFlags, uint64_t SourceHash, int SupportedFormats,
+                            const GL::image* Images = nullptr, bool Build = true)
+{
+	Texture = {};
+	if (SourceHash == 0)
+		return false;
+
+	if (ImageFlags & IMG_COMPRESS)
+	{
+		bool Compressed = Build ? Texture::MapCompressedCache(Texture.Compressed, Filenames, FaceCount, ImageFlags, SourceHash, Images)
+		                        : Texture::MapValidCompressedCache(Texture.Compressed, Filenames[0], FaceCount, ImageFlags, SourceHash);
+		if (!Compressed)
+			return false;
+		if (SupportedFormats & (1 << Texture.Compressed.Format))
+			return true;
+		Texture::UnmapCompressedTexture(Texture.Compressed);
+	}
+
+	// Also when the compressed format isn't supported
+	if (!(ImageFlags & IMG_GEN_MIPMAPS))
+		return false;
+	return Build ? Cook::MapTextureCache(Texture.Cooked, Filenames, FaceCount, ImageFlags, SourceHash, Images)
+	             : Cook::MapValidTextureCache(Texture.Cooked, Filenames[0], FaceCount, ImageFlags, SourceHash);
+}
+
+static const file_mapping& GetTextureMapping(const mapped_texture& Texture)
+{
+	return Texture.Compressed.Mapping.Data ? Texture.Compressed.Mapping : Texture.Cooked.Mapping;
+}
+
+// Target is bound, Height is not written for cubemaps
+static void UploadMappedTexture(GLenum Target, const mapped_texture& Texture, int* Width, int* Height)
+{
+	if (Texture.Compressed.Mapping.Data)
+	{
+		GL::UploadCompressedTexture(Target, Texture.Compressed);
+		*Width = Texture.Compressed.Width;
+		if (Height) *Height = Texture.Compressed.Height;
+	}
+	else
+	{
+		GL::UploadCookedTexture(Target, Texture.Cooked);
+		*Width = (int)Texture.Cooked.Header->Width;
+		if (Height) *Height = (int)Texture.Cooked.Header->Height;
+	}
+}
+
+// Levels of a decoded or mapped 2D texture, laid out in an upload block
+static void PrepareStream(texture_stream& Stream, const mapped_texture& Texture, const GL::image& Image, int ImageFlags)
+{
+	const GLenum GLImageFormat[] = { 0, GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+	Stream = {};
+	Stream.MaxLevel = -1;
+	if (Texture.Compressed.Mapping.Data)
+	{
+		const compressed_texture& Compressed = Texture.Compressed;
+		Stream.Format = (GLenum)Texture::GetGLFormat(Compressed.Format);
+		Stream.Compressed = true;
+		Stream.MaxLevel = Compressed.LevelCount - 1;
+		for (int Level = 0; Level < Compressed.LevelCount; ++Level)
+		{
+			stream_level Stored = {};
+			Stored.Width = Math::Max(Compressed.Width >> Level, 1);
+			Stored.Height = Math::Max(Compressed.Height >> Level, 1);
+			Stored.Source = Compressed.Levels[0][Level];
+			Stored.Size = Texture::GetCompressedSize(Compressed.Format, Stored.Width, Stored.Height);
+			Stream.Levels.push_back(Stored);
+		}
+	}
+	else if (Texture.Cooked.Mapping.Data)
+	{
+		const cooked_texture_header& Header = *Texture.Cooked.Header;
+		Stream.Format = GLImageFormat[Header.Channels];
+		Stream.MaxLevel = (int)Header.LevelCount - 1;
+		for (int Level = 0; Level < (int)Header.LevelCount; ++Level)
+		{
+			stream_level Stored = {};
+			Stored.Source = Cook::GetCookedLevel(Texture.Cooked, 0, Level, &Stored.Width, &Stored.Height);
+			Stored.RowSize = (size_t)Texture::GetMipRowSize(Stored.Width, (int)Header.Channels);
+			Stored.SourcePitch = Stored.RowSize;
+			Stored.Size = Stored.RowSize * Stored.Height;
+			Stream.Levels.push_back(Stored);
+		}
+	}
+	else
+	{
+		stream_level Stored = {};
+		Stored.Width = Image.Width;
+		Stored.Height = Image.Height;
+		Stored.Source = Image.Data;
+		Stored.SourcePitch = (size_t)Image.Width * Image.Channels;
+		Stored.RowSize = (Stored.SourcePitch + 3) & ~(size_t)3;
+		Stored.Size = Stored.RowSize * Stored.Height;
+		Stream.Format = GLImageFormat[Image.Channels];
+		Stream.GenerateMipmaps = (ImageFlags & IMG_GEN_MIPMAPS) != 0;
+		Stream.Levels.push_back(Stored);
+	}
+
+	for (stream_level& Stored : Stream.Levels)
+	{
+		Stored.Offset = Stream.Size;
+		Stream.Size += (Stored.Size + 15) & ~(size_t)15;
+	}
+}
+
+// Worker side: the mapped block is plain memory until the GL thread binds it
+static void WriteStream(const texture_stream& Stream)
+{
+	for (const stream_level& Stored : Stream.Levels)
+	{
+		uint8_t* Destination = Stream.Block.Data + Stored.Offset;
+		if (Stored.SourcePitch == Stored.RowSize)
+		{
+			memcpy(Destination, Stored.Source, Stored.Size);
+			continue;
+		}
+		for (int y = 0; y < Stored.Height; ++y)
+			memcpy(Destination + y * Stored.RowSize, Stored.Source + y * Stored.SourcePitch, Stored.SourcePitch);
+	}
+}
+
+// Target is bound: the pixels are read from the bound pixel buffer, the calls return before the copy
+static void UploadStream(GL::upload_ring& UploadRing, const texture_stream& Stream, GLenum Target)
+{
+	// Storage first, with no pixel buffer bound (a null pointer would be offset 0 of the buffer)
+	if (!Stream.Compressed)
+	{
+		for (int Level = 0; Level < (int)Stream.Levels.size(); ++Level)
+		{
+			const stream_level& Stored = Stream.Levels[Level];
+			glTexImage2D(Target, Level, (GLint)Stream.Format, Stored.Width, Stored.Height, 0, Stream.Format, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+
+	uintptr_t Base = UploadRing.Bind(Stream.Block);
+	for (int Level = 0; Level < (int)Stream.Levels.size(); ++Level)
+	{
+		const stream_level& Stored = Stream.Levels[Level];
+		const void* Pixels = (const void*)(Base + Stored.Offset);
+		if (Stream.Compressed)
+			glCompressedTexImage2D(Target, Level, Stream.Format, Stored.Width, Stored.Height, 0, (GLsizei)Stored.Size, Pixels);
+		else
+			glTexSubImage2D(Target, Level, 0, 0, Stored.Width, Stored.Height, Stream.Format, GL_UNSIGNED_BYTE, Pixels);
+	}
+	UploadRing.Release(Stream.Block);
+
+	if (Stream.GenerateMipmaps)
+		glGenerateMipmap(Target);
+	else if (Stream.MaxLevel >= 0)
+		glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, Stream.MaxLevel);
+}
+
+// Read one byte per page so that the disk reads happen on the calling thread
+static void TouchPages(const file_mapping& Mapping)
+{
+	const uint8_t* Bytes = (const uint8_t*)Mapping.Data;
+	volatile uint8_t Sum = 0;
+	for (size_t i = 0; i < Mapping.Size; i += 4096)
+		Sum += Bytes[i];
+}
+
+// Meshes loaded with different vertex layouts are cached separately
+static std::string GetMeshKey(const char* Filename, const vertex_layout& Layout)
+{
+	std::string Key = Filename;
+	if (!Mesh::IsFullVertexLayout(Layout))
+	{
+		Key += std::string("|") + Mesh::GetVertexFormatName(Layout.PositionFormat);
+		Key += std::string("|") + Mesh::GetVertexFormatName(Layout.NormalFormat);
+		Key += std::string("|") + Mesh::GetVertexFormatName(Layout.UVFormat);
+	}
+	return Key;
+}
+
+// Vertices in the mesh layout (points into the mapped cache when no conversion is needed)
+static const void* EncodeMeshVertices(std::vector<uint8_t>& Buffer, const vertex_layout& Layout, const mapped_mesh& MappedMesh, float Scale)
+{
+	// Quantized positions are rescaled with the bounds
+	bool ScalePositions = Scale != 1.f && Layout.PositionFormat == VERTEX_FORMAT_FLOAT;
+	if (Mesh::IsFullVertexLayout(Layout) && !ScalePositions)
+		return MappedMesh.Vertices;
+
+	Buffer.resize(MappedMesh.VertexCount * Layout.Stride);
+	if (!ScalePositions)
+	{
+		Mesh::EncodeVertices(Buffer.data(), Layout, MappedMesh.Vertices, MappedMesh.VertexCount, MappedMesh.BoundsMin, MappedMesh.BoundsMax);
+		return Buffer.data();
+	}
+
+	std::vector<vertex_full> Vertices(MappedMesh.Vertices, MappedMesh.Vertices + MappedMesh.VertexCount);
+	for (vertex_full& Vertex : Vertices)
+		Vertex.Position *= Scale;
+	Mesh::EncodeVertices(Buffer.data(), Layout, Vertices.data(), MappedMesh.VertexCount, MappedMesh.BoundsMin * Scale, MappedMesh.BoundsMax * Scale);
+	return Buffer.data();
+}
+
+// BVH of a mapped mesh at the scale of the GL::mesh
+static void LoadScaledBvh(mesh_bvh& Bvh, const char* Filename, const mapped_mesh& MappedMesh, float Scale)
+{
+	if (Mesh::LoadBvh(Bvh, Filename, MappedMesh) && Scale != 1.f)
+		Mesh::ScaleBvh(Bvh, Scale);
+}
+
+static void PrintEncodingError(const char* Filename, const vertex_layout& Layout, const vertex_encoding_error& Error, float Scale)
+{
+	printf("Vertex encoding: %s (%d bytes per vertex, max errors: position %.2e, normal %.3f deg, uv %.2e)\n",
+		Filename, Layout.Stride, Error.PositionMax * Scale, Error.NormalMax, Error.UVMax);
+}
+
+const GL::mesh* GL::cache::LoadMesh(const char* Filename, float Scale)
+{
+	return LoadMesh(Filename, Scale, Mesh::MakeVertexLayout(VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_FLOAT));
+}
+
+const GL::mesh* GL::cache::LoadMesh(const char* Filename, float Scale, const vertex_layout& Layout, int MeshFlags)
+{
+	std::string Key = GetMeshKey(Filename, Layout);
+	auto Found = this->MeshMap.find(Key);
+	if (Found != this->MeshMap.end())
+	{
+		// The cache is mapped again for the BVH
+		mesh& Mesh = Found->second;
+		mapped_mesh MappedMesh;
+		if ((MeshFlags & MESH_LOAD_BVH) && Mesh.Ready && Mesh.Bvh.Nodes.empty() && MapMesh(MappedMesh, this->Manifest, Filename))
+		{
+			LoadScaledBvh(Mesh.Bvh, Filename, MappedMesh, Scale);
+			Mesh::UnmapObj(MappedMesh);
+		}
+		return &Mesh;
+	}
+
+	mesh& Mesh = this->MeshMap[Key];
+	Mesh = {};
+	Mesh.Layout = Layout;
+
+	mapped_mesh MappedMesh;
+	if (!MapMesh(MappedMesh, this->Manifest, Filename) || MappedMesh.IndexCount == 0)
+	{
+		Mesh::UnmapObj(MappedMesh);
+		Mesh.Ready = true;
+		return &Mesh;
+	}
+
+	if (!Mesh::IsFullVertexLayout(Layout))
+	{
+		vertex_encoding_error Error = Mesh::MeasureEncodingError(Layout, MappedMesh.Vertices, MappedMesh.VertexCount, MappedMesh.BoundsMin, MappedMesh.BoundsMax);
+		PrintEncodingError(Filename, Layout, Error, Scale);
+	}
+
+	UploadMesh(Mesh, MappedMesh, EncodeMeshVertices(this->EncodedVertices, Layout, MappedMesh, Scale), Scale);
+	if (MeshFlags & MESH_LOAD_BVH)
+		LoadScaledBvh(Mesh.Bvh, Filename, MappedMesh, Scale);
+	Mesh::UnmapObj(MappedMesh);
+
+	return &Mesh;
+}
+
+// Single submesh without material covering every LOD of Mesh
+static mesh_submesh GetWholeSubmesh(const GL::mesh& Mesh)
+{
+	mesh_submesh Submesh = {};
+	for (int i = 0; i < Mesh.LodCount; ++i)
+	{
+		Submesh.FirstIndex[i] = Mesh.Lods[i].FirstIndex;
+		Submesh.IndexCount[i] = Mesh.Lods[i].IndexCount;
+	}
+	Submesh.MaterialId = -1;
+	return Submesh;
+}
+
+bool GL::cache::AllocateMesh(mesh& Mesh, int VertexCount, int IndexCount, GLenum IndexType)
+{
+	auto Found = this->MeshVertexPools.find(Mesh.Layout.Stride);
+	if (Found == this->MeshVertexPools.end())
+		Found = this->MeshVertexPools.emplace(std::piecewise_construct, std::forward_as_tuple(Mesh.Layout.Stride),
+			std::forward_as_tuple(Mesh.Layout.Stride, MESH_VERTEX_POOL_CAPACITY, true)).first;
+	buffer_pool& VertexPool = Found->second;
+
+	// Async meshes get their final ranges in the same buffers as their placeholder, so their vertex arrays stay valid
+	VertexPool.Free(Mesh.VertexAllocation);
+	this->IndexPool.Free(Mesh.IndexAllocation);
+	Mesh.VertexAllocation = {};
+	Mesh.IndexAllocation = {};
+
+	int IndexSize = IndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	uint32_t IndexUnits = (uint32_t)(((size_t)IndexCount * IndexSize + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+	if (!VertexPool.Allocate(Mesh.VertexAllocation, (uint32_t)VertexCount, nullptr) || !this->IndexPool.Allocate(Mesh.IndexAllocation, IndexUnits, nullptr))
+	{
+		VertexPool.Free(Mesh.VertexAllocation);
+		Mesh.VertexAllocation = {};
+		return false;
+	}
+
+	Mesh.VertexBuffer = Mesh.VertexAllocation.Buffer;
+	Mesh.IndexBuffer = Mesh.IndexAllocation.Buffer;
+	Mesh.IndexType = IndexType;
+	Mesh.BaseVertex = (int)Mesh.VertexAllocation.Offset;
+	Mesh.FirstIndex = (int)(Mesh.IndexAllocation.Offset * sizeof(uint32_t) / IndexSize);
+	return true;
+}
+
+void GL::cache::UploadMesh(mesh& Mesh, const mapped_mesh& MappedMesh, const void* Vertices, float Scale)
+{
+	Mesh.VertexCount = MappedMesh.VertexCount;
+	Mesh.IndexCount = MappedMesh.IndexCount;
+	Mesh.BoundsMin = MappedMesh.BoundsMin * Scale;
+	Mesh.BoundsMax = MappedMesh.BoundsMax * Scale;
+	Mesh.Ready = true;
+
+	// LODs are stored after the full resolution indices (already stored as 16 bits indices when possible)
+	Mesh.LodCount = MappedMesh.LodCount;
+	for (int i = 0; i < Mesh.LodCount; ++i)
+	{
+		Mesh.Lods[i] = MappedMesh.Lods[i];
+		Mesh.Lods[i].Error *= Scale;
+	}
+	const mesh_lod& LastLod = Mesh.Lods[Mesh.LodCount - 1];
+	int TotalIndexCount = (int)(LastLod.FirstIndex + LastLod.IndexCount);
+
+	// Upload vertices and indices to their ranges (vertices straight from the mapped cache when they are neither encoded nor rescaled)
+	GLenum IndexType = MappedMesh.IndexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	if (AllocateMesh(Mesh, Mesh.VertexCount, TotalIndexCount, IndexType))
+	{
+		this->MeshVertexPools.at(Mesh.Layout.Stride).Write(Mesh.VertexAllocation, Vertices, (size_t)Mesh.VertexCount * Mesh.Layout.Stride);
+		this->IndexPool.Write(Mesh.IndexAllocation, MappedMesh.Indices, (size_t)TotalIndexCount * MappedMesh.IndexSize);
+	}
+	else
+		fprintf(stderr, "No room for mesh in the shared buffers (%d vertices, %d indices)\n", Mesh.VertexCount, TotalIndexCount);
+
+	Mesh.Clusters.assign(MappedMesh.Clusters, MappedMesh.Clusters + MappedMesh.ClusterCount);
+	for (mesh_cluster& Cluster : Mesh.Clusters)
+	{
+		Cluster.Center *= Scale;
+		Cluster.Radius *= Scale;
+	}
+
+	Mesh.Submeshes.assign(MappedMesh.Submeshes, MappedMesh.Submeshes + MappedMesh.SubmeshCount);
+	if (Mesh.Submeshes.empty())
+		Mesh.Submeshes.push_back(GetWholeSubmesh(Mesh));
+	Mesh.Materials.assign(MappedMesh.Materials, MappedMesh.Materials + MappedMesh.MaterialCount);
+}
+
+// Primitives built with different tessellations or vertex formats are cached separately
+static std::string GetPrimitiveKey(GL::primitive_shape Shape, const vertex_descriptor& Descriptor, int Lon, int Lat)
+{
+	char Key[128];
+	snprintf(Key, sizeof(Key), "primitive|%d|%dx%d|%d|%d|%d|%d", (int)Shape, Lon, Lat, Descriptor.Stride, Descriptor.PositionOffset,
+		Descriptor.HasNormal ? Descriptor.NormalOffset : -1, Descriptor.HasUV ? Descriptor.UVOffset : -1);
+	return Key;
+}
+
+const GL::mesh* GL::cache::LoadPrimitive(primitive_shape Shape, const vertex_descriptor& Descriptor, int Lon, int Lat)
+{
+	return GeneratePrimitive(Shape, Descriptor, Lon, Lat, &Mesh::ConvertVertices);
+}
+
+const GL::mesh* GL::cache::GeneratePrimitive(primitive_shape Shape, const vertex_descriptor& Descriptor, int Lon, int Lat, vertex_convert_proc Convert)
+{
+	if (Shape != PRIMITIVE_SPHERE)
+		Lon = Lat = 0;
+
+	std::string Key = GetPrimitiveKey(Shape, Descriptor, Lon, Lat);
+	auto Found = this->MeshMap.find(Key);
+	if (Found != this->MeshMap.end())
+		return &Found->second;
+
+	mesh& Mesh = this->MeshMap[Key];
+	Mesh = {};
+	if (Shape == PRIMITIVE_SPHERE && (Lon <= 0 || Lat <= 0))
+	{
+		fprintf(stderr, "Invalid sphere tessellation (%dx%d)\n", Lon, Lat);
+		return &Mesh;
+	}
+
+	// Generate the triangles once with full vertices, then weld them
+	int VertexCount = Shape == PRIMITIVE_SPHERE ? Lon * Lat * 6 : (Shape == PRIMITIVE_QUAD || Shape == PRIMITIVE_UNIT_QUAD) ? 6 : 36;
+	this->TmpBuffer.resize(VertexCount);
+	vertex_full* Begin = this->TmpBuffer.data();
+	vertex_full* End = Begin + VertexCount;
+	vertex_descriptor FullDescriptor = { sizeof(vertex_full), OFFSETOF(vertex_full, Position), true, OFFSETOF(vertex_full, Normal), true, OFFSETOF(vertex_full, UV) };
+	switch (Shape)
+	{
+	case PRIMITIVE_QUAD:            Mesh::BuildQuad(Begin, End, FullDescriptor); break;
+	case PRIMITIVE_UNIT_QUAD:       Mesh::BuildUnitQuad(Begin, End, FullDescriptor); break;
+	case PRIMITIVE_CUBE:            Mesh::BuildCube(Begin, End, FullDescriptor); break;
+	case PRIMITIVE_NORMALIZED_CUBE: Mesh::BuildNormalizedCube(Begin, End, FullDescriptor); break;
+	case PRIMITIVE_INVERTED_CUBE:   Mesh::BuildInvertedCube(Begin, End, FullDescriptor); break;
+	case PRIMITIVE_SPHERE:          Mesh::BuildSphere(Begin, End, FullDescriptor, Lon, Lat); break;
+	}
+
+	indexed_mesh Primitive;
+	Mesh::BuildIndexedMesh(Primitive, Begin, VertexCount);
+	Mesh.Lods[0] = { 0, (uint32_t)Primitive.Indices.size(), 0.f, 0 };
+	Mesh.LodCount = 1;
+	if (Shape == PRIMITIVE_SPHERE)
+		Mesh.LodCount = Mesh::BuildLods(Mesh.Lods, Primitive);
+	Mesh.Submeshes.assign(1, GetWholeSubmesh(Mesh));
+
+	Mesh.BoundsMin = Mesh.BoundsMax = Primitive.Vertices[0].Position;
+	for (const vertex_full& Vertex : Primitive.Vertices)
+	{
+		Mesh.BoundsMin = Vec3::Min(Mesh.BoundsMin, Vertex.Position);
+		Mesh.BoundsMax = Vec3::Max(Mesh.BoundsMax, Vertex.Position);
+	}
+
+	UploadPrimitive(Mesh, Primitive, Descriptor, Convert);
+	return &Mesh;
+}
+
+void GL::cache::UploadPrimitive(mesh& Mesh, const indexed_mesh& Primitive, const vertex_descriptor& Descriptor, vertex_convert_proc Convert)
+{
+	Mesh.Layout = {};
+	Mesh.Layout.Stride = Descriptor.Stride;
+	Mesh.Layout.PositionFormat = VERTEX_FORMAT_FLOAT;
+	Mesh.Layout.PositionOffset = Descriptor.PositionOffset;
+	Mesh.Layout.NormalFormat = Descriptor.HasNormal ? VERTEX_FORMAT_FLOAT : VERTEX_FORMAT_NONE;
+	Mesh.Layout.NormalOffset = Descriptor.NormalOffset;
+	Mesh.Layout.UVFormat = Descriptor.HasUV ? VERTEX_FORMAT_FLOAT : VERTEX_FORMAT_NONE;
+	Mesh.Layout.UVOffset = Descriptor.UVOffset;
+
+	const mesh_lod& LastLod = Mesh.Lods[Mesh.LodCount - 1];
+	int TotalIndexCount = (int)(LastLod.FirstIndex + LastLod.IndexCount);
+	Mesh.VertexCount = (int)Primitive.Vertices.size();
+	Mesh.IndexCount = (int)Mesh.Lods[0].IndexCount;
+	Mesh.Ready = true;
+	if (!AllocateMesh(Mesh, Mesh.VertexCount, TotalIndexCount, Mesh.VertexCount <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT))
+	{
+		fprintf(stderr, "No room for primitive in the shared buffers (%d vertices)\n", Mesh.VertexCount);
+		return;
+	}
+
+	// Vertices are converted to the demo format straight into the mapped range (no staging copy)
+	const buffer_pool& VertexPool = this->MeshVertexPools.at(Descriptor.Stride);
+	void* Vertices = VertexPool.Map(Mesh.VertexAllocation);
+	if (Vertices)
+	{
+		Convert(Vertices, Descriptor, Primitive.Vertices.data(), Mesh.VertexCount);
+		if (!VertexPool.Unmap())
+			fprintf(stderr, "Primitive vertex buffer lost while mapped\n");
+	}
+
+	// Same for the indices, narrowed to 16 bits when possible
+	void* Indices = this->IndexPool.Map(Mesh.IndexAllocation);
+	if (Indices)
+	{
+		if (Mesh.IndexType == GL_UNSIGNED_SHORT)
+			std::copy(Primitive.Indices.begin(), Primitive.Indices.begin() + TotalIndexCount, (uint16_t*)Indices);
+		else
+			std::copy(Primitive.Indices.begin(), Primitive.Indices.begin() + TotalIndexCount, (uint32_t*)Indices);
+		if (!this->IndexPool.Unmap())
+			fprintf(stderr, "Primitive index buffer lost while mapped\n");
+	}
+}
+
+const void* GL::GetIndexOffset(const mesh& Mesh, uint32_t Index)
+{
+	int IndexSize = Mesh.IndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	return (const void*)(((size_t)Mesh.FirstIndex + Index) * IndexSize);
+}
+
+int GL::DrawMeshClusters(const mesh& Mesh, const mat4& ModelViewProjection, v3 CameraPosition, bool BackfaceCulling)
+{
+	if (Mesh.Clusters.empty())
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, Mesh.IndexCount, Mesh.IndexType, GetIndexOffset(Mesh, 0), Mesh.BaseVertex);
+		return Mesh.IndexCount / 3;
+	}
+
+	// Draw lists reused from frame to frame (GL thread only)
+	static std::vector<uint32_t> FirstIndices;
+	static std::vector<int> IndexCounts;
+	static std::vector<const void*> IndexOffsets;
+	static std::vector<GLint> BaseVertices;
+
+	int TriangleCount = Mesh::CullClusters(FirstIndices, IndexCounts, Mesh.Clusters.data(), (int)Mesh.Clusters.size(), ModelViewProjection, CameraPosition, BackfaceCulling);
+
+	IndexOffsets.resize(FirstIndices.size());
+	for (size_t i = 0; i < FirstIndices.size(); ++i)
+		IndexOffsets[i] = GetIndexOffset(Mesh, FirstIndices[i]);
+	BaseVertices.assign(FirstIndices.size(), Mesh.BaseVertex);
+
+	if (!IndexOffsets.empty())
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, IndexCounts.data(), Mesh.IndexType, IndexOffsets.data(), (GLsizei)IndexOffsets.size(), BaseVertices.data());
+
+	return TriangleCount;
+}
+
+void GL::DrawMeshLod(const mesh& Mesh, int Lod)
+{
+	if (Mesh.LodCount == 0)
+		return;
+
+	const mesh_lod& MeshLod = Mesh.Lods[Math::Clamp(Lod, 0, Mesh.LodCount - 1)];
+	glDrawElementsBaseVertex(GL_TRIANGLES, MeshLod.IndexCount, Mesh.IndexType, GetIndexOffset(Mesh, MeshLod.FirstIndex), Mesh.BaseVertex);
+}
+
+void GL::DrawSubmesh(const mesh& Mesh, int Submesh, int Lod)
+{
+	if (Mesh.LodCount == 0 || Submesh < 0 || Submesh >= (int)Mesh.Submeshes.size())
+		return;
+
+	const mesh_submesh& MeshSubmesh = Mesh.Submeshes[Submesh];
+	Lod = Math::Clamp(Lod, 0, Mesh.LodCount - 1);
+	if (MeshSubmesh.IndexCount[Lod] == 0)
+		return;
+
+	glDrawElementsBaseVertex(GL_TRIANGLES, MeshSubmesh.IndexCount[Lod], Mesh.IndexType, GetIndexOffset(Mesh, MeshSubmesh.FirstIndex[Lod]), Mesh.BaseVertex);
+}
+
+static uint64_t HashTextureName(const char* Filename, int ImageFlags)
+{
+	return Texture::HashBytes(Filename, strlen(Filename), TEXTURE_HASH_SEED ^ (uint64_t)ImageFlags);
+}
+
+static uint64_t HashTextureContent(uint64_t ContentHash, int ImageFlags, GLenum Target)
+{
+	uint64_t Hash = (ContentHash ^ ((uint64_t)ImageFlags << 32 | Target)) * 0xff51afd7ed558ccdull;
+	return Hash ^ (Hash >> 32);
+}
+
+// Slot holding an index accepted by Match, or the empty slot ending the probe sequence
+template<typename slot, typename match>
+static size_t FindSlot(const std::vector<slot>& Slots, uint64_t Hash, match Match)
+{
+	size_t Mask = Slots.size() - 1;
+	size_t Slot = (size_t)Hash & Mask;
+	while (Slots[Slot].Index >= 0 && (Slots[Slot].Hash != Hash || !Match(Slots[Slot].Index)))
+		Slot = (Slot + 1) & Mask;
+	return Slot;
+}
+
+// Keeps the table at most half full
+template<typename slot>
+static void InsertSlot(std::vector<slot>& Slots, int Count, uint64_t Hash, int Index)
+{
+	if ((size_t)(Count + 1) * 2 > Slots.size())
+	{
+		std::vector<slot> Old;
+		Old.swap(Slots);
+		Slots.assign(std::max(Old.size() * 2, (size_t)16), { 0, -1 });
+		for (const slot& OldSlot : Old)
+		{
+			if (OldSlot.Index >= 0)
+				Slots[FindSlot(Slots, OldSlot.Hash, [](int) { return false; })] = OldSlot;
+		}
+	}
+	Slots[FindSlot(Slots, Hash, [](int) { return false; })] = { Hash, Index };
+}
+
+// Backward shift: the following slots of the probe sequence move up so that no search stops early
+template<typename slot>
+static void EraseSlot(std::vector<slot>& Slots, size_t Slot)
+{
+	size_t Mask = Slots.size() - 1;
+	for (size_t Next = (Slot + 1) & Mask; Slots[Next].Index >= 0; Next = (Next + 1) & Mask)
+	{
+		size_t Home = (size_t)Slots[Next].Hash & Mask;
+		if (((Next - Home) & Mask) >= ((Next - Slot) & Mask))
+		{
+			Slots[Slot] = Slots[Next];
+			Slot = Next;
+		}
+	}
+	Slots[Slot].Index = -1;
+}
+
+// Video memory of the bound texture from its level 0 (mips add a third, RGB8 is counted as RGBA8 like drivers store it)
+static uint64_t MeasureTextureBytes(GLenum Target)
+{
+	GLenum Face = Target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : Target;
+	GLint Width = 0, Height = 0, MipWidth = 0, Compressed = 0;
+	glGetTexLevelParameteriv(Face, 0, GL_TEXTURE_WIDTH, &Width);
+	glGetTexLevelParameteriv(Face, 0, GL_TEXTURE_HEIGHT, &Height);
+	glGetTexLevelParameteriv(Face, 1, GL_TEXTURE_WIDTH, &MipWidth);
+	glGetTexLevelParameteriv(Face, 0, GL_TEXTURE_COMPRESSED, &Compressed);
+
+	uint64_t Bytes;
+	if (Compressed)
+	{
+		GLint Size = 0;
+		glGetTexLevelParameteriv(Face, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &Size);
+		Bytes = (uint64_t)Size;
+	}
+	else
+	{
+		GLint Bits = 0;
+		const GLenum Channels[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE };
+		for (GLenum Channel : Channels)
+		{
+			GLint ChannelBits = 0;
+			glGetTexLevelParameteriv(Face, 0, Channel, &ChannelBits);
+			Bits += ChannelBits;
+		}
+		int TexelBytes = Bits / 8 == 3 ? 4 : Bits / 8;
+		Bytes = (uint64_t)Width * Height * TexelBytes;
+	}
+
+	if (MipWidth > 0)
+		Bytes += Bytes / 3;
+	return Target == GL_TEXTURE_CUBE_MAP ? Bytes * 6 : Bytes;
+}
+
+int GL::cache::FindTexture(const char* Filename, int ImageFlags) const
+{
+	if (this->NameSlots.empty())
+		return -1;
 
-	if (VertexCountOut)
-		*VertexCountOut = (int)this->TmpBuffer.size();
-	
-	this->VertexBufferMap[Filename] = { MeshBuffer, (int)this->TmpBuffer.size() };
+	size_t Slot = FindSlot(this->NameSlots, HashTextureName(Filename, ImageFlags), [&](int Name)
+	{
+		return this->TextureNames[Name].ImageFlags == ImageFlags && this->TextureNames[Name].Filename == Filename;
+	});
+	int Name = this->NameSlots[Slot].Index;
+	return Name >= 0 ? this->TextureNames[Name].Texture : -1;
+}
+
+int GL::cache::FindTextureContent(uint64_t ContentHash, int ImageFlags, GLenum Target) const
+{
+	if (this->ContentSlots.empty() || ContentHash == 0)
+		return -1;
+
+	size_t Slot = FindSlot(this->ContentSlots, HashTextureContent(ContentHash, ImageFlags, Target), [&](int Texture)
+	{
+		const texture& Other = this->Textures[Texture];
+		return Other.ContentHash == ContentHash && Other.ImageFlags == ImageFlags && Other.Target == Target;
+	});
+	return this->ContentSlots[Slot].Index;
+}
+
+GLuint GL::cache::UseTexture(int Texture, int* WidthOut, int* HeightOut)
+{
+	texture& Used = this->Textures[Texture];
+	Used.LastUse = ++this->TextureClock;
+	Used.RefCount++;
+	if (WidthOut)  *WidthOut  = Used.Width;
+	if (HeightOut) *HeightOut = Used.Height;
+	return Used.TextureID;
+}
+
+int GL::cache::AddTexture(const texture& Texture, const char* Filename)
+{
+	int Index;
+	if (!this->FreeTextures.empty())
+	{
+		Index = this->FreeTextures.back();
+		this->FreeTextures.pop_back();
+	}
+	else
+	{
+		Index = (int)this->Textures.size();
+		this->Textures.emplace_back();
+	}
+
+	texture& Added = this->Textures[Index];
+	Added = Texture;
+	Added.LastUse = ++this->TextureClock;
+	Added.RefCount = 1;
+	this->TextureStats.TextureCount++;
+	this->TextureStats.ResidentBytes += Added.Bytes;
 
-	return MeshBuffer;
+	AddTextureContent(Index);
+	AddTextureName(Filename, Texture.ImageFlags, Index);
+	return Index;
+}
+
+void GL::cache::AddTextureName(const char* Filename, int ImageFlags, int Texture)
+{
+	uint64_t Hash = HashTextureName(Filename, ImageFlags);
+	InsertSlot(this->NameSlots, (int)this->TextureNames.size(), Hash, (int)this->TextureNames.size());
+	this->TextureNames.push_back({ Filename, ImageFlags, Hash, Texture });
+}
+
+void GL::cache::AddTextureContent(int Texture)
+{
+	const texture& Added = this->Textures[Texture];
+	if (Added.ContentHash == 0 || FindTextureContent(Added.ContentHash, Added.ImageFlags, Added.Target) >= 0)
+		return;
+
+	InsertSlot(this->ContentSlots, this->ContentCount++, HashTextureContent(Added.ContentHash, Added.ImageFlags, Added.Target), Texture);
+}
+
+void GL::cache::RemoveTexture(int Texture)
+{
+	texture& Removed = this->Textures[Texture];
+	if (FindTextureContent(Removed.ContentHash, Removed.ImageFlags, Removed.Target) == Texture)
+	{
+		uint64_t Hash = HashTextureContent(Removed.ContentHash, Removed.ImageFlags, Removed.Target);
+		EraseSlot(this->ContentSlots, FindSlot(this->ContentSlots, Hash, [&](int Index) { return Index == Texture; }));
+		this->ContentCount--;
+	}
+
+	// Names of the texture, the last name is moved into each removed one
+	for (int Name = (int)this->TextureNames.size() - 1; Name >= 0; --Name)
+	{
+		if (this->TextureNames[Name].Texture != Texture)
+			continue;
+
+		EraseSlot(this->NameSlots, FindSlot(this->NameSlots, this->TextureNames[Name].Hash, [&](int Index) { return Index == Name; }));
+		int Last = (int)this->TextureNames.size() - 1;
+		if (Name != Last)
+		{
+			size_t LastSlot = FindSlot(this->NameSlots, this->TextureNames[Last].Hash, [&](int Index) { return Index == Last; });
+			this->NameSlots[LastSlot].Index = Name;
+			this->TextureNames[Name] = std::move(this->TextureNames[Last]);
+		}
+		this->TextureNames.pop_back();
+	}
+
+	glDeleteTextures(1, &Removed.TextureID);
+	this->TextureStats.TextureCount--;
+	this->TextureStats.ResidentBytes -= Removed.Bytes;
+	Removed = {};
+	this->FreeTextures.push_back(Texture);
+}
+
+void GL::cache::EvictTextures()
+{
+	while (this->TextureStats.ResidentBytes > this->TextureStats.BudgetBytes)
+	{
+		// Least recently used among the textures nobody holds (async loads hold theirs until uploaded)
+		int Oldest = -1;
+		for (int i = 0; i < (int)this->Textures.size(); ++i)
+		{
+			const texture& Texture = this->Textures[i];
+			if (Texture.TextureID != 0 && Texture.RefCount == 0 && Texture.Ready && (Oldest < 0 || Texture.LastUse < this->Textures[Oldest].LastUse))
+				Oldest = i;
+		}
+		if (Oldest < 0)
+			return;
+
+		RemoveTexture(Oldest);
+		this->TextureStats.Evictions++;
+	}
+}
+
+void GL::cache::ReleaseTexture(GLuint Texture)
+{
+	for (texture& Released : this->Textures)
+	{
+		if (Released.TextureID == Texture && Texture != 0)
+		{
+			if (Released.RefCount > 0 && --Released.RefCount == 0)
+				EvictTextures();
+			return;
+		}
+	}
+}
+
+void GL::cache::SetTextureBudget(uint64_t Bytes)
+{
+	this->TextureStats.BudgetBytes = Bytes;
+	EvictTextures();
 }
 
 GLuint GL::cache::LoadTexture(const char* Filename, int ImageFlags, int* WidthOut, int* HeightOut)
 {
-	texture_identifier TextureIdentifier = { Filename, ImageFlags };
-	
-	auto Found = this->TextureMap.find(TextureIdentifier);
-	if (Found != this->TextureMap.end())
+	int Found = FindTexture(Filename, ImageFlags);
+	if (Found >= 0)
 	{
-		if (WidthOut)  *WidthOut  = Found->second.Width;
-		if (HeightOut) *HeightOut = Found->second.Height;
-		return Found->second.TextureID;
+		this->TextureStats.Hits++;
+		return UseTexture(Found, WidthOut, HeightOut);
 	}
+	this->TextureStats.Misses++;
 
-	GLuint Texture;
-	glGenTextures(1, &Texture);
-	glBindTexture(GL_TEXTURE_2D, Texture);
-	int Width, Height;
-	GL::UploadTexture(Filename, ImageFlags, &Width, &Height);
+	// The cooked file or the source is hashed before anything is decoded
+	texture Texture = {};
+	Texture.Target = GL_TEXTURE_2D;
+	Texture.ImageFlags = ImageFlags;
+	Texture.Ready = true;
+	mapped_texture Mapped;
+	bool IsMapped = MapCookedTexture(Mapped, this->Manifest, COOKED_TEXTURE, Filename, ImageFlags, this->SupportedFormats);
+	if (IsMapped)
+		Texture.ContentHash = Texture::HashBytes(GetTextureMapping(Mapped).Data, GetTextureMapping(Mapped).Size);
+	else if (!Texture::HashFiles(&Filename, 1, &Texture.ContentHash))
+		Texture.ContentHash = 0;
+
+	int Shared = FindTextureContent(Texture.ContentHash, ImageFlags, GL_TEXTURE_2D);
+	if (Shared >= 0)
+	{
+		UnmapTexture(Mapped);
+		this->TextureStats.ContentHits++;
+		AddTextureName(Filename, ImageFlags, Shared);
+		return UseTexture(Shared, WidthOut, HeightOut);
+	}
 
-	if (WidthOut)  *WidthOut  = Width;
-	if (HeightOut) *HeightOut = Height;
+	if (!IsMapped)
+		IsMapped = MapTextureCache(Mapped, &Filename, 1, ImageFlags, Texture.ContentHash, this->SupportedFormats);
 
-	this->TextureMap[TextureIdentifier] = { Texture, Width, Height };
+	glGenTextures(1, &Texture.TextureID);
+	glBindTexture(GL_TEXTURE_2D, Texture.TextureID);
+	if (IsMapped)
+	{
+		UploadMappedTexture(GL_TEXTURE_2D, Mapped, &Texture.Width, &Texture.Height);
+		UnmapTexture(Mapped);
+	}
+	else
+	{
+		GL::UploadTexture(Filename, ImageFlags, &Texture.Width, &Texture.Height);
+	}
+	Texture.Bytes = MeasureTextureBytes(GL_TEXTURE_2D);
+
+	if (WidthOut)  *WidthOut  = Texture.Width;
+	if (HeightOut) *HeightOut = Texture.Height;
+
+	AddTexture(Texture, Filename);
+	EvictTextures();
+
+	return Texture.TextureID;
+}
+
+void GL::cache::LoadTextures(const char* const* Filenames, int Count, int ImageFlags, GLuint* TexturesOut)
+{
+	// Cached or cooked textures are loaded as usual, the others are hashed then decoded together
+	// Compressed and mipmapped textures without an up to date cache too, their caches are then built one image at a time (rows in parallel)
+	std::vector<int> Batch;
+	std::vector<const char*> BatchFilenames;
+	for (int i = 0; i < Count; ++i)
+	{
+		if (FindTexture(Filenames[i], ImageFlags) >= 0 || Cook::FindCooked(this->Manifest, COOKED_TEXTURE, Filenames[i], ImageFlags))
+		{
+			TexturesOut[i] = LoadTexture(Filenames[i], ImageFlags);
+			continue;
+		}
+		Batch.push_back(i);
+		BatchFilenames.push_back(Filenames[i]);
+	}
+
+	std::vector<uint64_t> Hashes(Batch.size());
+	Jobs::ParallelFor((int)Batch.size(), 1, [&](int Begin, int End)
+	{
+		for (int b = Begin; b < End; ++b)
+		{
+			if (!Texture::HashFiles(&BatchFilenames[b], 1, &Hashes[b]))
+				Hashes[b] = 0;
+		}
+	});
+
+	// Files already loaded under another name, or listed twice, are decoded once, and not at all when their cache is up to date
+	bool Cached = (ImageFlags & (IMG_COMPRESS | IMG_GEN_MIPMAPS)) != 0;
+	std::vector<mapped_texture> Mapped(Batch.size());
+	std::vector<const char*> DecodeFilenames;
+	std::vector<int> Decoded(Batch.size(), -1);
+	for (size_t b = 0; b < Batch.size(); ++b)
+	{
+		if (FindTextureContent(Hashes[b], ImageFlags, GL_TEXTURE_2D) >= 0)
+			continue;
+		bool Duplicate = false;
+		for (size_t Previous = 0; Previous < b && !Duplicate; ++Previous)
+			Duplicate = (Decoded[Previous] >= 0 || GetTextureMapping(Mapped[Previous]).Data) && Hashes[b] != 0 && Hashes[Previous] == Hashes[b];
+		if (Duplicate)
+			continue;
+		if (Cached && MapTextureCache(Mapped[b], &BatchFilenames[b], 1, ImageFlags, Hashes[b], this->SupportedFormats, nullptr, false))
+			continue;
+		Decoded[b] = (int)DecodeFilenames.size();
+		DecodeFilenames.push_back(BatchFilenames[b]);
+	}
+
+	std::vector<image> Images(DecodeFilenames.size());
+	GL::DecodeImages(Images.data(), DecodeFilenames.data(), (int)DecodeFilenames.size(), ImageFlags);
+
+	// Uploaded in order, the duplicates find the texture of their first file
+	for (size_t b = 0; b < Batch.size(); ++b)
+	{
+		int Found = FindTexture(BatchFilenames[b], ImageFlags);
+		if (Found >= 0)
+		{
+			this->TextureStats.Hits++;
+			TexturesOut[Batch[b]] = UseTexture(Found, nullptr, nullptr);
+			continue;
+		}
+		this->TextureStats.Misses++;
+
+		int Shared = Decoded[b] < 0 && !GetTextureMapping(Mapped[b]).Data ? FindTextureContent(Hashes[b], ImageFlags, GL_TEXTURE_2D) : -1;
+		if (Shared >= 0)
+		{
+			this->TextureStats.ContentHits++;
+			AddTextureName(BatchFilenames[b], ImageFlags, Shared);
+			TexturesOut[Batch[b]] = UseTexture(Shared, nullptr, nullptr);
+			continue;
+		}
+
+		texture Texture = {};
+		Texture.Target = GL_TEXTURE_2D;
+		Texture.ImageFlags = ImageFlags;
+		Texture.ContentHash = Hashes[b];
+		Texture.Ready = true;
+		glGenTextures(1, &Texture.TextureID);
+		glBindTexture(GL_TEXTURE_2D, Texture.TextureID);
+		const image* Image = Decoded[b] >= 0 && Images[Decoded[b]].Data ? &Images[Decoded[b]] : nullptr;
+		if (Cached && Image)
+			MapTextureCache(Mapped[b], &BatchFilenames[b], 1, ImageFlags, Hashes[b], this->SupportedFormats, Image);
+		if (GetTextureMapping(Mapped[b]).Data)
+		{
+			UploadMappedTexture(GL_TEXTURE_2D, Mapped[b], &Texture.Width, &Texture.Height);
+			UnmapTexture(Mapped[b]);
+			Texture.Bytes = MeasureTextureBytes(GL_TEXTURE_2D);
+		}
+		else if (Image)
+		{
+			GL::UploadImage(GL_TEXTURE_2D, *Image);
+			if (ImageFlags & IMG_GEN_MIPMAPS)
+				glGenerateMipmap(GL_TEXTURE_2D);
+			Texture.Width = Image->Width;
+			Texture.Height = Image->Height;
+			Texture.Bytes = MeasureTextureBytes(GL_TEXTURE_2D);
+		}
+		AddTexture(Texture, BatchFilenames[b]);
+		TexturesOut[Batch[b]] = Texture.TextureID;
+	}
+
+	for (image& Image : Images)
+	{
+		if (Image.Data)
+			GL::FreeImage(Image);
+	}
+	EvictTextures();
+}
+
+GLuint GL::cache::LoadCubemap(const char* const* Faces, int ImageFlags, int* SizeOut)
+{
+	std::string Key = std::string("cubemap|") + Faces[0];
+	int Found = FindTexture(Key.c_str(), ImageFlags);
+	if (Found >= 0)
+	{
+		this->TextureStats.Hits++;
+		return UseTexture(Found, SizeOut, nullptr);
+	}
+	this->TextureStats.Misses++;
+
+	texture Texture = {};
+	Texture.Target = GL_TEXTURE_CUBE_MAP;
+	Texture.ImageFlags = ImageFlags;
+	Texture.Ready = true;
+	mapped_texture Mapped;
+	bool IsMapped = MapCookedTexture(Mapped, this->Manifest, COOKED_CUBEMAP, Faces[0], ImageFlags, this->SupportedFormats);
+	if (IsMapped)
+		Texture.ContentHash = Texture::HashBytes(GetTextureMapping(Mapped).Data, GetTextureMapping(Mapped).Size);
+	else if (!Texture::HashFiles(Faces, 6, &Texture.ContentHash))
+		Texture.ContentHash = 0;
+
+	int Shared = FindTextureContent(Texture.ContentHash, ImageFlags, GL_TEXTURE_CUBE_MAP);
+	if (Shared >= 0)
+	{
+		UnmapTexture(Mapped);
+		this->TextureStats.ContentHits++;
+		AddTextureName(Key.c_str(), ImageFlags, Shared);
+		return UseTexture(Shared, SizeOut, nullptr);
+	}
+
+	if (!IsMapped)
+		IsMapped = MapTextureCache(Mapped, Faces, 6, ImageFlags, Texture.ContentHash, this->SupportedFormats);
+
+	glGenTextures(1, &Texture.TextureID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, Texture.TextureID);
+	if (IsMapped)
+	{
+		UploadMappedTexture(GL_TEXTURE_CUBE_MAP, Mapped, &Texture.Width, nullptr);
+		UnmapTexture(Mapped);
+	}
+	else
+	{
+		GL::UploadCubemapTextures(Faces, ImageFlags, &Texture.Width);
+	}
+	Texture.Height = Texture.Width;
+	Texture.Bytes = MeasureTextureBytes(GL_TEXTURE_CUBE_MAP);
+
+	if (SizeOut) *SizeOut = Texture.Width;
+
+	AddTexture(Texture, Key.c_str());
+	EvictTextures();
+
+	return Texture.TextureID;
+}
+
+const GL::mesh* GL::cache::LoadMeshAsync(const char* Filename, float Scale)
+{
+	return LoadMeshAsync(Filename, Scale, Mesh::MakeVertexLayout(VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_FLOAT));
+}
+
+const GL::mesh* GL::cache::LoadMeshAsync(const char* Filename, float Scale, const vertex_layout& Layout, int MeshFlags)
+{
+	// Meshes already loaded get their missing BVH right away (once uploaded)
+	std::string Key = GetMeshKey(Filename, Layout);
+	auto Found = this->MeshMap.find(Key);
+	if (Found != this->MeshMap.end())
+		return LoadMesh(Filename, Scale, Layout, MeshFlags);
+
+	mesh& Mesh = this->MeshMap[Key];
+	Mesh = {};
+	Mesh.Layout = Layout;
+
+	// Placeholder: unit cube in the buffers that will receive the mesh
+	if (this->PlaceholderMesh.Vertices.empty())
+	{
+		vertex_full Cube[36];
+		vertex_descriptor Descriptor = { sizeof(vertex_full), OFFSETOF(vertex_full, Position), true, OFFSETOF(vertex_full, Normal), true, OFFSETOF(vertex_full, UV) };
+		Mesh::BuildCube(Cube, Cube + ARRAY_SIZE(Cube), Descriptor);
+		Mesh::BuildIndexedMesh(this->PlaceholderMesh, Cube, (int)ARRAY_SIZE(Cube));
+	}
+
+	std::vector<uint16_t> PlaceholderIndices(this->PlaceholderMesh.Indices.begin(), this->PlaceholderMesh.Indices.end());
+	mapped_mesh Placeholder = {};
+	Placeholder.Vertices = this->PlaceholderMesh.Vertices.data();
+	Placeholder.VertexCount = (int)this->PlaceholderMesh.Vertices.size();
+	Placeholder.Indices = PlaceholderIndices.data();
+	Placeholder.IndexCount = (int)PlaceholderIndices.size();
+	Placeholder.IndexSize = sizeof(uint16_t);
+	Placeholder.BoundsMin = { -0.5f, -0.5f, -0.5f };
+	Placeholder.BoundsMax = {  0.5f,  0.5f,  0.5f };
+	Placeholder.Lods[0] = { 0, (uint32_t)Placeholder.IndexCount, 0.f, 0 };
+	Placeholder.LodCount = 1;
+	UploadMesh(Mesh, Placeholder, EncodeMeshVertices(this->EncodedVertices, Layout, Placeholder, 1.f), 1.f);
+	Mesh.Ready = false;
+
+	upload_request* Request = new upload_request();
+	Request->Filename = Filename;
+	Request->Mesh = &Mesh;
+	Request->Scale = Scale;
+	Request->Layout = Layout;
+	Request->MeshFlags = MeshFlags;
+
+	this->PendingCount++;
+	this->DecodingCount++;
+	Jobs::Run([this, Request]()
+	{
+		Request->Success = MapMesh(Request->MappedMesh, this->Manifest, Request->Filename.c_str()) && Request->MappedMesh.IndexCount > 0;
+
+		// Encode vertices here to keep the GL thread free
+		if (Request->Success)
+		{
+			const mapped_mesh& MappedMesh = Request->MappedMesh;
+			Request->Vertices = EncodeMeshVertices(Request->EncodedVertices, Request->Layout, MappedMesh, Request->Scale);
+			if (!Mesh::IsFullVertexLayout(Request->Layout))
+				Request->EncodingError = Mesh::MeasureEncodingError(Request->Layout, MappedMesh.Vertices, MappedMesh.VertexCount, MappedMesh.BoundsMin, MappedMesh.BoundsMax);
+			if (Request->MeshFlags & MESH_LOAD_BVH)
+				LoadScaledBvh(Request->Bvh, Request->Filename.c_str(), MappedMesh, Request->Scale);
+		}
+
+		// Lock-free push
+		Request->Next = this->UploadQueue.load(std::memory_order_relaxed);
+		while (!this->UploadQueue.compare_exchange_weak(Request->Next, Request, std::memory_order_release, std::memory_order_relaxed));
+		this->DecodingCount--;
+	});
+
+	return &Mesh;
+}
+
+GLuint GL::cache::LoadTextureAsync(const char* Filename, int ImageFlags)
+{
+	int Found = FindTexture(Filename, ImageFlags);
+	if (Found >= 0)
+	{
+		this->TextureStats.Hits++;
+		return UseTexture(Found, nullptr, nullptr);
+	}
+	this->TextureStats.Misses++;
+
+	// Placeholder: checkerboard in the texture that will receive the image (held until uploaded, so never evicted before)
+	texture Texture = {};
+	Texture.Target = GL_TEXTURE_2D;
+	Texture.ImageFlags = ImageFlags;
+	Texture.Width = 64;
+	Texture.Height = 64;
+	glGenTextures(1, &Texture.TextureID);
+	glBindTexture(GL_TEXTURE_2D, Texture.TextureID);
+	GL::UploadCheckerboardTexture(64, 64, 8);
+	if (ImageFlags & IMG_GEN_MIPMAPS)
+		glGenerateMipmap(GL_TEXTURE_2D);
+	Texture.Bytes = MeasureTextureBytes(GL_TEXTURE_2D);
+
+	upload_request* Request = new upload_request();
+	Request->Filename = Filename;
+	Request->Texture = AddTexture(Texture, Filename);
+	Request->ImageFlags = ImageFlags;
+
+	this->PendingCount++;
+	this->DecodingCount++;
+	Jobs::Run([this, Request]()
+	{
+		// Cooked textures are only read here: the GL thread uploads their levels without decoding
+		// Compressed and mipmapped caches are built here on the first load
+		const char* Filename = Request->Filename.c_str();
+		mapped_texture& Mapped = Request->MappedTexture;
+		if (MapCookedTexture(Mapped, this->Manifest, COOKED_TEXTURE, Filename, Request->ImageFlags, this->SupportedFormats))
+		{
+			TouchPages(GetTextureMapping(Mapped));
+			Request->ContentHash = Texture::HashBytes(GetTextureMapping(Mapped).Data, GetTextureMapping(Mapped).Size);
+			Request->Success = true;
+		}
+		else if (Texture::HashFiles(&Filename, 1, &Request->ContentHash))
+		{
+			Request->Success = MapTextureCache(Mapped, &Filename, 1, Request->ImageFlags, Request->ContentHash, this->SupportedFormats)
+			                || GL::DecodeImage(Request->Image, Filename, Request->ImageFlags);
+		}
+		if (Request->Success)
+			PrepareStream(Request->Stream, Mapped, Request->Image, Request->ImageFlags);
+
+		// Lock-free push
+		Request->Next = this->UploadQueue.load(std::memory_order_relaxed);
+		while (!this->UploadQueue.compare_exchange_weak(Request->Next, Request, std::memory_order_release, std::memory_order_relaxed));
+		this->DecodingCount--;
+	});
+
+	return Texture.TextureID;
+}
+
+bool GL::cache::IsTextureReady(GLuint Texture) const
+{
+	for (const texture& Loaded : this->Textures)
+	{
+		if (Loaded.TextureID == Texture && Texture != 0)
+			return Loaded.Ready;
+	}
+	return false;
+}
+
+bool GL::cache::UploadRequest(upload_request* Request)
+{
+	// Textures that fit in the upload ring are staged first: a worker copies their levels into a block, then they come back
+	// through the upload queue to be uploaded from it
+	texture_stream& Stream = Request->Stream;
+	if (Request->Texture >= 0 && Request->Success && !Stream.Staged && this->UploadRing.CanAllocate(Stream.Size))
+	{
+		if (!this->UploadRing.Allocate(Stream.Block, Stream.Size))
+			return false;
+
+		this->DecodingCount++;
+		Jobs::Run([this, Request]()
+		{
+			WriteStream(Request->Stream);
+			UnmapTexture(Request->MappedTexture);
+			if (Request->Image.Data)
+				GL::FreeImage(Request->Image);
+			Request->Stream.Staged = true;
+
+			// Lock-free push
+			Request->Next = this->UploadQueue.load(std::memory_order_relaxed);
+			while (!this->UploadQueue.compare_exchange_weak(Request->Next, Request, std::memory_order_release, std::memory_order_relaxed));
+			this->DecodingCount--;
+		});
+		return true;
+	}
+
+	if (Request->Success)
+		printf("Async upload: %s\n", Request->Filename.c_str());
+
+	if (Request->Mesh)
+	{
+		if (Request->Success)
+		{
+			if (!Mesh::IsFullVertexLayout(Request->Layout))
+				PrintEncodingError(Request->Filename.c_str(), Request->Layout, Request->EncodingError, Request->Scale);
+			UploadMesh(*Request->Mesh, Request->MappedMesh, Request->Vertices, Request->Scale);
+			Request->Mesh->Bvh = std::move(Request->Bvh);
+		}
+		Request->Mesh->Ready = true;
+		Mesh::UnmapObj(Request->MappedMesh);
+	}
+
+	if (Request->Texture >= 0)
+	{
+		texture& Texture = this->Textures[Request->Texture];
+		if (Request->Success && Stream.Staged)
+		{
+			glBindTexture(GL_TEXTURE_2D, Texture.TextureID);
+			UploadStream(this->UploadRing, Stream, GL_TEXTURE_2D);
+			Texture.Width = Stream.Levels[0].Width;
+			Texture.Height = Stream.Levels[0].Height;
+		}
+		else if (Request->Success && GetTextureMapping(Request->MappedTexture).Data)
+		{
+			glBindTexture(GL_TEXTURE_2D, Texture.TextureID);
+			UploadMappedTexture(GL_TEXTURE_2D, Request->MappedTexture, &Texture.Width, &Texture.Height);
+			UnmapTexture(Request->MappedTexture);
+		}
+		else if (Request->Success)
+		{
+			glBindTexture(GL_TEXTURE_2D, Texture.TextureID);
+			GL::UploadImage(GL_TEXTURE_2D, Request->Image);
+			if (Request->ImageFlags & IMG_GEN_MIPMAPS)
+				glGenerateMipmap(GL_TEXTURE_2D);
+
+			Texture.Width = Request->Image.Width;
+			Texture.Height = Request->Image.Height;
+			GL::FreeImage(Request->Image);
+		}
+
+		// Shared by the next loads of the same bytes under another name
+		if (Request->Success)
+		{
+			this->TextureStats.ResidentBytes -= Texture.Bytes;
+			Texture.Bytes = MeasureTextureBytes(GL_TEXTURE_2D);
+			this->TextureStats.ResidentBytes += Texture.Bytes;
+			Texture.ContentHash = Request->ContentHash;
+			AddTextureContent(Request->Texture);
+		}
+		Texture.Ready = true;
+		EvictTextures();
+	}
+
+	this->PendingCount--;
+	delete Request;
+	return true;
+}
+
+void GL::cache::ProcessUploads(float BudgetMilliseconds)
+{
+	// Take all the decoded assets at once (the stack is in reverse completion order)
+	size_t FirstNew = this->PendingUploads.size();
+	for (upload_request* Request = this->UploadQueue.exchange(nullptr, std::memory_order_acquire); Request; Request = Request->Next)
+		this->PendingUploads.push_back(Request);
+	std::reverse(this->PendingUploads.begin() + FirstNew, this->PendingUploads.end());
+
+	typedef std::chrono::steady_clock clock;
+	clock::time_point Start = clock::now();
+	this->UploadRing.Collect();
+
+	// Requests waiting for room in the upload ring stay pending, the next ones still go (staged uploads free the ring)
+	size_t UploadCount = 0;
+	size_t KeptCount = 0;
+	for (size_t i = 0; i < this->PendingUploads.size(); ++i)
+	{
+		upload_request* Request = this->PendingUploads[i];
+		bool OverBudget = UploadCount > 0 && std::chrono::duration<float, std::milli>(clock::now() - Start).count() >= BudgetMilliseconds;
+		if (!OverBudget && UploadRequest(Request))
+			UploadCount++;
+		else
+			this->PendingUploads[KeptCount++] = Request;
+	}
 
-	return Texture;
+	this->PendingUploads.resize(KeptCount);
 }
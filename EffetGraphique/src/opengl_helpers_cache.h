@@ -1,49 +1,257 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 
 #include "opengl_headers.h"
 #include "mesh.h"
+#include "mesh_bvh.h"
+#include "vertex_encoding.h"
+#include "opengl_helpers_buffer_pool.h"
+#include "opengl_helpers_upload_ring.h"
+#include "cooked_assets.h"
+#include "texture_codec.h"
 
 namespace GL
 {
+	// Indexed mesh uploaded on gpu, in the buffers GL::cache shares between meshes: the meshes with the same vertex stride
+	// share a vertex buffer and every mesh shares the index buffer, so draw with glDrawElementsBaseVertex (see GL::GetIndexOffset)
+	// The buffer names never change (async loads and defragmentation included), only BaseVertex and FirstIndex
+	struct mesh
+	{
+		GLuint VertexBuffer; // Vertices encoded with Layout
+		GLuint IndexBuffer;
+		GLenum IndexType;    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		int BaseVertex;      // First vertex of the mesh in VertexBuffer
+		int FirstIndex;      // First index of the mesh in IndexBuffer (in IndexType units), LODs, clusters and submeshes are relative to it
+		buffer_range VertexAllocation; // Ranges of the cache buffer pools
+		buffer_range IndexAllocation;
+		int VertexCount;
+		int IndexCount;
+		v3 BoundsMin;
+		v3 BoundsMax;
+		vertex_layout Layout;
+		bool Ready;          // False while a placeholder is displayed (async loading)
+		std::vector<mesh_cluster> Clusters; // Scaled with the mesh, empty for placeholders
+		mesh_lod Lods[MESH_MAX_LODS];       // Errors scaled with the mesh, see Mesh::SelectLod
+		int LodCount;
+		std::vector<mesh_submesh> Submeshes; // Sorted by material (a single submesh without material for primitives and placeholders)
+		std::vector<mesh_material> Materials;
+		mesh_bvh Bvh;                        // LOD 0 triangles for ray queries (scaled), empty unless loaded with MESH_LOAD_BVH
+	};
+
+	// Options of cache::LoadMesh and cache::LoadMeshAsync
+	enum mesh_load_flags
+	{
+		MESH_LOAD_BVH = 1 << 0, // Load or build mesh::Bvh (saved next to the mesh cache, see Mesh::LoadBvh)
+	};
+
+	// Non indexed vertex_full triangles of a .obj inside one of the shared vertex buffers of GL::cache
+	// Draw with glDrawArrays(GL_TRIANGLES, BaseVertex, VertexCount), the range is updated by DefragmentVertexBuffers
+	struct vertex_range
+	{
+		GLuint VertexBuffer;
+		int BaseVertex;
+		int VertexCount;
+	};
+
+	// Shapes generated by Mesh::Build* (see cache::LoadPrimitive)
+	enum primitive_shape
+	{
+		PRIMITIVE_QUAD,
+		PRIMITIVE_UNIT_QUAD,
+		PRIMITIVE_CUBE,
+		PRIMITIVE_NORMALIZED_CUBE,
+		PRIMITIVE_INVERTED_CUBE,
+		PRIMITIVE_SPHERE,
+	};
+
+	// Offset in the index buffer of an index of Mesh (relative to Mesh.FirstIndex), for glDrawElements*BaseVertex
+	const void* GetIndexOffset(const mesh& Mesh, uint32_t Index);
+
+	// Draw the clusters of Mesh inside the frustum (and not facing away from the camera when BackfaceCulling) with one glMultiDrawElements
+	// Matrix and camera position are in mesh space (before the position dequantization), the vertex array must be bound
+	// Meshes without clusters are drawn whole. Returns the number of triangles submitted
+	int DrawMeshClusters(const mesh& Mesh, const mat4& ModelViewProjection, v3 CameraPosition, bool BackfaceCulling);
+
+	// Draw one LOD of Mesh (clamped to the available LODs), the vertex array must be bound
+	void DrawMeshLod(const mesh& Mesh, int Lod);
+
+	// Draw the triangles of one submesh at a LOD (clamped), the vertex array must be bound
+	// Submeshes are sorted by material: bind the material of Mesh.Submeshes[i].MaterialId when it changes, then draw
+	void DrawSubmesh(const mesh& Mesh, int Submesh, int Lod);
+
+	// Counters of the texture cache (see cache::GetTextureStats)
+	struct texture_cache_stats
+	{
+		int TextureCount;       // Textures on gpu (a texture shared by several names counts once)
+		uint64_t ResidentBytes; // Estimated video memory of these textures (faces and mips included)
+		uint64_t BudgetBytes;
+		uint64_t Hits;          // Loads answered by a texture already loaded with the same name and flags
+		uint64_t Misses;        // Loads that read files
+		uint64_t ContentHits;   // Misses sharing a texture loaded from identical bytes under another name (nothing uploaded)
+		uint64_t Evictions;
+	};
+
+	const uint64_t TEXTURE_CACHE_DEFAULT_BUDGET = 512ull * 1024 * 1024;
+
+	// Assets cooked by asset_cook (listed in COOKED_MANIFEST_FILENAME) are preferred to their sources:
+	// meshes map their cache without hashing the source, textures and cubemaps are mapped with their mips instead of decoded
+	// Textures loaded with IMG_COMPRESS are uploaded block compressed (cooked, or compressed once next to their sources)
+	// and the mip chains of IMG_GEN_MIPMAPS are filtered on the cpu in linear space, once per version of the sources (see Cook::MapTextureCache)
 	class cache
 	{
 	public:
         cache();
         ~cache();
-        GLuint LoadObj(const char* Filename, float Scale, int* VertexCountOut);
+        const vertex_range* LoadObj(const char* Filename, float Scale);
+        // Each LoadObj needs a ReleaseObj, the range is reused by the next loads once released by every user
+        void ReleaseObj(const char* Filename);
+        // Pack the .obj and mesh ranges of the shared vertex and index buffers (gpu copies, buffer names are kept)
+        void DefragmentVertexBuffers();
+        // Summed over the .obj and mesh buffers (in vertices, whatever their stride)
+        offset_allocator_stats GetVertexBufferStats() const;
+        // In 32 bits units (16 bits indices are packed by two)
+        offset_allocator_stats GetIndexBufferStats() const { return IndexPool.GetStats(); }
+        const mesh* LoadMesh(const char* Filename, float Scale);
+        // Vertices are encoded on load (positions relative to the bounds when quantized, see mesh::Layout)
+        // MeshFlags are mesh_load_flags, a mesh already loaded without its BVH gets it on this call
+        const mesh* LoadMesh(const char* Filename, float Scale, const vertex_layout& Layout, int MeshFlags = 0);
+        // Textures are keyed by filename and flags, a file with the same bytes (and flags) as a loaded one shares its texture
+        // Each load counts as a reference until ReleaseTexture, unreferenced textures are evicted when over budget (least recently loaded first)
         GLuint LoadTexture(const char* Filename, int ImageFlags = 0, int* WidthOut = nullptr, int* HeightOut = nullptr);
+        // Textures missing from the cache are decoded at once on the job threads, then uploaded in order (TexturesOut gets Count names)
+        // With IMG_COMPRESS/IMG_GEN_MIPMAPS, only the sources without an up to date cache are decoded, their caches are built after, image by image
+        void LoadTextures(const char* const* Filenames, int Count, int ImageFlags, GLuint* TexturesOut);
+        // Six faces in GL order (+X, -X, +Y, -Y, +Z, -Z) decoded at once, the texture is keyed by the first face
+        GLuint LoadCubemap(const char* const* Faces, int ImageFlags = 0, int* SizeOut = nullptr);
+
+        // Indexed procedural shape shared by every demo using the same vertex format, generated once (spheres get LODs)
+        // Vertices follow Descriptor (float attributes), Lon and Lat are only used by spheres
+        const mesh* LoadPrimitive(primitive_shape Shape, const vertex_descriptor& Descriptor, int Lon = 0, int Lat = 0);
+        // Same for the vertex struct of a typed_vertex_layout: vertices are converted by layout::Convert (no per attribute branches)
+        template<typename layout>
+        const mesh* LoadPrimitive(primitive_shape Shape, int Lon = 0, int Lat = 0)
+        {
+            return GeneratePrimitive(Shape, layout::Descriptor(), Lon, Lat, &ConvertTypedVertices<layout>);
+        }
+
+        // Async variants: return immediately with a placeholder (cube mesh, checkerboard texture)
+        // Files are decoded on worker threads and uploaded by ProcessUploads() in the same buffers/texture,
+        // so VAOs and texture names stay valid. The placeholder stays if the file can't be loaded
+        const mesh* LoadMeshAsync(const char* Filename, float Scale);
+        const mesh* LoadMeshAsync(const char* Filename, float Scale, const vertex_layout& Layout, int MeshFlags = 0);
+        GLuint LoadTextureAsync(const char* Filename, int ImageFlags = 0);
+        bool IsTextureReady(GLuint Texture) const;
+        // Async loads return their name before the file is read, so they never share a texture with identical bytes
+
+        // Drop a reference taken by a texture or cubemap load (the name stays valid until the texture is evicted)
+        void ReleaseTexture(GLuint Texture);
+        // Evicts the unreferenced textures at once when they don't fit
+        void SetTextureBudget(uint64_t Bytes);
+        texture_cache_stats GetTextureStats() const { return TextureStats; }
+        int GetPendingCount() const { return PendingCount; }
+
+        // Upload decoded assets to gpu (call once per frame on the GL thread)
+        // At least one upload is done per call even if it exceeds the budget
+        // Async textures are streamed: a worker copies their levels into the upload ring, then they are uploaded from it
+        // without waiting for the copy to the gpu
+        void ProcessUploads(float BudgetMilliseconds);
+        upload_ring_stats GetUploadStats() const { return UploadRing.GetStats(); }
 
 	private:
-		struct mesh
-		{
-			GLuint VertexBuffer;
-			int Size;
-		};
+		struct upload_request;
 
-		struct texture_identifier
+		// Ranges of Mesh in the pools (the previous ones are freed), false when they can't be allocated
+		bool AllocateMesh(mesh& Mesh, int VertexCount, int IndexCount, GLenum IndexType);
+		void UploadMesh(mesh& Mesh, const mapped_mesh& MappedMesh, const void* Vertices, float Scale);
+		// False when the request waits for room in the upload ring
+		bool UploadRequest(upload_request* Request);
+		// Conversion of the primitive vertices from vertex_full into the mapped vertex buffer (Mesh::ConvertVertices or a typed layout)
+		typedef void* (*vertex_convert_proc)(void* VerticesDst, const vertex_descriptor& Descriptor, const vertex_full* VerticesSrc, int Count);
+		template<typename layout>
+		static void* ConvertTypedVertices(void* VerticesDst, const vertex_descriptor&, const vertex_full* VerticesSrc, int Count)
 		{
-			std::string Filename;
-			int ImageFlags;
+			return layout::Convert((typename layout::vertex*)VerticesDst, VerticesSrc, Count);
+		}
+		const mesh* GeneratePrimitive(primitive_shape Shape, const vertex_descriptor& Descriptor, int Lon, int Lat, vertex_convert_proc Convert);
+		void UploadPrimitive(mesh& Mesh, const indexed_mesh& Primitive, const vertex_descriptor& Descriptor, vertex_convert_proc Convert);
 
-			bool operator<(const texture_identifier& Other) const
-			{
-				return Filename < Other.Filename;
-			}
+		struct texture;
+		int FindTexture(const char* Filename, int ImageFlags) const;
+		int FindTextureContent(uint64_t ContentHash, int ImageFlags, GLenum Target) const;
+		GLuint UseTexture(int Texture, int* WidthOut, int* HeightOut);
+		int AddTexture(const texture& Texture, const char* Filename);
+		void AddTextureName(const char* Filename, int ImageFlags, int Texture);
+		void AddTextureContent(int Texture);
+		void RemoveTexture(int Texture);
+		void EvictTextures();
+
+		struct vertex_buffer
+		{
+			vertex_range Range;
+			buffer_range Allocation;
+			int RefCount;
 		};
 
 		struct texture
 		{
-			GLuint TextureID;
+			GLuint TextureID;     // 0 for a free entry
+			GLenum Target;        // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
 			int Width;
 			int Height;
+			bool Ready;
+			int ImageFlags;
+			uint64_t ContentHash; // Of the bytes read (cooked file or sources), 0 when unknown
+			uint64_t Bytes;       // Estimated video memory
+			uint64_t LastUse;     // TextureClock of the last load returning it
+			int RefCount;
+		};
+
+		// Name a texture was loaded with (a shared texture has several)
+		struct texture_name
+		{
+			std::string Filename;
+			int ImageFlags;
+			uint64_t Hash;
+			int Texture;
+		};
+
+		// Open addressing (linear probing, power of 2 size), Index is -1 for empty slots
+		struct texture_slot
+		{
+			uint64_t Hash;
+			int Index;
 		};
 
 		std::vector<vertex_full> TmpBuffer;
-		std::map<std::string, mesh> VertexBufferMap;
-		std::map<texture_identifier, texture> TextureMap;
+		std::vector<uint8_t> EncodedVertices;
+		std::map<std::string, vertex_buffer> VertexBufferMap;
+		buffer_pool VertexPool; // vertex_full ranges of VertexBufferMap
+		std::vector<buffer_move> VertexMoves;
+		std::map<std::string, mesh> MeshMap;
+		std::map<int, buffer_pool> MeshVertexPools; // Vertices of MeshMap, one growable pool per stride
+		buffer_pool IndexPool;                      // Indices of MeshMap in 32 bits units (growable)
+		std::vector<texture> Textures;
+		std::vector<int> FreeTextures;
+		std::vector<texture_name> TextureNames;
+		std::vector<texture_slot> NameSlots;    // Filename and flags -> TextureNames
+		std::vector<texture_slot> ContentSlots; // Content hash, flags and target -> Textures
+		int ContentCount;
+		uint64_t TextureClock;
+		texture_cache_stats TextureStats;
+		int SupportedFormats; // Bit per texture_format the context can sample (read by the workers)
+		cooked_manifest Manifest;
+
+		// Async loading
+		std::atomic<upload_request*> UploadQueue;   // Lock-free stack of decoded assets pushed by the workers
+		std::vector<upload_request*> PendingUploads; // Popped from UploadQueue in completion order (GL thread only)
+		std::atomic<int> DecodingCount;              // Requests still running on workers
+		std::atomic<int> PendingCount;               // Requests not uploaded yet
+		indexed_mesh PlaceholderMesh;
+		upload_ring UploadRing;
 	};
 }
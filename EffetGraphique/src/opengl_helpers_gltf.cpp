@@ -0,0 +1,64 @@
+
+#include "opengl_helpers_gltf.h"
+
+static void GltfAttribPointer(GLint Location, const gltf_attribute& Attribute, const std::vector<GLuint>& Buffers)
+{
+	if (Location < 0 || Attribute.Buffer < 0)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, Buffers[Attribute.Buffer]);
+	glEnableVertexAttribArray(Location);
+	glVertexAttribPointer(Location, Attribute.ComponentCount, Attribute.ComponentType, Attribute.Normalized ? GL_TRUE : GL_FALSE,
+		Attribute.Stride, (const void*)(size_t)Attribute.Offset);
+}
+
+void GL::UploadGltf(gltf_gpu_scene& Gpu, const gltf_scene& Scene, GLint PositionLocation, GLint UVLocation, GLint NormalLocation)
+{
+	DeleteGltf(Gpu);
+
+	// No intermediate copy: the driver reads the mapped file
+	Gpu.Buffers.resize(Scene.Buffers.size());
+	glGenBuffers((GLsizei)Gpu.Buffers.size(), Gpu.Buffers.data());
+	for (int i = 0; i < (int)Scene.Buffers.size(); ++i)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, Gpu.Buffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)Scene.Buffers[i].Size, Scene.Buffers[i].Data, GL_STATIC_DRAW);
+	}
+
+	Gpu.VertexArrays.resize(Scene.Primitives.size());
+	glGenVertexArrays((GLsizei)Gpu.VertexArrays.size(), Gpu.VertexArrays.data());
+	for (int i = 0; i < (int)Scene.Primitives.size(); ++i)
+	{
+		const gltf_primitive& Primitive = Scene.Primitives[i];
+		glBindVertexArray(Gpu.VertexArrays[i]);
+		GltfAttribPointer(PositionLocation, Primitive.Position, Gpu.Buffers);
+		GltfAttribPointer(UVLocation, Primitive.TexCoord, Gpu.Buffers);
+		GltfAttribPointer(NormalLocation, Primitive.Normal, Gpu.Buffers);
+		if (Primitive.Indices.Buffer >= 0)
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Gpu.Buffers[Primitive.Indices.Buffer]);
+	}
+	glBindVertexArray(0);
+}
+
+void GL::DeleteGltf(gltf_gpu_scene& Gpu)
+{
+	if (!Gpu.VertexArrays.empty())
+		glDeleteVertexArrays((GLsizei)Gpu.VertexArrays.size(), Gpu.VertexArrays.data());
+	if (!Gpu.Buffers.empty())
+		glDeleteBuffers((GLsizei)Gpu.Buffers.size(), Gpu.Buffers.data());
+	Gpu.VertexArrays.clear();
+	Gpu.Buffers.clear();
+}
+
+void GL::DrawGltfPrimitive(const gltf_scene& Scene, const gltf_gpu_scene& Gpu, int Primitive)
+{
+	if (Primitive < 0 || Primitive >= (int)Gpu.VertexArrays.size())
+		return;
+
+	const gltf_primitive& ScenePrimitive = Scene.Primitives[Primitive];
+	glBindVertexArray(Gpu.VertexArrays[Primitive]);
+	if (ScenePrimitive.Indices.Buffer >= 0)
+		glDrawElements(GL_TRIANGLES, ScenePrimitive.IndexCount, ScenePrimitive.Indices.ComponentType, (const void*)(size_t)ScenePrimitive.Indices.Offset);
+	else
+		glDrawArrays(GL_TRIANGLES, 0, ScenePrimitive.VertexCount);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "opengl_headers.h"
+#include "gltf_loader.h"
+
+namespace GL
+{
+	// glTF scene on the gpu: each glTF buffer is one buffer object uploaded straight from the mapped file (vertices and indices together)
+	// and each primitive gets a vertex array whose attributes use the accessor layouts as they are
+	struct gltf_gpu_scene
+	{
+		std::vector<GLuint> Buffers;
+		std::vector<GLuint> VertexArrays; // One per primitive
+	};
+
+	// The locations can be -1 (attribute not used by the shader)
+	void UploadGltf(gltf_gpu_scene& Gpu, const gltf_scene& Scene, GLint PositionLocation, GLint UVLocation, GLint NormalLocation);
+	void DeleteGltf(gltf_gpu_scene& Gpu);
+	// Bind the vertex array of the primitive and draw it
+	void DrawGltfPrimitive(const gltf_scene& Scene, const gltf_gpu_scene& Gpu, int Primitive);
+}
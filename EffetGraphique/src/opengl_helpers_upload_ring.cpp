@@ -0,0 +1,207 @@
+#include <cstdint>
+#include <cstring>
+
+#include "maths.h"
+#include "opengl_helpers_upload_ring.h"
+
+// GL 4.4 enums missing from the 3.3 headers
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT   0x0080
+#endif
+
+// Offsets of the blocks in the persistent ring (texel and compressed block alignment)
+const size_t UPLOAD_RING_ALIGNMENT = 256;
+
+static size_t AlignBlockEnd(size_t End)
+{
+	return (End + UPLOAD_RING_ALIGNMENT - 1) & ~(UPLOAD_RING_ALIGNMENT - 1);
+}
+
+typedef void (APIENTRYP buffer_storage_proc)(GLenum Target, GLsizeiptr Size, const void* Data, GLbitfield Flags);
+static buffer_storage_proc BufferStorage = nullptr;
+
+void GL::LoadBufferStorage(GLADloadproc GetProcAddress)
+{
+	GLint Major = 0, Minor = 0, ExtensionCount = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &Major);
+	glGetIntegerv(GL_MINOR_VERSION, &Minor);
+	bool Supported = Major > 4 || (Major == 4 && Minor >= 4);
+	glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionCount);
+	for (GLint i = 0; i < ExtensionCount && !Supported; ++i)
+		Supported = strcmp((const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i), "GL_ARB_buffer_storage") == 0;
+	BufferStorage = Supported ? (buffer_storage_proc)GetProcAddress("glBufferStorage") : nullptr;
+}
+
+GL::upload_ring::upload_ring(size_t Capacity)
+	: Persistent(false), Capacity(Capacity), RingBuffer(0), RingData(nullptr), Head(0), Uploads(0), Stalls(0)
+{
+	if (BufferStorage == nullptr)
+		return;
+
+	// Coherent: the writes of the workers are seen by the uploads without flushing
+	GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &this->RingBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->RingBuffer);
+	BufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)Capacity, nullptr, Flags);
+	this->RingData = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)Capacity, Flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	this->Persistent = this->RingData != nullptr;
+	if (!this->Persistent)
+	{
+		glDeleteBuffers(1, &this->RingBuffer);
+		this->RingBuffer = 0;
+	}
+}
+
+GL::upload_ring::~upload_ring()
+{
+	for (const allocation& Allocation : this->Allocations)
+	{
+		if (Allocation.Fence)
+			glDeleteSync(Allocation.Fence);
+	}
+
+	// Deleting a buffer unmaps it
+	if (this->RingBuffer)
+		glDeleteBuffers(1, &this->RingBuffer);
+	for (const orphan_buffer& Buffer : this->OrphanBuffers)
+		glDeleteBuffers(1, &Buffer.Buffer);
+}
+
+bool GL::upload_ring::Allocate(upload_block& Block, size_t Size)
+{
+	Block = {};
+	Block.Buffer = -1;
+	if (Size == 0 || !CanAllocate(Size))
+		return false;
+
+	if (this->Persistent)
+	{
+		// Free space after Head, then from the start of the ring up to the oldest block still in flight
+		// (Head stays before the oldest block once wrapped, so Head == Tail only when the ring is empty)
+		size_t Offset = SIZE_MAX;
+		if (this->Allocations.empty())
+		{
+			this->Head = 0;
+			Offset = 0;
+		}
+		else
+		{
+			size_t Tail = this->Allocations.front().Offset;
+			if (this->Head > Tail && this->Head + Size <= this->Capacity)
+				Offset = this->Head;
+			else if (this->Head > Tail && AlignBlockEnd(Size) < Tail)
+				Offset = 0;
+			else if (this->Head < Tail && AlignBlockEnd(this->Head + Size) < Tail)
+				Offset = this->Head;
+		}
+
+		if (Offset == SIZE_MAX)
+		{
+			this->Stalls++;
+			return false;
+		}
+
+		this->Allocations.push_back({ Offset, Size, nullptr });
+		this->Head = Math::Min(AlignBlockEnd(Offset + Size), this->Capacity);
+		Block.Data = this->RingData + Offset;
+		Block.Size = Size;
+		Block.Offset = Offset;
+		return true;
+	}
+
+	// Orphaned buffers: a free one gets new storage (the driver keeps the old one until its uploads are done), then is mapped
+	int Index = -1;
+	for (int i = 0; i < (int)this->OrphanBuffers.size() && Index < 0; ++i)
+		Index = this->OrphanBuffers[i].Used ? -1 : i;
+	if (Index < 0)
+	{
+		if ((int)this->OrphanBuffers.size() >= UPLOAD_RING_ORPHAN_BUFFERS)
+		{
+			this->Stalls++;
+			return false;
+		}
+		orphan_buffer Buffer = {};
+		glGenBuffers(1, &Buffer.Buffer);
+		Index = (int)this->OrphanBuffers.size();
+		this->OrphanBuffers.push_back(Buffer);
+	}
+
+	orphan_buffer& Buffer = this->OrphanBuffers[Index];
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Buffer.Buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)Size, nullptr, GL_STREAM_DRAW);
+	Block.Data = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (Block.Data == nullptr)
+		return false;
+
+	Buffer.Size = Size;
+	Buffer.Used = true;
+	Block.Size = Size;
+	Block.Buffer = Index;
+	return true;
+}
+
+uintptr_t GL::upload_ring::Bind(const upload_block& Block)
+{
+	if (Block.Buffer >= 0)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->OrphanBuffers[Block.Buffer].Buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		return 0;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->RingBuffer);
+	return (uintptr_t)Block.Offset;
+}
+
+void GL::upload_ring::Release(const upload_block& Block)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	this->Uploads++;
+
+	// Orphaned again on its next use
+	if (Block.Buffer >= 0)
+	{
+		this->OrphanBuffers[Block.Buffer].Used = false;
+		return;
+	}
+
+	for (allocation& Allocation : this->Allocations)
+	{
+		if (Allocation.Offset == Block.Offset && Allocation.Fence == nullptr)
+		{
+			Allocation.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			break;
+		}
+	}
+}
+
+void GL::upload_ring::Collect()
+{
+	// In order: a block uploaded early waits for the older ones
+	while (!this->Allocations.empty() && this->Allocations.front().Fence)
+	{
+		GLenum Status = glClientWaitSync(this->Allocations.front().Fence, 0, 0);
+		if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(this->Allocations.front().Fence);
+		this->Allocations.pop_front();
+	}
+}
+
+GL::upload_ring_stats GL::upload_ring::GetStats() const
+{
+	upload_ring_stats Stats = {};
+	Stats.Persistent = this->Persistent;
+	Stats.Capacity = this->Capacity;
+	Stats.Uploads = this->Uploads;
+	Stats.Stalls = this->Stalls;
+	for (const allocation& Allocation : this->Allocations)
+		Stats.BytesInFlight += Allocation.Size;
+	for (const orphan_buffer& Buffer : this->OrphanBuffers)
+		Stats.BytesInFlight += Buffer.Used ? Buffer.Size : 0;
+	return Stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "opengl_headers.h"
+
+namespace GL
+{
+	// glBufferStorage (GL 4.4 or ARB_buffer_storage) isn't loaded by glad on the 3.3 context: call once after gladLoadGL
+	void LoadBufferStorage(GLADloadproc GetProcAddress);
+
+	// Buffers mapped at once when the ring isn't persistent (the block of each upload gets its own buffer)
+	const int UPLOAD_RING_ORPHAN_BUFFERS = 4;
+
+	// Mapped memory of an upload_ring, written by any thread until the GL thread binds it
+	struct upload_block
+	{
+		uint8_t* Data;
+		size_t Size;
+		size_t Offset; // In the ring buffer (persistent ring), 0 for orphaned buffers
+		int Buffer;    // Orphaned buffer index, -1 in the persistent ring
+	};
+
+	struct upload_ring_stats
+	{
+		bool Persistent;
+		size_t Capacity;
+		size_t BytesInFlight; // Allocated, not yet read by the gpu
+		uint64_t Uploads;
+		uint64_t Stalls;      // Allocations refused because the ring was full
+	};
+
+	// Pixel buffers streaming texture uploads: glTex(Sub)Image2D from a GL_PIXEL_UNPACK_BUFFER returns before the copy is done,
+	// so loading textures overlaps rendering. Workers fill the blocks, the GL thread uploads from them (GL thread only otherwise)
+	//   - GL 4.4: one persistently mapped, coherent buffer suballocated as a ring, blocks are reused once a fence says the gpu read them
+	//   - Otherwise: up to UPLOAD_RING_ORPHAN_BUFFERS buffers, orphaned (glBufferData(nullptr)) and mapped for each block
+	class upload_ring
+	{
+	public:
+		upload_ring(size_t Capacity);
+		~upload_ring();
+
+		// False when Size doesn't fit in the ring (see CanAllocate) or when it is full until uploads complete
+		bool Allocate(upload_block& Block, size_t Size);
+		bool CanAllocate(size_t Size) const { return Size <= Capacity; }
+		// Bind as GL_PIXEL_UNPACK_BUFFER (orphaned buffers are unmapped): the pixels of glTex(Sub)Image2D are then
+		// (const void*)(Base + offset in Block), with Base the returned value
+		uintptr_t Bind(const upload_block& Block);
+		// After the uploads from Block: unbind, the memory is reused once read by the gpu
+		void Release(const upload_block& Block);
+		// Reclaim the blocks read by the gpu (once per frame)
+		void Collect();
+		upload_ring_stats GetStats() const;
+
+	private:
+		struct allocation
+		{
+			size_t Offset;
+			size_t Size;
+			GLsync Fence; // Set by Release
+		};
+
+		struct orphan_buffer
+		{
+			GLuint Buffer;
+			size_t Size;
+			bool Used;
+		};
+
+		bool Persistent;
+		size_t Capacity;
+		GLuint RingBuffer;
+		uint8_t* RingData;
+		size_t Head;
+		std::deque<allocation> Allocations; // In allocation order, freed from the front
+		std::vector<orphan_buffer> OrphanBuffers;
+		uint64_t Uploads;
+		uint64_t Stalls;
+	};
+}
@@ -37,6 +37,49 @@ void main()
     oColor = vec4(uLineColor.rgb, uLineColor.a * (1.0 - edgeFactor()));
 })GLSL";
 
+static const char* gWireframeIndexedVertexShaderStr = R"GLSL(
+layout(location = 0) in vec3 aPosition;
+uniform mat4 uModelViewProj;
+
+void main()
+{
+    gl_Position = uModelViewProj * vec4(aPosition, 1.0);
+})GLSL";
+
+static const char* gWireframeIndexedGeometryShaderStr = R"GLSL(
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+out vec3 vBC;
+
+void main()
+{
+    vBC = vec3(1.0, 0.0, 0.0); gl_Position = gl_in[0].gl_Position; EmitVertex();
+    vBC = vec3(0.0, 1.0, 0.0); gl_Position = gl_in[1].gl_Position; EmitVertex();
+    vBC = vec3(0.0, 0.0, 1.0); gl_Position = gl_in[2].gl_Position; EmitVertex();
+    EndPrimitive();
+})GLSL";
+
+static GLuint CreateIndexedProgram()
+{
+	GLuint Program = glCreateProgram();
+
+	GLuint VertexShader = GL::CompileShader(GL_VERTEX_SHADER, gWireframeIndexedVertexShaderStr);
+	GLuint GeometryShader = GL::CompileShader(GL_GEOMETRY_SHADER, gWireframeIndexedGeometryShaderStr);
+	GLuint FragmentShader = GL::CompileShader(GL_FRAGMENT_SHADER, gWireframeFragmentShaderStr);
+
+	glAttachShader(Program, VertexShader);
+	glAttachShader(Program, GeometryShader);
+	glAttachShader(Program, FragmentShader);
+
+	glLinkProgram(Program);
+
+	glDeleteShader(VertexShader);
+	glDeleteShader(GeometryShader);
+	glDeleteShader(FragmentShader);
+
+	return Program;
+}
+
 wireframe_renderer::wireframe_renderer()
 {
 	Program = GL::CreateProgram(gWireframeVertexShaderStr, gWireframeFragmentShaderStr);
@@ -45,6 +88,11 @@ wireframe_renderer::wireframe_renderer()
 	glBindVertexArray(VAO);
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
+
+	IndexedProgram = CreateIndexedProgram();
+	glGenVertexArrays(1, &IndexedVAO);
+	glBindVertexArray(IndexedVAO);
+	glEnableVertexAttribArray(0);
 }
 
 wireframe_renderer::~wireframe_renderer()
@@ -52,12 +100,18 @@ wireframe_renderer::~wireframe_renderer()
 	glDeleteProgram(Program);
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &BaryBuffer);
+
+	glDeleteProgram(IndexedProgram);
+	glDeleteVertexArrays(1, &IndexedVAO);
 }
 
 void wireframe_renderer::SendBindBuffer(const wireframe_renderer::cmd_bind_buffer& Cmd)
 {
 	assert(Cmd.VertexCount % 3 == 0);
 
+	glUseProgram(Program);
+	glBindVertexArray(VAO);
+
 	// Resize barycentric coords buffer as needed
 	if (Cmd.VertexCount > (int)BaryBufferData.size())
 	{
@@ -88,6 +142,25 @@ void wireframe_renderer::SendDrawArray(const wireframe_renderer::cmd_draw_array&
 	glDrawArrays(GL_TRIANGLES, Cmd.First, Cmd.Count);
 }
 
+void wireframe_renderer::SendBindIndexedBuffer(const wireframe_renderer::cmd_bind_indexed_buffer& Cmd)
+{
+	glUseProgram(IndexedProgram);
+	glBindVertexArray(IndexedVAO);
+
+	// Bind position and index buffers
+	glBindBuffer(GL_ARRAY_BUFFER, Cmd.MeshVBO);
+	glVertexAttribPointer(0, 3, Cmd.PositionType, Cmd.PositionNormalized, Cmd.PositionStride, (void*)(size_t)Cmd.PositionOffset);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Cmd.MeshIBO);
+	CurrentIndexType = Cmd.IndexType;
+}
+
+void wireframe_renderer::SendDrawElements(const wireframe_renderer::cmd_draw_elements& Cmd)
+{
+	glUniformMatrix4fv(glGetUniformLocation(IndexedProgram, "uModelViewProj"), 1, GL_FALSE, Cmd.MVP.e);
+	size_t IndexSize = CurrentIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	glDrawElementsBaseVertex(GL_TRIANGLES, Cmd.Count, CurrentIndexType, (const void*)(Cmd.FirstIndex * IndexSize), Cmd.BaseVertex);
+}
+
 void wireframe_renderer::Flush()
 {
 	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 1234, -1, "Wireframe::flush");
@@ -122,6 +195,14 @@ void wireframe_renderer::Flush()
 		case command_type::DRAW_ARRAY:
 			SendDrawArray(Command.DrawArray);
 			break;
+
+		case command_type::BIND_INDEXED_BUFFER:
+			SendBindIndexedBuffer(Command.BindIndexedBuffer);
+			break;
+
+		case command_type::DRAW_ELEMENTS:
+			SendDrawElements(Command.DrawElements);
+			break;
 		}
 	}
 	Commands.clear();
@@ -156,3 +237,44 @@ void wireframe_renderer::DrawArray(GLint First, GLsizei Count, const mat4& MVP)
 	Command.DrawArray.MVP = MVP;
 	Commands.push_back(Command);
 }
+
+void wireframe_renderer::BindIndexedBuffer(GLuint MeshVBO, GLuint MeshIBO, GLenum IndexType, GLsizei PositionStride, GLsizei PositionOffset)
+{
+	command Command;
+	Command.Type = command_type::BIND_INDEXED_BUFFER;
+	Command.BindIndexedBuffer = {};
+	Command.BindIndexedBuffer.MeshVBO = MeshVBO;
+	Command.BindIndexedBuffer.MeshIBO = MeshIBO;
+	Command.BindIndexedBuffer.IndexType = IndexType;
+	Command.BindIndexedBuffer.PositionStride = PositionStride;
+	Command.BindIndexedBuffer.PositionOffset = PositionOffset;
+	Command.BindIndexedBuffer.PositionType = GL_FLOAT;
+	Command.BindIndexedBuffer.PositionNormalized = GL_FALSE;
+	Commands.push_back(Command);
+}
+
+void wireframe_renderer::BindIndexedBuffer(GLuint MeshVBO, GLuint MeshIBO, GLenum IndexType, const vertex_layout& Layout)
+{
+	BindIndexedBuffer(MeshVBO, MeshIBO, IndexType, Layout.Stride, Layout.PositionOffset);
+
+	cmd_bind_indexed_buffer& Cmd = Commands.back().BindIndexedBuffer;
+	if (Layout.PositionFormat == VERTEX_FORMAT_HALF)
+		Cmd.PositionType = GL_HALF_FLOAT;
+	else if (Layout.PositionFormat == VERTEX_FORMAT_UNORM16)
+	{
+		Cmd.PositionType = GL_UNSIGNED_SHORT;
+		Cmd.PositionNormalized = GL_TRUE;
+	}
+}
+
+void wireframe_renderer::DrawElements(GLsizei Count, const mat4& MVP, GLint FirstIndex, GLint BaseVertex)
+{
+	command Command;
+	Command.Type = command_type::DRAW_ELEMENTS;
+	Command.DrawElements = {};
+	Command.DrawElements.Count = Count;
+	Command.DrawElements.FirstIndex = FirstIndex;
+	Command.DrawElements.BaseVertex = BaseVertex;
+	Command.DrawElements.MVP = MVP;
+	Commands.push_back(Command);
+}
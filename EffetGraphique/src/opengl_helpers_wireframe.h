@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "maths.h"
+#include "vertex_encoding.h"
 
 #include "opengl_headers.h"
 
@@ -16,13 +17,20 @@ namespace GL
 
 		void BindBuffer(GLuint MeshVBO, GLsizei PositionStride, GLsizei PositionOffset, int VertexCount);
 		void DrawArray(GLint First, GLsizei Count, const mat4& MVP);
+		void BindIndexedBuffer(GLuint MeshVBO, GLuint MeshIBO, GLenum IndexType, GLsizei PositionStride, GLsizei PositionOffset);
+		// Quantized positions: the MVP must include the position dequantization
+		void BindIndexedBuffer(GLuint MeshVBO, GLuint MeshIBO, GLenum IndexType, const vertex_layout& Layout);
+		// FirstIndex and BaseVertex locate a mesh in shared buffers (see GL::mesh)
+		void DrawElements(GLsizei Count, const mat4& MVP, GLint FirstIndex = 0, GLint BaseVertex = 0);
 		void Flush();
 
 	private:	
 		enum class command_type
 		{
 			BIND_BUFFER,
-			DRAW_ARRAY
+			DRAW_ARRAY,
+			BIND_INDEXED_BUFFER,
+			DRAW_ELEMENTS
 		};
 
 		struct cmd_bind_buffer
@@ -40,6 +48,25 @@ namespace GL
 			mat4 MVP;
 		};
 
+		struct cmd_bind_indexed_buffer
+		{
+			GLuint MeshVBO;
+			GLuint MeshIBO;
+			GLenum IndexType;
+			GLsizei PositionStride;
+			GLsizei PositionOffset;
+			GLenum PositionType;
+			GLboolean PositionNormalized;
+		};
+
+		struct cmd_draw_elements
+		{
+			GLsizei Count;
+			GLint FirstIndex;
+			GLint BaseVertex;
+			mat4 MVP;
+		};
+
 		struct command
 		{
 			command_type Type;
@@ -47,16 +74,25 @@ namespace GL
 			{
 				cmd_bind_buffer BindBuffer;
 				cmd_draw_array DrawArray;
+				cmd_bind_indexed_buffer BindIndexedBuffer;
+				cmd_draw_elements DrawElements;
 			};
 		};
 	
 		void SendBindBuffer(const cmd_bind_buffer& Cmd);
 		void SendDrawArray(const cmd_draw_array& Cmd);
+		void SendBindIndexedBuffer(const cmd_bind_indexed_buffer& Cmd);
+		void SendDrawElements(const cmd_draw_elements& Cmd);
 
 		GLuint Program = 0;
 		GLuint VAO = 0;
 		std::vector<v3> BaryBufferData;
 		GLuint BaryBuffer = 0;
 		std::vector<command> Commands;
+
+		// Indexed meshes (barycentric coords are generated by a geometry shader)
+		GLuint IndexedProgram = 0;
+		GLuint IndexedVAO = 0;
+		GLenum CurrentIndexType = 0;
 	};
 }
\ No newline at end of file
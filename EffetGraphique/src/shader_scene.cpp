@@ -5,6 +5,7 @@
 #include "shader_scene.h"
 
 shader_scene::shader_scene(GL::cache& GLCache)
+    : GLCache(GLCache)
 {
     // Init light
     {
@@ -18,7 +19,7 @@ shader_scene::shader_scene(GL::cache& GLCache)
     // Create mesh
     {
         // Use vbo from GLCache
-        MeshBuffer = GLCache.LoadObj("media/ball.obj", 1.f, &this->MeshVertexCount);
+        MeshRange = GLCache.LoadObj("media/ball.obj", 1.f);
 
         MeshDesc.Stride = sizeof(vertex_full);
         MeshDesc.HasNormal = true;
@@ -39,7 +40,7 @@ shader_scene::shader_scene(GL::cache& GLCache)
 shader_scene::~shader_scene()
 {
     glDeleteBuffers(1, &LightsUniformBuffer);
-    glDeleteBuffers(1, &MeshBuffer); // From cache
+    GLCache.ReleaseObj("media/ball.obj");
 }
 
 static bool EditLight(GL::light* Light)
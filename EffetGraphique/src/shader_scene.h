@@ -10,9 +10,10 @@ public:
     shader_scene(GL::cache& GLCache);
     ~shader_scene();
 
-    // Mesh
-    GLuint MeshBuffer = 0;
-    int MeshVertexCount = 0;
+    GL::cache& GLCache;
+
+    // Mesh (range of the shared vertex buffers of GLCache)
+    const GL::vertex_range* MeshRange = nullptr;
     vertex_descriptor MeshDesc;
 
     // Lights buffer
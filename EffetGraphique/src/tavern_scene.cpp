@@ -1,14 +1,21 @@
 
+#include <cfloat>
+
 #include <imgui.h>
 
 #include "platform.h"
 
 #include "color.h"
+#include "maths.h"
 
 #include "tavern_scene.h"
 
+GL::cache* tavern_scene::TextureCache = nullptr;
+
 tavern_scene::tavern_scene(GL::cache& GLCache)
 {
+    TextureCache = &GLCache;
+
     // Init lights
     {
         this->LightCount = 6;
@@ -47,21 +54,25 @@ tavern_scene::tavern_scene(GL::cache& GLCache)
 
     // Create mesh
     {
-        // Use vbo from GLCache
-        MeshBuffer = GLCache.LoadObj("media/fantasy_game_inn.obj", 1.f, &this->MeshVertexCount);
+        // Use vbo/ibo from GLCache (placeholder until loaded in background)
+        // Compressed 16 bytes vertices: positions relative to the bounds, octahedral normals, half UVs
+        vertex_layout Layout = Mesh::MakeVertexLayout(VERTEX_FORMAT_UNORM16, VERTEX_FORMAT_OCT16, VERTEX_FORMAT_HALF);
+        // The BVH is used to pick the lights
+        Mesh = GLCache.LoadMeshAsync("media/fantasy_game_inn.obj", 1.f, Layout, GL::MESH_LOAD_BVH);
         
-        MeshDesc.Stride = sizeof(vertex_full);
+        // Offsets only, attribute formats are given by Mesh->Layout
+        MeshDesc.Stride = Layout.Stride;
         MeshDesc.HasNormal = true;
         MeshDesc.HasUV = true;
-        MeshDesc.PositionOffset = OFFSETOF(vertex_full, Position);
-        MeshDesc.UVOffset = OFFSETOF(vertex_full, UV);
-        MeshDesc.NormalOffset = OFFSETOF(vertex_full, Normal);
+        MeshDesc.PositionOffset = Layout.PositionOffset;
+        MeshDesc.UVOffset = Layout.UVOffset;
+        MeshDesc.NormalOffset = Layout.NormalOffset;
     }
 
     // Gen texture
     {
-        DiffuseTexture  = GLCache.LoadTexture("media/fantasy_game_inn_diffuse.png", IMG_FLIP | IMG_GEN_MIPMAPS);
-        EmissiveTexture = GLCache.LoadTexture("media/fantasy_game_inn_emissive.png", IMG_FLIP | IMG_GEN_MIPMAPS);
+        DiffuseTexture  = GLCache.LoadTextureAsync("media/fantasy_game_inn_diffuse.png", IMG_FLIP | IMG_GEN_MIPMAPS | IMG_COMPRESS);
+        EmissiveTexture = GLCache.LoadTextureAsync("media/fantasy_game_inn_emissive.png", IMG_FLIP | IMG_GEN_MIPMAPS | IMG_COMPRESS);
     }
     
     // Gen light uniform buffer
@@ -75,10 +86,17 @@ tavern_scene::tavern_scene(GL::cache& GLCache)
 tavern_scene::~tavern_scene()
 {
     glDeleteBuffers(1, &LightsUniformBuffer);
-    //glDeleteTextures(1, &Texture);   // From cache
-    //glDeleteBuffers(1, &MeshBuffer); // From cache
+    TextureCache->ReleaseTexture(EmissiveTexture);
+    TextureCache->ReleaseTexture(DiffuseTexture);
 }
 
+// Radius of the light markers hit by PickLight
+const float LIGHT_PICK_RADIUS = 0.2f;
+
+// Light picked in the viewport, shared by the tavern scenes (a single demo is displayed at a time)
+static int SelectedLight = -1;
+static bool SelectionChanged = false;
+
 static bool EditLight(GL::light* Light)
 {
     bool Result =
@@ -95,11 +113,16 @@ static bool EditLight(GL::light* Light)
 
 void tavern_scene::InspectLights()
 {
+    // A new selection opens its node once, then the node is left to the user
+    if (SelectionChanged && SelectedLight >= 0)
+        ImGui::SetNextItemOpen(true);
     if (ImGui::TreeNodeEx("Lights"))
     {
         for (int i = 0; i < LightCount; ++i)
         {
-            if (ImGui::TreeNode(&Lights[i], "Light[%d]", i))
+            if (SelectionChanged && i == SelectedLight)
+                ImGui::SetNextItemOpen(true);
+            if (ImGui::TreeNode(&Lights[i], i == SelectedLight ? "Light[%d] (selected)" : "Light[%d]", i))
             {
                 GL::light& Light = Lights[i];
                 if (EditLight(&Light))
@@ -121,5 +144,49 @@ void tavern_scene::InspectLights()
             }
         }
         ImGui::TreePop();
+        SelectionChanged = false;
+    }
+}
+
+// Distance where the ray enters the sphere (0 from inside)
+static bool IntersectSphere(v3 Origin, v3 Direction, v3 Center, float Radius, float* Distance)
+{
+    v3 ToCenter = Center - Origin;
+    float A = Vec3::Dot(Direction, Direction);
+    float B = Vec3::Dot(ToCenter, Direction);
+    float Discriminant = B * B - A * (Vec3::Dot(ToCenter, ToCenter) - Radius * Radius);
+    if (A == 0.f || Discriminant < 0.f)
+        return false;
+
+    float Root = Math::Sqrt(Discriminant);
+    if (B + Root < 0.f)
+        return false;
+    *Distance = Math::Max((B - Root) / A, 0.f);
+    return true;
+}
+
+int tavern_scene::PickLight(v3 Origin, v3 Direction, const mat4& ModelMatrix)
+{
+    // Walls in mesh space, hit distances are the same in both spaces
+    mat4 InverseModelMatrix = Mat4::Inverse(ModelMatrix);
+    v3 MeshOrigin = (InverseModelMatrix * Vec4::vec4(Origin, 1.f)).xyz;
+    v3 MeshDirection = (InverseModelMatrix * Vec4::vec4(Direction, 0.f)).xyz;
+    bvh_hit Hit;
+    float PickedDistance = Mesh::IntersectBvh(Mesh->Bvh, MeshOrigin, MeshDirection, FLT_MAX, &Hit) ? Hit.Distance : FLT_MAX;
+
+    // Directional lights have no marker
+    int Picked = -1;
+    for (int i = 0; i < LightCount; ++i)
+    {
+        float Distance;
+        if (Lights[i].Position.w != 0.f && IntersectSphere(Origin, Direction, Lights[i].Position.xyz, LIGHT_PICK_RADIUS, &Distance) && Distance <= PickedDistance)
+        {
+            Picked = i;
+            PickedDistance = Distance;
+        }
     }
+
+    SelectedLight = Picked;
+    SelectionChanged = true;
+    return Picked;
 }
@@ -11,9 +11,8 @@ public:
     tavern_scene(GL::cache& GLCache);
     ~tavern_scene();
     
-    // Mesh
-    GLuint MeshBuffer = 0;
-    int MeshVertexCount = 0;
+    // Mesh (indexed, owned by GLCache)
+    const GL::mesh* Mesh = nullptr;
     vertex_descriptor MeshDesc;
 
     // Lights buffer
@@ -27,7 +26,14 @@ public:
     // ImGui debug function to edit lights
     void InspectLights();
 
+    // Select the nearest point light whose marker is hit by the ray before the tavern walls (BVH of Mesh), -1 if none
+    // The ray is in world space, ModelMatrix is the one the tavern is rendered with. InspectLights opens the selected light
+    int PickLight(v3 Origin, v3 Direction, const mat4& ModelMatrix);
+
 private:
     // Lights data
     std::vector<GL::light> Lights;
+
+    // Cache releasing the textures (static: the size of tavern_scene is part of the pg lib ABI, the app has a single cache)
+    static GL::cache* TextureCache;
 };
\ No newline at end of file
@@ -0,0 +1,1117 @@
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "maths.h"
+#include "jobs.h"
+#include "opengl_helpers.h"
+#include "texture_codec.h"
+#include "texture_mips.h"
+
+// SSE2 is always available on x64
+#if defined(_M_X64) || defined(__x86_64__)
+#define TEXTURE_CODEC_SIMD
+#include <emmintrin.h>
+#endif
+
+struct texture_format_info
+{
+    const char* Name;
+    int BlockSize;
+    uint32_t DxgiFormat;
+    uint32_t GLFormat;   // glInternalFormat (also the one of KTX files)
+};
+
+static const texture_format_info FormatInfos[] =
+{
+    { "BC1", 8,  71, 0x83F0 }, // DXGI_FORMAT_BC1_UNORM, GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    { "BC3", 16, 77, 0x83F3 }, // DXGI_FORMAT_BC3_UNORM, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    { "BC4", 8,  80, 0x8DBB }, // DXGI_FORMAT_BC4_UNORM, GL_COMPRESSED_RED_RGTC1
+    { "BC5", 16, 83, 0x8DBD }, // DXGI_FORMAT_BC5_UNORM, GL_COMPRESSED_RG_RGTC2
+    { "BC7", 16, 98, 0x8E8C }, // DXGI_FORMAT_BC7_UNORM, GL_COMPRESSED_RGBA_BPTC_UNORM
+};
+
+int Texture::GetBlockSize(texture_format Format)
+{
+    return FormatInfos[Format].BlockSize;
+}
+
+size_t Texture::GetCompressedSize(texture_format Format, int Width, int Height)
+{
+    return (size_t)((Width + 3) / 4) * ((Height + 3) / 4) * FormatInfos[Format].BlockSize;
+}
+
+int Texture::GetLevelCount(int Width, int Height)
+{
+    int LevelCount = 1;
+    while (Width > 1 || Height > 1)
+    {
+        Width = Width > 1 ? Width / 2 : 1;
+        Height = Height > 1 ? Height / 2 : 1;
+        LevelCount++;
+    }
+    return LevelCount;
+}
+
+texture_format Texture::ChooseFormat(int Channels, bool HighQuality)
+{
+    if (Channels == 1)
+        return TEXTURE_BC4;
+    if (Channels == 2)
+        return TEXTURE_BC5;
+    if (HighQuality)
+        return TEXTURE_BC7;
+    return Channels == 3 ? TEXTURE_BC1 : TEXTURE_BC3;
+}
+
+uint32_t Texture::GetGLFormat(texture_format Format)
+{
+    return FormatInfos[Format].GLFormat;
+}
+
+// 4x4 texels in RGBA, the last row/column is repeated on the borders
+static void FetchBlock(uint8_t Block[64], const uint8_t* Pixels, int Width, int Height, int Channels, int BlockX, int BlockY)
+{
+    for (int y = 0; y < 4; ++y)
+    {
+        const uint8_t* Row = Pixels + (size_t)Math::Min(BlockY * 4 + y, Height - 1) * Width * Channels;
+        for (int x = 0; x < 4; ++x)
+        {
+            const uint8_t* Texel = Row + Math::Min(BlockX * 4 + x, Width - 1) * Channels;
+            uint8_t* Dst = &Block[(y * 4 + x) * 4];
+            Dst[0] = Texel[0];
+            Dst[1] = Channels > 1 ? Texel[1] : 0;
+            Dst[2] = Channels > 2 ? Texel[2] : 0;
+            Dst[3] = Channels > 3 ? Texel[3] : 255;
+        }
+    }
+}
+
+// Closest palette entry of each texel (squared RGBA distance, first entry on ties), returns the summed error
+static uint32_t FitIndices(const uint8_t Block[64], const uint8_t (*Palette)[4], int PaletteSize, uint8_t Indices[16])
+{
+    uint32_t Error = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int Best = INT32_MAX;
+        for (int p = 0; p < PaletteSize; ++p)
+        {
+            int Distance = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int Delta = Block[i * 4 + c] - Palette[p][c];
+                Distance += Delta * Delta;
+            }
+            if (Distance < Best)
+            {
+                Best = Distance;
+                Indices[i] = (uint8_t)p;
+            }
+        }
+        Error += (uint32_t)Best;
+    }
+    return Error;
+}
+
+#ifdef TEXTURE_CODEC_SIMD
+// Same as FitIndices, 4 texels at a time (16 bits channels, the squared distances are summed with madd)
+static uint32_t FitIndicesSimd(const uint8_t Block[64], const uint8_t (*Palette)[4], int PaletteSize, uint8_t Indices[16])
+{
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Texels[8];
+    for (int g = 0; g < 4; ++g)
+    {
+        __m128i Bytes = _mm_loadu_si128((const __m128i*)(Block + g * 16));
+        Texels[g * 2] = _mm_unpacklo_epi8(Bytes, Zero);
+        Texels[g * 2 + 1] = _mm_unpackhi_epi8(Bytes, Zero);
+    }
+
+    __m128i Best[4], BestIndex[4];
+    for (int g = 0; g < 4; ++g)
+    {
+        Best[g] = _mm_set1_epi32(INT32_MAX);
+        BestIndex[g] = Zero;
+    }
+
+    for (int p = 0; p < PaletteSize; ++p)
+    {
+        uint32_t Color;
+        memcpy(&Color, Palette[p], sizeof(Color));
+        __m128i Entry = _mm_unpacklo_epi8(_mm_set1_epi32((int)Color), Zero);
+        __m128i Index = _mm_set1_epi32(p);
+        for (int g = 0; g < 4; ++g)
+        {
+            __m128i Delta0 = _mm_sub_epi16(Texels[g * 2], Entry);
+            __m128i Delta1 = _mm_sub_epi16(Texels[g * 2 + 1], Entry);
+            __m128 Squared0 = _mm_castsi128_ps(_mm_madd_epi16(Delta0, Delta0)); // RG and BA of texels 0 and 1
+            __m128 Squared1 = _mm_castsi128_ps(_mm_madd_epi16(Delta1, Delta1)); // Texels 2 and 3
+            __m128i Distance = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(Squared0, Squared1, _MM_SHUFFLE(2, 0, 2, 0))),
+                                             _mm_castps_si128(_mm_shuffle_ps(Squared0, Squared1, _MM_SHUFFLE(3, 1, 3, 1))));
+
+            __m128i Closer = _mm_cmplt_epi32(Distance, Best[g]);
+            Best[g] = _mm_or_si128(_mm_and_si128(Closer, Distance), _mm_andnot_si128(Closer, Best[g]));
+            BestIndex[g] = _mm_or_si128(_mm_and_si128(Closer, Index), _mm_andnot_si128(Closer, BestIndex[g]));
+        }
+    }
+
+    // Pack the indices to bytes and sum the errors
+    __m128i Packed = _mm_packus_epi16(_mm_packs_epi32(BestIndex[0], BestIndex[1]), _mm_packs_epi32(BestIndex[2], BestIndex[3]));
+    _mm_storeu_si128((__m128i*)Indices, Packed);
+    __m128i Sum = _mm_add_epi32(_mm_add_epi32(Best[0], Best[1]), _mm_add_epi32(Best[2], Best[3]));
+    Sum = _mm_add_epi32(Sum, _mm_shuffle_epi32(Sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    Sum = _mm_add_epi32(Sum, _mm_shuffle_epi32(Sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(Sum);
+}
+#endif
+
+static uint32_t FitIndices(const uint8_t Block[64], const uint8_t (*Palette)[4], int PaletteSize, uint8_t Indices[16], bool Simd)
+{
+#ifdef TEXTURE_CODEC_SIMD
+    if (Simd)
+        return FitIndicesSimd(Block, Palette, PaletteSize, Indices);
+#endif
+    return FitIndices(Block, Palette, PaletteSize, Indices);
+}
+
+// Line through the texels along their principal axis (power iteration on the covariance), clamped to [0;255]
+static void FitLine(const uint8_t Block[64], int Channels, float Start[4], float End[4])
+{
+    float Mean[4] = {};
+    float Min[4] = { 255.f, 255.f, 255.f, 255.f };
+    float Max[4] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < Channels; ++c)
+        {
+            Mean[c] += Block[i * 4 + c] / 16.f;
+            Min[c] = Math::Min(Min[c], (float)Block[i * 4 + c]);
+            Max[c] = Math::Max(Max[c], (float)Block[i * 4 + c]);
+        }
+    }
+
+    float Covariance[4][4] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int a = 0; a < Channels; ++a)
+        {
+            for (int b = 0; b < Channels; ++b)
+                Covariance[a][b] += (Block[i * 4 + a] - Mean[a]) * (Block[i * 4 + b] - Mean[b]);
+        }
+    }
+
+    // Starting from the bounding box diagonal
+    float Axis[4] = {};
+    for (int c = 0; c < Channels; ++c)
+        Axis[c] = Max[c] - Min[c];
+    for (int Iteration = 0; Iteration < 8; ++Iteration)
+    {
+        float Next[4] = {};
+        float Length = 0.f;
+        for (int a = 0; a < Channels; ++a)
+        {
+            for (int b = 0; b < Channels; ++b)
+                Next[a] += Covariance[a][b] * Axis[b];
+            Length = Math::Max(Length, std::fabs(Next[a]));
+        }
+        if (Length == 0.f)
+            break;
+        for (int c = 0; c < Channels; ++c)
+            Axis[c] = Next[c] / Length;
+    }
+
+    float SquaredLength = 0.f;
+    for (int c = 0; c < Channels; ++c)
+        SquaredLength += Axis[c] * Axis[c];
+
+    float MinT = 0.f, MaxT = 0.f;
+    if (SquaredLength > 0.f)
+    {
+        MinT = FLT_MAX;
+        MaxT = -FLT_MAX;
+        for (int i = 0; i < 16; ++i)
+        {
+            float T = 0.f;
+            for (int c = 0; c < Channels; ++c)
+                T += (Block[i * 4 + c] - Mean[c]) * Axis[c];
+            MinT = Math::Min(MinT, T / SquaredLength);
+            MaxT = Math::Max(MaxT, T / SquaredLength);
+        }
+    }
+
+    for (int c = 0; c < 4; ++c)
+    {
+        Start[c] = c < Channels ? Math::Clamp(Mean[c] + Axis[c] * MinT, 0.f, 255.f) : 255.f;
+        End[c] = c < Channels ? Math::Clamp(Mean[c] + Axis[c] * MaxT, 0.f, 255.f) : 255.f;
+    }
+}
+
+// Least squares endpoints for the indices (Weights[Index] is the fraction of End), false if the indices don't span a line
+static bool RefitLine(const uint8_t Block[64], int Channels, const uint8_t Indices[16], const float* Weights, float Start[4], float End[4])
+{
+    float AA = 0.f, AB = 0.f, BB = 0.f;
+    float AX[4] = {}, BX[4] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        float B = Weights[Indices[i]];
+        float A = 1.f - B;
+        AA += A * A;
+        AB += A * B;
+        BB += B * B;
+        for (int c = 0; c < Channels; ++c)
+        {
+            AX[c] += A * Block[i * 4 + c];
+            BX[c] += B * Block[i * 4 + c];
+        }
+    }
+
+    float Determinant = AA * BB - AB * AB;
+    if (std::fabs(Determinant) < 1e-6f)
+        return false;
+
+    for (int c = 0; c < Channels; ++c)
+    {
+        Start[c] = Math::Clamp((AX[c] * BB - BX[c] * AB) / Determinant, 0.f, 255.f);
+        End[c] = Math::Clamp((BX[c] * AA - AX[c] * AB) / Determinant, 0.f, 255.f);
+    }
+    return true;
+}
+
+static uint16_t PackRgb565(const float Color[4])
+{
+    int R = (int)(Color[0] * 31.f / 255.f + 0.5f);
+    int G = (int)(Color[1] * 63.f / 255.f + 0.5f);
+    int B = (int)(Color[2] * 31.f / 255.f + 0.5f);
+    return (uint16_t)(R << 11 | G << 5 | B);
+}
+
+static void UnpackRgb565(uint16_t Color, uint8_t Rgba[4])
+{
+    int R = Color >> 11, G = (Color >> 5) & 63, B = Color & 31;
+    Rgba[0] = (uint8_t)(R << 3 | R >> 2);
+    Rgba[1] = (uint8_t)(G << 2 | G >> 4);
+    Rgba[2] = (uint8_t)(B << 3 | B >> 2);
+    Rgba[3] = 255;
+}
+
+// Four colors mode (Color0 > Color1), or Color0 alone when both are equal
+static int GetBc1Palette(uint16_t Color0, uint16_t Color1, uint8_t Palette[4][4])
+{
+    UnpackRgb565(Color0, Palette[0]);
+    UnpackRgb565(Color1, Palette[1]);
+    if (Color0 == Color1)
+        return 1;
+    for (int c = 0; c < 4; ++c)
+    {
+        Palette[2][c] = (uint8_t)((2 * Palette[0][c] + Palette[1][c]) / 3);
+        Palette[3][c] = (uint8_t)((Palette[0][c] + 2 * Palette[1][c]) / 3);
+    }
+    return 4;
+}
+
+static uint32_t FitBc1(const uint8_t Block[64], const float Start[4], const float End[4], uint16_t* Color0, uint16_t* Color1, uint8_t Indices[16], bool Simd)
+{
+    *Color0 = PackRgb565(End);
+    *Color1 = PackRgb565(Start);
+    if (*Color0 < *Color1)
+        std::swap(*Color0, *Color1);
+
+    uint8_t Palette[4][4];
+    int PaletteSize = GetBc1Palette(*Color0, *Color1, Palette);
+    return FitIndices(Block, Palette, PaletteSize, Indices, Simd);
+}
+
+// Color block of BC1 and BC3 (alpha ignored)
+static void EncodeBc1(uint8_t* Dst, const uint8_t Source[64], bool Simd)
+{
+    uint8_t Block[64];
+    memcpy(Block, Source, sizeof(Block));
+    for (int i = 0; i < 16; ++i)
+        Block[i * 4 + 3] = 255;
+
+    float Start[4], End[4];
+    FitLine(Block, 3, Start, End);
+    uint16_t Color0, Color1;
+    uint8_t Indices[16];
+    uint32_t Error = FitBc1(Block, Start, End, &Color0, &Color1, Indices, Simd);
+
+    // One least squares pass on the indices found (index 2 is 1/3 of Color1, index 3 is 2/3)
+    static const float Weights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+    if (Error > 0 && Color0 != Color1 && RefitLine(Block, 3, Indices, Weights, End, Start))
+    {
+        uint16_t RefitColor0, RefitColor1;
+        uint8_t RefitIndices[16];
+        if (FitBc1(Block, Start, End, &RefitColor0, &RefitColor1, RefitIndices, Simd) < Error)
+        {
+            Color0 = RefitColor0;
+            Color1 = RefitColor1;
+            memcpy(Indices, RefitIndices, sizeof(Indices));
+        }
+    }
+
+    uint32_t Bits = 0;
+    for (int i = 0; i < 16; ++i)
+        Bits |= (uint32_t)Indices[i] << (i * 2);
+    memcpy(Dst, &Color0, 2);
+    memcpy(Dst + 2, &Color1, 2);
+    memcpy(Dst + 4, &Bits, 4);
+}
+
+// Eight values between the channel extremes (Value0 > Value1)
+static int GetBc4Palette(uint8_t Value0, uint8_t Value1, uint8_t Palette[8][4])
+{
+    memset(Palette, 0, 8 * 4);
+    Palette[0][0] = Value0;
+    Palette[1][0] = Value1;
+    if (Value0 <= Value1)
+        return 1;
+    for (int i = 2; i < 8; ++i)
+        Palette[i][0] = (uint8_t)(((8 - i) * Value0 + (i - 1) * Value1) / 7);
+    return 8;
+}
+
+// One channel of the block (alpha of BC3, channels of BC4 and BC5)
+static void EncodeBc4(uint8_t* Dst, const uint8_t Source[64], int Channel, bool Simd)
+{
+    uint8_t Block[64] = {};
+    uint8_t Min = 255, Max = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        uint8_t Value = Source[i * 4 + Channel];
+        Block[i * 4] = Value;
+        Min = Math::Min(Min, Value);
+        Max = Math::Max(Max, Value);
+    }
+
+    uint8_t Palette[8][4];
+    uint8_t Indices[16];
+    FitIndices(Block, Palette, GetBc4Palette(Max, Min, Palette), Indices, Simd);
+
+    uint64_t Bits = 0;
+    for (int i = 0; i < 16; ++i)
+        Bits |= (uint64_t)Indices[i] << (i * 3);
+    Dst[0] = Max;
+    Dst[1] = Min;
+    for (int i = 0; i < 6; ++i)
+        Dst[2 + i] = (uint8_t)(Bits >> (i * 8));
+}
+
+static const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static const float Bc7FloatWeights[16] =
+{
+    0.f / 64.f,  4.f / 64.f,  9.f / 64.f,  13.f / 64.f, 17.f / 64.f, 21.f / 64.f, 26.f / 64.f, 30.f / 64.f,
+    34.f / 64.f, 38.f / 64.f, 43.f / 64.f, 47.f / 64.f, 51.f / 64.f, 55.f / 64.f, 60.f / 64.f, 64.f / 64.f,
+};
+
+// 7 bits per channel and a shared lowest bit (p-bit), the p-bit closest to the endpoint is kept
+static void QuantizeBc7Endpoint(const float Endpoint[4], uint8_t Quantized[4], int* PBit)
+{
+    float BestError = FLT_MAX;
+    for (int Bit = 0; Bit < 2; ++Bit)
+    {
+        uint8_t Values[4];
+        float Error = 0.f;
+        for (int c = 0; c < 4; ++c)
+        {
+            Values[c] = (uint8_t)Math::Clamp((int)((Endpoint[c] - Bit) / 2.f + 0.5f), 0, 127);
+            float Delta = (Values[c] << 1 | Bit) - Endpoint[c];
+            Error += Delta * Delta;
+        }
+        if (Error < BestError)
+        {
+            BestError = Error;
+            memcpy(Quantized, Values, 4);
+            *PBit = Bit;
+        }
+    }
+}
+
+struct bc7_mode6
+{
+    uint8_t Endpoints[2][4]; // 7 bits
+    int PBits[2];
+    uint8_t Indices[16];
+};
+
+static uint32_t FitBc7(const uint8_t Block[64], const float Start[4], const float End[4], bc7_mode6& Mode6, bool Simd)
+{
+    QuantizeBc7Endpoint(Start, Mode6.Endpoints[0], &Mode6.PBits[0]);
+    QuantizeBc7Endpoint(End, Mode6.Endpoints[1], &Mode6.PBits[1]);
+
+    uint8_t Palette[16][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        int Value0 = Mode6.Endpoints[0][c] << 1 | Mode6.PBits[0];
+        int Value1 = Mode6.Endpoints[1][c] << 1 | Mode6.PBits[1];
+        for (int i = 0; i < 16; ++i)
+            Palette[i][c] = (uint8_t)(((64 - Bc7Weights[i]) * Value0 + Bc7Weights[i] * Value1 + 32) >> 6);
+    }
+    return FitIndices(Block, Palette, 16, Mode6.Indices, Simd);
+}
+
+static void WriteBits(uint8_t* Dst, int& Offset, uint32_t Value, int Count)
+{
+    for (int i = 0; i < Count; ++i, ++Offset)
+        Dst[Offset >> 3] |= (uint8_t)(((Value >> i) & 1) << (Offset & 7));
+}
+
+// Mode 6: one subset, RGBA endpoints with p-bits, 4 bits indices
+static void EncodeBc7(uint8_t* Dst, const uint8_t Block[64], bool Simd)
+{
+    float Start[4], End[4];
+    FitLine(Block, 4, Start, End);
+    bc7_mode6 Mode6;
+    uint32_t Error = FitBc7(Block, Start, End, Mode6, Simd);
+
+    bc7_mode6 Refit;
+    if (Error > 0 && RefitLine(Block, 4, Mode6.Indices, Bc7FloatWeights, Start, End) && FitBc7(Block, Start, End, Refit, Simd) < Error)
+        Mode6 = Refit;
+
+    // The first index is stored without its highest bit (swap the endpoints when it is set)
+    if (Mode6.Indices[0] & 8)
+    {
+        std::swap(Mode6.Endpoints[0], Mode6.Endpoints[1]);
+        std::swap(Mode6.PBits[0], Mode6.PBits[1]);
+        for (int i = 0; i < 16; ++i)
+            Mode6.Indices[i] = (uint8_t)(15 - Mode6.Indices[i]);
+    }
+
+    memset(Dst, 0, 16);
+    int Offset = 0;
+    WriteBits(Dst, Offset, 1 << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        WriteBits(Dst, Offset, Mode6.Endpoints[0][c], 7);
+        WriteBits(Dst, Offset, Mode6.Endpoints[1][c], 7);
+    }
+    WriteBits(Dst, Offset, (uint32_t)Mode6.PBits[0], 1);
+    WriteBits(Dst, Offset, (uint32_t)Mode6.PBits[1], 1);
+    for (int i = 0; i < 16; ++i)
+        WriteBits(Dst, Offset, Mode6.Indices[i], i == 0 ? 3 : 4);
+}
+
+static void EncodeBlock(uint8_t* Dst, texture_format Format, const uint8_t Block[64], bool Simd)
+{
+    switch (Format)
+    {
+    case TEXTURE_BC1: EncodeBc1(Dst, Block, Simd); break;
+    case TEXTURE_BC3: EncodeBc4(Dst, Block, 3, Simd); EncodeBc1(Dst + 8, Block, Simd); break;
+    case TEXTURE_BC4: EncodeBc4(Dst, Block, 0, Simd); break;
+    case TEXTURE_BC5: EncodeBc4(Dst, Block, 0, Simd); EncodeBc4(Dst + 8, Block, 1, Simd); break;
+    case TEXTURE_BC7: EncodeBc7(Dst, Block, Simd); break;
+    }
+}
+
+static void CompressImpl(uint8_t* Dst, texture_format Format, const uint8_t* Pixels, int Width, int Height, int Channels, bool Simd)
+{
+    int BlocksX = (Width + 3) / 4;
+    int BlocksY = (Height + 3) / 4;
+    int BlockSize = FormatInfos[Format].BlockSize;
+    Jobs::ParallelFor(BlocksY, 4, [&](int Begin, int End)
+    {
+        uint8_t Block[64];
+        for (int y = Begin; y < End; ++y)
+        {
+            for (int x = 0; x < BlocksX; ++x)
+            {
+                FetchBlock(Block, Pixels, Width, Height, Channels, x, y);
+                EncodeBlock(Dst + ((size_t)y * BlocksX + x) * BlockSize, Format, Block, Simd);
+            }
+        }
+    });
+}
+
+void Texture::Compress(uint8_t* Dst, texture_format Format, const uint8_t* Pixels, int Width, int Height, int Channels)
+{
+    CompressImpl(Dst, Format, Pixels, Width, Height, Channels, true);
+}
+
+void Texture::CompressLevels(std::vector<uint8_t>& Data, texture_format Format, const uint8_t* const* Faces, int FaceCount, int Width, int Height, int Channels,
+                             bool Mipmaps, bool Srgb)
+{
+    int LevelCount = Mipmaps ? Math::Min(GetLevelCount(Width, Height), TEXTURE_MAX_LEVELS) : 1;
+    size_t FaceSize = 0;
+    for (int l = 0; l < LevelCount; ++l)
+        FaceSize += GetCompressedSize(Format, Math::Max(Width >> l, 1), Math::Max(Height >> l, 1));
+    Data.assign(FaceSize * FaceCount, 0);
+
+    // Mips are filtered with the channels of the image, then each level is compressed from RGBA (rows tightly packed)
+    std::vector<std::vector<uint8_t>> Mips;
+    std::vector<uint8_t> Level;
+    uint8_t* Dst = Data.data();
+    for (int Face = 0; Face < FaceCount; ++Face)
+    {
+        GenerateMips(Mips, Faces[Face], Width * Channels, Width, Height, Channels, LevelCount, Srgb);
+        for (int l = 0; l < LevelCount; ++l)
+        {
+            int LevelWidth = Math::Max(Width >> l, 1);
+            int LevelHeight = Math::Max(Height >> l, 1);
+            const uint8_t* Pixels = l == 0 ? Faces[Face] : Mips[l - 1].data();
+            int Pitch = l == 0 ? Width * Channels : GetMipRowSize(LevelWidth, Channels);
+            Level.resize((size_t)LevelWidth * LevelHeight * 4);
+            for (int y = 0; y < LevelHeight; ++y)
+            {
+                for (int x = 0; x < LevelWidth; ++x)
+                {
+                    const uint8_t* Texel = Pixels + (size_t)y * Pitch + x * Channels;
+                    uint8_t* Rgba = &Level[((size_t)y * LevelWidth + x) * 4];
+                    Rgba[0] = Texel[0];
+                    Rgba[1] = Channels > 1 ? Texel[1] : 0;
+                    Rgba[2] = Channels > 2 ? Texel[2] : 0;
+                    Rgba[3] = Channels > 3 ? Texel[3] : 255;
+                }
+            }
+
+            Compress(Dst, Format, Level.data(), LevelWidth, LevelHeight, 4);
+            Dst += GetCompressedSize(Format, LevelWidth, LevelHeight);
+        }
+    }
+}
+
+// DDS layout: magic, header, DX10 header, then the levels of each face
+struct dds_pixel_format
+{
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t FourCC;
+    uint32_t RGBBitCount;
+    uint32_t RBitMask, GBitMask, BBitMask, ABitMask;
+};
+
+struct dds_header
+{
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t Height;
+    uint32_t Width;
+    uint32_t PitchOrLinearSize;
+    uint32_t Depth;
+    uint32_t MipMapCount;
+    uint32_t Reserved1[11]; // DDS_SOURCE_MAGIC and the source hash in the files of WriteDds
+    dds_pixel_format PixelFormat;
+    uint32_t Caps;
+    uint32_t Caps2;
+    uint32_t Caps3;
+    uint32_t Caps4;
+    uint32_t Reserved2;
+};
+
+struct dds_header_dx10
+{
+    uint32_t DxgiFormat;
+    uint32_t ResourceDimension;
+    uint32_t MiscFlag;
+    uint32_t ArraySize;
+    uint32_t MiscFlags2;
+};
+
+const uint32_t DDS_MAGIC = 'D' | ('D' << 8) | ('S' << 16) | (' ' << 24);
+// Ends with the version of the caches (2: mips filtered in linear space), older caches have no source hash and are rebuilt
+const uint32_t DDS_SOURCE_MAGIC = 'S' | ('R' << 8) | ('C' << 16) | ('2' << 24);
+const uint32_t DDS_FOURCC_DX10 = 'D' | ('X' << 8) | ('1' << 16) | ('0' << 24);
+const uint32_t DDSD_REQUIRED = 0x1 | 0x2 | 0x4 | 0x1000; // Caps, height, width, pixel format
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+const uint32_t DDSD_LINEARSIZE = 0x80000;
+const uint32_t DDPF_FOURCC = 0x4;
+const uint32_t DDSCAPS_COMPLEX = 0x8;
+const uint32_t DDSCAPS_TEXTURE = 0x1000;
+const uint32_t DDSCAPS_MIPMAP = 0x400000;
+const uint32_t DDSCAPS2_CUBEMAP_ALL_FACES = 0x200 | 0xFC00;
+const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+const uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+// Legacy DDS files without the DX10 header
+static const struct { uint32_t FourCC; texture_format Format; } DdsFourCCs[] =
+{
+    { 'D' | ('X' << 8) | ('T' << 16) | ('1' << 24), TEXTURE_BC1 },
+    { 'D' | ('X' << 8) | ('T' << 16) | ('5' << 24), TEXTURE_BC3 },
+    { 'A' | ('T' << 8) | ('I' << 16) | ('1' << 24), TEXTURE_BC4 },
+    { 'B' | ('C' << 8) | ('4' << 16) | ('U' << 24), TEXTURE_BC4 },
+    { 'A' | ('T' << 8) | ('I' << 16) | ('2' << 24), TEXTURE_BC5 },
+    { 'B' | ('C' << 8) | ('5' << 16) | ('U' << 24), TEXTURE_BC5 },
+};
+
+bool Texture::WriteDds(const char* Filename, texture_format Format, int Width, int Height, int FaceCount, int LevelCount, const std::vector<uint8_t>& Data, uint64_t SourceHash)
+{
+    dds_header Header = {};
+    Header.Size = sizeof(dds_header);
+    Header.Flags = DDSD_REQUIRED | DDSD_LINEARSIZE | (LevelCount > 1 ? DDSD_MIPMAPCOUNT : 0);
+    Header.Height = (uint32_t)Height;
+    Header.Width = (uint32_t)Width;
+    Header.PitchOrLinearSize = (uint32_t)GetCompressedSize(Format, Width, Height);
+    Header.Depth = 1;
+    Header.MipMapCount = (uint32_t)LevelCount;
+    Header.Reserved1[0] = DDS_SOURCE_MAGIC;
+    Header.Reserved1[1] = (uint32_t)SourceHash;
+    Header.Reserved1[2] = (uint32_t)(SourceHash >> 32);
+    Header.PixelFormat.Size = sizeof(dds_pixel_format);
+    Header.PixelFormat.Flags = DDPF_FOURCC;
+    Header.PixelFormat.FourCC = DDS_FOURCC_DX10;
+    Header.Caps = DDSCAPS_TEXTURE | (LevelCount > 1 || FaceCount > 1 ? DDSCAPS_COMPLEX : 0) | (LevelCount > 1 ? DDSCAPS_MIPMAP : 0);
+    Header.Caps2 = FaceCount == 6 ? DDSCAPS2_CUBEMAP_ALL_FACES : 0;
+
+    dds_header_dx10 Dx10 = {};
+    Dx10.DxgiFormat = FormatInfos[Format].DxgiFormat;
+    Dx10.ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+    Dx10.MiscFlag = FaceCount == 6 ? DDS_MISC_TEXTURECUBE : 0;
+    Dx10.ArraySize = 1;
+
+    FILE* File = fopen(Filename, "wb");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write compressed texture: %s\n", Filename);
+        return false;
+    }
+    fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, File);
+    fwrite(&Header, sizeof(Header), 1, File);
+    fwrite(&Dx10, sizeof(Dx10), 1, File);
+    fwrite(Data.data(), 1, Data.size(), File);
+
+    bool Success = ferror(File) == 0;
+    fclose(File);
+    return Success;
+}
+
+// Point the levels of each face in the mapping (DDS order: levels of face 0, then face 1...)
+static bool SetLevels(compressed_texture& Texture, const uint8_t* Data, const uint8_t* DataEnd)
+{
+    for (int Face = 0; Face < Texture.FaceCount; ++Face)
+    {
+        for (int Level = 0; Level < Texture.LevelCount; ++Level)
+        {
+            size_t Size = Texture::GetCompressedSize(Texture.Format, Math::Max(Texture.Width >> Level, 1), Math::Max(Texture.Height >> Level, 1));
+            if (Size > (size_t)(DataEnd - Data))
+                return false;
+            Texture.Levels[Face][Level] = Data;
+            Data += Size;
+        }
+    }
+    return true;
+}
+
+static bool CheckCompressedTexture(compressed_texture& Texture, const char* Filename, const char* Error)
+{
+    if (Error == nullptr && (Texture.Width <= 0 || Texture.Height <= 0 || (Texture.FaceCount != 1 && Texture.FaceCount != 6)
+                          || Texture.LevelCount < 1 || Texture.LevelCount > Math::Min(Texture::GetLevelCount(Texture.Width, Texture.Height), TEXTURE_MAX_LEVELS)))
+        Error = "invalid header";
+
+    if (Error)
+    {
+        fprintf(stderr, "Invalid compressed texture %s (%s)\n", Filename, Error);
+        Texture::UnmapCompressedTexture(Texture);
+        return false;
+    }
+    return true;
+}
+
+bool Texture::MapDds(compressed_texture& Texture, const char* Filename)
+{
+    Texture = {};
+    if (!File::Map(Texture.Mapping, Filename))
+        return false;
+
+    const uint8_t* Data = (const uint8_t*)Texture.Mapping.Data;
+    const uint8_t* DataEnd = Data + Texture.Mapping.Size;
+    dds_header Header;
+    dds_header_dx10 Dx10 = {};
+    uint32_t Magic = 0;
+    if (Texture.Mapping.Size >= sizeof(Magic) + sizeof(Header))
+    {
+        memcpy(&Magic, Data, sizeof(Magic));
+        memcpy(&Header, Data + sizeof(Magic), sizeof(Header));
+        Data += sizeof(Magic) + sizeof(Header);
+    }
+    if (Magic != DDS_MAGIC || Header.Size != sizeof(dds_header))
+        return CheckCompressedTexture(Texture, Filename, "not a DDS file");
+
+    bool Found = false;
+    if ((Header.PixelFormat.Flags & DDPF_FOURCC) && Header.PixelFormat.FourCC == DDS_FOURCC_DX10)
+    {
+        if ((size_t)(DataEnd - Data) < sizeof(Dx10))
+            return CheckCompressedTexture(Texture, Filename, "truncated header");
+        memcpy(&Dx10, Data, sizeof(Dx10));
+        Data += sizeof(Dx10);
+        for (int Format = TEXTURE_BC1; Format <= TEXTURE_BC7; ++Format)
+        {
+            if (FormatInfos[Format].DxgiFormat == Dx10.DxgiFormat)
+            {
+                Texture.Format = (texture_format)Format;
+                Found = true;
+            }
+        }
+        if (Dx10.ArraySize != 1)
+            return CheckCompressedTexture(Texture, Filename, "texture arrays are not supported");
+    }
+    else if (Header.PixelFormat.Flags & DDPF_FOURCC)
+    {
+        for (const auto& FourCC : DdsFourCCs)
+        {
+            if (FourCC.FourCC == Header.PixelFormat.FourCC)
+            {
+                Texture.Format = FourCC.Format;
+                Found = true;
+            }
+        }
+    }
+    if (!Found)
+        return CheckCompressedTexture(Texture, Filename, "unsupported format");
+
+    Texture.Width = (int)Header.Width;
+    Texture.Height = (int)Header.Height;
+    Texture.FaceCount = (Header.Caps2 & DDSCAPS2_CUBEMAP_ALL_FACES) || (Dx10.MiscFlag & DDS_MISC_TEXTURECUBE) ? 6 : 1;
+    Texture.LevelCount = Header.MipMapCount > 0 ? (int)Header.MipMapCount : 1;
+    if (Header.Reserved1[0] == DDS_SOURCE_MAGIC)
+        Texture.SourceHash = Header.Reserved1[1] | (uint64_t)Header.Reserved1[2] << 32;
+    if (!CheckCompressedTexture(Texture, Filename, nullptr))
+        return false;
+
+    return CheckCompressedTexture(Texture, Filename, SetLevels(Texture, Data, DataEnd) ? nullptr : "truncated data");
+}
+
+bool Texture::MapKtx(compressed_texture& Texture, const char* Filename)
+{
+    static const uint8_t Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    struct ktx_header
+    {
+        uint32_t Endianness;
+        uint32_t GLType, GLTypeSize, GLFormat, GLInternalFormat, GLBaseInternalFormat;
+        uint32_t PixelWidth, PixelHeight, PixelDepth;
+        uint32_t ArrayElementCount, FaceCount, MipmapLevelCount;
+        uint32_t KeyValueDataSize;
+    };
+
+    Texture = {};
+    if (!File::Map(Texture.Mapping, Filename))
+        return false;
+
+    const uint8_t* Data = (const uint8_t*)Texture.Mapping.Data;
+    const uint8_t* DataEnd = Data + Texture.Mapping.Size;
+    ktx_header Header;
+    if (Texture.Mapping.Size < sizeof(Identifier) + sizeof(Header) || memcmp(Data, Identifier, sizeof(Identifier)) != 0)
+        return CheckCompressedTexture(Texture, Filename, "not a KTX file");
+    memcpy(&Header, Data + sizeof(Identifier), sizeof(Header));
+    Data += sizeof(Identifier) + sizeof(Header);
+
+    bool Found = false;
+    for (int Format = TEXTURE_BC1; Format <= TEXTURE_BC7; ++Format)
+    {
+        // The RGBA variant of BC1 is read as BC1 (the encoder never uses its transparent texels)
+        uint32_t GLFormat = FormatInfos[Format].GLFormat;
+        if (Header.GLInternalFormat == GLFormat || (Format == TEXTURE_BC1 && Header.GLInternalFormat == GLFormat + 1))
+        {
+            Texture.Format = (texture_format)Format;
+            Found = true;
+        }
+    }
+    if (Header.Endianness != 0x04030201)
+        return CheckCompressedTexture(Texture, Filename, "big endian file");
+    if (!Found || Header.GLType != 0)
+        return CheckCompressedTexture(Texture, Filename, "unsupported format");
+    if (Header.PixelDepth > 1 || Header.ArrayElementCount > 0)
+        return CheckCompressedTexture(Texture, Filename, "3D textures and texture arrays are not supported");
+    if (Header.KeyValueDataSize > (size_t)(DataEnd - Data))
+        return CheckCompressedTexture(Texture, Filename, "truncated data");
+    Data += Header.KeyValueDataSize;
+
+    Texture.Width = (int)Header.PixelWidth;
+    Texture.Height = (int)Header.PixelHeight;
+    Texture.FaceCount = (int)Header.FaceCount;
+    Texture.LevelCount = Header.MipmapLevelCount > 0 ? (int)Header.MipmapLevelCount : 1;
+    if (!CheckCompressedTexture(Texture, Filename, nullptr))
+        return false;
+
+    // Each level: its size (of one face), then the faces (block sizes keep the 4 bytes alignment without padding)
+    for (int Level = 0; Level < Texture.LevelCount; ++Level)
+    {
+        uint32_t ImageSize = 0;
+        size_t Size = GetCompressedSize(Texture.Format, Math::Max(Texture.Width >> Level, 1), Math::Max(Texture.Height >> Level, 1));
+        if ((size_t)(DataEnd - Data) >= sizeof(ImageSize))
+            memcpy(&ImageSize, Data, sizeof(ImageSize));
+        Data += sizeof(ImageSize);
+        if (ImageSize != Size || Size * Texture.FaceCount > (size_t)(DataEnd - Data))
+            return CheckCompressedTexture(Texture, Filename, "truncated data");
+
+        for (int Face = 0; Face < Texture.FaceCount; ++Face)
+        {
+            Texture.Levels[Face][Level] = Data;
+            Data += Size;
+        }
+    }
+    return true;
+}
+
+bool Texture::IsCompressedTextureFile(const char* Filename)
+{
+    size_t Length = strlen(Filename);
+    return Length > 4 && (strcmp(Filename + Length - 4, ".dds") == 0 || strcmp(Filename + Length - 4, ".ktx") == 0);
+}
+
+bool Texture::MapCompressedTexture(compressed_texture& Texture, const char* Filename)
+{
+    size_t Length = strlen(Filename);
+    if (Length > 4 && strcmp(Filename + Length - 4, ".ktx") == 0)
+        return MapKtx(Texture, Filename);
+    return MapDds(Texture, Filename);
+}
+
+void Texture::UnmapCompressedTexture(compressed_texture& Texture)
+{
+    File::Unmap(Texture.Mapping);
+    Texture = {};
+}
+
+uint64_t Texture::HashBytes(const void* Data, size_t Size, uint64_t Hash)
+{
+    const uint8_t* Bytes = (const uint8_t*)Data;
+    size_t Words = Size / sizeof(uint64_t);
+    for (size_t i = 0; i < Words; ++i)
+    {
+        uint64_t Word;
+        memcpy(&Word, Bytes + i * sizeof(uint64_t), sizeof(Word));
+        Hash = (Hash ^ (Word * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;
+        Hash ^= Hash >> 32;
+    }
+    for (size_t i = Words * sizeof(uint64_t); i < Size; ++i)
+        Hash = (Hash ^ Bytes[i]) * 1099511628211ull;
+    return Hash ^ Size;
+}
+
+bool Texture::HashFiles(const char* const* Filenames, int Count, uint64_t* Hash)
+{
+    *Hash = TEXTURE_HASH_SEED;
+    for (int i = 0; i < Count; ++i)
+    {
+        file_mapping Mapping;
+        if (!File::Map(Mapping, Filenames[i]))
+            return false;
+        *Hash = HashBytes(Mapping.Data, Mapping.Size, *Hash);
+        File::Unmap(Mapping);
+    }
+    return true;
+}
+
+std::string Texture::GetCompressedCacheName(const char* Filename, int FaceCount, int ImageFlags)
+{
+    return std::string(Filename) + (FaceCount == 6 ? ".cubemap." : ".") + std::to_string(ImageFlags) + ".dds";
+}
+
+bool Texture::MapValidCompressedCache(compressed_texture& Texture, const char* Filename, int FaceCount, int ImageFlags, uint64_t SourceHash)
+{
+    std::string CacheName = GetCompressedCacheName(Filename, FaceCount, ImageFlags);
+    uint64_t CacheSize = 0;
+    if (File::GetSize(CacheName.c_str(), &CacheSize) && MapDds(Texture, CacheName.c_str()))
+    {
+        if (Texture.SourceHash == SourceHash && Texture.FaceCount == FaceCount)
+            return true;
+        UnmapCompressedTexture(Texture);
+    }
+    return false;
+}
+
+bool Texture::MapCompressedCache(compressed_texture& Texture, const char* const* Filenames, int FaceCount, int ImageFlags, uint64_t SourceHash,
+                                 const GL::image* Images)
+{
+    if (MapValidCompressedCache(Texture, Filenames[0], FaceCount, ImageFlags, SourceHash))
+        return true;
+    std::string CacheName = GetCompressedCacheName(Filenames[0], FaceCount, ImageFlags);
+
+    std::vector<GL::image> Decoded;
+    bool Success = true;
+    if (!Images)
+    {
+        Decoded.resize(FaceCount);
+        Success = GL::DecodeImages(Decoded.data(), Filenames, FaceCount, ImageFlags);
+        Images = Decoded.data();
+    }
+    std::vector<const uint8_t*> Faces;
+    for (int i = 0; i < FaceCount && Success; ++i)
+    {
+        Success = Images[i].Width == Images[0].Width && Images[i].Height == Images[0].Height && Images[i].Channels == Images[0].Channels;
+        Faces.push_back(Images[i].Data);
+    }
+
+    if (Success)
+    {
+        typedef std::chrono::steady_clock clock;
+        clock::time_point Start = clock::now();
+
+        // Opaque RGBA images are stored without alpha (BC1 instead of BC3)
+        const GL::image& Image = Images[0];
+        bool Opaque = Image.Channels == 4;
+        for (int i = 0; i < FaceCount && Opaque; ++i)
+        {
+            for (size_t t = 0; t < (size_t)Image.Width * Image.Height && Opaque; ++t)
+                Opaque = Images[i].Data[t * 4 + 3] == 255;
+        }
+        texture_format Format = ChooseFormat(Opaque ? 3 : Image.Channels, (ImageFlags & IMG_COMPRESS_BC7) != 0);
+        bool Mipmaps = (ImageFlags & IMG_GEN_MIPMAPS) != 0;
+        std::vector<uint8_t> Data;
+        CompressLevels(Data, Format, Faces.data(), FaceCount, Image.Width, Image.Height, Image.Channels, Mipmaps, !(ImageFlags & IMG_LINEAR));
+        int LevelCount = Mipmaps ? Math::Min(GetLevelCount(Image.Width, Image.Height), TEXTURE_MAX_LEVELS) : 1;
+        Success = WriteDds(CacheName.c_str(), Format, Image.Width, Image.Height, FaceCount, LevelCount, Data, SourceHash)
+               && MapDds(Texture, CacheName.c_str());
+
+        printf("Compressed texture: %s (%s, %d levels, %.1f MB -> %.1f MB in %.0f ms)\n", CacheName.c_str(), FormatInfos[Format].Name, LevelCount,
+               (double)Image.Width * Image.Height * Image.Channels * FaceCount / (1024.0 * 1024.0), Data.size() / (1024.0 * 1024.0),
+               std::chrono::duration<double, std::milli>(clock::now() - Start).count());
+    }
+    else
+    {
+        fprintf(stderr, "Cannot compress %s\n", Filenames[0]);
+    }
+
+    for (GL::image& Image : Decoded)
+    {
+        if (Image.Data)
+            GL::FreeImage(Image);
+    }
+    return Success;
+}
+
+// Decoders of the blocks written above (BC7: mode 6 only), for BenchmarkTextureCodec
+static void DecodeBc1(const uint8_t* Src, uint8_t Block[64])
+{
+    uint16_t Color0, Color1;
+    uint32_t Bits;
+    memcpy(&Color0, Src, 2);
+    memcpy(&Color1, Src + 2, 2);
+    memcpy(&Bits, Src + 4, 4);
+    uint8_t Palette[4][4];
+    GetBc1Palette(Color0, Color1, Palette);
+    if (Color0 <= Color1)
+    {
+        for (int c = 0; c < 3; ++c)
+            Palette[2][c] = (uint8_t)((Palette[0][c] + Palette[1][c]) / 2);
+        memset(Palette[3], 0, 4);
+    }
+    for (int i = 0; i < 16; ++i)
+        memcpy(&Block[i * 4], Palette[(Bits >> (i * 2)) & 3], 3);
+}
+
+static void DecodeBc4(const uint8_t* Src, uint8_t Block[64], int Channel)
+{
+    uint8_t Palette[8][4];
+    GetBc4Palette(Src[0], Src[1], Palette);
+    if (Src[0] <= Src[1])
+    {
+        for (int i = 2; i < 6; ++i)
+            Palette[i][0] = (uint8_t)(((6 - i) * Src[0] + (i - 1) * Src[1]) / 5);
+        Palette[6][0] = 0;
+        Palette[7][0] = 255;
+    }
+    uint64_t Bits = 0;
+    for (int i = 0; i < 6; ++i)
+        Bits |= (uint64_t)Src[2 + i] << (i * 8);
+    for (int i = 0; i < 16; ++i)
+        Block[i * 4 + Channel] = Palette[(Bits >> (i * 3)) & 7][0];
+}
+
+static uint32_t ReadBits(const uint8_t* Src, int& Offset, int Count)
+{
+    uint32_t Value = 0;
+    for (int i = 0; i < Count; ++i, ++Offset)
+        Value |= (uint32_t)((Src[Offset >> 3] >> (Offset & 7)) & 1) << i;
+    return Value;
+}
+
+static void DecodeBc7(const uint8_t* Src, uint8_t Block[64])
+{
+    int Offset = 0;
+    if (ReadBits(Src, Offset, 7) != 1 << 6)
+    {
+        memset(Block, 0, 64);
+        return;
+    }
+    int Endpoints[2][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        Endpoints[0][c] = (int)ReadBits(Src, Offset, 7) << 1;
+        Endpoints[1][c] = (int)ReadBits(Src, Offset, 7) << 1;
+    }
+    int PBit0 = (int)ReadBits(Src, Offset, 1);
+    int PBit1 = (int)ReadBits(Src, Offset, 1);
+    for (int i = 0; i < 16; ++i)
+    {
+        int Index = (int)ReadBits(Src, Offset, i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c)
+            Block[i * 4 + c] = (uint8_t)(((64 - Bc7Weights[Index]) * (Endpoints[0][c] | PBit0) + Bc7Weights[Index] * (Endpoints[1][c] | PBit1) + 32) >> 6);
+    }
+}
+
+static void DecodeBlock(const uint8_t* Src, texture_format Format, uint8_t Block[64])
+{
+    memset(Block, 0, 64);
+    switch (Format)
+    {
+    case TEXTURE_BC1: DecodeBc1(Src, Block); break;
+    case TEXTURE_BC3: DecodeBc1(Src + 8, Block); DecodeBc4(Src, Block, 3); break;
+    case TEXTURE_BC4: DecodeBc4(Src, Block, 0); break;
+    case TEXTURE_BC5: DecodeBc4(Src, Block, 0); DecodeBc4(Src + 8, Block, 1); break;
+    case TEXTURE_BC7: DecodeBc7(Src, Block); break;
+    }
+}
+
+void Texture::BenchmarkTextureCodec(const char* Filename, int ImageFlags)
+{
+    GL::image Image;
+    if (!GL::DecodeImage(Image, Filename, ImageFlags))
+        return;
+
+    size_t Size = (size_t)Image.Width * Image.Height * Image.Channels;
+    printf("%s: %dx%d, %d channels (%.1f MB)\n", Filename, Image.Width, Image.Height, Image.Channels, Size / (1024.0 * 1024.0));
+
+    std::vector<uint8_t> Compressed[2];
+    for (int Format = TEXTURE_BC1; Format <= TEXTURE_BC7; ++Format)
+    {
+        // Error on the channels stored by the format
+        static const int FormatChannels[] = { 3, 4, 1, 2, 4 };
+        int Channels = FormatChannels[Format];
+        float Times[2] = {};
+        for (int Simd = 1; Simd >= 0; --Simd)
+        {
+#ifndef TEXTURE_CODEC_SIMD
+            if (Simd)
+                continue;
+#endif
+            Compressed[Simd].assign(GetCompressedSize((texture_format)Format, Image.Width, Image.Height), 0);
+            std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+            CompressImpl(Compressed[Simd].data(), (texture_format)Format, Image.Data, Image.Width, Image.Height, Image.Channels, Simd != 0);
+            Times[Simd] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - Start).count();
+        }
+
+        double SquaredError = 0.0;
+        int BlocksX = (Image.Width + 3) / 4;
+        for (int y = 0; y < Image.Height; y += 4)
+        {
+            for (int x = 0; x < Image.Width; x += 4)
+            {
+                uint8_t Source[64], Decoded[64];
+                FetchBlock(Source, Image.Data, Image.Width, Image.Height, Image.Channels, x / 4, y / 4);
+                DecodeBlock(&Compressed[0][((size_t)(y / 4) * BlocksX + x / 4) * FormatInfos[Format].BlockSize], (texture_format)Format, Decoded);
+                for (int i = 0; i < 16; ++i)
+                {
+                    if (x + i % 4 >= Image.Width || y + i / 4 >= Image.Height)
+                        continue;
+                    for (int c = 0; c < Channels; ++c)
+                        SquaredError += (double)(Source[i * 4 + c] - Decoded[i * 4 + c]) * (Source[i * 4 + c] - Decoded[i * 4 + c]);
+                }
+            }
+        }
+        double Mse = SquaredError / ((double)Image.Width * Image.Height * Channels);
+        double Psnr = Mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / Mse) : 99.0;
+
+#ifdef TEXTURE_CODEC_SIMD
+        bool Identical = Compressed[0] == Compressed[1];
+        printf("  %s %6.1f KB (x%4.1f), PSNR %5.2f dB, SSE2 %7.1f ms, scalar %7.1f ms %s\n", FormatInfos[Format].Name, Compressed[0].size() / 1024.0,
+               (double)Size / Compressed[0].size(), Psnr, Times[1], Times[0], Identical ? "identical" : "DIFFERENT");
+#else
+        printf("  %s %6.1f KB (x%4.1f), PSNR %5.2f dB, %7.1f ms\n", FormatInfos[Format].Name, Compressed[0].size() / 1024.0,
+               (double)Size / Compressed[0].size(), Psnr, Times[0]);
+#endif
+    }
+
+    GL::FreeImage(Image);
+}
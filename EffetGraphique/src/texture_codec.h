@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_mapping.h"
+
+namespace GL { struct image; }
+
+// Block compressed texture formats (4x4 texels per block)
+enum texture_format
+{
+    TEXTURE_BC1, // RGB, 8 bytes per block (opaque, 4 colors per block)
+    TEXTURE_BC3, // RGBA: BC4 alpha block then BC1 color block, 16 bytes
+    TEXTURE_BC4, // R, 8 bytes
+    TEXTURE_BC5, // RG: two BC4 blocks, 16 bytes
+    TEXTURE_BC7, // RGBA, 16 bytes (encoded with mode 6 only: one RGBA line per block, 16 levels)
+};
+
+const int TEXTURE_MAX_LEVELS = 16;
+const uint64_t TEXTURE_HASH_SEED = 0xcbf29ce484222325ull;
+
+// DDS or KTX file mapped in memory, levels point in the mapping
+struct compressed_texture
+{
+    file_mapping Mapping;
+    texture_format Format;
+    int Width;
+    int Height;
+    int FaceCount;  // 1, or 6 for cubemaps in GL face order (+X, -X, +Y, -Y, +Z, -Z)
+    int LevelCount; // Full mip chain, or fewer levels
+    const uint8_t* Levels[6][TEXTURE_MAX_LEVELS];
+    uint64_t SourceHash; // Hash of the sources written by WriteDds in the reserved header fields, 0 for other files
+};
+
+namespace Texture
+{
+
+int GetBlockSize(texture_format Format);
+size_t GetCompressedSize(texture_format Format, int Width, int Height);
+int GetLevelCount(int Width, int Height);
+// glInternalFormat of the format (GL_COMPRESSED_*)
+uint32_t GetGLFormat(texture_format Format);
+// BC4/BC5 for 1/2 channels, BC1/BC3 for 3/4 channels, or BC7 with HighQuality
+texture_format ChooseFormat(int Channels, bool HighQuality);
+
+// Compress an image (rows tightly packed, Channels 1 to 4) into GetCompressedSize bytes, block rows run on the job threads
+// Missing channels are 0, alpha 255 (a grey image is compressed as its red channel)
+void Compress(uint8_t* Dst, texture_format Format, const uint8_t* Pixels, int Width, int Height, int Channels);
+// Faces (same size and channels) compressed with their mip chain when Mipmaps is set, in DDS order (levels of face 0, then face 1...)
+// Mips are filtered in linear space when Srgb is set (see Texture::GenerateMips)
+void CompressLevels(std::vector<uint8_t>& Data, texture_format Format, const uint8_t* const* Faces, int FaceCount, int Width, int Height, int Channels,
+                    bool Mipmaps, bool Srgb);
+
+// DDS with the DX10 header, Data holds the levels of every face in DDS order
+bool WriteDds(const char* Filename, texture_format Format, int Width, int Height, int FaceCount, int LevelCount, const std::vector<uint8_t>& Data, uint64_t SourceHash);
+bool MapDds(compressed_texture& Texture, const char* Filename);
+// KTX 1.1 with one of the block compressed internal formats above
+bool MapKtx(compressed_texture& Texture, const char* Filename);
+// MapDds or MapKtx depending on the extension
+bool MapCompressedTexture(compressed_texture& Texture, const char* Filename);
+void UnmapCompressedTexture(compressed_texture& Texture);
+bool IsCompressedTextureFile(const char* Filename);
+
+// Content hash of the texture caches (8 bytes per step)
+uint64_t HashBytes(const void* Data, size_t Size, uint64_t Hash = TEXTURE_HASH_SEED);
+// Bytes of every file (faces of a cubemap), false if one can't be read
+bool HashFiles(const char* const* Filenames, int Count, uint64_t* Hash);
+
+// Compressed copy of an image (or the six faces of a cubemap) decoded with ImageFlags (IMG_COMPRESS_BC7 picks BC7 for RGB(A) images),
+// cached next to the first file as <Filename>.<ImageFlags>.dds (<Filename>.cubemap.<ImageFlags>.dds) and rebuilt when SourceHash
+// (HashFiles of the sources) changes. Images: the sources when the caller already decoded them, decoded here otherwise. Runs on any thread
+std::string GetCompressedCacheName(const char* Filename, int FaceCount, int ImageFlags);
+bool MapCompressedCache(compressed_texture& Texture, const char* const* Filenames, int FaceCount, int ImageFlags, uint64_t SourceHash,
+                        const GL::image* Images = nullptr);
+// The cache above only when it is already written and up to date, nothing is decoded
+bool MapValidCompressedCache(compressed_texture& Texture, const char* Filename, int FaceCount, int ImageFlags, uint64_t SourceHash);
+
+// Compression error (PSNR of each format) and speed on an image
+void BenchmarkTextureCodec(const char* Filename, int ImageFlags);
+}
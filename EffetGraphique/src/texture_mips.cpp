@@ -0,0 +1,353 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "maths.h"
+#include "jobs.h"
+#include "opengl_helpers.h"
+#include "texture_codec.h"
+#include "texture_mips.h"
+
+// SSE2 is always available on x64
+#if defined(_M_X64) || defined(__x86_64__)
+#define TEXTURE_MIPS_SIMD
+#include <emmintrin.h>
+#endif
+
+// Destination rows per tile (the Kaiser filter reads 2 * MIP_TILE_ROWS + 4 source rows)
+const int MIP_TILE_ROWS = 16;
+const int MIP_MAX_TAPS = 6;
+
+// Separable 2:1 filter: destination texel x reads the source texels [2x + First; 2x + First + TapCount) (clamped to the edges)
+struct mip_kernel
+{
+    int First;
+    int TapCount;
+    float Weights[MIP_MAX_TAPS];
+};
+
+// Channel layout of the image: how each channel is decoded to linear and encoded back
+struct mip_format
+{
+    int Channels;
+    bool Srgb[4];
+    const float* ToLinear[4];
+};
+
+// Level filtered by a tile: level 0 is read from the image, the next ones from the previous level kept in float (RGBA)
+struct mip_source
+{
+    const uint8_t* Pixels;
+    int Pitch;
+    const float* Texels;
+    int Width;
+    int Height;
+};
+
+// sRGB decoding of the 256 codes, and the linear values halfway between two codes for the encoding
+struct srgb_tables
+{
+    float ToLinear[256];
+    float Unorm[256];      // Linear channels
+    float Thresholds[255]; // Values from Thresholds[k] on are encoded as k + 1 or more
+
+    srgb_tables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            ToLinear[i] = (float)Decode(i / 255.0);
+            Unorm[i] = i / 255.f;
+        }
+        for (int i = 0; i < 255; ++i)
+            Thresholds[i] = (float)Decode((i + 0.5) / 255.0);
+    }
+
+    static double Decode(double Value)
+    {
+        return Value <= 0.04045 ? Value / 12.92 : pow((Value + 0.055) / 1.055, 2.4);
+    }
+};
+
+static const srgb_tables& GetSrgbTables()
+{
+    static const srgb_tables Tables;
+    return Tables;
+}
+
+static uint8_t EncodeSrgb(const srgb_tables& Tables, float Value)
+{
+    int Code = 0;
+    for (int Step = 128; Step > 0; Step >>= 1)
+        Code += Value >= Tables.Thresholds[Code + Step - 1] ? Step : 0;
+    return (uint8_t)Code;
+}
+
+static uint8_t EncodeUnorm(float Value)
+{
+    return (uint8_t)(Math::Clamp(Value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+// Bessel function of the first kind of order 0, for the Kaiser window
+static double BesselI0(double x)
+{
+    double Sum = 1.0;
+    double Term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+        Term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        Sum += Term;
+    }
+    return Sum;
+}
+
+static mip_kernel GetKernel(mip_filter Filter)
+{
+    mip_kernel Kernel = {};
+    if (Filter == MIP_FILTER_BOX)
+    {
+        Kernel.First = 0;
+        Kernel.TapCount = 2;
+        Kernel.Weights[0] = Kernel.Weights[1] = 0.5f;
+        return Kernel;
+    }
+
+    // sinc cut at the destination frequency, windowed over 3 source texels (alpha 4)
+    const double Radius = 3.0;
+    const double Alpha = 4.0;
+    Kernel.First = -2;
+    Kernel.TapCount = 6;
+    double Weights[6];
+    double Sum = 0.0;
+    for (int t = 0; t < 6; ++t)
+    {
+        double Distance = t - 2.5; // From the destination texel center, in source texels
+        double x = Math::Pi() * Distance * 0.5;
+        double Ratio = Distance / Radius;
+        Weights[t] = sin(x) / x * BesselI0(Alpha * sqrt(1.0 - Ratio * Ratio)) / BesselI0(Alpha);
+        Sum += Weights[t];
+    }
+    for (int t = 0; t < 6; ++t)
+        Kernel.Weights[t] = (float)(Weights[t] / Sum);
+    return Kernel;
+}
+
+static mip_format GetFormat(int Channels, bool Srgb)
+{
+    // The last channel of grey alpha and RGBA images is alpha
+    int ColorChannels = Channels == 2 || Channels == 4 ? Channels - 1 : Channels;
+    const srgb_tables& Tables = GetSrgbTables();
+    mip_format Format = {};
+    Format.Channels = Channels;
+    for (int c = 0; c < Channels; ++c)
+    {
+        Format.Srgb[c] = Srgb && c < ColorChannels;
+        Format.ToLinear[c] = Format.Srgb[c] ? Tables.ToLinear : Tables.Unorm;
+    }
+    return Format;
+}
+
+static void LoadRow(float* Dst, const uint8_t* Src, int Width, const mip_format& Format)
+{
+    for (int x = 0; x < Width; ++x, Dst += 4, Src += Format.Channels)
+    {
+        for (int c = 0; c < 4; ++c)
+            Dst[c] = c < Format.Channels ? Format.ToLinear[c][Src[c]] : 0.f;
+    }
+}
+
+static void EncodeRow(uint8_t* Dst, const float* Src, int Width, const mip_format& Format)
+{
+    const srgb_tables& Tables = GetSrgbTables();
+    for (int x = 0; x < Width; ++x, Dst += Format.Channels, Src += 4)
+    {
+        for (int c = 0; c < Format.Channels; ++c)
+            Dst[c] = Format.Srgb[c] ? EncodeSrgb(Tables, Src[c]) : EncodeUnorm(Src[c]);
+    }
+}
+
+// Weighted sum of the taps (RGBA texels), same operations in both paths so the results are identical
+static void FilterTexel(float* Dst, const float* const* Texels, const mip_kernel& Kernel, bool Simd)
+{
+#ifdef TEXTURE_MIPS_SIMD
+    if (Simd)
+    {
+        __m128 Sum = _mm_mul_ps(_mm_loadu_ps(Texels[0]), _mm_set1_ps(Kernel.Weights[0]));
+        for (int t = 1; t < Kernel.TapCount; ++t)
+            Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(Texels[t]), _mm_set1_ps(Kernel.Weights[t])));
+        _mm_storeu_ps(Dst, Sum);
+        return;
+    }
+#endif
+    for (int c = 0; c < 4; ++c)
+    {
+        float Sum = Texels[0][c] * Kernel.Weights[0];
+        for (int t = 1; t < Kernel.TapCount; ++t)
+            Sum += Texels[t][c] * Kernel.Weights[t];
+        Dst[c] = Sum;
+    }
+}
+
+// Destination rows [Y0;Y1): source rows filtered horizontally, then the columns of these rows
+static void FilterTile(const mip_source& Src, float* DstTexels, uint8_t* DstPixels, int DstWidth, int Y0, int Y1,
+                       const mip_kernel& Kernel, const mip_format& Format, bool Simd)
+{
+    int RowBegin = Math::Max(2 * Y0 + Kernel.First, 0);
+    int RowEnd = Math::Min(2 * (Y1 - 1) + Kernel.First + Kernel.TapCount, Src.Height);
+    std::vector<float> Filtered((size_t)(RowEnd - RowBegin) * DstWidth * 4);
+    std::vector<float> Row((size_t)Math::Max(Src.Width, DstWidth) * 4);
+    const float* Texels[MIP_MAX_TAPS];
+
+    for (int y = RowBegin; y < RowEnd; ++y)
+    {
+        const float* SrcRow = Row.data();
+        if (Src.Pixels)
+            LoadRow(Row.data(), Src.Pixels + (size_t)y * Src.Pitch, Src.Width, Format);
+        else
+            SrcRow = Src.Texels + (size_t)y * Src.Width * 4;
+
+        float* FilteredRow = &Filtered[(size_t)(y - RowBegin) * DstWidth * 4];
+        for (int x = 0; x < DstWidth; ++x)
+        {
+            for (int t = 0; t < Kernel.TapCount; ++t)
+                Texels[t] = SrcRow + Math::Clamp(2 * x + Kernel.First + t, 0, Src.Width - 1) * 4;
+            FilterTexel(FilteredRow + x * 4, Texels, Kernel, Simd);
+        }
+    }
+
+    int RowSize = Texture::GetMipRowSize(DstWidth, Format.Channels);
+    for (int y = Y0; y < Y1; ++y)
+    {
+        const float* Rows[MIP_MAX_TAPS];
+        for (int t = 0; t < Kernel.TapCount; ++t)
+            Rows[t] = &Filtered[(size_t)(Math::Clamp(2 * y + Kernel.First + t, 0, Src.Height - 1) - RowBegin) * DstWidth * 4];
+
+        // The last level isn't kept in float
+        float* DstRow = DstTexels ? DstTexels + (size_t)y * DstWidth * 4 : Row.data();
+        for (int x = 0; x < DstWidth; ++x)
+        {
+            for (int t = 0; t < Kernel.TapCount; ++t)
+                Texels[t] = Rows[t] + x * 4;
+            FilterTexel(DstRow + x * 4, Texels, Kernel, Simd);
+        }
+        EncodeRow(DstPixels + (size_t)y * RowSize, DstRow, DstWidth, Format);
+    }
+}
+
+static void GenerateMipsImpl(std::vector<std::vector<uint8_t>>& Levels, const uint8_t* Pixels, int Pitch, int Width, int Height, int Channels,
+                             int LevelCount, bool Srgb, mip_filter Filter, bool Simd)
+{
+    mip_format Format = GetFormat(Channels, Srgb);
+    mip_kernel Kernel = GetKernel(Filter);
+    Levels.resize(Math::Max(LevelCount - 1, 0));
+
+    // Levels in float, alternately written and read
+    std::vector<float> Texels[2];
+    mip_source Src = { Pixels, Pitch, nullptr, Width, Height };
+    for (int l = 1; l < LevelCount; ++l)
+    {
+        int DstWidth = Math::Max(Src.Width / 2, 1);
+        int DstHeight = Math::Max(Src.Height / 2, 1);
+        std::vector<uint8_t>& Level = Levels[l - 1];
+        Level.assign((size_t)Texture::GetMipRowSize(DstWidth, Channels) * DstHeight, 0);
+        std::vector<float>& DstTexels = Texels[l & 1];
+        DstTexels.resize(l + 1 < LevelCount ? (size_t)DstWidth * DstHeight * 4 : 0);
+        float* DstData = DstTexels.empty() ? nullptr : DstTexels.data();
+
+        int TileCount = (DstHeight + MIP_TILE_ROWS - 1) / MIP_TILE_ROWS;
+        Jobs::ParallelFor(TileCount, 1, [&](int Begin, int End)
+        {
+            for (int Tile = Begin; Tile < End; ++Tile)
+            {
+                FilterTile(Src, DstData, Level.data(), DstWidth, Tile * MIP_TILE_ROWS, Math::Min((Tile + 1) * MIP_TILE_ROWS, DstHeight),
+                           Kernel, Format, Simd);
+            }
+        });
+
+        Src = { nullptr, 0, DstData, DstWidth, DstHeight };
+    }
+}
+
+int Texture::GetMipRowSize(int Width, int Channels)
+{
+    return (Width * Channels + 3) & ~3;
+}
+
+void Texture::GenerateMips(std::vector<std::vector<uint8_t>>& Levels, const uint8_t* Pixels, int Pitch, int Width, int Height, int Channels,
+                           int LevelCount, bool Srgb, mip_filter Filter)
+{
+    GenerateMipsImpl(Levels, Pixels, Pitch, Width, Height, Channels, LevelCount, Srgb, Filter, true);
+}
+
+// Mean of the color channels in linear space
+static double MeasureBrightness(const uint8_t* Pixels, int Pitch, int Width, int Height, int Channels)
+{
+    int ColorChannels = Channels == 2 || Channels == 4 ? Channels - 1 : Channels;
+    const srgb_tables& Tables = GetSrgbTables();
+    double Sum = 0.0;
+    for (int y = 0; y < Height; ++y)
+    {
+        const uint8_t* Row = Pixels + (size_t)y * Pitch;
+        for (int x = 0; x < Width; ++x)
+        {
+            for (int c = 0; c < ColorChannels; ++c)
+                Sum += Tables.ToLinear[Row[x * Channels + c]];
+        }
+    }
+    return Sum / ((double)Width * Height * ColorChannels);
+}
+
+void Texture::BenchmarkMips(const char* Filename, int ImageFlags)
+{
+    GL::image Image;
+    if (!GL::DecodeImage(Image, Filename, ImageFlags))
+        return;
+
+    int LevelCount = GetLevelCount(Image.Width, Image.Height);
+    int Pitch = Image.Width * Image.Channels;
+    double Brightness = MeasureBrightness(Image.Data, Pitch, Image.Width, Image.Height, Image.Channels);
+    printf("%s: %dx%d, %d channels, %d levels, linear brightness %.4f\n", Filename, Image.Width, Image.Height, Image.Channels, LevelCount, Brightness);
+
+    // The gamma space box filter is the one of glGenerateMipmap on textures which aren't GL_SRGB8
+    struct { const char* Name; mip_filter Filter; bool Srgb; } Configs[] =
+    {
+        { "box, gamma space", MIP_FILTER_BOX, false },
+        { "box, linear",      MIP_FILTER_BOX, true },
+        { "Kaiser, linear",   MIP_FILTER_KAISER, true },
+    };
+    int MeasuredLevel = Math::Min(4, LevelCount - 1);
+    for (const auto& Config : Configs)
+    {
+        std::vector<std::vector<uint8_t>> Levels[2];
+        float Times[2] = {};
+        for (int Simd = 1; Simd >= 0; --Simd)
+        {
+#ifndef TEXTURE_MIPS_SIMD
+            if (Simd)
+                continue;
+#endif
+            std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+            GenerateMipsImpl(Levels[Simd], Image.Data, Pitch, Image.Width, Image.Height, Image.Channels, LevelCount, Config.Srgb, Config.Filter, Simd != 0);
+            Times[Simd] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - Start).count();
+        }
+
+        double LevelBrightness = Brightness;
+        if (MeasuredLevel > 0)
+        {
+            int Width = Math::Max(Image.Width >> MeasuredLevel, 1);
+            int Height = Math::Max(Image.Height >> MeasuredLevel, 1);
+            LevelBrightness = MeasureBrightness(Levels[0][MeasuredLevel - 1].data(), GetMipRowSize(Width, Image.Channels), Width, Height, Image.Channels);
+        }
+        double Change = Brightness > 0.0 ? 100.0 * (LevelBrightness / Brightness - 1.0) : 0.0;
+
+#ifdef TEXTURE_MIPS_SIMD
+        bool Identical = Levels[0] == Levels[1];
+        printf("  %-16s SSE2 %6.1f ms, scalar %6.1f ms %s, level %d brightness %+.2f%%\n", Config.Name, Times[1], Times[0],
+               Identical ? "identical" : "DIFFERENT", MeasuredLevel, Change);
+#else
+        printf("  %-16s %6.1f ms, level %d brightness %+.2f%%\n", Config.Name, Times[0], MeasuredLevel, Change);
+#endif
+    }
+
+    GL::FreeImage(Image);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Filters of the mip chains built on the cpu (see Texture::GenerateMips)
+enum mip_filter
+{
+    MIP_FILTER_BOX,    // 2x2 average, the filter of most glGenerateMipmap implementations
+    MIP_FILTER_KAISER, // 6x6 Kaiser windowed sinc: sharper levels with less aliasing
+};
+
+namespace Texture
+{
+
+// Rows of the levels written by GenerateMips are aligned on 4 bytes (the default GL_UNPACK_ALIGNMENT)
+int GetMipRowSize(int Width, int Channels);
+
+// Levels 1 to LevelCount - 1 of an image (Channels 1 to 4, rows of Pitch bytes), each level filtered from the previous one kept in float
+// With Srgb, the color channels are sRGB encoded: they are filtered in linear space (alpha is always linear)
+// Levels are split in tiles of rows filtered on the job threads (SSE2, one texel per register)
+void GenerateMips(std::vector<std::vector<uint8_t>>& Levels, const uint8_t* Pixels, int Pitch, int Width, int Height, int Channels,
+                  int LevelCount, bool Srgb, mip_filter Filter = MIP_FILTER_KAISER);
+
+// Speed of the filters and brightness of the levels compared to the gamma space box filter
+void BenchmarkMips(const char* Filename, int ImageFlags);
+}
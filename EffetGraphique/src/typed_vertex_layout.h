@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "opengl_headers.h"
+#include "mesh.h"
+
+// Vertex layout described at compile time from a vertex struct and its attributes (member + shader location)
+// Generates the vertex_descriptor, a branch free conversion from vertex_full and the VAO setup
+//
+//     struct vertex { v3 Position; v2 UV; };
+//     typedef typed_vertex_layout<vertex,
+//         position_attribute<vertex, &vertex::Position, 0>,
+//         uv_attribute<vertex, &vertex::UV, 1>> vertex_layout_type;
+//
+//     Quad = GLCache.LoadPrimitive<vertex_layout_type>(GL::PRIMITIVE_QUAD); // Vertices written by vertex_layout_type::Convert
+//     VAO = vertex_layout_type::CreateVertexArray(Quad->VertexBuffer);
+
+// A member pointer can't give its offset in a constant expression (C++14): measured once per member on a vertex
+template<typename V, typename M, M V::*Member>
+inline int GetMemberOffset()
+{
+    static_assert(std::is_standard_layout<V>::value, "Vertex struct must be standard layout");
+    static const int Offset = []()
+    {
+        V Vertex = {};
+        return (int)((uint8_t*)&(Vertex.*Member) - (uint8_t*)&Vertex);
+    }();
+    return Offset;
+}
+
+template<typename V, v3 V::*Member, GLuint Location>
+struct position_attribute
+{
+    static void Describe(vertex_descriptor& Descriptor) { Descriptor.PositionOffset = GetMemberOffset<V, v3, Member>(); }
+    static void Convert(V& Dst, const vertex_full& Src) { Dst.*Member = Src.Position; }
+    static void Bind()
+    {
+        glEnableVertexAttribArray(Location);
+        glVertexAttribPointer(Location, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)(size_t)GetMemberOffset<V, v3, Member>());
+    }
+};
+
+template<typename V, v3 V::*Member, GLuint Location>
+struct normal_attribute
+{
+    static void Describe(vertex_descriptor& Descriptor)
+    {
+        Descriptor.HasNormal = true;
+        Descriptor.NormalOffset = GetMemberOffset<V, v3, Member>();
+    }
+    static void Convert(V& Dst, const vertex_full& Src) { Dst.*Member = Src.Normal; }
+    static void Bind()
+    {
+        glEnableVertexAttribArray(Location);
+        glVertexAttribPointer(Location, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)(size_t)GetMemberOffset<V, v3, Member>());
+    }
+};
+
+template<typename V, v2 V::*Member, GLuint Location>
+struct uv_attribute
+{
+    static void Describe(vertex_descriptor& Descriptor)
+    {
+        Descriptor.HasUV = true;
+        Descriptor.UVOffset = GetMemberOffset<V, v2, Member>();
+    }
+    static void Convert(V& Dst, const vertex_full& Src) { Dst.*Member = Src.UV; }
+    static void Bind()
+    {
+        glEnableVertexAttribArray(Location);
+        glVertexAttribPointer(Location, 2, GL_FLOAT, GL_FALSE, sizeof(V), (void*)(size_t)GetMemberOffset<V, v2, Member>());
+    }
+};
+
+template<typename V, typename... Attributes>
+struct typed_vertex_layout
+{
+    typedef V vertex;
+
+    static vertex_descriptor Descriptor()
+    {
+        vertex_descriptor Descriptor = {};
+        Descriptor.Stride = sizeof(V);
+        int Expand[] = { 0, (Attributes::Describe(Descriptor), 0)... };
+        (void)Expand;
+        return Descriptor;
+    }
+
+    // Attribute copies are resolved at compile time: plain strided copies the compiler can vectorize
+    static V* Convert(V* __restrict VerticesDst, const vertex_full* __restrict VerticesSrc, int Count)
+    {
+        for (int i = 0; i < Count; ++i)
+        {
+            int Expand[] = { 0, (Attributes::Convert(VerticesDst[i], VerticesSrc[i]), 0)... };
+            (void)Expand;
+        }
+        return VerticesDst + Count;
+    }
+
+    // Enable and setup the attributes of the bound vertex buffer
+    static void BindAttributes()
+    {
+        int Expand[] = { 0, (Attributes::Bind(), 0)... };
+        (void)Expand;
+    }
+
+    // Create a vertex array sourcing its attributes from VertexBuffer (the vertex array stays bound)
+    static GLuint CreateVertexArray(GLuint VertexBuffer)
+    {
+        GLuint VAO = 0;
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+        BindAttributes();
+        return VAO;
+    }
+};
@@ -0,0 +1,407 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#include "maths.h"
+#include "platform.h"
+#include "vertex_encoding.h"
+
+using namespace Mesh;
+
+// IEEE 754 binary16 conversions (round to nearest even)
+static uint16_t FloatToHalf(float Value)
+{
+    uint32_t Bits;
+    memcpy(&Bits, &Value, sizeof(Bits));
+
+    uint16_t Sign = (uint16_t)((Bits >> 16) & 0x8000);
+    int FloatExponent = (int)((Bits >> 23) & 0xFF);
+    uint32_t Mantissa = Bits & 0x7FFFFF;
+
+    if (FloatExponent == 0xFF) // Inf/NaN
+        return Sign | 0x7C00 | (Mantissa ? 0x200 : 0);
+
+    int Exponent = FloatExponent - 127 + 15;
+    if (Exponent >= 31) // Overflow
+        return Sign | 0x7C00;
+
+    uint32_t Half;
+    uint32_t Rest;
+    uint32_t Halfway;
+    if (Exponent <= 0)
+    {
+        // Denormalized half
+        if (Exponent < -10)
+            return Sign;
+        Mantissa |= 0x800000;
+        int Shift = 14 - Exponent;
+        Half = Mantissa >> Shift;
+        Rest = Mantissa & ((1u << Shift) - 1);
+        Halfway = 1u << (Shift - 1);
+    }
+    else
+    {
+        Half = ((uint32_t)Exponent << 10) | (Mantissa >> 13);
+        Rest = Mantissa & 0x1FFF;
+        Halfway = 0x1000;
+    }
+
+    // Carry can overflow in the exponent (gives the next power of two or inf)
+    if (Rest > Halfway || (Rest == Halfway && (Half & 1)))
+        Half++;
+
+    return Sign | (uint16_t)Half;
+}
+
+static float HalfToFloat(uint16_t Half)
+{
+    uint32_t Sign = (uint32_t)(Half & 0x8000) << 16;
+    uint32_t Exponent = (Half >> 10) & 0x1F;
+    uint32_t Mantissa = Half & 0x3FF;
+
+    if (Exponent == 0)
+    {
+        float Value = std::ldexp((float)Mantissa, -24);
+        return Sign ? -Value : Value;
+    }
+
+    uint32_t Bits;
+    if (Exponent == 31)
+        Bits = Sign | 0x7F800000 | (Mantissa << 13);
+    else
+        Bits = Sign | ((Exponent + 112) << 23) | (Mantissa << 13);
+
+    float Value;
+    memcpy(&Value, &Bits, sizeof(Value));
+    return Value;
+}
+
+static uint16_t FloatToUnorm16(float Value)
+{
+    return (uint16_t)(Math::Clamp(Value, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+static float Unorm16ToFloat(uint16_t Value)
+{
+    return Value / 65535.f;
+}
+
+static float SignNotZero(float Value)
+{
+    return Value >= 0.f ? 1.f : -1.f;
+}
+
+// Same as octDecode() in GetVertexDecodingFunctions()
+static v3 OctDecode(const int16_t* Encoded)
+{
+    float X = Encoded[0] / 32767.f;
+    float Y = Encoded[1] / 32767.f;
+    v3 Normal = { X, Y, 1.f - std::fabs(X) - std::fabs(Y) };
+    float T = Math::Max(-Normal.z, 0.f);
+    Normal.x += Normal.x >= 0.f ? -T : T;
+    Normal.y += Normal.y >= 0.f ? -T : T;
+    return Vec3::Normalize(Normal);
+}
+
+// "A Survey of Efficient Representations for Independent Unit Vectors" (Cigolle et al. 2014)
+// Keep the best of the 4 roundings around the projected point
+static void OctEncode(int16_t* Encoded, v3 Normal)
+{
+    float L1Norm = std::fabs(Normal.x) + std::fabs(Normal.y) + std::fabs(Normal.z);
+    if (L1Norm == 0.f)
+    {
+        Encoded[0] = Encoded[1] = 0;
+        return;
+    }
+
+    float X = Normal.x / L1Norm;
+    float Y = Normal.y / L1Norm;
+    if (Normal.z < 0.f)
+    {
+        float FoldedX = (1.f - std::fabs(Y)) * SignNotZero(X);
+        float FoldedY = (1.f - std::fabs(X)) * SignNotZero(Y);
+        X = FoldedX;
+        Y = FoldedY;
+    }
+
+    v3 Reference = Vec3::Normalize(Normal);
+    float FloorX = std::floor(X * 32767.f);
+    float FloorY = std::floor(Y * 32767.f);
+    float BestDot = -2.f;
+    for (int i = 0; i < 4; ++i)
+    {
+        int16_t Candidate[2] = {
+            (int16_t)Math::Clamp(FloorX + (i & 1), -32767.f, 32767.f),
+            (int16_t)Math::Clamp(FloorY + (i >> 1), -32767.f, 32767.f),
+        };
+        float Dot = Vec3::Dot(OctDecode(Candidate), Reference);
+        if (Dot > BestDot)
+        {
+            BestDot = Dot;
+            Encoded[0] = Candidate[0];
+            Encoded[1] = Candidate[1];
+        }
+    }
+}
+
+static int GetAttributeSize(vertex_attribute_format Format, int ComponentCount)
+{
+    switch (Format)
+    {
+    case VERTEX_FORMAT_FLOAT:   return ComponentCount * 4;
+    case VERTEX_FORMAT_HALF:
+    case VERTEX_FORMAT_UNORM16: return (ComponentCount * 2 + 3) & ~3; // Keep attributes 4 bytes aligned
+    case VERTEX_FORMAT_OCT16:   return 4;
+    default:                    return 0;
+    }
+}
+
+static v3 GetExtent(v3 BoundsMin, v3 BoundsMax)
+{
+    // Avoid divisions by zero on flat meshes
+    v3 Extent = BoundsMax - BoundsMin;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (Extent.e[i] <= 0.f)
+            Extent.e[i] = 1.f;
+    }
+    return Extent;
+}
+
+vertex_layout Mesh::MakeVertexLayout(vertex_attribute_format PositionFormat, vertex_attribute_format NormalFormat, vertex_attribute_format UVFormat)
+{
+    vertex_layout Layout = {};
+    Layout.PositionFormat = PositionFormat;
+    Layout.PositionOffset = Layout.Stride;
+    Layout.Stride += GetAttributeSize(PositionFormat, 3);
+
+    Layout.NormalFormat = NormalFormat;
+    Layout.NormalOffset = Layout.Stride;
+    Layout.Stride += GetAttributeSize(NormalFormat, 3);
+
+    Layout.UVFormat = UVFormat;
+    Layout.UVOffset = Layout.Stride;
+    Layout.Stride += GetAttributeSize(UVFormat, 2);
+    return Layout;
+}
+
+bool Mesh::IsFullVertexLayout(const vertex_layout& Layout)
+{
+    return Layout.PositionFormat == VERTEX_FORMAT_FLOAT
+        && Layout.NormalFormat == VERTEX_FORMAT_FLOAT
+        && Layout.UVFormat == VERTEX_FORMAT_FLOAT
+        && Layout.Stride == sizeof(vertex_full);
+}
+
+const char* Mesh::GetVertexFormatName(vertex_attribute_format Format)
+{
+    switch (Format)
+    {
+    case VERTEX_FORMAT_FLOAT:   return "float";
+    case VERTEX_FORMAT_HALF:    return "half";
+    case VERTEX_FORMAT_UNORM16: return "unorm16";
+    case VERTEX_FORMAT_OCT16:   return "oct16";
+    default:                    return "none";
+    }
+}
+
+void* Mesh::EncodeVertices(void* VerticesDst, const vertex_layout& Layout, const vertex_full* VerticesSrc, int Count, v3 BoundsMin, v3 BoundsMax)
+{
+    uint8_t* Buffer = (uint8_t*)VerticesDst;
+    v3 Extent = GetExtent(BoundsMin, BoundsMax);
+
+    for (int i = 0; i < Count; ++i)
+    {
+        const vertex_full& VertexSrc = VerticesSrc[i];
+        uint8_t* VertexStart = Buffer + i * Layout.Stride;
+
+        uint8_t* PositionDst = VertexStart + Layout.PositionOffset;
+        if (Layout.PositionFormat == VERTEX_FORMAT_FLOAT)
+        {
+            memcpy(PositionDst, &VertexSrc.Position, sizeof(v3));
+        }
+        else if (Layout.PositionFormat == VERTEX_FORMAT_HALF || Layout.PositionFormat == VERTEX_FORMAT_UNORM16)
+        {
+            uint16_t Encoded[4] = {};
+            for (int j = 0; j < 3; ++j)
+            {
+                float Relative = (VertexSrc.Position.e[j] - BoundsMin.e[j]) / Extent.e[j];
+                Encoded[j] = Layout.PositionFormat == VERTEX_FORMAT_HALF ? FloatToHalf(Relative) : FloatToUnorm16(Relative);
+            }
+            memcpy(PositionDst, Encoded, sizeof(Encoded));
+        }
+
+        uint8_t* NormalDst = VertexStart + Layout.NormalOffset;
+        if (Layout.NormalFormat == VERTEX_FORMAT_FLOAT)
+        {
+            memcpy(NormalDst, &VertexSrc.Normal, sizeof(v3));
+        }
+        else if (Layout.NormalFormat == VERTEX_FORMAT_OCT16)
+        {
+            int16_t Encoded[2];
+            OctEncode(Encoded, VertexSrc.Normal);
+            memcpy(NormalDst, Encoded, sizeof(Encoded));
+        }
+
+        uint8_t* UVDst = VertexStart + Layout.UVOffset;
+        if (Layout.UVFormat == VERTEX_FORMAT_FLOAT)
+        {
+            memcpy(UVDst, &VertexSrc.UV, sizeof(v2));
+        }
+        else if (Layout.UVFormat == VERTEX_FORMAT_HALF || Layout.UVFormat == VERTEX_FORMAT_UNORM16)
+        {
+            uint16_t Encoded[2];
+            for (int j = 0; j < 2; ++j)
+                Encoded[j] = Layout.UVFormat == VERTEX_FORMAT_HALF ? FloatToHalf(VertexSrc.UV.e[j]) : FloatToUnorm16(VertexSrc.UV.e[j]);
+            memcpy(UVDst, Encoded, sizeof(Encoded));
+        }
+    }
+
+    return Buffer + Layout.Stride * Count;
+}
+
+void Mesh::DecodeVertices(vertex_full* VerticesDst, const vertex_layout& Layout, const void* VerticesSrc, int Count, v3 BoundsMin, v3 BoundsMax)
+{
+    const uint8_t* Buffer = (const uint8_t*)VerticesSrc;
+    v3 Extent = GetExtent(BoundsMin, BoundsMax);
+
+    for (int i = 0; i < Count; ++i)
+    {
+        vertex_full& VertexDst = VerticesDst[i];
+        VertexDst = {};
+        const uint8_t* VertexStart = Buffer + i * Layout.Stride;
+
+        const uint8_t* PositionSrc = VertexStart + Layout.PositionOffset;
+        if (Layout.PositionFormat == VERTEX_FORMAT_FLOAT)
+        {
+            memcpy(&VertexDst.Position, PositionSrc, sizeof(v3));
+        }
+        else if (Layout.PositionFormat == VERTEX_FORMAT_HALF || Layout.PositionFormat == VERTEX_FORMAT_UNORM16)
+        {
+            uint16_t Encoded[3];
+            memcpy(Encoded, PositionSrc, sizeof(Encoded));
+            for (int j = 0; j < 3; ++j)
+            {
+                float Relative = Layout.PositionFormat == VERTEX_FORMAT_HALF ? HalfToFloat(Encoded[j]) : Unorm16ToFloat(Encoded[j]);
+                VertexDst.Position.e[j] = BoundsMin.e[j] + Relative * Extent.e[j];
+            }
+        }
+
+        const uint8_t* NormalSrc = VertexStart + Layout.NormalOffset;
+        if (Layout.NormalFormat == VERTEX_FORMAT_FLOAT)
+        {
+            memcpy(&VertexDst.Normal, NormalSrc, sizeof(v3));
+        }
+        else if (Layout.NormalFormat == VERTEX_FORMAT_OCT16)
+        {
+            int16_t Encoded[2];
+            memcpy(Encoded, NormalSrc, sizeof(Encoded));
+            VertexDst.Normal = OctDecode(Encoded);
+        }
+
+        const uint8_t* UVSrc = VertexStart + Layout.UVOffset;
+        if (Layout.UVFormat == VERTEX_FORMAT_FLOAT)
+        {
+            memcpy(&VertexDst.UV, UVSrc, sizeof(v2));
+        }
+        else if (Layout.UVFormat == VERTEX_FORMAT_HALF || Layout.UVFormat == VERTEX_FORMAT_UNORM16)
+        {
+            uint16_t Encoded[2];
+            memcpy(Encoded, UVSrc, sizeof(Encoded));
+            for (int j = 0; j < 2; ++j)
+                VertexDst.UV.e[j] = Layout.UVFormat == VERTEX_FORMAT_HALF ? HalfToFloat(Encoded[j]) : Unorm16ToFloat(Encoded[j]);
+        }
+    }
+}
+
+mat4 Mesh::GetPositionDequantization(const vertex_layout& Layout, v3 BoundsMin, v3 BoundsMax)
+{
+    if (Layout.PositionFormat != VERTEX_FORMAT_HALF && Layout.PositionFormat != VERTEX_FORMAT_UNORM16)
+        return Mat4::Identity();
+
+    return Mat4::Translate(BoundsMin) * Mat4::Scale(GetExtent(BoundsMin, BoundsMax));
+}
+
+vertex_encoding_error Mesh::MeasureEncodingError(const vertex_layout& Layout, const vertex_full* Vertices, int Count, v3 BoundsMin, v3 BoundsMax)
+{
+    vertex_encoding_error Error = {};
+    if (Count == 0)
+        return Error;
+
+    std::vector<uint8_t> Encoded(Count * Layout.Stride);
+    std::vector<vertex_full> Decoded(Count);
+    EncodeVertices(Encoded.data(), Layout, Vertices, Count, BoundsMin, BoundsMax);
+    DecodeVertices(Decoded.data(), Layout, Encoded.data(), Count, BoundsMin, BoundsMax);
+
+    int NormalCount = 0;
+    for (int i = 0; i < Count; ++i)
+    {
+        const vertex_full& A = Vertices[i];
+        const vertex_full& B = Decoded[i];
+
+        if (Layout.PositionFormat != VERTEX_FORMAT_NONE)
+        {
+            float PositionError = Vec3::Length(A.Position - B.Position);
+            Error.PositionMax = Math::Max(Error.PositionMax, PositionError);
+            Error.PositionMean += PositionError;
+        }
+
+        // Angle with the normalized source normal (degenerated normals are skipped)
+        float NormalLength = Vec3::Length(A.Normal);
+        if (Layout.NormalFormat != VERTEX_FORMAT_NONE && NormalLength > 0.f)
+        {
+            float Cos = Math::Clamp(Vec3::Dot(A.Normal / NormalLength, Vec3::Normalize(B.Normal)), -1.f, 1.f);
+            float NormalError = Math::ToDegrees(std::acos(Cos));
+            Error.NormalMax = Math::Max(Error.NormalMax, NormalError);
+            Error.NormalMean += NormalError;
+            NormalCount++;
+        }
+
+        if (Layout.UVFormat != VERTEX_FORMAT_NONE)
+        {
+            float UVError = Math::Sqrt((A.UV.x - B.UV.x) * (A.UV.x - B.UV.x) + (A.UV.y - B.UV.y) * (A.UV.y - B.UV.y));
+            Error.UVMax = Math::Max(Error.UVMax, UVError);
+            Error.UVMean += UVError;
+        }
+    }
+
+    Error.PositionMean /= Count;
+    Error.NormalMean /= Math::Max(NormalCount, 1);
+    Error.UVMean /= Count;
+    return Error;
+}
+
+void Mesh::ReportVertexEncodings(const char* Filename)
+{
+    mapped_mesh MappedMesh;
+    if (!Mesh::MapObj(MappedMesh, Filename))
+    {
+        Mesh::UnmapObj(MappedMesh);
+        return;
+    }
+
+    const vertex_attribute_format Formats[][3] = {
+        { VERTEX_FORMAT_FLOAT,   VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_FLOAT },
+        { VERTEX_FORMAT_FLOAT,   VERTEX_FORMAT_OCT16, VERTEX_FORMAT_HALF },
+        { VERTEX_FORMAT_HALF,    VERTEX_FORMAT_OCT16, VERTEX_FORMAT_HALF },
+        { VERTEX_FORMAT_UNORM16, VERTEX_FORMAT_OCT16, VERTEX_FORMAT_HALF },
+        { VERTEX_FORMAT_UNORM16, VERTEX_FORMAT_OCT16, VERTEX_FORMAT_UNORM16 },
+    };
+
+    v3 Extent = MappedMesh.BoundsMax - MappedMesh.BoundsMin;
+    printf("%s: %d vertices, bounds size (%.3f, %.3f, %.3f)\n", Filename, MappedMesh.VertexCount, Extent.x, Extent.y, Extent.z);
+    printf("%-8s %-7s %-8s %6s %10s %21s %21s %21s\n", "position", "normal", "uv", "stride", "size (KB)", "position error (max/mean)", "normal error (deg)", "uv error");
+    for (int i = 0; i < (int)ARRAY_SIZE(Formats); ++i)
+    {
+        vertex_layout Layout = MakeVertexLayout(Formats[i][0], Formats[i][1], Formats[i][2]);
+        vertex_encoding_error Error = MeasureEncodingError(Layout, MappedMesh.Vertices, MappedMesh.VertexCount, MappedMesh.BoundsMin, MappedMesh.BoundsMax);
+        printf("%-8s %-7s %-8s %6d %10.1f %10.2e/%10.2e %10.4f/%10.4f %10.2e/%10.2e\n",
+            GetVertexFormatName(Layout.PositionFormat), GetVertexFormatName(Layout.NormalFormat), GetVertexFormatName(Layout.UVFormat),
+            Layout.Stride, MappedMesh.VertexCount * Layout.Stride / 1024.f,
+            Error.PositionMax, Error.PositionMean, Error.NormalMax, Error.NormalMean, Error.UVMax, Error.UVMean);
+    }
+
+    Mesh::UnmapObj(MappedMesh);
+}
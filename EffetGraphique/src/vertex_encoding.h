@@ -0,0 +1,59 @@
+#pragma once
+
+#include "mesh.h"
+
+// Attribute encodings of compressed vertex formats
+enum vertex_attribute_format
+{
+    VERTEX_FORMAT_NONE,    // Attribute not stored
+    VERTEX_FORMAT_FLOAT,   // 32 bits floats
+    VERTEX_FORMAT_HALF,    // 16 bits floats (positions are relative to the mesh bounds)
+    VERTEX_FORMAT_UNORM16, // 16 bits fixed point in [0;1] (positions are relative to the mesh bounds, UVs are clamped)
+    VERTEX_FORMAT_OCT16,   // Normals only: octahedral mapping stored in 2 x int16 (unnormalized, see GetVertexDecodingFunctions)
+};
+
+// Interleaved vertex format with encoded attributes (vertex_descriptor is limited to floats)
+// Quantized positions are stored in [0;1] over the mesh bounds, use GetPositionDequantization() as part of the model matrix
+struct vertex_layout
+{
+    int Stride;
+    vertex_attribute_format PositionFormat;
+    int PositionOffset;
+    vertex_attribute_format NormalFormat;
+    int NormalOffset;
+    vertex_attribute_format UVFormat;
+    int UVOffset;
+};
+
+// Error introduced by an encoding (max and mean over all vertices)
+struct vertex_encoding_error
+{
+    float PositionMax;  // Distance in mesh units
+    float PositionMean;
+    float NormalMax;    // Angle in degrees
+    float NormalMean;
+    float UVMax;        // Distance in texture units
+    float UVMean;
+};
+
+namespace Mesh
+{
+
+// Attributes are packed in Position, Normal, UV order (4 bytes aligned)
+// Float formats everywhere give the vertex_full layout
+vertex_layout MakeVertexLayout(vertex_attribute_format PositionFormat, vertex_attribute_format NormalFormat, vertex_attribute_format UVFormat);
+bool IsFullVertexLayout(const vertex_layout& Layout);
+const char* GetVertexFormatName(vertex_attribute_format Format);
+
+// Same as ConvertVertices with encoded attributes
+void* EncodeVertices(void* VerticesDst, const vertex_layout& Layout, const vertex_full* VerticesSrc, int Count, v3 BoundsMin, v3 BoundsMax);
+void DecodeVertices(vertex_full* VerticesDst, const vertex_layout& Layout, const void* VerticesSrc, int Count, v3 BoundsMin, v3 BoundsMax);
+
+// Map quantized positions back to mesh space (identity for float positions)
+mat4 GetPositionDequantization(const vertex_layout& Layout, v3 BoundsMin, v3 BoundsMax);
+
+vertex_encoding_error MeasureEncodingError(const vertex_layout& Layout, const vertex_full* Vertices, int Count, v3 BoundsMin, v3 BoundsMax);
+
+// Print size and error of each encoding for a .obj
+void ReportVertexEncodings(const char* Filename);
+}